@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/asio.hpp>
+
+#include <async_nats/async_nats.hpp>
+#include <async_nats/testing/server.hpp>
+
+// Benchmark suite modelled on `nats bench`. Every scenario runs against the server at $NATS_URL
+// or against the in-process async_nats::testing::Server if it is not set, and reports messages
+// and bytes per second. Use --benchmark_format=json or --benchmark_out=<file> for
+// machine-readable results.
+//
+// Throughput scenarios publish the messages in batches and every iteration waits for the whole
+// batch to complete, so the measured time includes the delivery of the last message.
+
+namespace
+{
+const async_nats::TokioRuntime* runtime = nullptr;
+std::string address;
+
+const std::vector<int64_t> payload_sizes {0, 16, 128, 1024, 16 * 1024, 128 * 1024, 1024 * 1024};
+const std::vector<int64_t> client_counts {1, 2, 4, 8, 16, 32};
+
+/// time for the server to register subscribtions before the first publish
+constexpr auto subscribe_delay = std::chrono::milliseconds(100);
+
+/// messages of one batch; batches are limited to 8 MiB so slow consumer limits are not hit
+std::size_t batch_size(std::size_t payload)
+{
+  return std::clamp<std::size_t>((8 * 1024 * 1024) / std::max<std::size_t>(payload, 1), 1, 1024);
+}
+
+async_nats::Connection connect(const std::string& name)
+{
+  async_nats::ConnectionOptions options;
+  options.name(name).address(address);
+  return async_nats::connect(*runtime, options, boost::asio::use_future).get();
+}
+
+/// Pending counts operations that are not completed yet
+class Pending
+{
+public:
+  void reset(std::size_t count) noexcept { count_.store(count, std::memory_order_relaxed); }
+
+  void done() noexcept
+  {
+    if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      count_.notify_one();
+    }
+  }
+
+  void wait() const noexcept
+  {
+    auto count = count_.load(std::memory_order_acquire);
+    while (count != 0) {
+      count_.wait(count, std::memory_order_acquire);
+      count = count_.load(std::memory_order_acquire);
+    }
+  }
+
+private:
+  std::atomic<std::size_t> count_ {0};
+};
+
+/// Consumer receives messages with Subscribtion::receive until the subscribtion is closed
+struct Consumer
+{
+  async_nats::Subscribtion sub;
+  Pending* pending = nullptr;
+
+  void next()
+  {
+    sub.receive(
+        [this](async_nats::Message msg)
+        {
+          if (!msg) {
+            return;
+          }
+          pending->done();
+          next();
+        });
+  }
+};
+
+/// Responder replies to every request with its payload
+struct Responder
+{
+  async_nats::Connection conn;
+  async_nats::Subscribtion sub;
+
+  void next()
+  {
+    sub.receive(
+        [this](async_nats::Message msg)
+        {
+          if (!msg) {
+            return;
+          }
+          if (const auto reply = msg.reply_to()) {
+            const auto data = msg.data();
+            conn.publish(*reply, boost::asio::const_buffer(data.data(), data.size()), [] {});
+          }
+          next();
+        });
+  }
+};
+
+void set_throughput(benchmark::State& state, std::size_t messages, std::size_t payload)
+{
+  const auto total = static_cast<int64_t>(messages) * state.iterations();
+  state.SetItemsProcessed(total);
+  state.SetBytesProcessed(total * static_cast<int64_t>(payload));
+}
+
+/// pub-only throughput of Connection::publish with `publishers` connections
+void publish_connection(benchmark::State& state)
+{
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+  const auto batch = batch_size(payload.size());
+  std::vector<async_nats::Connection> publishers;
+  for (int64_t i = 0; i < state.range(1); ++i) {
+    publishers.push_back(connect("bench_pub"));
+  }
+  const auto subject = publishers.front().new_mailbox();
+
+  Pending pending;
+  for (auto _ : state) {
+    pending.reset(batch);
+    for (std::size_t i = 0; i < batch; ++i) {
+      publishers[i % publishers.size()].publish(subject,
+                                                boost::asio::buffer(payload),
+                                                [&pending] { pending.done(); });
+    }
+    pending.wait();
+  }
+  set_throughput(state, batch, payload.size());
+}
+
+/// pub-only throughput of nonblocking::Sender with `publishers` connections
+void publish_sender(benchmark::State& state)
+{
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+  const auto batch = batch_size(payload.size());
+  std::vector<async_nats::Connection> publishers;
+  std::vector<async_nats::nonblocking::Sender> senders;
+  for (int64_t i = 0; i < state.range(1); ++i) {
+    publishers.push_back(connect("bench_pub"));
+  }
+  const std::string subject(std::string_view(publishers.front().new_mailbox()));
+  for (const auto& conn : publishers) {
+    senders.emplace_back(subject, conn, batch);
+  }
+
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < batch; ++i) {
+      senders[i % senders.size()].send(boost::asio::buffer(payload));
+    }
+    for (const auto& sender : senders) {
+      while (sender.statistics().queued != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  set_throughput(state, batch, payload.size());
+}
+
+/// pub/sub throughput of one publisher and `subscribers` subscribers on their own connections
+void pub_sub(benchmark::State& state)
+{
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+  const auto batch = batch_size(payload.size());
+  auto publisher = connect("bench_pub");
+  const auto subject = publisher.new_mailbox();
+
+  Pending pending;
+  std::vector<async_nats::Connection> connections;
+  std::vector<std::unique_ptr<Consumer>> consumers;
+  for (int64_t i = 0; i < state.range(1); ++i) {
+    connections.push_back(connect("bench_sub"));
+    auto sub = connections.back().subcribe(subject, boost::asio::use_future).get();
+    consumers.push_back(std::make_unique<Consumer>(Consumer {std::move(sub), &pending}));
+    consumers.back()->next();
+  }
+  std::this_thread::sleep_for(subscribe_delay);
+
+  for (auto _ : state) {
+    pending.reset(batch * (consumers.size() + 1));
+    for (std::size_t i = 0; i < batch; ++i) {
+      publisher.publish(subject, boost::asio::buffer(payload), [&pending] { pending.done(); });
+    }
+    pending.wait();
+  }
+  set_throughput(state, batch * consumers.size(), payload.size());
+}
+
+/// request/reply round-trip latency with an echo responder on another connection
+void request_reply(benchmark::State& state)
+{
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+  auto requester = connect("bench_req");
+  Responder responder {connect("bench_rep"), {}};
+  const auto subject = responder.conn.new_mailbox();
+  responder.sub = responder.conn.subcribe(subject, boost::asio::use_future).get();
+  responder.next();
+  std::this_thread::sleep_for(subscribe_delay);
+
+  for (auto _ : state) {
+    auto reply =
+        requester.request(subject, boost::asio::buffer(payload), boost::asio::use_future).get();
+    benchmark::DoNotOptimize(reply);
+  }
+
+  const auto latency = requester.request_latency();
+  state.counters["p50_us"] = static_cast<double>(latency.percentile(0.5).count());
+  state.counters["p99_us"] = static_cast<double>(latency.percentile(0.99).count());
+  set_throughput(state, 1, payload.size());
+}
+
+/// consumer throughput of Subscribtion::receive
+void receive_subscribtion(benchmark::State& state)
+{
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+  const auto batch = batch_size(payload.size());
+  auto publisher = connect("bench_pub");
+  const auto subject = publisher.new_mailbox();
+
+  Pending pending;
+  auto conn = connect("bench_sub");
+  Consumer consumer {conn.subcribe(subject, boost::asio::use_future).get(), &pending};
+  consumer.next();
+  std::this_thread::sleep_for(subscribe_delay);
+
+  for (auto _ : state) {
+    pending.reset(batch);
+    for (std::size_t i = 0; i < batch; ++i) {
+      publisher.publish(subject, boost::asio::buffer(payload), [] {});
+    }
+    pending.wait();
+  }
+  set_throughput(state, batch, payload.size());
+}
+
+/// consumer throughput of nonblocking::Receiver
+void receive_receiver(benchmark::State& state)
+{
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+  const auto batch = batch_size(payload.size());
+  auto publisher = connect("bench_pub");
+  const auto subject = publisher.new_mailbox();
+
+  auto conn = connect("bench_sub");
+  const async_nats::nonblocking::Receiver receiver(
+      conn.subcribe(subject, boost::asio::use_future).get(), batch);
+  std::this_thread::sleep_for(subscribe_delay);
+
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < batch; ++i) {
+      publisher.publish(subject, boost::asio::buffer(payload), [] {});
+    }
+    for (std::size_t i = 0; i < batch; ++i) {
+      auto msg = receiver.receive();
+      benchmark::DoNotOptimize(msg);
+    }
+  }
+  set_throughput(state, batch, payload.size());
+}
+
+/// mailbox creation through the C API compared with the inline C++ inbox
+void inbox_mailbox(benchmark::State& state)
+{
+  auto conn = connect("bench_inbox");
+  for (auto _ : state) {
+    auto mailbox = conn.new_mailbox();
+    benchmark::DoNotOptimize(mailbox);
+  }
+}
+
+void inbox_inline(benchmark::State& state)
+{
+  auto conn = connect("bench_inbox");
+  for (auto _ : state) {
+    auto inbox = conn.new_inbox();
+    benchmark::DoNotOptimize(inbox);
+  }
+}
+
+void register_benchmarks()
+{
+  benchmark::RegisterBenchmark("Publish/Connection", publish_connection)
+      ->ArgsProduct({payload_sizes, client_counts})
+      ->ArgNames({"payload", "publishers"})
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("Publish/Sender", publish_sender)
+      ->ArgsProduct({payload_sizes, client_counts})
+      ->ArgNames({"payload", "publishers"})
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("PubSub", pub_sub)
+      ->ArgsProduct({payload_sizes, client_counts})
+      ->ArgNames({"payload", "subscribers"})
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("RequestReply", request_reply)
+      ->ArgsProduct({payload_sizes})
+      ->ArgNames({"payload"})
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("Receive/Subscribtion", receive_subscribtion)
+      ->ArgsProduct({payload_sizes})
+      ->ArgNames({"payload"})
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("Receive/Receiver", receive_receiver)
+      ->ArgsProduct({payload_sizes})
+      ->ArgNames({"payload"})
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("Inbox/Mailbox", inbox_mailbox);
+  benchmark::RegisterBenchmark("Inbox/Inline", inbox_inline);
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int
+{
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  try {
+    std::unique_ptr<async_nats::testing::Server> server;
+    if (const char* url = std::getenv("NATS_URL")) {
+      address = url;
+    } else {
+      server = std::make_unique<async_nats::testing::Server>();
+      address = server->url();
+    }
+
+    const async_nats::TokioRuntime rt;
+    runtime = &rt;
+    register_benchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+  } catch (const async_nats::ConnectionError& e) {
+    std::cerr << "ConnectionError: type=" << e.kind() << "; text='" << e.what() << "'"
+              << std::endl;
+    return -1;
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: text='" << e.what() << "'" << std::endl;
+    return -2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,564 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <async_nats/async_nats.hpp>
+#include <async_nats/testing/server.hpp>
+
+// Open-loop load generator in the spirit of wrk2. Operations are issued at a fixed rate from a
+// schedule and their latency is measured from the intended send time, so the queueing delay is
+// not hidden when the client or the server falls behind (coordinated omission). The service time,
+// measured from the actual send time, is reported next to it.
+//
+// Publishes are measured end to end by a subscriber that reads the send times from the payload.
+// Requests are answered by an echo responder on the same subscriber connection.
+//
+// Usage: async_nats_loadgen [config_file] [key=value...]
+//
+// See loadgen.conf for the configuration keys. Without `url` and $NATS_URL the load is generated
+// against the in-process async_nats::testing::Server.
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+/// HdrHistogram records nanoseconds from 0 to 1 hour with 3 significant digits. It is thread safe.
+class HdrHistogram
+{
+public:
+  static constexpr unsigned sub_bucket_bits = 11;
+  static constexpr uint64_t sub_bucket_count = uint64_t {1} << sub_bucket_bits;
+  static constexpr uint64_t sub_bucket_half = sub_bucket_count / 2;
+  static constexpr uint64_t max_value = 3'600'000'000'000;
+
+  HdrHistogram()
+      : counts_(index(max_value) + 1)
+  {
+  }
+
+  void record(Clock::duration value) noexcept
+  {
+    const auto ns = std::clamp<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(value).count(), 0, max_value);
+    const auto v = static_cast<uint64_t>(ns);
+    counts_[index(v)].fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(1, std::memory_order_relaxed);
+    auto max = max_.load(std::memory_order_relaxed);
+    while (v > max && !max_.compare_exchange_weak(max, v, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t total() const noexcept { return total_.load(std::memory_order_relaxed); }
+
+  uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief percentile returns the highest value that is equivalent to the value at the
+   * percentile
+   *
+   * @param p - percentile within [0.0; 100.0]
+   */
+  uint64_t percentile(double p) const noexcept
+  {
+    const auto count = total();
+    if (count == 0) {
+      return 0;
+    }
+    const auto target = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= target) {
+        return std::min(highest_equivalent(i), max());
+      }
+    }
+    return max();
+  }
+
+  /**
+   * @brief write_hgrm writes the percentile distribution in milliseconds in the format of
+   * HdrHistogram that is accepted by its plotter
+   */
+  void write_hgrm(std::ostream& out) const
+  {
+    const auto count = total();
+    double sum = 0;
+    double sum_squares = 0;
+    std::size_t last = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      const auto c = static_cast<double>(counts_[i].load(std::memory_order_relaxed));
+      const auto v = static_cast<double>(lowest_equivalent(i) + highest_equivalent(i)) / 2;
+      sum += c * v;
+      sum_squares += c * v * v;
+      if (c != 0) {
+        last = i;
+      }
+    }
+    const auto mean = count == 0 ? 0.0 : sum / static_cast<double>(count);
+    const auto variance =
+        count == 0 ? 0.0 : std::max(sum_squares / static_cast<double>(count) - mean * mean, 0.0);
+
+    out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n" << std::fixed;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      const auto c = counts_[i].load(std::memory_order_relaxed);
+      if (c == 0) {
+        continue;
+      }
+      seen += c;
+      const auto q = static_cast<double>(seen) / static_cast<double>(count);
+      out << std::setw(12) << std::setprecision(3) << ms(highest_equivalent(i)) << ' '
+          << std::setw(14) << std::setprecision(12) << q << ' ' << std::setw(10) << seen;
+      if (seen != count) {
+        out << ' ' << std::setw(14) << std::setprecision(2) << 1.0 / (1.0 - q);
+      }
+      out << '\n';
+    }
+    out << std::setprecision(3) << "#[Mean    = " << std::setw(12) << mean / 1e6
+        << ", StdDeviation   = " << std::setw(12) << std::sqrt(variance) / 1e6 << "]\n"
+        << "#[Max     = " << std::setw(12) << ms(max()) << ", Total count    = " << std::setw(12)
+        << count << "]\n"
+        << "#[Buckets = " << std::setw(12) << bucket(last) + 1
+        << ", SubBuckets     = " << std::setw(12) << sub_bucket_count << "]\n";
+  }
+
+  static double ms(uint64_t ns) noexcept { return static_cast<double>(ns) / 1e6; }
+
+private:
+  static std::size_t index(uint64_t value) noexcept
+  {
+    const auto b = static_cast<unsigned>(std::bit_width(value | (sub_bucket_count - 1)))
+        - sub_bucket_bits;
+    return b * sub_bucket_half + (value >> b);
+  }
+
+  static unsigned bucket(std::size_t index) noexcept
+  {
+    return index < sub_bucket_count ? 0 : static_cast<unsigned>(index / sub_bucket_half - 1);
+  }
+
+  static uint64_t lowest_equivalent(std::size_t index) noexcept
+  {
+    const auto b = bucket(index);
+    return (index - b * sub_bucket_half) << b;
+  }
+
+  static uint64_t highest_equivalent(std::size_t index) noexcept
+  {
+    return lowest_equivalent(index) + (uint64_t {1} << bucket(index)) - 1;
+  }
+
+  std::vector<std::atomic<uint64_t>> counts_;
+  std::atomic<uint64_t> total_ {0};
+  std::atomic<uint64_t> max_ {0};
+};
+
+/// Weighted picks values with probabilities proportional to their weights
+template<class T>
+class Weighted
+{
+public:
+  void add(T value, double weight)
+  {
+    values_.push_back(std::move(value));
+    weights_.push_back(weight);
+    choice_ = std::discrete_distribution<std::size_t>(weights_.begin(), weights_.end());
+  }
+
+  void clear()
+  {
+    values_.clear();
+    weights_.clear();
+  }
+
+  const T& pick(std::mt19937_64& rng) { return values_[choice_(rng)]; }
+
+  const std::vector<T>& values() const noexcept { return values_; }
+
+private:
+  std::vector<T> values_;
+  std::vector<double> weights_;
+  std::discrete_distribution<std::size_t> choice_;
+};
+
+enum class Operation
+{
+  Publish,
+  Request,
+};
+
+/// send times are written to the beginning of every payload
+struct Stamp
+{
+  int64_t intended;
+  int64_t sent;
+};
+
+struct Config
+{
+  std::string url;
+  double rate = 1000;
+  std::chrono::seconds duration {10};
+  std::chrono::seconds drain {5};
+  std::size_t connections = 1;
+  bool use_sender = false;
+  Weighted<Operation> mix;
+  Weighted<std::string> subjects;
+  Weighted<std::size_t> payloads;
+  std::string hdr_output;
+  uint64_t seed = 1;
+};
+
+std::string trim(const std::string& s)
+{
+  const auto begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) {
+    return {};
+  }
+  return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+}
+
+/// parses the list of `value:weight` items; the weight is 1 if omitted
+template<class T, class F>
+void parse_weighted(Weighted<T>& out, const std::string& text, F parse)
+{
+  out.clear();
+  std::istringstream items(text);
+  std::string item;
+  while (items >> item) {
+    const auto colon = item.rfind(':');
+    const auto weight = colon == std::string::npos ? 1.0 : std::stod(item.substr(colon + 1));
+    out.add(parse(item.substr(0, colon)), weight);
+  }
+  if (out.values().empty()) {
+    throw std::invalid_argument("empty list: '" + text + "'");
+  }
+}
+
+void set_option(Config& config, const std::string& line)
+{
+  const auto text = trim(line.substr(0, line.find('#')));
+  if (text.empty()) {
+    return;
+  }
+  const auto eq = text.find('=');
+  if (eq == std::string::npos) {
+    throw std::invalid_argument("expected key = value: '" + text + "'");
+  }
+  const auto key = trim(text.substr(0, eq));
+  const auto value = trim(text.substr(eq + 1));
+
+  if (key == "url") {
+    config.url = value;
+  } else if (key == "rate") {
+    config.rate = std::stod(value);
+  } else if (key == "duration") {
+    config.duration = std::chrono::seconds(std::stoul(value));
+  } else if (key == "drain") {
+    config.drain = std::chrono::seconds(std::stoul(value));
+  } else if (key == "connections") {
+    config.connections = std::max<std::size_t>(std::stoul(value), 1);
+  } else if (key == "publisher") {
+    if (value != "connection" && value != "sender") {
+      throw std::invalid_argument("publisher must be connection or sender");
+    }
+    config.use_sender = value == "sender";
+  } else if (key == "mix") {
+    parse_weighted(config.mix,
+                   value,
+                   [](const std::string& op)
+                   {
+                     if (op == "publish") {
+                       return Operation::Publish;
+                     }
+                     if (op == "request") {
+                       return Operation::Request;
+                     }
+                     throw std::invalid_argument("unknown operation: '" + op + "'");
+                   });
+  } else if (key == "subjects") {
+    parse_weighted(config.subjects, value, [](const std::string& s) { return s; });
+  } else if (key == "payloads") {
+    parse_weighted(config.payloads,
+                   value,
+                   [](const std::string& s)
+                   { return std::max<std::size_t>(std::stoul(s), sizeof(Stamp)); });
+  } else if (key == "hdr_output") {
+    config.hdr_output = value;
+  } else if (key == "seed") {
+    config.seed = std::stoull(value);
+  } else {
+    throw std::invalid_argument("unknown key: '" + key + "'");
+  }
+}
+
+Config load(int argc, char** argv)
+{
+  Config config;
+  set_option(config, "mix = publish");
+  set_option(config, "subjects = loadgen.default");
+  set_option(config, "payloads = 128");
+  if (const char* url = std::getenv("NATS_URL")) {
+    config.url = url;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.find('=') != std::string::npos) {
+      set_option(config, arg);
+      continue;
+    }
+    std::ifstream file(arg);
+    if (!file) {
+      throw std::invalid_argument("can not open " + arg);
+    }
+    for (std::string line; std::getline(file, line);) {
+      set_option(config, line);
+    }
+  }
+  if (config.rate <= 0) {
+    throw std::invalid_argument("rate must be positive");
+  }
+  return config;
+}
+
+/// Recorder collects the results of one operation type
+struct Recorder
+{
+  explicit Recorder(const char* n) noexcept
+      : name(n)
+  {
+  }
+
+  const char* name;
+  HdrHistogram latency;
+  HdrHistogram service_time;
+  std::atomic<uint64_t> sent {0};
+  std::atomic<uint64_t> completed {0};
+  std::atomic<uint64_t> errors {0};
+
+  void complete(const Stamp& stamp) noexcept
+  {
+    const auto now = Clock::now().time_since_epoch();
+    latency.record(now - Clock::duration(stamp.intended));
+    service_time.record(now - Clock::duration(stamp.sent));
+    completed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool done() const noexcept
+  {
+    return completed.load(std::memory_order_relaxed) + errors.load(std::memory_order_relaxed)
+        >= sent.load(std::memory_order_relaxed);
+  }
+
+  void report(std::chrono::duration<double> elapsed) const
+  {
+    const auto count = completed.load();
+    if (sent.load() == 0) {
+      return;
+    }
+    std::cout << "  " << name << ": sent " << sent.load() << ", completed " << count
+              << ", errors " << errors.load() << ", " << std::fixed << std::setprecision(1)
+              << static_cast<double>(count) / elapsed.count() << " ops/s\n"
+              << "    percentile     latency  service time\n";
+    for (const double p : {50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 99.999, 100.0}) {
+      std::cout << "    " << std::setw(9) << std::setprecision(3) << p << "%" << std::setw(10)
+                << HdrHistogram::ms(latency.percentile(p)) << "ms" << std::setw(12)
+                << HdrHistogram::ms(service_time.percentile(p)) << "ms\n";
+    }
+  }
+
+  void write_hgrm(const std::string& prefix) const
+  {
+    if (prefix.empty() || sent.load() == 0) {
+      return;
+    }
+    std::ofstream latency_file(prefix + "_" + name + "_latency.hgrm");
+    latency.write_hgrm(latency_file);
+    std::ofstream service_file(prefix + "_" + name + "_service_time.hgrm");
+    service_time.write_hgrm(service_file);
+  }
+};
+
+/// Sink records published messages and echoes requests
+struct Sink
+{
+  async_nats::Connection& conn;
+  async_nats::Subscribtion sub;
+  std::shared_ptr<Recorder> publishes;
+
+  void next()
+  {
+    sub.receive(
+        [this](async_nats::Message msg)
+        {
+          if (!msg) {
+            return;
+          }
+          const auto data = msg.data();
+          if (const auto reply = msg.reply_to()) {
+            conn.publish(*reply,
+                         boost::asio::buffer(data.data(), data.size()),
+                         [m = std::move(msg)] {});
+          } else if (data.size() >= sizeof(Stamp)) {
+            Stamp stamp {};
+            std::memcpy(&stamp, data.data(), sizeof(stamp));
+            publishes->complete(stamp);
+          }
+          next();
+        });
+  }
+};
+
+async_nats::Connection connect(const async_nats::TokioRuntime& rt,
+                               const std::string& address,
+                               const std::string& name)
+{
+  async_nats::ConnectionOptions options;
+  options.name(name).address(address);
+  return async_nats::connect(rt, options, boost::asio::use_future).get();
+}
+
+void run(Config& config, const async_nats::TokioRuntime& rt)
+{
+  // completions may arrive after the drain period, so the handlers share the recorders
+  const auto publishes = std::make_shared<Recorder>("publish");
+  const auto requests = std::make_shared<Recorder>("request");
+
+  std::vector<async_nats::Connection> connections;
+  for (std::size_t i = 0; i < config.connections; ++i) {
+    connections.push_back(connect(rt, config.url, "loadgen_pub"));
+  }
+  std::vector<async_nats::nonblocking::Sender> senders;
+  if (config.use_sender) {
+    for (const auto& conn : connections) {
+      senders.emplace_back(config.subjects.values().front(), conn, 64 * 1024);
+    }
+  }
+
+  auto sink_conn = connect(rt, config.url, "loadgen_sink");
+  std::vector<std::unique_ptr<Sink>> sinks;
+  for (const auto& subject : std::set<std::string>(config.subjects.values().begin(),
+                                                   config.subjects.values().end()))
+  {
+    auto sub = sink_conn.subcribe(subject.c_str(), boost::asio::use_future).get();
+    sinks.push_back(std::make_unique<Sink>(Sink {sink_conn, std::move(sub), publishes}));
+    sinks.back()->next();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::cout << "async_nats_loadgen: " << config.rate << " ops/s for " << config.duration.count()
+            << "s, " << config.connections << " connections, "
+            << (config.use_sender ? "nonblocking::Sender" : "Connection::publish") << "\n";
+
+  std::mt19937_64 rng(config.seed);
+  std::vector<char> scratch;
+  const std::chrono::duration<double> interval(1.0 / config.rate);
+  const auto start = Clock::now();
+  const auto end = start + config.duration;
+  auto elapsed = Clock::duration::zero();
+  for (uint64_t i = 0;; ++i) {
+    const auto intended = start + std::chrono::duration_cast<Clock::duration>(interval * i);
+    if (intended >= end) {
+      elapsed = Clock::now() - start;
+      break;
+    }
+    if (Clock::now() < intended) {
+      std::this_thread::sleep_until(intended);
+    }
+
+    const auto op = config.mix.pick(rng);
+    const auto& subject = config.subjects.pick(rng);
+    const auto size = config.payloads.pick(rng);
+    auto& conn = connections[i % connections.size()];
+    const Stamp stamp {intended.time_since_epoch().count(),
+                       Clock::now().time_since_epoch().count()};
+
+    if (op == Operation::Publish && config.use_sender) {
+      scratch.resize(size);
+      std::memcpy(scratch.data(), &stamp, sizeof(stamp));
+      publishes->sent.fetch_add(1, std::memory_order_relaxed);
+      senders[i % senders.size()].send(subject.c_str(), boost::asio::buffer(scratch));
+      continue;
+    }
+
+    // the payload must stay valid until the completion
+    auto payload = std::make_unique<char[]>(size);
+    std::memcpy(payload.get(), &stamp, sizeof(stamp));
+    const auto data = boost::asio::buffer(payload.get(), size);
+    if (op == Operation::Publish) {
+      publishes->sent.fetch_add(1, std::memory_order_relaxed);
+      conn.publish(subject, data, [p = std::move(payload)] {});
+    } else {
+      requests->sent.fetch_add(1, std::memory_order_relaxed);
+      conn.request(subject.c_str(),
+                   data,
+                   [p = std::move(payload), stamp, requests](std::exception_ptr e,
+                                                             const async_nats::Message&)
+                   {
+                     if (e) {
+                       requests->errors.fetch_add(1, std::memory_order_relaxed);
+                     } else {
+                       requests->complete(stamp);
+                     }
+                   });
+    }
+  }
+
+  // operations that are not completed after the drain period are reported as lost
+  const auto drain_end = Clock::now() + config.drain;
+  while ((!publishes->done() || !requests->done()) && Clock::now() < drain_end) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  publishes->report(elapsed);
+  requests->report(elapsed);
+  publishes->write_hgrm(config.hdr_output);
+  requests->write_hgrm(config.hdr_output);
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int
+{
+  try {
+    auto config = load(argc, argv);
+    std::unique_ptr<async_nats::testing::Server> server;
+    if (config.url.empty()) {
+      server = std::make_unique<async_nats::testing::Server>();
+      config.url = server->url();
+    }
+
+    const async_nats::TokioRuntime rt;
+    run(config, rt);
+  } catch (const async_nats::ConnectionError& e) {
+    std::cerr << "ConnectionError: type=" << e.kind() << "; text='" << e.what() << "'"
+              << std::endl;
+    return -1;
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: text='" << e.what() << "'" << std::endl;
+    return -2;
+  }
+
+  return 0;
+}
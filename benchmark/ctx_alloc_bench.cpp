@@ -0,0 +1,187 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <boost/asio/bind_allocator.hpp>
+#include <boost/asio/recycling_allocator.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <async_nats/async_nats.hpp>
+#include <async_nats/testing/server.hpp>
+
+// Compares the allocation of completion contexts from detail::CtxPool, which is used for tokens
+// without an allocator of their own, with malloc and asio's recycling_allocator bound to the
+// token. Contexts are allocated on the benchmark thread and freed on another thread the same way
+// they are freed on the runtime threads.
+
+namespace
+{
+/// MallocAllocator allocates every context with malloc, as the library did before CtxPool
+template<class T>
+struct MallocAllocator
+{
+  using value_type = T;
+
+  MallocAllocator() noexcept = default;
+
+  template<class U>
+  explicit MallocAllocator(const MallocAllocator<U>& /*o*/) noexcept
+  {
+  }
+
+  T* allocate(std::size_t n)
+  {
+    if (void* p = std::malloc(n * sizeof(T))) {
+      return static_cast<T*>(p);
+    }
+    throw std::bad_alloc();
+  }
+
+  void deallocate(T* p, std::size_t /*n*/) noexcept { std::free(p); }
+
+  friend bool operator==(const MallocAllocator&, const MallocAllocator&) noexcept { return true; }
+
+  friend bool operator!=(const MallocAllocator&, const MallocAllocator&) noexcept { return false; }
+};
+
+/// Handler of the size of a typical callback with a few captures
+struct Handler
+{
+  std::array<void*, 4> captures {};
+
+  void operator()() const noexcept { benchmark::DoNotOptimize(captures); }
+};
+
+/// Remote frees contexts on its own thread, passed through a single-producer ring
+template<class CH>
+class Remote
+{
+public:
+  Remote()
+      : thread_([this] { run(); })
+  {
+  }
+
+  Remote(const Remote&) = delete;
+  Remote& operator=(const Remote&) = delete;
+
+  ~Remote()
+  {
+    push(nullptr);
+    thread_.join();
+  }
+
+  void push(CH* ctx) noexcept
+  {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    while (tail - head_.load(std::memory_order_acquire) == ring_.size()) {
+      std::this_thread::yield();
+    }
+    ring_[tail % ring_.size()] = ctx;
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+private:
+  void run() noexcept
+  {
+    for (;;) {
+      const auto head = head_.load(std::memory_order_relaxed);
+      while (tail_.load(std::memory_order_acquire) == head) {
+        std::this_thread::yield();
+      }
+      auto* ctx = ring_[head % ring_.size()];
+      head_.store(head + 1, std::memory_order_release);
+      if (ctx == nullptr) {
+        return;
+      }
+      (*ctx)();
+      async_nats::detail::deallocate_ctx(ctx);
+    }
+  }
+
+  std::array<CH*, 1024> ring_ {};
+  alignas(64) std::atomic<std::size_t> head_ {0};
+  alignas(64) std::atomic<std::size_t> tail_ {0};
+  std::thread thread_;
+};
+
+template<class MakeToken>
+void cross_thread(benchmark::State& state, MakeToken make_token)
+{
+  using CH = decltype(make_token());
+  Remote<CH> remote;
+  for (auto _ : state) {
+    remote.push(async_nats::detail::allocate_ctx(make_token()));
+  }
+}
+BENCHMARK_CAPTURE(cross_thread, ctx_pool, [] { return Handler {}; });
+BENCHMARK_CAPTURE(cross_thread,
+                  malloc,
+                  [] { return boost::asio::bind_allocator(MallocAllocator<void>(), Handler {}); });
+BENCHMARK_CAPTURE(cross_thread,
+                  recycling_allocator,
+                  []
+                  {
+                    return boost::asio::bind_allocator(boost::asio::recycling_allocator<void>(),
+                                                       Handler {});
+                  });
+
+template<class T>
+void same_thread(benchmark::State& state, T make_token)
+{
+  for (auto _ : state) {
+    auto* ctx = async_nats::detail::allocate_ctx(make_token());
+    benchmark::DoNotOptimize(ctx);
+    async_nats::detail::deallocate_ctx(ctx);
+  }
+}
+BENCHMARK_CAPTURE(same_thread, ctx_pool, [] { return Handler {}; });
+BENCHMARK_CAPTURE(same_thread,
+                  malloc,
+                  [] { return boost::asio::bind_allocator(MallocAllocator<void>(), Handler {}); });
+
+/// publish through the in-process test server with both kinds of contexts
+template<class MakeToken>
+void publish(benchmark::State& state, MakeToken make_token)
+{
+  static const async_nats::testing::Server server;
+  static const async_nats::TokioRuntime rt;
+  async_nats::ConnectionOptions options;
+  options.address(server.url());
+  auto conn = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  const std::string payload(16, 'x');
+  std::atomic<std::size_t> done {0};
+  std::size_t sent = 0;
+  for (auto _ : state) {
+    conn.publish("bench.ctx", boost::asio::buffer(payload), make_token(done));
+    ++sent;
+  }
+  while (done.load(std::memory_order_acquire) != sent) {
+    std::this_thread::yield();
+  }
+}
+BENCHMARK_CAPTURE(publish,
+                  ctx_pool,
+                  [](std::atomic<std::size_t>& done)
+                  { return [&done] { done.fetch_add(1, std::memory_order_release); }; })
+    ->UseRealTime();
+BENCHMARK_CAPTURE(publish,
+                  malloc,
+                  [](std::atomic<std::size_t>& done)
+                  {
+                    return boost::asio::bind_allocator(
+                        MallocAllocator<void>(),
+                        [&done] { done.fetch_add(1, std::memory_order_release); });
+                  })
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,217 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <async_nats/async_nats.hpp>
+
+// Measures the cost of the C API functions that can be called without a server on synthetic
+// messages: every function in isolation and the C++ accessors built on top of them. The
+// typical_handler benchmark reports the number of FFI calls per message if the library is built
+// with ASYNC_NATS_FFI_ACCOUNTING.
+//
+// The same functions are measured from Rust by `cargo bench --bench ffi`.
+
+namespace
+{
+const std::string payload(128, 'x');
+
+async_nats::Message synthetic_message()
+{
+  return async_nats::make_message("orders.eu.created",
+                                  payload,
+                                  "_INBOX.bench.reply",
+                                  {{"Nats-Msg-Id", "2f2a5c1e"},
+                                   {"Content-Type", "application/json"},
+                                   {"Trace", "00-4bf92f3577b34da6-01"}});
+}
+
+void message_new_delete(benchmark::State& state)
+{
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(synthetic_message());
+  }
+}
+BENCHMARK(message_new_delete);
+
+void message_clone_delete(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  for (auto _ : state) {
+    async_nats_message_delete(async_nats_message_clone(msg.get_raw()));
+  }
+}
+BENCHMARK(message_clone_delete);
+
+template<class F>
+void accessor(benchmark::State& state, F f)
+{
+  auto msg = synthetic_message();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(f(msg.get_raw()));
+  }
+}
+BENCHMARK_CAPTURE(accessor, message_topic, async_nats_message_topic);
+BENCHMARK_CAPTURE(accessor, message_data, async_nats_message_data);
+BENCHMARK_CAPTURE(accessor, message_reply_to, async_nats_message_reply_to);
+BENCHMARK_CAPTURE(accessor, message_has_headers, async_nats_message_has_headers);
+BENCHMARK_CAPTURE(accessor, message_status, async_nats_message_status);
+BENCHMARK_CAPTURE(accessor, message_description, async_nats_message_description);
+BENCHMARK_CAPTURE(accessor, message_length, async_nats_message_length);
+
+void message_to_string(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  for (auto _ : state) {
+    async_nats_owned_string_delete(async_nats_message_to_string(msg.get_raw()));
+  }
+}
+BENCHMARK(message_to_string);
+
+void header_iterator_free(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  for (auto _ : state) {
+    async_nats_message_header_iterator_free(async_nats_message_header_iterator(msg.get_raw()));
+  }
+}
+BENCHMARK(header_iterator_free);
+
+void header_get_free(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  const std::string_view name = "Content-Type";
+  for (auto _ : state) {
+    async_nats_message_header_iterator_free(
+        async_nats_message_get_header(msg.get_raw(), {name.data(), name.size()}));
+  }
+}
+BENCHMARK(header_get_free);
+
+void header_iterator_copy_free(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  auto* it = async_nats_message_get_header(msg.get_raw(), {"Trace", 5});
+  for (auto _ : state) {
+    async_nats_message_header_iterator_copy(it);
+    async_nats_message_header_iterator_free(it);
+  }
+  async_nats_message_header_iterator_free(it);
+}
+BENCHMARK(header_iterator_copy_free);
+
+void header_iterator_key(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  auto* it = async_nats_message_get_header(msg.get_raw(), {"Trace", 5});
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(async_nats_message_header_iterator_key(it));
+  }
+  async_nats_message_header_iterator_free(it);
+}
+BENCHMARK(header_iterator_key);
+
+void header_iterator_value_count(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  auto* it = async_nats_message_get_header(msg.get_raw(), {"Trace", 5});
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(async_nats_message_header_iterator_value_count(it));
+  }
+  async_nats_message_header_iterator_free(it);
+}
+BENCHMARK(header_iterator_value_count);
+
+void header_iterator_value_at(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  auto* it = async_nats_message_get_header(msg.get_raw(), {"Trace", 5});
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(async_nats_message_header_iterator_value_at(it, 0));
+  }
+  async_nats_message_header_iterator_free(it);
+}
+BENCHMARK(header_iterator_value_at);
+
+void abort_handle_new_delete(benchmark::State& state)
+{
+  for (auto _ : state) {
+    async_nats_abort_handle_delete(async_nats_abort_handle_new());
+  }
+}
+BENCHMARK(abort_handle_new_delete);
+
+void request_new_delete(benchmark::State& state)
+{
+  for (auto _ : state) {
+    async_nats_request_delete(async_nats_request_new());
+  }
+}
+BENCHMARK(request_new_delete);
+
+void connection_config_new_delete(benchmark::State& state)
+{
+  for (auto _ : state) {
+    async_nats_connection_config_delete(async_nats_connection_config_new());
+  }
+}
+BENCHMARK(connection_config_new_delete);
+
+/// C++ wrappers: every accessor is one FFI call, headers() clones the message
+void cpp_topic_data_reply(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(msg.topic());
+    benchmark::DoNotOptimize(msg.data());
+    benchmark::DoNotOptimize(msg.reply_to());
+  }
+}
+BENCHMARK(cpp_topic_data_reply);
+
+void cpp_headers_walk(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  for (auto _ : state) {
+    const auto headers = msg.headers();
+    for (auto it = headers.begin(); it != headers.end(); ++it) {
+      const auto [name, values] = *it;
+      benchmark::DoNotOptimize(name);
+      for (std::size_t i = 0; i < values.size(); ++i) {
+        benchmark::DoNotOptimize(values.at(i));
+      }
+    }
+  }
+}
+BENCHMARK(cpp_headers_walk);
+
+/// Handler that copies the message, reads its subject, payload, reply subject and one header
+void typical_handler(benchmark::State& state)
+{
+  auto msg = synthetic_message();
+  auto handle = [](async_nats::Message m)
+  {
+    benchmark::DoNotOptimize(m.topic());
+    benchmark::DoNotOptimize(m.data());
+    benchmark::DoNotOptimize(m.reply_to());
+    auto headers = m.headers();
+    if (headers) {
+      benchmark::DoNotOptimize(headers.get_header("Nats-Msg-Id"));
+    }
+  };
+
+#if defined(ASYNC_NATS_FFI_ACCOUNTING)
+  const async_nats::FfiCallCounter counter;
+#endif
+  for (auto _ : state) {
+    handle(msg);
+  }
+#if defined(ASYNC_NATS_FFI_ACCOUNTING)
+  state.counters["ffi_calls_per_message"] =
+      static_cast<double>(counter.calls()) / static_cast<double>(state.iterations());
+#endif
+}
+BENCHMARK(typical_handler);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+#include <boost/asio.hpp>
+
+#include <async_nats/async_nats.hpp>
+
+// Compares publish throughput of thread-per-core publishers that share one multi-thread runtime
+// and one connection with the same publishers using PerCoreClient.
+//
+// Usage: per_core_throughput [threads] [messages_per_thread] [payload_size] [address]
+
+namespace
+{
+constexpr std::size_t batch = 1024;
+
+void pin_current_thread([[maybe_unused]] std::size_t cpu)
+{
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+/// Runs `threads` pinned publishers and returns the total rate in messages per second
+double run(std::size_t threads,
+           std::size_t messages,
+           const std::string& payload,
+           const std::function<async_nats::Connection&(std::size_t)>& connection_for)
+{
+  std::latch ready(static_cast<std::ptrdiff_t>(threads) + 1);
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < threads; ++t) {
+    workers.emplace_back(
+        [&, t]()
+        {
+          pin_current_thread(t);
+          const std::string subject = "bench.core." + std::to_string(t);
+          ready.arrive_and_wait();
+
+          for (std::size_t sent = 0; sent < messages; sent += batch) {
+            const auto count = std::min(batch, messages - sent);
+            std::latch done(static_cast<std::ptrdiff_t>(count));
+            for (std::size_t i = 0; i < count; ++i) {
+              connection_for(t).publish(subject,
+                                        boost::asio::const_buffer(payload.data(), payload.size()),
+                                        [&done]() { done.count_down(); });
+            }
+            done.wait();
+          }
+        });
+  }
+
+  ready.arrive_and_wait();
+  const auto start = std::chrono::steady_clock::now();
+  for (auto& w : workers) {
+    w.join();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(threads * messages) / elapsed.count();
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int
+{
+  const std::size_t threads = std::max<std::size_t>(
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::thread::hardware_concurrency(), 1);
+  const std::size_t messages = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200'000;
+  const std::size_t payload_size = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 128;
+  const std::string address = argc > 4 ? argv[4] : "nats://localhost:4222";
+  const std::string payload(payload_size, 'x');
+
+  try {
+    async_nats::ConnectionOptions options;
+    options.name("per_core_throughput").address(address);
+
+    async_nats::TokioRuntimeConfig config;
+    config.thread_count(static_cast<uint32_t>(threads));
+
+    double shared_rate = 0;
+    {
+      const async_nats::TokioRuntime rt(config);
+      auto conn = async_nats::connect(rt, options, boost::asio::use_future).get();
+      shared_rate = run(threads,
+                        messages,
+                        payload,
+                        [&conn](std::size_t) -> async_nats::Connection& { return conn; });
+    }
+
+    double per_core_rate = 0;
+    {
+      std::vector<std::size_t> cpus(threads);
+      for (std::size_t i = 0; i < threads; ++i) {
+        cpus[i] = i;
+      }
+      async_nats::PerCoreClient client(config, cpus);
+      client.connect(options, boost::asio::use_future).get();
+      per_core_rate = run(threads,
+                          messages,
+                          payload,
+                          [&client](std::size_t) -> async_nats::Connection&
+                          { return client.local(); });
+    }
+
+    std::cout << std::setw(24) << "topology" << std::setw(16) << "msgs/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << std::setw(24) << "shared multi-thread" << std::setw(16) << shared_rate
+              << std::endl;
+    std::cout << std::setw(24) << "per-core" << std::setw(16) << per_core_rate << std::endl;
+    std::cout << std::setprecision(2) << "speedup: " << per_core_rate / shared_rate << "x"
+              << std::endl;
+  } catch (const async_nats::ConnectionError& e) {
+    std::cerr << "ConnectionError: type=" << e.kind() << "; text='" << e.what() << "'"
+              << std::endl;
+    return -1;
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: text='" << e.what() << "'" << std::endl;
+    return -2;
+  }
+
+  return 0;
+}
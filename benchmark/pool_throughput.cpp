@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <async_nats/async_nats.hpp>
+
+// Measures publish throughput of ConnectionPool with 1, 2, 4 and 8 connections.
+//
+// Usage: pool_throughput [messages] [payload_size] [address]
+
+namespace
+{
+struct PublishRun
+{
+  async_nats::ConnectionPool pool;
+  std::vector<std::string> subjects;
+  std::string payload;
+  std::size_t total = 0;
+  std::atomic<std::size_t> issued {0};
+  std::atomic<std::size_t> completed {0};
+  std::promise<void> done;
+
+  void publish_next()
+  {
+    const auto i = issued.fetch_add(1, std::memory_order_relaxed);
+    if (i >= total) {
+      return;
+    }
+
+    pool.publish(subjects[i % subjects.size()],
+                 boost::asio::const_buffer(payload.data(), payload.size()),
+                 [this]()
+                 {
+                   if (completed.fetch_add(1, std::memory_order_relaxed) + 1 == total) {
+                     done.set_value();
+                   } else {
+                     publish_next();
+                   }
+                 });
+  }
+};
+
+constexpr std::size_t subject_count = 64;
+constexpr std::size_t window = 256;
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int
+{
+  const std::size_t messages =
+      std::max<std::size_t>(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000, 1);
+  const std::size_t payload_size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 128;
+  const std::string address = argc > 3 ? argv[3] : "nats://localhost:4222";
+
+  try {
+    const async_nats::TokioRuntime rt;
+    async_nats::ConnectionOptions options;
+    options.name("pool_throughput").address(address);
+
+    std::cout << std::setw(12) << "connections" << std::setw(16) << "msgs/s" << std::setw(12)
+              << "MB/s" << std::setw(10) << "speedup" << std::endl;
+
+    double baseline = 0;
+    for (std::size_t size : {1, 2, 4, 8}) {
+      PublishRun run;
+      run.pool = async_nats::connect_pool(rt,
+                                          options,
+                                          size,
+                                          async_nats::ShardingPolicy::subject_hash,
+                                          boost::asio::use_future)
+                     .get();
+      for (std::size_t i = 0; i < subject_count; ++i) {
+        run.subjects.push_back("bench.pool." + std::to_string(i));
+      }
+      run.payload.assign(payload_size, 'x');
+      run.total = messages;
+
+      auto done = run.done.get_future();
+      const auto start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < window; ++i) {
+        run.publish_next();
+      }
+      done.wait();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      const double rate = static_cast<double>(messages) / elapsed.count();
+      if (baseline == 0) {
+        baseline = rate;
+      }
+      std::cout << std::setw(12) << size << std::setw(16) << std::fixed << std::setprecision(0)
+                << rate << std::setw(12) << std::setprecision(1)
+                << rate * static_cast<double>(payload_size) / 1e6 << std::setw(9)
+                << std::setprecision(2) << rate / baseline << "x" << std::endl;
+    }
+  } catch (const async_nats::ConnectionError& e) {
+    std::cerr << "ConnectionError: type=" << e.kind() << "; text='" << e.what() << "'"
+              << std::endl;
+    return -1;
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: text='" << e.what() << "'" << std::endl;
+    return -2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <boost/asio/system_executor.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <async_nats/async_nats.hpp>
+#include <async_nats/nonblocking/sender.hpp>
+#include <async_nats/testing/server.hpp>
+
+// Measures the durable spool of nonblocking::Sender: the throughput of appends while the
+// connection is down and the time it takes to publish the spooled messages once it is up.
+
+namespace
+{
+constexpr std::size_t messages = 100000;
+
+const async_nats::TokioRuntime& runtime()
+{
+  static const async_nats::TokioRuntime rt;
+  return rt;
+}
+
+std::filesystem::path spool_directory()
+{
+  return std::filesystem::temp_directory_path() / "async_nats_spool_bench";
+}
+
+/// Outage is a connection to a server that has been stopped
+class Outage
+{
+public:
+  Outage()
+  {
+    auto disconnected = std::make_shared<std::promise<void>>();
+    auto result = disconnected->get_future();
+    async_nats::ConnectionOptions options;
+    options.address(server_.url())
+        .on_event(boost::asio::system_executor(),
+                  [disconnected](const async_nats::ConnectionEvent& event) mutable
+                  {
+                    if (event.kind == AsyncNats_Event_Disconnected && disconnected) {
+                      disconnected->set_value();
+                      disconnected.reset();
+                    }
+                  });
+    conn_ = async_nats::connect(runtime(), options, boost::asio::use_future).get();
+    server_.stop();
+    result.wait();
+  }
+
+  const async_nats::Connection& connection() const noexcept { return *conn_; }
+
+private:
+  async_nats::testing::Server server_;
+  std::optional<async_nats::Connection> conn_;
+};
+
+/// append to the spool while the connection is down
+void append(benchmark::State& state)
+{
+  std::filesystem::remove_all(spool_directory());
+  const Outage outage;
+  const async_nats::nonblocking::Sender sender(
+      "bench.spool",
+      outage.connection(),
+      0,
+      async_nats::nonblocking::SpoolOptions(spool_directory().string()));
+
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+  for (auto _ : state) {
+    if (!sender.try_send(boost::asio::buffer(payload))) {
+      state.SkipWithError("spool is full");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  std::filesystem::remove_all(spool_directory());
+}
+BENCHMARK(append)->Arg(16)->Arg(256)->Arg(1024)->Iterations(messages);
+
+/// publish the messages spooled during an outage once a sender is created on a live connection
+void replay(benchmark::State& state)
+{
+  static const async_nats::testing::Server server;
+  async_nats::ConnectionOptions options;
+  options.address(server.url());
+  auto conn = async_nats::connect(runtime(), options, boost::asio::use_future).get();
+  const async_nats::nonblocking::SpoolOptions spool(spool_directory().string());
+  const std::string payload(static_cast<std::size_t>(state.range(0)), 'x');
+
+  for (auto _ : state) {
+    std::filesystem::remove_all(spool_directory());
+    {
+      const Outage outage;
+      const async_nats::nonblocking::Sender sender("bench.spool", outage.connection(), 0, spool);
+      for (std::size_t i = 0; i < messages; ++i) {
+        sender.try_send(boost::asio::buffer(payload));
+      }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const async_nats::nonblocking::Sender sender("bench.spool", conn, 0, spool);
+    while (sender.statistics().spool_pending != 0) {
+      std::this_thread::yield();
+    }
+    state.SetIterationTime(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  state.SetItemsProcessed(state.iterations() * messages);
+  state.SetBytesProcessed(state.iterations() * messages * state.range(0));
+  std::filesystem::remove_all(spool_directory());
+}
+BENCHMARK(replay)->Arg(16)->Arg(256)->Arg(1024)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,60 @@
+#include <iostream>
+
+#include <boost/asio.hpp>
+#include <boost/asio/co_spawn.hpp>
+
+#include <async_nats/async_nats.hpp>
+
+boost::asio::awaitable<void> example_task(async_nats::TokioRuntime& rt);
+
+auto main(int /*argc*/, char** /*argv*/) -> int
+{
+  try {
+    async_nats::TokioRuntime rt;
+    boost::asio::io_context ctx;
+
+    auto res = boost::asio::co_spawn(ctx, example_task(rt), boost::asio::use_future);
+    ctx.run();
+    res.get();
+  } catch (const async_nats::ConnectionError& e) {
+    std::cerr << "ConnectionError: type=" << e.kind() << "; text='" << e.what() << "'"
+              << std::endl;
+    return -1;
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: text='" << e.what() << "'" << std::endl;
+    return -2;
+  }
+
+  return 0;
+}
+
+boost::asio::awaitable<void> example_task(async_nats::TokioRuntime& rt)
+{
+  async_nats::ConnectionOptions options;
+  options.name("test_app").address("nats://localhost:4222");
+  async_nats::Connection conn =
+      co_await async_nats::connect(rt, options, boost::asio::use_awaitable);
+
+  // start a responder; the handler runs on the TokioRuntime thread and its result is the reply
+  async_nats::ServiceOptions service_options("greeter", "greet");
+  service_options.queue_group("greeters")
+      .max_in_flight(64)
+      .queue_budget(std::chrono::milliseconds(100));
+  async_nats::Service svc = co_await async_nats::start_service(
+      conn,
+      service_options,
+      [](const async_nats::Message& msg) { return std::string("Hello, ").append(msg.data()); },
+      boost::asio::use_awaitable);
+
+  // send a request
+  std::string request = "world";
+  async_nats::Message reply =
+      co_await conn.request("greet",
+                            boost::asio::const_buffer(request.data(), request.size()),
+                            boost::asio::use_awaitable);
+  std::cout << reply.data() << std::endl;
+
+  auto stats = svc.statistics();
+  std::cout << "requests=" << stats.requests << "; completed=" << stats.completed << std::endl;
+  co_return;
+}
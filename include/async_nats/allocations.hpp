@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include <async_nats/detail/capi.h>
+
+/**
+ * Allocation accounting counts the allocations made by the Rust library, including tokio and
+ * async-nats. It is compiled in only if ASYNC_NATS_ALLOC_ACCOUNTING is defined and the Rust
+ * library is built with the `alloc-accounting` feature (both are set by the
+ * ASYNC_NATS_ALLOC_ACCOUNTING CMake option).
+ *
+ * Allocations made by the C++ code are not counted.
+ */
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+namespace async_nats
+{
+/**
+ * @brief rust_allocations returns the number of allocations made by the Rust library on all
+ * threads since the start of the process
+ */
+inline uint64_t rust_allocations() noexcept
+{
+  return async_nats_allocations();
+}
+
+/**
+ * @brief The RustAllocationCounter class counts allocations made by the Rust library since its
+ * creation or the last reset
+ *
+ * The counter is shared by all threads, so background work of the runtime is counted as well.
+ * Divide the count by the number of operations of a long enough run to get a stable value.
+ */
+class RustAllocationCounter
+{
+public:
+  uint64_t allocations() const noexcept { return rust_allocations() - start_; }
+
+  void reset() noexcept { start_ = rust_allocations(); }
+
+private:
+  uint64_t start_ = rust_allocations();
+};
+
+}  // namespace async_nats
+#endif
@@ -2,9 +2,17 @@
 
 #include <string>
 
+#include <async_nats/allocations.hpp>
 #include <async_nats/connection.hpp>
+#include <async_nats/connection_pool.hpp>
+#include <async_nats/ffi_calls.hpp>
+#include <async_nats/io_context_driver.hpp>
 #include <async_nats/message.hpp>
+#include <async_nats/metrics.hpp>
 #include <async_nats/nonblocking/receiver.hpp>
 #include <async_nats/nonblocking/sender.hpp>
+#include <async_nats/per_core_client.hpp>
+#include <async_nats/service.hpp>
 #include <async_nats/subscribtion.hpp>
 #include <async_nats/tokio_runtime.hpp>
+#include <async_nats/trace.hpp>
@@ -1,22 +1,118 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include <boost/asio/async_result.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
 
+#include <async_nats/detail/abort.hpp>
 #include <async_nats/detail/helpers.hpp>
 #include <async_nats/errors.hpp>
+#include <async_nats/latency_histogram.hpp>
+#include <async_nats/nuid.hpp>
 #include <async_nats/owned_string.h>
 #include <async_nats/request.hpp>
 #include <async_nats/subscribtion.hpp>
 #include <async_nats/tokio_runtime.hpp>
+#include <async_nats/trace.hpp>
 
 namespace async_nats
 {
+/**
+ * @brief The ConnectionEvent struct describes a change of the connection state
+ */
+struct ConnectionEvent
+{
+  AsyncNatsConnectionEventKind kind;
+  /// subscribtion id of the slow consumer; zero for other events
+  std::uint64_t sid = 0;
+  /// error description of server and client errors; empty for other events
+  std::string description;
+};
+
+namespace detail
+{
+template<class Executor, class Handler>
+struct ConnectionEventHandler
+{
+  static void call(const AsyncNatsConnectionEvent* e, void* d)
+  {
+    auto* self = static_cast<ConnectionEventHandler*>(d);
+    ConnectionEvent event {
+        e->kind,
+        e->sid,
+        std::string(static_cast<const char*>(e->description.data), e->description.size)};
+    boost::asio::post(self->executor,
+                      [handler = self->handler, event = std::move(event)]() mutable
+                      { (*handler)(std::move(event)); });
+  }
+
+  static void drop(void* d) { delete static_cast<ConnectionEventHandler*>(d); }
+
+  Executor executor;
+  // shared with the posted invocations that may outlive the connection
+  std::shared_ptr<Handler> handler;
+};
+
+}  // namespace detail
+
+/**
+ * @brief The ReconnectBufferOptions class configures the reconnect buffer of a Connection
+ *
+ * Once the client reports a disconnect, publishes are kept in the buffer and their completion
+ * handlers are called as soon as the message is buffered or dropped. When the connection is
+ * restored the buffer is replayed in order in batches; new publishes are queued behind it until
+ * it is empty. Messages that are dropped are counted in ReconnectBufferStatistics.
+ */
+class ReconnectBufferOptions
+{
+public:
+  /**
+   * @brief max_messages sets maximum number of buffered messages. Default is 65536.
+   */
+  ReconnectBufferOptions& max_messages(uint64_t count) noexcept
+  {
+    config_.max_messages = count;
+    return *this;
+  }
+
+  /**
+   * @brief max_bytes sets maximum size of subjects and payloads of the buffered messages.
+   * Default is 64 MiB.
+   */
+  ReconnectBufferOptions& max_bytes(uint64_t bytes) noexcept
+  {
+    config_.max_bytes = bytes;
+    return *this;
+  }
+
+  /**
+   * @brief overflow sets what to do with a message that does not fit into the buffer. Default is
+   * AsyncNats_Overflow_DropNewest.
+   */
+  ReconnectBufferOptions& overflow(AsyncNatsReconnectOverflow overflow) noexcept
+  {
+    config_.overflow = overflow;
+    return *this;
+  }
+
+  const AsyncNatsReconnectBufferConfig& get_raw() const noexcept { return config_; }
+
+private:
+  AsyncNatsReconnectBufferConfig config_ {65536, 64 * 1024 * 1024, AsyncNats_Overflow_DropNewest};
+};
+
 class ConnectionOptions
 {
 public:
@@ -64,6 +160,75 @@ public:
     return *this;
   }
 
+  /**
+   * @brief response_cache enables the response cache for requests that are built with
+   * RequestBuilder::cache()
+   */
+  ConnectionOptions& response_cache(const ResponseCacheOptions& cache) noexcept
+  {
+    async_nats_connection_config_response_cache(options_, cache.get_raw());
+    return *this;
+  }
+
+  /**
+   * @brief reconnect_buffer enables the reconnect buffer for publishes, see
+   * ReconnectBufferOptions
+   */
+  ConnectionOptions& reconnect_buffer(const ReconnectBufferOptions& buffer) noexcept
+  {
+    async_nats_connection_config_reconnect_buffer(options_, buffer.get_raw());
+    return *this;
+  }
+
+  /**
+   * @brief latency_histograms enables built-in latency histograms of publishes, requests and
+   * message delivery
+   *
+   * Histograms are recorded inside the library with a few relaxed atomic increments per
+   * operation. Subscriptions of such connection pass every message through an additional task
+   * that stamps its arrival time.
+   */
+  ConnectionOptions& latency_histograms() noexcept
+  {
+    async_nats_connection_config_latency_histograms(options_);
+    return *this;
+  }
+
+  /**
+   * @brief latency_histogram_prefix enables latency histograms and records the round-trip time
+   * of requests with the subject prefix separately. A request is recorded to the first matching
+   * prefix in the order they are added.
+   */
+  ConnectionOptions& latency_histogram_prefix(const std::string& prefix) noexcept
+  {
+    async_nats_connection_config_latency_histogram_prefix(options_, prefix.c_str());
+    return *this;
+  }
+
+  /**
+   * @brief on_event sets the handler of connection events: disconnects, reconnects, lame duck
+   * mode, slow consumers and errors
+   *
+   * The handler has the `void(ConnectionEvent)` signature and is posted to the executor for every
+   * event. Events are posted in the order they happen; use a strand or a single-threaded
+   * executor to handle them in that order. The handler is shared by every connection that is
+   * created with these options and is destroyed after the last of them is closed.
+   */
+  template<class Executor, class Handler>
+  ConnectionOptions& on_event(const Executor& executor, Handler&& handler)
+  {
+    using H = std::decay_t<Handler>;
+    using EH = detail::ConnectionEventHandler<Executor, H>;
+
+    async_nats_connection_config_event_handler(
+        options_,
+        ::AsyncNatsConnectionEventHandler {
+            &EH::call,
+            &EH::drop,
+            new EH {executor, std::make_shared<H>(std::forward<Handler>(handler))}});
+    return *this;
+  }
+
   AsyncNatsConnetionParams* get_raw() noexcept { return options_; }
 
   const AsyncNatsConnetionParams* get_raw() const noexcept { return options_; }
@@ -231,6 +396,83 @@ private:
   mutable std::optional<OwnedString> str_;
 };
 
+class SubscribeError : public Exception
+{
+public:
+  explicit SubscribeError(const OwnedString& text)
+      : text_(static_cast<std::string_view>(text))
+  {
+  }
+
+  const char* what() const noexcept override { return text_.c_str(); }
+
+private:
+  std::string text_;
+};
+
+/**
+ * @brief The ConnectionStatistics struct contains traffic counters of the Connection
+ *
+ * Counters are monotonic since the connection was created; pending values are instant.
+ */
+struct ConnectionStatistics
+{
+  ConnectionStatistics() noexcept = default;
+
+  explicit ConnectionStatistics(const AsyncNatsConnectionStatistics& s) noexcept
+      : in_bytes(s.in_bytes)
+      , out_bytes(s.out_bytes)
+      , in_messages(s.in_messages)
+      , out_messages(s.out_messages)
+      , connects(s.connects)
+      , pending_messages(s.pending_messages)
+      , pending_bytes(s.pending_bytes)
+  {
+  }
+
+  /**
+   * @brief reconnects returns the number of connects after the initial one
+   */
+  uint64_t reconnects() const noexcept { return connects == 0 ? 0 : connects - 1; }
+
+  uint64_t in_bytes = 0;
+  uint64_t out_bytes = 0;
+  uint64_t in_messages = 0;
+  uint64_t out_messages = 0;
+  uint64_t connects = 0;
+  /// publishes accepted by the connection that are not handed over to the writer yet
+  uint64_t pending_messages = 0;
+  uint64_t pending_bytes = 0;
+};
+
+/**
+ * @brief The ReconnectBufferStatistics struct contains counters of the reconnect buffer
+ */
+struct ReconnectBufferStatistics
+{
+  ReconnectBufferStatistics() noexcept = default;
+
+  explicit ReconnectBufferStatistics(const AsyncNatsReconnectBufferStatistics& s) noexcept
+      : buffered_messages(s.buffered_messages)
+      , buffered_bytes(s.buffered_bytes)
+      , buffered(s.buffered)
+      , replayed(s.replayed)
+      , dropped(s.dropped)
+  {
+  }
+
+  /// messages in the buffer
+  uint64_t buffered_messages = 0;
+  /// size of subjects and payloads of the messages in the buffer
+  uint64_t buffered_bytes = 0;
+  /// messages put into the buffer
+  uint64_t buffered = 0;
+  /// messages replayed after reconnects
+  uint64_t replayed = 0;
+  /// messages dropped because the buffer was full
+  uint64_t dropped = 0;
+};
+
 /**
  * @brief The Connection class is used to access nats server
  *
@@ -244,11 +486,20 @@ public:
   Connection(AsyncNatsConnection* conn) noexcept
       : conn_(conn)
   {
+    if (conn_ != nullptr) {
+      const auto prefix = async_nats_connection_inbox_prefix(conn_);
+      inbox_prefix_ = std::string_view(static_cast<const char*>(prefix.data), prefix.size);
+    }
   }
 
-  Connection(const Connection& o) noexcept { conn_ = async_nats_connection_clone(o.get_raw()); }
+  Connection(const Connection& o) noexcept
+      : inbox_prefix_(o.inbox_prefix_)
+  {
+    conn_ = async_nats_connection_clone(o.get_raw());
+  }
 
   Connection(Connection&& o) noexcept
+      : inbox_prefix_(o.inbox_prefix_)
   {
     conn_ = o.conn_;
     o.conn_ = nullptr;
@@ -271,6 +522,7 @@ public:
       async_nats_connection_delete(conn_);
     }
     conn_ = async_nats_connection_clone(o.get_raw());
+    inbox_prefix_ = o.inbox_prefix_;
 
     return *this;
   }
@@ -286,6 +538,7 @@ public:
     }
     conn_ = o.conn_;
     o.conn_ = nullptr;
+    inbox_prefix_ = o.inbox_prefix_;
 
     return *this;
   }
@@ -304,6 +557,20 @@ public:
     return OwnedString(async_nats_connection_mailbox(conn_));
   }
 
+  /**
+   * @brief new_inbox function generates a new inbox with the inbox prefix of the connection
+   *
+   * Unlike new_mailbox() the inbox is generated in C++ by the Nuid of the current thread and
+   * stored inline, so no FFI calls and allocations are made.
+   */
+  Inbox new_inbox() const { return Inbox(inbox_prefix_); }
+
+  /**
+   * @brief inbox_prefix returns the prefix of the inboxes of the connection without the trailing
+   * dot
+   */
+  std::string_view inbox_prefix() const noexcept { return inbox_prefix_; }
+
   /**
    * @brief publish
    * @param subject
@@ -322,12 +589,14 @@ public:
       static auto f = [](void* ctx)
       {
         auto* c = static_cast<CH*>(ctx);
+        ASYNC_NATS_TRACE(AsyncNats_Trace_Handler, ctx, {});
         (*c)();
         detail::deallocate_ctx(c);
       };
 
       auto ctx = detail::allocate_ctx(std::move(token));
       const ::AsyncNatsPublishCallback cb {f, ctx};
+      ASYNC_NATS_TRACE(AsyncNats_Trace_Initiate, ctx, i_subject);
       async_nats_connection_publish_async(get_raw(),
                                           AsyncNatsSlice {i_subject.data(), i_subject.size()},
                                           AsyncNatsBorrowedMessage {i_data.data(), i_data.size()},
@@ -358,12 +627,14 @@ public:
       static auto f = [](void* ctx)
       {
         auto* c = static_cast<CH*>(ctx);
+        ASYNC_NATS_TRACE(AsyncNats_Trace_Handler, ctx, {});
         (*c)();
         detail::deallocate_ctx(c);
       };
 
       auto ctx = detail::allocate_ctx(std::move(token));
       const ::AsyncNatsPublishCallback cb {f, ctx};
+      ASYNC_NATS_TRACE(AsyncNats_Trace_Initiate, ctx, i_subject);
       async_nats_connection_publish_with_reply_async(
           get_raw(),
           AsyncNatsSlice {i_subject.data(), i_subject.size()},
@@ -378,6 +649,12 @@ public:
 
   /// @todo TODO: publish with headers and reply target
 
+  /**
+   * @brief subcribe creates a new subscribtion
+   *
+   * Supports per-operation cancellation. The result of the cancelled operation is an empty
+   * Subscribtion.
+   */
   template<class CompletionToken>
   auto subcribe(AsyncNatsAsyncString subject, CompletionToken&& completion_token)
   {
@@ -389,19 +666,28 @@ public:
       {
         /// @todo TODO: process error
         auto* c = static_cast<CH*>(ctx);
+        detail::clear_abort_handle(*c);
         (*c)(Subscribtion(sub));
         detail::deallocate_ctx(c);
       };
 
+      const auto* abort = detail::make_abort_handle(token);
       auto ctx = detail::allocate_ctx(std::move(token));
       const ::AsyncNatsSubscribeCallback cb {f, ctx};
-      async_nats_connection_subscribe_async(get_raw(), i_subject, cb);
+      async_nats_connection_subscribe_async(get_raw(), i_subject, abort, cb);
     };
 
     return boost::asio::async_initiate<CompletionToken, void(Subscribtion)>(
         init, completion_token, subject);
   }
 
+  /**
+   * @brief request sends a request and waits for the reply
+   *
+   * Supports per-operation cancellation. The cancelled request stops waiting for the reply and
+   * completes with boost::system::system_error(operation_aborted). Partial and total
+   * cancellation are honoured only before the request is sent.
+   */
   template<class CompletionToken>
   auto request(AsyncNatsAsyncString subject,
                boost::asio::const_buffer data,
@@ -414,7 +700,13 @@ public:
       static auto f = [](AsyncNatsMessage* msg, AsyncNatsRequestError* e, void* ctx)
       {
         auto* c = static_cast<CH*>(ctx);
-        if (!msg) {
+        detail::clear_abort_handle(*c);
+        ASYNC_NATS_TRACE(AsyncNats_Trace_Handler, ctx, {});
+        if (msg == nullptr && e == nullptr) {
+          (*c)(std::make_exception_ptr(
+                   boost::system::system_error(boost::asio::error::operation_aborted)),
+               Message());
+        } else if (!msg) {
           (*c)(std::make_exception_ptr(RequestError(e)), Message());
         } else {
           (*c)(nullptr, Message(msg));
@@ -423,10 +715,12 @@ public:
         detail::deallocate_ctx(c);
       };
 
+      const auto* abort = detail::make_abort_handle(token);
       auto ctx = detail::allocate_ctx(std::move(token));
       const ::AsyncNatsRequestCallback cb {f, ctx};
+      ASYNC_NATS_TRACE(AsyncNats_Trace_Initiate, ctx, i_subject);
       async_nats_connection_request_async(
-          conn_, i_subject, AsyncNatsBorrowedMessage {i_data.data(), i_data.size()}, cb);
+          conn_, i_subject, AsyncNatsBorrowedMessage {i_data.data(), i_data.size()}, abort, cb);
     };
 
     return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr, Message)>(
@@ -445,7 +739,13 @@ public:
       static auto f = [](AsyncNatsMessage* msg, AsyncNatsRequestError* e, void* ctx)
       {
         auto* c = static_cast<CH*>(ctx);
-        if (!msg) {
+        detail::clear_abort_handle(*c);
+        ASYNC_NATS_TRACE(AsyncNats_Trace_Handler, ctx, {});
+        if (msg == nullptr && e == nullptr) {
+          (*c)(std::make_exception_ptr(
+                   boost::system::system_error(boost::asio::error::operation_aborted)),
+               Message());
+        } else if (!msg) {
           (*c)(std::make_exception_ptr(RequestError(e)), Message());
         } else {
           (*c)(nullptr, Message(msg));
@@ -453,17 +753,171 @@ public:
         detail::deallocate_ctx(c);
       };
 
+      const auto* abort = detail::make_abort_handle(token);
       auto ctx = detail::allocate_ctx(std::move(token));
       const ::AsyncNatsRequestCallback cb {f, ctx};
-      async_nats_connection_send_request_async(conn_, i_subject, req_builder.release(), cb);
+      ASYNC_NATS_TRACE(AsyncNats_Trace_Initiate, ctx, i_subject);
+      async_nats_connection_send_request_async(
+          conn_, i_subject, req_builder.release(), abort, cb);
     };
 
     return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr, Message)>(
         init, completion_token, subject, std::move(req));
   }
 
+  /**
+   * @brief request sends a request and sends a duplicate according to the hedge policy if the
+   * reply is slow
+   */
+  template<class CompletionToken>
+  auto request(AsyncNatsAsyncString subject,
+               boost::asio::const_buffer data,
+               const HedgePolicy& hedge,
+               CompletionToken&& completion_token)
+  {
+    return request(subject,
+                   std::move(RequestBuilder().data(data).hedge(hedge)),
+                   std::forward<CompletionToken>(completion_token));
+  }
+
+  /**
+   * @brief request_many sends a request that expects a stream of replies
+   *
+   * All replies are delivered to the resulting Subscribtion and can be received one by one or in
+   * batches. The result of this operation is either a Subscribtion or SubscribeError in
+   * std::exception_ptr. Supports per-operation cancellation.
+   *
+   * @param subject - subject to send the request to
+   * @param data - request payload. It is copied before the function returns
+   * @param options - conditions that finish the stream. They are copied
+   * @param token - asio completion token
+   */
+  template<class CompletionToken>
+  auto request_many(AsyncNatsAsyncString subject,
+                    boost::asio::const_buffer data,
+                    const RequestManyOptions& options,
+                    CompletionToken&& completion_token)
+  {
+    auto init = [this](auto token, auto i_subject, auto i_data, auto i_opts)
+    {
+      using CH = std::decay_t<decltype(token)>;
+
+      static auto f = [](AsyncNatsSubscribtion* sub, AsyncNatsOwnedString err, void* ctx)
+      {
+        auto* c = static_cast<CH*>(ctx);
+        detail::clear_abort_handle(*c);
+        if (sub != nullptr) {
+          (*c)(nullptr, Subscribtion(sub));
+        } else if (err != nullptr) {
+          (*c)(std::make_exception_ptr(SubscribeError(OwnedString(err))), Subscribtion());
+        } else {
+          (*c)(std::make_exception_ptr(
+                   boost::system::system_error(boost::asio::error::operation_aborted)),
+               Subscribtion());
+        }
+
+        detail::deallocate_ctx(c);
+      };
+
+      const auto* abort = detail::make_abort_handle(token);
+      auto ctx = detail::allocate_ctx(std::move(token));
+      const ::AsyncNatsSubscribeCallback cb {f, ctx};
+      async_nats_connection_request_many_async(
+          conn_,
+          i_subject,
+          AsyncNatsBorrowedMessage {i_data.data(), i_data.size()},
+          i_opts,
+          abort,
+          cb);
+    };
+
+    return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr, Subscribtion)>(
+        init, completion_token, subject, data, options.get_raw());
+  }
+
+  /**
+   * @brief statistics returns traffic counters of this connection
+   *
+   * The snapshot is lock-free and cheap enough to be taken frequently. Counters are shared
+   * between all copies of the connection.
+   */
+  ConnectionStatistics statistics() const noexcept
+  {
+    return ConnectionStatistics(async_nats_connection_statistics(conn_));
+  }
+
+  /**
+   * @brief publish_latency returns the histogram of time from the publish call to the message
+   * being handed over to the client writer
+   *
+   * The histogram is empty unless ConnectionOptions::latency_histograms() is enabled.
+   */
+  LatencyHistogram publish_latency() const noexcept
+  {
+    return LatencyHistogram(async_nats_connection_publish_latency(conn_));
+  }
+
+  /**
+   * @brief delivery_latency returns the histogram of time from the message arrival to the
+   * subscription to the receive completion
+   */
+  LatencyHistogram delivery_latency() const noexcept
+  {
+    return LatencyHistogram(async_nats_connection_delivery_latency(conn_));
+  }
+
+  /**
+   * @brief request_latency returns the request round-trip time histogram of the subject prefix
+   *
+   * @param prefix - one of the prefixes passed to ConnectionOptions::latency_histogram_prefix().
+   * Empty prefix selects requests that match no prefix
+   */
+  LatencyHistogram request_latency(std::string_view prefix = {}) const noexcept
+  {
+    return LatencyHistogram(async_nats_connection_request_latency(
+        conn_, AsyncNatsSlice {prefix.data(), prefix.size()}));
+  }
+
+  /**
+   * @brief request_latency_prefixes returns the prefixes passed to
+   * ConnectionOptions::latency_histogram_prefix() in the order they were added
+   *
+   * The views are valid while the connection or any of its copies exists.
+   */
+  std::vector<std::string_view> request_latency_prefixes() const
+  {
+    std::vector<std::string_view> prefixes(
+        async_nats_connection_request_latency_prefix_count(conn_));
+    for (std::size_t i = 0; i < prefixes.size(); ++i) {
+      const auto prefix = async_nats_connection_request_latency_prefix(conn_, i);
+      prefixes[i] = std::string_view(static_cast<const char*>(prefix.data), prefix.size);
+    }
+    return prefixes;
+  }
+
+  /**
+   * @brief request_statistics returns request counters of this connection
+   *
+   * Counters are shared between all copies of the connection.
+   */
+  RequestStatistics request_statistics() const noexcept
+  {
+    return RequestStatistics(async_nats_connection_request_statistics(conn_));
+  }
+
+  /**
+   * @brief reconnect_buffer_statistics returns counters of the reconnect buffer. All counters are
+   * zero unless ConnectionOptions::reconnect_buffer() is enabled.
+   */
+  ReconnectBufferStatistics reconnect_buffer_statistics() const noexcept
+  {
+    return ReconnectBufferStatistics(async_nats_connection_reconnect_buffer_statistics(conn_));
+  }
+
 private:
   AsyncNatsConnection* conn_ = nullptr;
+  /// owned by the connection state that is shared by all clones
+  std::string_view inbox_prefix_;
 };
 
 /**
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <async_nats/connection.hpp>
+#include <async_nats/tokio_runtime.hpp>
+
+namespace async_nats
+{
+/**
+ * @brief The ShardingPolicy enum selects the connection of the pool that sends a message
+ */
+enum class ShardingPolicy
+{
+  /// messages with the same subject are always sent by the same connection. Every publish is
+  /// sent independently, so only publishes that are awaited one after another keep their order
+  subject_hash,
+  /// messages are distributed evenly; no ordering guarantees between messages
+  round_robin,
+};
+
+/**
+ * @brief The ConnectionPool class keeps several connections to the same cluster
+ *
+ * Every connection has its own socket and writer task so the pool scales protocol encoding
+ * beyond a single core. Publishes are sharded according to the ShardingPolicy; subscriptions and
+ * requests are spread across the connections in round-robin order.
+ *
+ * Copies of the pool share the same connections.
+ *
+ * @threadsafe This class is thread safe
+ */
+class ConnectionPool
+{
+public:
+  ConnectionPool() noexcept = default;
+
+  /**
+   * @param connections - established connections. Must not be empty
+   * @param policy - publish sharding policy
+   */
+  explicit ConnectionPool(std::vector<Connection> connections,
+                          ShardingPolicy policy = ShardingPolicy::subject_hash)
+      : conns_(std::move(connections))
+      , policy_(policy)
+      , next_(std::make_shared<std::atomic<std::size_t>>(0))
+  {
+    assert(!conns_.empty() && "ConnectionPool requires at least one connection");
+  }
+
+  operator bool() const noexcept { return !conns_.empty(); }
+
+  std::size_t size() const noexcept { return conns_.size(); }
+
+  ShardingPolicy policy() const noexcept { return policy_; }
+
+  /**
+   * @brief connection returns the connection with the given index
+   */
+  const Connection& connection(std::size_t index) const noexcept
+  {
+    assert(index < conns_.size() && "Connection index is out of range");
+    return conns_[index];
+  }
+
+  /**
+   * @brief select returns index of the connection that publishes messages to the subject
+   */
+  std::size_t select(std::string_view subject) const noexcept
+  {
+    assert(!conns_.empty() && "ConnectionPool must be checked for null before usage");
+    if (policy_ == ShardingPolicy::subject_hash) {
+      return std::hash<std::string_view> {}(subject) % conns_.size();
+    }
+    return next();
+  }
+
+  /**
+   * @brief next returns index of the next connection in round-robin order
+   */
+  std::size_t next() const noexcept
+  {
+    assert(!conns_.empty() && "ConnectionPool must be checked for null before usage");
+    return next_->fetch_add(1, std::memory_order_relaxed) % conns_.size();
+  }
+
+  OwnedString new_mailbox() const noexcept { return conns_.front().new_mailbox(); }
+
+  template<class CompletionToken>
+  auto publish(std::string_view subject,
+               boost::asio::const_buffer data,
+               CompletionToken&& completion_token)
+  {
+    return conns_[select(subject)].publish(
+        subject, data, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto publish(std::string_view subject,
+               std::string_view reply_to,
+               boost::asio::const_buffer data,
+               CompletionToken&& completion_token)
+  {
+    return conns_[select(subject)].publish(
+        subject, reply_to, data, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto subcribe(AsyncNatsAsyncString subject, CompletionToken&& completion_token)
+  {
+    return conns_[next()].subcribe(subject, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto request(AsyncNatsAsyncString subject,
+               boost::asio::const_buffer data,
+               CompletionToken&& completion_token)
+  {
+    return conns_[next()].request(
+        subject, data, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto request(AsyncNatsAsyncString subject,
+               RequestBuilder&& req,
+               CompletionToken&& completion_token)
+  {
+    return conns_[next()].request(
+        subject, std::move(req), std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto request_many(AsyncNatsAsyncString subject,
+                    boost::asio::const_buffer data,
+                    const RequestManyOptions& options,
+                    CompletionToken&& completion_token)
+  {
+    return conns_[next()].request_many(
+        subject, data, options, std::forward<CompletionToken>(completion_token));
+  }
+
+private:
+  std::vector<Connection> conns_;
+  ShardingPolicy policy_ = ShardingPolicy::subject_hash;
+  std::shared_ptr<std::atomic<std::size_t>> next_;
+};
+
+namespace detail
+{
+template<class Handler>
+struct PoolConnectState
+{
+  PoolConnectState(Handler&& h, std::size_t size, ShardingPolicy p)
+      : handler(std::move(h))
+      , conns(size)
+      , remaining(size)
+      , policy(p)
+  {
+  }
+
+  void complete(std::size_t index, std::exception_ptr err, Connection conn)
+  {
+    {
+      std::lock_guard lock(mutex);
+      if (err && !error) {
+        error = err;
+      }
+      conns[index] = std::move(conn);
+      if (--remaining != 0) {
+        return;
+      }
+    }
+
+    if (error) {
+      handler(error, ConnectionPool());
+    } else {
+      handler(nullptr, ConnectionPool(std::move(conns), policy));
+    }
+  }
+
+  Handler handler;
+  std::mutex mutex;
+  std::vector<Connection> conns;
+  std::size_t remaining;
+  std::exception_ptr error;
+  ShardingPolicy policy;
+};
+
+}  // namespace detail
+
+/**
+ * @brief connect_pool establishes `size` connections concurrently
+ *
+ * The result of this operation is either a ConnectionPool or the first ConnectionError in
+ * std::exception_ptr. Connections that were established before the failure are closed.
+ *
+ * @param rt - Tokio runtime object
+ * @param options - connection options used for every connection
+ * @param size - number of connections. Must be positive
+ * @param policy - publish sharding policy
+ * @param token - asio completion token
+ *
+ * @note options must live until the very end of the asynchronous operation.
+ */
+template<class CompletionToken>
+auto connect_pool(const TokioRuntime& rt,
+                  const ConnectionOptions& options,
+                  std::size_t size,
+                  ShardingPolicy policy,
+                  CompletionToken&& completion_token)
+{
+  assert(size != 0 && "ConnectionPool requires at least one connection");
+
+  auto init = [](auto token,
+                 std::reference_wrapper<const TokioRuntime> i_rt,
+                 std::reference_wrapper<const ConnectionOptions> i_options,
+                 std::size_t i_size,
+                 ShardingPolicy i_policy)
+  {
+    using CH = std::decay_t<decltype(token)>;
+
+    auto state =
+        std::make_shared<detail::PoolConnectState<CH>>(std::move(token), i_size, i_policy);
+    for (std::size_t i = 0; i < i_size; ++i) {
+      connect(i_rt.get(),
+              i_options.get(),
+              [state, i](std::exception_ptr err, Connection conn)
+              { state->complete(i, err, std::move(conn)); });
+    }
+  };
+
+  return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr, ConnectionPool)>(
+      init, completion_token, std::cref(rt), std::cref(options), size, policy);
+}
+
+}  // namespace async_nats
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <boost/asio/associated_cancellation_slot.hpp>
+#include <boost/asio/cancellation_type.hpp>
+
+#include <async_nats/detail/capi.h>
+
+namespace async_nats::detail
+{
+/**
+ * @brief The AbortSlotHandler class is installed into asio cancellation slot and aborts the
+ * TokioRuntime task when cancellation is requested.
+ *
+ * Partial and total cancellation abort the task only before it had side effects (e.g. the
+ * request was handed over to the client). After that only terminal cancellation is honoured.
+ *
+ * The handler owns the abort handle. It is safe to destroy the handler at any time because the
+ * task holds its own reference to the shared state.
+ */
+class AbortSlotHandler
+{
+public:
+  AbortSlotHandler() noexcept
+      : handle_(async_nats_abort_handle_new())
+  {
+  }
+
+  AbortSlotHandler(const AbortSlotHandler&) = delete;
+  AbortSlotHandler& operator=(const AbortSlotHandler&) = delete;
+
+  ~AbortSlotHandler() noexcept { async_nats_abort_handle_delete(handle_); }
+
+  void operator()(boost::asio::cancellation_type type) const noexcept
+  {
+    if (!!(type
+           & (boost::asio::cancellation_type::terminal | boost::asio::cancellation_type::partial
+              | boost::asio::cancellation_type::total)))
+    {
+      async_nats_abort_handle_abort(handle_,
+                                    !!(type & boost::asio::cancellation_type::terminal));
+    }
+  }
+
+  const AsyncNatsAbortHandle* get_raw() const noexcept { return handle_; }
+
+private:
+  AsyncNatsAbortHandle* handle_;
+};
+
+/**
+ * @brief make_abort_handle connects the cancellation slot associated with the completion handler
+ * to the operation.
+ *
+ * Must be called before the handler is moved. Returns nullptr if the handler has no connected
+ * cancellation slot so the operation is not abortable.
+ */
+template<class Handler>
+inline const AsyncNatsAbortHandle* make_abort_handle(const Handler& handler)
+{
+  auto slot = boost::asio::get_associated_cancellation_slot(handler);
+  if (!slot.is_connected()) {
+    return nullptr;
+  }
+
+  return slot.template emplace<AbortSlotHandler>().get_raw();
+}
+
+/**
+ * @brief clear_abort_handle removes the AbortSlotHandler from the cancellation slot associated
+ * with the completion handler.
+ *
+ * Must be called before the handler is invoked so a reused slot does not keep the handler of the
+ * completed operation.
+ */
+template<class Handler>
+inline void clear_abort_handle(const Handler& handler) noexcept
+{
+  auto slot = boost::asio::get_associated_cancellation_slot(handler);
+  if (slot.is_connected()) {
+    slot.clear();
+  }
+}
+
+}  // namespace async_nats::detail
@@ -13,6 +13,17 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+/**
+ * Number of buckets in the latency histogram
+ */
+#define ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS 464
+
+/**
+ * Number of buckets in the processing time histogram. Bucket `i` counts requests that
+ * took less than `2^i` microseconds (and at least `2^(i-1)`); the last bucket also
+ * counts everything slower.
+ */
+#define ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS 24
 
 typedef enum AsyncNatsConnectErrorKind
 {
@@ -46,6 +57,46 @@ typedef enum AsyncNatsConnectErrorKind
   AsyncNats_ConnectIo,
 } AsyncNatsConnectErrorKind;
 
+typedef enum AsyncNatsConnectionEventKind
+{
+  /**
+   * The connection to the server is established or restored
+   */
+  AsyncNats_Event_Connected,
+  /**
+   * The connection to the server is lost. The client reconnects automatically.
+   */
+  AsyncNats_Event_Disconnected,
+  /**
+   * The server is going to shut down soon and asks clients to move away
+   */
+  AsyncNats_Event_LameDuckMode,
+  /**
+   * The subscribtion `sid` does not keep up and its messages are dropped
+   */
+  AsyncNats_Event_SlowConsumer,
+  /**
+   * The server reported an error
+   */
+  AsyncNats_Event_ServerError,
+  /**
+   * The client failed to process the connection
+   */
+  AsyncNats_Event_ClientError,
+} AsyncNatsConnectionEventKind;
+
+typedef enum AsyncNatsReconnectOverflow
+{
+  /**
+   * The new message is dropped
+   */
+  AsyncNats_Overflow_DropNewest,
+  /**
+   * The oldest messages are dropped to make room for the new one
+   */
+  AsyncNats_Overflow_DropOldest,
+} AsyncNatsReconnectOverflow;
+
 typedef enum AsyncNatsRequestErrorKind
 {
   /**
@@ -63,6 +114,60 @@ typedef enum AsyncNatsRequestErrorKind
   AsyncNats_Request_Other,
 } AsyncNatsRequestErrorKind;
 
+typedef enum AsyncNatsRuntimeFlavor
+{
+  /**
+   * Tasks are executed by a pool of `thread_count` worker threads
+   */
+  AsyncNats_Runtime_MultiThread,
+  /**
+   * Tasks are executed by a single dedicated thread
+   */
+  AsyncNats_Runtime_CurrentThread,
+  /**
+   * Tasks are executed by the thread that calls `async_nats_tokio_runtime_poll`
+   * or `async_nats_tokio_runtime_poll_for`. Nothing happens between the calls.
+   */
+  AsyncNats_Runtime_CallerDriven,
+} AsyncNatsRuntimeFlavor;
+
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+/**
+ * Stage of the operation at which the trace event is fired
+ */
+typedef enum AsyncNatsTraceStage
+{
+  /**
+   * The operation is initiated by the C++ wrapper
+   */
+  AsyncNats_Trace_Initiate,
+  /**
+   * The FFI function of the operation is entered
+   */
+  AsyncNats_Trace_FfiEntry,
+  /**
+   * The tokio task of the operation starts running
+   */
+  AsyncNats_Trace_TaskStart,
+  /**
+   * The message is handed over to the writer of the connection. The writer
+   * flushes the socket for many messages at once so this is the last stage of
+   * a publish.
+   */
+  AsyncNats_Trace_Enqueue,
+  /**
+   * The message or the reply is received from the connection
+   */
+  AsyncNats_Trace_Receive,
+  /**
+   * The completion handler is about to be invoked by the C++ wrapper
+   */
+  AsyncNats_Trace_Handler,
+} AsyncNatsTraceStage;
+#endif
+
+typedef struct AsyncNatsAbortHandle AsyncNatsAbortHandle;
+
 typedef struct AsyncNatsConnectError AsyncNatsConnectError;
 
 typedef struct AsyncNatsConnection AsyncNatsConnection;
@@ -81,8 +186,18 @@ typedef struct AsyncNatsRequest AsyncNatsRequest;
 
 typedef struct AsyncNatsRequestError AsyncNatsRequestError;
 
+typedef struct AsyncNatsRequestManyOptions AsyncNatsRequestManyOptions;
+
+typedef struct AsyncNatsResponseCacheConfig AsyncNatsResponseCacheConfig;
+
 typedef struct AsyncNatsRuntimeConfig AsyncNatsRuntimeConfig;
 
+typedef struct AsyncNatsService AsyncNatsService;
+
+typedef struct AsyncNatsServiceConfig AsyncNatsServiceConfig;
+
+typedef struct AsyncNatsServiceRequest AsyncNatsServiceRequest;
+
 typedef struct AsyncNatsSubscribtion AsyncNatsSubscribtion;
 
 typedef struct AsyncNatsSubscribtionCancellationToken AsyncNatsSubscribtionCancellationToken;
@@ -141,22 +256,464 @@ typedef struct AsyncNatsRequestCallback
   void *_1;
 } AsyncNatsRequestCallback;
 
+typedef struct AsyncNatsRequestStatistics
+{
+  /**
+   * Total number of requests sent by the user
+   */
+  uint64_t requests;
+  /**
+   * Number of requests that sent a hedged duplicate
+   */
+  uint64_t hedged;
+  /**
+   * Number of hedged requests where the duplicate replied first
+   */
+  uint64_t hedge_wins;
+  /**
+   * Number of requests that joined an identical request in flight instead of
+   * sending their own
+   */
+  uint64_t coalesced;
+  /**
+   * Number of cacheable requests served from the response cache
+   */
+  uint64_t cache_hits;
+  /**
+   * Number of cacheable requests that were sent to the server
+   */
+  uint64_t cache_misses;
+} AsyncNatsRequestStatistics;
+
 typedef struct AsyncNatsSubscribeCallback
 {
   void (*_0)(struct AsyncNatsSubscribtion *sub, AsyncNatsOwnedString err, void *d);
   void *_1;
 } AsyncNatsSubscribeCallback;
 
+/**
+ * AsyncNatsServiceHandler is called for every accepted request.
+ *
+ * The handler is called on the TokioRuntime thread and must not block. The second
+ * function is called exactly once when the service is stopped and the handler is not
+ * going to be called anymore.
+ */
+typedef struct AsyncNatsServiceHandler
+{
+  void (*_0)(struct AsyncNatsServiceRequest *req, void *d);
+  void (*_1)(void *d);
+  void *_2;
+} AsyncNatsServiceHandler;
+
+typedef struct AsyncNatsServiceStartCallback
+{
+  void (*_0)(struct AsyncNatsService *svc, AsyncNatsOwnedString err, void *d);
+  void *_1;
+} AsyncNatsServiceStartCallback;
+
+typedef struct AsyncNatsServiceStatistics
+{
+  /**
+   * Number of requests received by the service
+   */
+  uint64_t requests;
+  /**
+   * Number of requests that were responded by the handler
+   */
+  uint64_t completed;
+  /**
+   * Number of requests that were dropped by the handler without a reply
+   */
+  uint64_t errors;
+  /**
+   * Number of requests that were rejected because of the queue budget
+   */
+  uint64_t shed;
+  /**
+   * Number of requests that are being processed by the handler right now
+   */
+  uint64_t in_flight;
+  /**
+   * Processing time histogram. See `ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS`
+   */
+  uint64_t processing_time_us[ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS];
+} AsyncNatsServiceStatistics;
+
 typedef struct AsyncNatsReceiveCallback
 {
   void (*_0)(struct AsyncNatsMessage *m, void *c);
   void *_1;
 } AsyncNatsReceiveCallback;
 
+typedef struct AsyncNatsReceiveBatchCallback
+{
+  void (*_0)(struct AsyncNatsMessage *const *msgs, size_t count, void *c);
+  void *_1;
+} AsyncNatsReceiveBatchCallback;
+
+/**
+ * Scheduler counters of the whole runtime.
+ *
+ * Tokio exposes them only when the library is built with `--cfg tokio_unstable`.
+ * Otherwise all fields are zero and `available` is false.
+ */
+typedef struct AsyncNatsRuntimeMetrics
+{
+  /**
+   * True if the library is built with runtime metrics support
+   */
+  bool available;
+  /**
+   * Number of worker threads
+   */
+  size_t workers;
+  /**
+   * Number of tasks scheduled from outside of the runtime
+   */
+  uint64_t remote_schedules;
+  /**
+   * Number of tasks waiting in the global queue
+   */
+  size_t global_queue_depth;
+  /**
+   * Number of threads in the blocking pool
+   */
+  size_t blocking_threads;
+  /**
+   * Number of idle threads in the blocking pool
+   */
+  size_t idle_blocking_threads;
+  /**
+   * Number of tasks waiting for a blocking pool thread
+   */
+  size_t blocking_queue_depth;
+  /**
+   * Number of runtime threads that could not be pinned to the configured CPUs.
+   * Collected regardless of `available`.
+   */
+  uint64_t affinity_failures;
+} AsyncNatsRuntimeMetrics;
+
+/**
+ * Scheduler counters of a single worker thread. Counters are monotonic since the
+ * runtime start; depths are instant values.
+ */
+typedef struct AsyncNatsWorkerMetrics
+{
+  /**
+   * Total time the worker spent polling tasks
+   */
+  uint64_t busy_time_us;
+  /**
+   * Number of task polls
+   */
+  uint64_t polls;
+  /**
+   * Number of tasks stolen from other workers
+   */
+  uint64_t steals;
+  /**
+   * Number of steal operations
+   */
+  uint64_t steal_operations;
+  /**
+   * Number of tasks scheduled from the worker thread
+   */
+  uint64_t local_schedules;
+  /**
+   * Number of times the local queue overflowed into the global queue
+   */
+  uint64_t overflows;
+  /**
+   * Number of times the worker parked
+   */
+  uint64_t parks;
+  /**
+   * Number of tasks waiting in the local queue
+   */
+  size_t local_queue_depth;
+} AsyncNatsWorkerMetrics;
+
+typedef struct AsyncNatsConnectionStatistics
+{
+  /**
+   * Number of bytes received from the server
+   */
+  uint64_t in_bytes;
+  /**
+   * Number of bytes sent to the server
+   */
+  uint64_t out_bytes;
+  /**
+   * Number of messages received from the server
+   */
+  uint64_t in_messages;
+  /**
+   * Number of messages sent to the server
+   */
+  uint64_t out_messages;
+  /**
+   * Number of successful connects including the initial one
+   */
+  uint64_t connects;
+  /**
+   * Number of publishes accepted by the connection and not handed over to the
+   * writer yet
+   */
+  uint64_t pending_messages;
+  /**
+   * Payload size of the pending publishes
+   */
+  uint64_t pending_bytes;
+} AsyncNatsConnectionStatistics;
+
+typedef struct AsyncNatsReconnectBufferConfig
+{
+  /**
+   * Maximum number of buffered messages
+   */
+  uint64_t max_messages;
+  /**
+   * Maximum size of subjects and payloads of the buffered messages
+   */
+  uint64_t max_bytes;
+  /**
+   * What to do with a message that does not fit into the buffer
+   */
+  enum AsyncNatsReconnectOverflow overflow;
+} AsyncNatsReconnectBufferConfig;
+
+typedef struct AsyncNatsReconnectBufferStatistics
+{
+  /**
+   * Number of messages in the buffer
+   */
+  uint64_t buffered_messages;
+  /**
+   * Size of subjects and payloads of the messages in the buffer
+   */
+  uint64_t buffered_bytes;
+  /**
+   * Total number of messages put into the buffer
+   */
+  uint64_t buffered;
+  /**
+   * Total number of messages replayed after a reconnect
+   */
+  uint64_t replayed;
+  /**
+   * Total number of messages dropped because the buffer was full
+   */
+  uint64_t dropped;
+} AsyncNatsReconnectBufferStatistics;
+
+/**
+ * Merged snapshot of the latency histogram. Bucket `i` counts samples within
+ * [lower_bound(i); lower_bound(i + 1)) microseconds where lower_bound is `i` for
+ * the first 16 buckets and `(16 + i % 16) << (i / 16 - 1)` for the rest.
+ */
+typedef struct AsyncNatsLatencyHistogram
+{
+  /**
+   * Number of samples
+   */
+  uint64_t count;
+  /**
+   * Sum of all samples
+   */
+  uint64_t sum_us;
+  /**
+   * The largest sample
+   */
+  uint64_t max_us;
+  /**
+   * Sample counts. See `ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS`
+   */
+  uint64_t buckets[ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS];
+} AsyncNatsLatencyHistogram;
+
+/**
+ * Connection event is only valid during the handler call
+ */
+typedef struct AsyncNatsConnectionEvent
+{
+  enum AsyncNatsConnectionEventKind kind;
+  /**
+   * Subscribtion id of the slow consumer; zero for other events
+   */
+  uint64_t sid;
+  /**
+   * Error description of server and client errors; empty for other events
+   */
+  struct AsyncNatsSlice description;
+} AsyncNatsConnectionEvent;
+
+/**
+ * AsyncNatsConnectionEventHandler is called for every connection event.
+ *
+ * The handler is called on the TokioRuntime thread and must not block. The second
+ * function is called exactly once when the config and every connection that was
+ * created with it are deleted.
+ */
+typedef struct AsyncNatsConnectionEventHandler
+{
+  void (*_0)(const struct AsyncNatsConnectionEvent *event, void *d);
+  void (*_1)(void *d);
+  void *_2;
+} AsyncNatsConnectionEventHandler;
+
+/**
+ * Header of the message created with `async_nats_message_new`
+ */
+typedef struct AsyncNatsHeader
+{
+  struct AsyncNatsSlice key;
+  struct AsyncNatsSlice value;
+} AsyncNatsHeader;
+
+/**
+ * Counters of messages that pass through the receiver queue
+ */
+typedef struct AsyncNatsNamedReceiverStatistics
+{
+  /**
+   * Messages that are received from the subscribtion
+   */
+  uint64_t received;
+  /**
+   * Messages that are dropped because the queue is full
+   */
+  uint64_t dropped;
+  /**
+   * Messages that are waiting in the queue
+   */
+  uint64_t queued;
+} AsyncNatsNamedReceiverStatistics;
+
+/**
+ * Counters of messages that pass through the sender queue
+ */
+typedef struct AsyncNatsNamedSenderStatistics
+{
+  /**
+   * Messages that are handed over to the connection
+   */
+  uint64_t sent;
+  /**
+   * Messages that are rejected by `try_send` because the queue is full
+   */
+  uint64_t rejected;
+  /**
+   * Messages that are enqueued by `send` beyond the queue capacity
+   */
+  uint64_t unbounded;
+  /**
+   * Messages that are waiting in the queue
+   */
+  uint64_t queued;
+  /**
+   * Messages that are written to the spool
+   */
+  uint64_t spooled;
+  /**
+   * Messages that are published from the spool
+   */
+  uint64_t spool_replayed;
+  /**
+   * Messages that are waiting in the spool, including the ones left by a
+   * previous process
+   */
+  uint64_t spool_pending;
+} AsyncNatsNamedSenderStatistics;
+
+typedef struct AsyncNatsSpoolConfig
+{
+  /**
+   * Directory of the segment files. It is created if it does not exist.
+   */
+  AsyncNatsBorrowedString directory;
+  /**
+   * Size of one segment file in bytes. The biggest message must fit into one
+   * segment.
+   */
+  uint64_t segment_size;
+  /**
+   * Number of segment files
+   */
+  uint64_t segments;
+} AsyncNatsSpoolConfig;
+
+/**
+ * Counters of the messages that are delivered to the application
+ */
+typedef struct AsyncNatsSubscribtionStatistics
+{
+  uint64_t messages;
+  /**
+   * Payload bytes
+   */
+  uint64_t bytes;
+} AsyncNatsSubscribtionStatistics;
+
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+/**
+ * Trace event is only valid during the hook call
+ */
+typedef struct AsyncNatsTraceEvent
+{
+  enum AsyncNatsTraceStage stage;
+  /**
+   * Identity of the operation. It is the completion context passed to the FFI
+   * function so every stage of one operation reports the same id. Ids are
+   * reused after the operation completes.
+   */
+  uint64_t id;
+  /**
+   * Monotonic time in nanoseconds since the first event of the process
+   */
+  uint64_t timestamp_ns;
+  /**
+   * Subject of the message. Empty if the stage does not know it.
+   */
+  struct AsyncNatsSlice subject;
+} AsyncNatsTraceEvent;
+#endif
+
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+/**
+ * Trace hook is called synchronously from the thread that fires the event so it
+ * must be thread safe and fast. Null function disables tracing.
+ */
+typedef struct AsyncNatsTraceHook
+{
+  void (*_0)(const struct AsyncNatsTraceEvent *event, void *ctx);
+  void *_1;
+} AsyncNatsTraceHook;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
 
+/**
+ * Aborts the operation the handle is bound to. The operation completes with the
+ * aborted status unless it has already completed. If `terminal` is false the
+ * operation is aborted only if it had no side effects yet.
+ */
+void async_nats_abort_handle_abort(const struct AsyncNatsAbortHandle *handle, bool terminal);
+
+void async_nats_abort_handle_delete(struct AsyncNatsAbortHandle *handle);
+
+struct AsyncNatsAbortHandle *async_nats_abort_handle_new(void);
+
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+/**
+ * Returns the number of allocations made by the Rust library on all threads
+ * since the start of the process. Reallocations are counted as allocations.
+ */
+uint64_t async_nats_allocations(void);
+#endif
+
 struct AsyncNatsConnection *async_nats_connection_clone(const struct AsyncNatsConnection *conn);
 
 void async_nats_connection_config_addr(struct AsyncNatsConnetionParams *cfg,
@@ -164,17 +721,56 @@ void async_nats_connection_config_addr(struct AsyncNatsConnetionParams *cfg,
 
 void async_nats_connection_config_delete(struct AsyncNatsConnetionParams *cfg);
 
+/**
+ * Sets the handler of connection events. The handler is shared by the config and
+ * every connection that is created with it. The previous handler is released.
+ */
+void async_nats_connection_config_event_handler(struct AsyncNatsConnetionParams *cfg,
+                                                struct AsyncNatsConnectionEventHandler handler);
+
+/**
+ * Enables latency histograms and records the round-trip time of requests with
+ * the subject prefix separately. A request is recorded to the first matching
+ * prefix in the order they are added.
+ */
+void async_nats_connection_config_latency_histogram_prefix(struct AsyncNatsConnetionParams *cfg,
+                                                           AsyncNatsBorrowedString prefix);
+
+/**
+ * Enables latency histograms of publishes, requests and message delivery
+ */
+void async_nats_connection_config_latency_histograms(struct AsyncNatsConnetionParams *cfg);
+
 void async_nats_connection_config_name(struct AsyncNatsConnetionParams *cfg,
                                        AsyncNatsBorrowedString name);
 
 struct AsyncNatsConnetionParams *async_nats_connection_config_new(void);
 
+/**
+ * Enables the reconnect buffer that keeps publishes while the connection is
+ * down and replays them in order once it is restored
+ */
+void async_nats_connection_config_reconnect_buffer(struct AsyncNatsConnetionParams *cfg,
+                                                   struct AsyncNatsReconnectBufferConfig config);
+
+/**
+ * Enables the response cache for cacheable requests. `cache` is copied.
+ */
+void async_nats_connection_config_response_cache(struct AsyncNatsConnetionParams *cfg,
+                                                 const struct AsyncNatsResponseCacheConfig *cache);
+
 void async_nats_connection_connect(const struct AsyncNatsTokioRuntime *rt,
                                    const struct AsyncNatsConnetionParams *cfg,
                                    struct AsyncNatsConnectCallback cb);
 
 void async_nats_connection_delete(struct AsyncNatsConnection *conn);
 
+/**
+ * Returns the histogram of time from the message arrival to the subscribtion to
+ * the receive callback. Empty if histograms are disabled.
+ */
+struct AsyncNatsLatencyHistogram async_nats_connection_delivery_latency(const struct AsyncNatsConnection *conn);
+
 struct AsyncNatsConnectError *async_nats_connection_error_clone(struct AsyncNatsConnectError *err);
 
 void async_nats_connection_error_delete(struct AsyncNatsConnectError *err);
@@ -183,6 +779,13 @@ AsyncNatsOwnedString async_nats_connection_error_describtion(const struct AsyncN
 
 enum AsyncNatsConnectErrorKind async_nats_connection_error_kind(const struct AsyncNatsConnectError *err);
 
+/**
+ * Returns the prefix of the inboxes created by the connection without the trailing dot.
+ *
+ * The slice is valid while the connection or any of its clones exists.
+ */
+struct AsyncNatsSlice async_nats_connection_inbox_prefix(const struct AsyncNatsConnection *conn);
+
 AsyncNatsOwnedString async_nats_connection_mailbox(struct AsyncNatsConnection *conn);
 
 /**
@@ -195,6 +798,12 @@ void async_nats_connection_publish_async(const struct AsyncNatsConnection *conn,
                                          AsyncNatsAsyncMessage message,
                                          struct AsyncNatsPublishCallback cb);
 
+/**
+ * Returns the histogram of time from the publish call to the message being
+ * handed over to the client writer. Empty if histograms are disabled.
+ */
+struct AsyncNatsLatencyHistogram async_nats_connection_publish_latency(const struct AsyncNatsConnection *conn);
+
 /**
  * Publish data asynchronously with reply topic.
  *
@@ -206,20 +815,93 @@ void async_nats_connection_publish_with_reply_async(const struct AsyncNatsConnec
                                                     AsyncNatsAsyncMessage message,
                                                     struct AsyncNatsPublishCallback cb);
 
+/**
+ * Returns counters of the reconnect buffer. All zeros if the buffer is disabled.
+ */
+struct AsyncNatsReconnectBufferStatistics async_nats_connection_reconnect_buffer_statistics(const struct AsyncNatsConnection *conn);
+
+/**
+ * `abort` is an optional handle that aborts the request. Pass null if the
+ * request is not abortable.
+ */
 void async_nats_connection_request_async(const struct AsyncNatsConnection *conn,
                                          AsyncNatsAsyncString topic,
                                          AsyncNatsAsyncMessage message,
+                                         const struct AsyncNatsAbortHandle *abort,
                                          struct AsyncNatsRequestCallback cb);
 
+/**
+ * Returns the request round-trip time histogram of the configured subject
+ * prefix. Empty prefix selects requests that match no prefix. Empty if
+ * histograms are disabled or the prefix is unknown.
+ */
+struct AsyncNatsLatencyHistogram async_nats_connection_request_latency(const struct AsyncNatsConnection *conn,
+                                                                       struct AsyncNatsSlice prefix);
+
+/**
+ * Returns the subject prefix of the request latency histogram `index` in the
+ * order they were configured. Empty if `index` is out of range.
+ *
+ * The slice is valid while the connection or any of its clones exists.
+ */
+struct AsyncNatsSlice async_nats_connection_request_latency_prefix(const struct AsyncNatsConnection *conn,
+                                                                   size_t index);
+
+/**
+ * Returns the number of subject prefixes with their own request latency
+ * histogram. Zero if histograms are disabled.
+ */
+size_t async_nats_connection_request_latency_prefix_count(const struct AsyncNatsConnection *conn);
+
+/**
+ * Sends a request that expects a stream of replies. All replies are received by
+ * the resulting subscribtion that is finished according to the options.
+ *
+ * `opts` is copied and may be null. `abort` is an optional handle that aborts
+ * the operation.
+ */
+void async_nats_connection_request_many_async(const struct AsyncNatsConnection *conn,
+                                              AsyncNatsAsyncString topic,
+                                              AsyncNatsAsyncMessage message,
+                                              const struct AsyncNatsRequestManyOptions *opts,
+                                              const struct AsyncNatsAbortHandle *abort,
+                                              struct AsyncNatsSubscribeCallback cb);
+
+struct AsyncNatsRequestStatistics async_nats_connection_request_statistics(const struct AsyncNatsConnection *conn);
+
+/**
+ * `abort` is an optional handle that aborts the request. Pass null if the
+ * request is not abortable.
+ */
 void async_nats_connection_send_request_async(const struct AsyncNatsConnection *conn,
                                               AsyncNatsAsyncString topic,
                                               struct AsyncNatsRequest *request,
+                                              const struct AsyncNatsAbortHandle *abort,
                                               struct AsyncNatsRequestCallback cb);
 
+/**
+ * Returns traffic counters of the connection. Counters are read with relaxed
+ * atomic loads without any locks.
+ */
+struct AsyncNatsConnectionStatistics async_nats_connection_statistics(const struct AsyncNatsConnection *conn);
+
+/**
+ * `abort` is an optional handle that aborts subscribing. Pass null if the
+ * operation is not abortable.
+ */
 void async_nats_connection_subscribe_async(const struct AsyncNatsConnection *conn,
                                            AsyncNatsAsyncString topic,
+                                           const struct AsyncNatsAbortHandle *abort,
                                            struct AsyncNatsSubscribeCallback cb);
 
+#if defined(ASYNC_NATS_FFI_ACCOUNTING)
+/**
+ * Returns the number of FFI calls made by the current thread. This call is
+ * not counted.
+ */
+uint64_t async_nats_ffi_calls(void);
+#endif
+
 /**
  * Increments reference counter
  */
@@ -267,6 +949,19 @@ uint64_t async_nats_message_header_iterator_value_count(struct AsyncNatsHeaderIt
  */
 uint64_t async_nats_message_length(const struct AsyncNatsMessage *msg);
 
+/**
+ * Creates a message that is not received from the server. It is used to test
+ * and benchmark message handlers without a connection. Values of headers with
+ * the same key are appended.
+ *
+ * Returns null if a header name is invalid
+ */
+struct AsyncNatsMessage *async_nats_message_new(struct AsyncNatsSlice topic,
+                                                struct AsyncNatsSlice reply_to,
+                                                struct AsyncNatsSlice data,
+                                                const struct AsyncNatsHeader *headers,
+                                                uint64_t headers_count);
+
 struct AsyncNatsSlice async_nats_message_reply_to(const struct AsyncNatsMessage *msg);
 
 /**
@@ -294,6 +989,8 @@ struct AsyncNatsNamedReceiver *async_nats_named_receiver_new(struct AsyncNatsSub
 
 struct AsyncNatsMessage *async_nats_named_receiver_recv(const struct AsyncNatsNamedReceiver *s);
 
+struct AsyncNatsNamedReceiverStatistics async_nats_named_receiver_statistics(const struct AsyncNatsNamedReceiver *recv);
+
 struct AsyncNatsMessage *async_nats_named_receiver_try_recv(const struct AsyncNatsNamedReceiver *s);
 
 struct AsyncNatsNamedSender *async_nats_named_sender_clone(const struct AsyncNatsNamedSender *sender);
@@ -304,16 +1001,47 @@ struct AsyncNatsNamedSender *async_nats_named_sender_new(AsyncNatsBorrowedString
                                                          const struct AsyncNatsConnection *conn,
                                                          unsigned long long capacity);
 
+/**
+ * Creates a sender with a durable spool. Returns null and sets `err` if the
+ * spool can not be opened.
+ */
+struct AsyncNatsNamedSender *async_nats_named_sender_new_spooled(AsyncNatsBorrowedString topic,
+                                                                 const struct AsyncNatsConnection *conn,
+                                                                 unsigned long long capacity,
+                                                                 struct AsyncNatsSpoolConfig spool,
+                                                                 AsyncNatsOwnedString *err);
+
 void async_nats_named_sender_send(const struct AsyncNatsNamedSender *sender,
                                   AsyncNatsBorrowedString topic,
                                   struct AsyncNatsBorrowedMessage data);
 
+struct AsyncNatsNamedSenderStatistics async_nats_named_sender_statistics(const struct AsyncNatsNamedSender *sender);
+
 bool async_nats_named_sender_try_send(const struct AsyncNatsNamedSender *sender,
                                       AsyncNatsBorrowedString topic,
                                       struct AsyncNatsBorrowedMessage data);
 
 void async_nats_owned_string_delete(AsyncNatsOwnedString s);
 
+/**
+ * Serve the request from the response cache of the connection if possible and
+ * cache the reply otherwise. Requests are cached by subject and payload.
+ */
+void async_nats_request_cache(struct AsyncNatsRequest *req);
+
+/**
+ * Share the reply with other coalescing requests to the same subject with the
+ * same payload that are in flight at the same time. Only the first request is
+ * sent and its options are used.
+ */
+void async_nats_request_coalesce(struct AsyncNatsRequest *req);
+
+/**
+ * Same as `async_nats_request_coalesce` but requests are matched by the subject
+ * and the `key` instead of the payload
+ */
+void async_nats_request_coalesce_key(struct AsyncNatsRequest *req, AsyncNatsAsyncString key);
+
 void async_nats_request_delete(struct AsyncNatsRequest *req);
 
 struct AsyncNatsRequestError *async_nats_request_error_clone(struct AsyncNatsRequestError *err);
@@ -324,14 +1052,142 @@ AsyncNatsOwnedString async_nats_request_error_describtion(const struct AsyncNats
 
 enum AsyncNatsRequestErrorKind async_nats_request_error_kind(const struct AsyncNatsRequestError *err);
 
+/**
+ * Send a duplicate request if there is no reply after `delay_us` microseconds.
+ * The first reply wins.
+ */
+void async_nats_request_hedge_after(struct AsyncNatsRequest *req, uint64_t delay_us);
+
+/**
+ * Send a duplicate request if there is no reply after the `percentile` ([0.0; 1.0])
+ * of the recent request latencies of the connection. `fallback_us` is used until
+ * enough latency samples are collected.
+ */
+void async_nats_request_hedge_percentile(struct AsyncNatsRequest *req,
+                                         double percentile,
+                                         uint64_t fallback_us);
+
 void async_nats_request_inbox(struct AsyncNatsRequest *req, AsyncNatsAsyncString inbox);
 
+void async_nats_request_many_options_delete(struct AsyncNatsRequestManyOptions *opts);
+
+/**
+ * Finish the stream if there are no replies for `timeout_us` microseconds
+ */
+void async_nats_request_many_options_idle_timeout(struct AsyncNatsRequestManyOptions *opts,
+                                                  uint64_t timeout_us);
+
+/**
+ * Finish the stream after receiving `count` replies. The stream is finished right
+ * away if `count` is 0.
+ */
+void async_nats_request_many_options_max_messages(struct AsyncNatsRequestManyOptions *opts,
+                                                  uint64_t count);
+
+struct AsyncNatsRequestManyOptions *async_nats_request_many_options_new(void);
+
+/**
+ * Finish the stream when a reply with empty payload is received
+ */
+void async_nats_request_many_options_sentinel(struct AsyncNatsRequestManyOptions *opts,
+                                              bool enabled);
+
 void async_nats_request_message(struct AsyncNatsRequest *req, AsyncNatsAsyncMessage message);
 
 struct AsyncNatsRequest *async_nats_request_new(void);
 
 void async_nats_request_timeout(struct AsyncNatsRequest *req, uint64_t timeout);
 
+/**
+ * Maximum number of cached replies
+ */
+void async_nats_response_cache_config_capacity(struct AsyncNatsResponseCacheConfig *cfg,
+                                               uint64_t capacity);
+
+/**
+ * TTL of subjects without their own TTL. Zero disables caching for them.
+ */
+void async_nats_response_cache_config_default_ttl(struct AsyncNatsResponseCacheConfig *cfg,
+                                                  uint64_t ttl_us);
+
+void async_nats_response_cache_config_delete(struct AsyncNatsResponseCacheConfig *cfg);
+
+/**
+ * Messages on this subject invalidate the cache. The payload is the subject
+ * whose replies are dropped; an empty payload drops all replies.
+ */
+void async_nats_response_cache_config_invalidation_subject(struct AsyncNatsResponseCacheConfig *cfg,
+                                                           AsyncNatsBorrowedString subject);
+
+struct AsyncNatsResponseCacheConfig *async_nats_response_cache_config_new(void);
+
+void async_nats_response_cache_config_subject_ttl(struct AsyncNatsResponseCacheConfig *cfg,
+                                                  AsyncNatsBorrowedString subject,
+                                                  uint64_t ttl_us);
+
+void async_nats_service_config_delete(struct AsyncNatsServiceConfig *cfg);
+
+/**
+ * Maximum number of requests that are passed to the handler and are not responded yet
+ */
+void async_nats_service_config_max_in_flight(struct AsyncNatsServiceConfig *cfg,
+                                             uint64_t max_in_flight);
+
+/**
+ * Maximum number of requests that wait in the queue for a free in-flight slot. Requests
+ * that arrive when the queue is full are rejected with `503` without calling the handler
+ */
+void async_nats_service_config_max_queued(struct AsyncNatsServiceConfig *cfg, uint64_t max_queued);
+
+struct AsyncNatsServiceConfig *async_nats_service_config_new(AsyncNatsBorrowedString name,
+                                                             AsyncNatsBorrowedString subject);
+
+/**
+ * Requests that waited in the queue for longer than `budget_us` microseconds are
+ * rejected with `503` without calling the handler
+ */
+void async_nats_service_config_queue_budget(struct AsyncNatsServiceConfig *cfg, uint64_t budget_us);
+
+void async_nats_service_config_queue_group(struct AsyncNatsServiceConfig *cfg,
+                                           AsyncNatsBorrowedString queue_group);
+
+/**
+ * Stops the service. Requests that are already passed to the handler can still be
+ * responded.
+ */
+void async_nats_service_delete(struct AsyncNatsService *svc);
+
+/**
+ * Deletes the request without sending a reply. The request is counted as an error.
+ */
+void async_nats_service_request_delete(struct AsyncNatsServiceRequest *req);
+
+/**
+ * Returns new reference to the request message
+ *
+ * `reply_to` of the returned message is always empty. Use
+ * `async_nats_service_request_reply_to` instead.
+ */
+struct AsyncNatsMessage *async_nats_service_request_message(struct AsyncNatsServiceRequest *req);
+
+struct AsyncNatsSlice async_nats_service_request_reply_to(const struct AsyncNatsServiceRequest *req);
+
+/**
+ * Sends the reply and deletes the request. Data is copied before the function returns.
+ */
+void async_nats_service_request_respond(struct AsyncNatsServiceRequest *req,
+                                        struct AsyncNatsBorrowedMessage data);
+
+/**
+ * Starts a new service. Config is copied and may be deleted right after the call.
+ */
+void async_nats_service_start_async(const struct AsyncNatsConnection *conn,
+                                    const struct AsyncNatsServiceConfig *cfg,
+                                    struct AsyncNatsServiceHandler handler,
+                                    struct AsyncNatsServiceStartCallback cb);
+
+struct AsyncNatsServiceStatistics async_nats_service_statistics(const struct AsyncNatsService *svc);
+
 void async_nats_subscribtion_cancellation_token_cancel(struct AsyncNatsSubscribtionCancellationToken *c);
 
 struct AsyncNatsSubscribtionCancellationToken *async_nats_subscribtion_cancellation_token_clone(struct AsyncNatsSubscribtionCancellationToken *c);
@@ -342,23 +1198,127 @@ void async_nats_subscribtion_delete(struct AsyncNatsSubscribtion *s);
 
 struct AsyncNatsSubscribtionCancellationToken *async_nats_subscribtion_get_cancellation_token(struct AsyncNatsSubscribtion *s);
 
+/**
+ * `abort` is an optional handle that aborts receiving. Messages are not lost when
+ * receiving is aborted and can be received by the next call.
+ */
 void async_nats_subscribtion_receive_async(struct AsyncNatsSubscribtion *s,
+                                           const struct AsyncNatsAbortHandle *abort,
                                            struct AsyncNatsReceiveCallback cb);
 
+/**
+ * Receives up to `max` messages at once. The callback owns every message but
+ * the array itself is only valid during the call. An empty batch means that the
+ * subscribtion is finished or the operation is aborted.
+ */
+void async_nats_subscribtion_receive_batch_async(struct AsyncNatsSubscribtion *s,
+                                                 size_t max,
+                                                 const struct AsyncNatsAbortHandle *abort,
+                                                 struct AsyncNatsReceiveBatchCallback cb);
+
+/**
+ * Can be called while a receive operation is in progress
+ */
+struct AsyncNatsSubscribtionStatistics async_nats_subscribtion_statistics(const struct AsyncNatsSubscribtion *s);
+
+/**
+ * Returns a copy of the config or null if `cfg` is null
+ */
+struct AsyncNatsTokioRuntimeConfig *async_nats_tokio_runtime_config_clone(const struct AsyncNatsTokioRuntimeConfig *cfg);
+
+/**
+ * Pins every runtime thread to the set of `count` CPUs. The array is copied.
+ * Supported on Linux only. Returns false and leaves the config unchanged if a
+ * CPU does not fit into the affinity mask of the system.
+ */
+bool async_nats_tokio_runtime_config_cpu_affinity(struct AsyncNatsTokioRuntimeConfig *cfg,
+                                                  const size_t *cpus,
+                                                  size_t count);
+
 void async_nats_tokio_runtime_config_delete(struct AsyncNatsTokioRuntimeConfig *cfg);
 
+/**
+ * Number of scheduler ticks after which the scheduler polls for external
+ * events (timers, I/O)
+ */
+void async_nats_tokio_runtime_config_event_interval(struct AsyncNatsTokioRuntimeConfig *cfg,
+                                                    uint32_t interval);
+
+void async_nats_tokio_runtime_config_flavor(struct AsyncNatsTokioRuntimeConfig *cfg,
+                                            enum AsyncNatsRuntimeFlavor flavor);
+
+/**
+ * Number of scheduler ticks after which the scheduler polls the global task
+ * queue. Returns false and leaves the config unchanged if `interval` is 0.
+ */
+bool async_nats_tokio_runtime_config_global_queue_interval(struct AsyncNatsTokioRuntimeConfig *cfg,
+                                                           uint32_t interval);
+
+/**
+ * Maximum number of threads spawned for blocking operations. Returns false and
+ * leaves the config unchanged if `count` is 0.
+ */
+bool async_nats_tokio_runtime_config_max_blocking_threads(struct AsyncNatsTokioRuntimeConfig *cfg,
+                                                          uint32_t count);
+
 struct AsyncNatsTokioRuntimeConfig *async_nats_tokio_runtime_config_new(void);
 
 void async_nats_tokio_runtime_config_thread_count(struct AsyncNatsTokioRuntimeConfig *cfg,
                                                   uint32_t thread_count);
 
+/**
+ * Time that idle blocking threads are kept alive
+ */
+void async_nats_tokio_runtime_config_thread_keep_alive(struct AsyncNatsTokioRuntimeConfig *cfg,
+                                                       uint64_t keep_alive_us);
+
 void async_nats_tokio_runtime_config_thread_name(struct AsyncNatsTokioRuntimeConfig *cfg,
                                                  AsyncNatsBorrowedString thread_name);
 
 void async_nats_tokio_runtime_delete(struct AsyncNatsTokioRuntime *runtime);
 
+struct AsyncNatsRuntimeMetrics async_nats_tokio_runtime_metrics(const struct AsyncNatsTokioRuntime *runtime);
+
 struct AsyncNatsTokioRuntime *async_nats_tokio_runtime_new(const struct AsyncNatsTokioRuntimeConfig *cfg);
 
+/**
+ * Runs tasks of the caller-driven runtime that are ready and polls I/O without
+ * waiting. Tasks woken by that I/O are run before returning. Must not be called
+ * from a callback that is invoked by the runtime.
+ */
+void async_nats_tokio_runtime_poll(const struct AsyncNatsTokioRuntime *runtime);
+
+/**
+ * Runs tasks of the caller-driven runtime for `timeout_us` microseconds. Must not
+ * be called from a callback that is invoked by the runtime.
+ */
+void async_nats_tokio_runtime_poll_for(const struct AsyncNatsTokioRuntime *runtime,
+                                       uint64_t timeout_us);
+
+/**
+ * Returns counters of the worker thread. `worker` must be less than
+ * `AsyncNatsRuntimeMetrics::workers`; zeroes are returned otherwise.
+ */
+struct AsyncNatsWorkerMetrics async_nats_tokio_runtime_worker_metrics(const struct AsyncNatsTokioRuntime *runtime,
+                                                                      size_t worker);
+
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+/**
+ * Fires the event of a stage that is observed by the caller of the library
+ */
+void async_nats_trace_emit(enum AsyncNatsTraceStage stage,
+                           uint64_t id,
+                           struct AsyncNatsSlice subject);
+#endif
+
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+/**
+ * Registers the trace hook. Hooks are expected to be set once at startup: the
+ * previous hook is never freed because other threads may still be calling it.
+ */
+void async_nats_trace_set_hook(struct AsyncNatsTraceHook hook);
+#endif
+
 void nats_runtime_config_free(struct AsyncNatsRuntimeConfig *cfg);
 
 struct AsyncNatsRuntimeConfig *nats_runtime_config_new(void);
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace async_nats::detail
+{
+/**
+ * @brief The CtxPool class caches the memory of completion contexts of the current thread
+ *
+ * Contexts are allocated by the thread that starts an operation and usually freed by a runtime
+ * thread. Blocks freed by the owner thread go to its free lists directly, blocks freed by other
+ * threads are pushed to the lock-free stack of the owner that is drained when a free list is
+ * empty. Pools are never deleted: the pool of a finished thread is handed over to the next new
+ * thread together with the blocks that are freed in the meantime.
+ */
+class CtxPool
+{
+  struct alignas(std::max_align_t) Block
+  {
+    CtxPool* owner;
+    Block* next;
+    std::size_t size_class;
+  };
+
+public:
+  static constexpr std::size_t min_block = 64;
+  static constexpr std::size_t size_classes = 4;
+  /// the largest context that is allocated from the pool
+  static constexpr std::size_t max_size = (min_block << (size_classes - 1)) - sizeof(Block);
+  /// blocks of one size class that are kept in the free list
+  static constexpr std::size_t max_cached = 1024;
+
+  template<std::size_t Size>
+  static void* allocate()
+  {
+    static_assert(Size <= max_size);
+    constexpr auto size_class = class_of(Size);
+
+    auto* pool = current();
+    if (pool == nullptr) {
+      pool = adopt();
+    }
+
+    auto* block = pool->free_[size_class];
+    if (block == nullptr) {
+      pool->drain_remote();
+      block = pool->free_[size_class];
+    }
+    if (block != nullptr) {
+      pool->free_[size_class] = block->next;
+      --pool->cached_[size_class];
+    } else {
+      block = static_cast<Block*>(::operator new(min_block << size_class));
+      block->owner = pool;
+      block->size_class = size_class;
+    }
+    return block + 1;
+  }
+
+  static void deallocate(void* p) noexcept
+  {
+    auto* block = static_cast<Block*>(p) - 1;
+    if (block->owner == current()) {
+      block->owner->push_local(block);
+    } else {
+      block->owner->push_remote(block);
+    }
+  }
+
+private:
+  /// Releaser returns the pool to the orphans when its thread exits
+  struct Releaser
+  {
+    Releaser() = default;
+    Releaser(const Releaser&) = delete;
+    Releaser& operator=(const Releaser&) = delete;
+
+    ~Releaser()
+    {
+      auto* pool = current();
+      current() = nullptr;
+      const std::lock_guard<std::mutex> lock(orphans_mutex());
+      orphans().push_back(pool);
+    }
+  };
+
+  CtxPool() = default;
+
+  static constexpr std::size_t class_of(std::size_t size) noexcept
+  {
+    std::size_t size_class = 0;
+    while ((min_block << size_class) - sizeof(Block) < size) {
+      ++size_class;
+    }
+    return size_class;
+  }
+
+  static CtxPool*& current() noexcept
+  {
+    static thread_local CtxPool* pool = nullptr;
+    return pool;
+  }
+
+  static std::mutex& orphans_mutex() noexcept
+  {
+    // leaked for the same reason as the orphans
+    static auto* mutex = new std::mutex();
+    return *mutex;
+  }
+
+  static std::vector<CtxPool*>& orphans() noexcept
+  {
+    // never destroyed because threads may exit after the static destructors
+    static auto* pools = new std::vector<CtxPool*>();
+    return *pools;
+  }
+
+  /// assigns a pool to the current thread, reusing the pool of a finished thread if possible
+  static CtxPool* adopt()
+  {
+    static thread_local Releaser releaser;
+    {
+      const std::lock_guard<std::mutex> lock(orphans_mutex());
+      if (!orphans().empty()) {
+        current() = orphans().back();
+        orphans().pop_back();
+        return current();
+      }
+    }
+    current() = new CtxPool();
+    return current();
+  }
+
+  void push_local(Block* block) noexcept
+  {
+    if (cached_[block->size_class] == max_cached) {
+      ::operator delete(block);
+      return;
+    }
+    block->next = free_[block->size_class];
+    free_[block->size_class] = block;
+    ++cached_[block->size_class];
+  }
+
+  void push_remote(Block* block) noexcept
+  {
+    auto* head = remote_.load(std::memory_order_relaxed);
+    do {
+      block->next = head;
+    } while (!remote_.compare_exchange_weak(
+        head, block, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  void drain_remote() noexcept
+  {
+    auto* block = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (block != nullptr) {
+      auto* next = block->next;
+      push_local(block);
+      block = next;
+    }
+  }
+
+  std::array<Block*, size_classes> free_ {};
+  std::array<std::size_t, size_classes> cached_ {};
+  alignas(64) std::atomic<Block*> remote_ {nullptr};
+};
+
+}  // namespace async_nats::detail
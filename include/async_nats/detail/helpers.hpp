@@ -1,22 +1,44 @@
 // NOLINTBEGIN
 #pragma once
 
+#include <memory>
 #include <type_traits>
 
+#include <async_nats/detail/ctx_pool.hpp>
 #include <boost/asio/associated_allocator.hpp>
 
 namespace async_nats::detail
 {
+template<class T>
+struct is_std_allocator : std::false_type
+{
+};
+
+template<class T>
+struct is_std_allocator<std::allocator<T>> : std::true_type
+{
+};
+
+/// Contexts of tokens without an allocator of their own are allocated from the CtxPool
+template<class CH, class Allocator>
+inline constexpr bool uses_ctx_pool = is_std_allocator<Allocator>::value
+    && sizeof(CH) <= CtxPool::max_size && alignof(CH) <= alignof(std::max_align_t);
+
 template<class Token>
 inline auto allocate_ctx(Token&& token)
 {
   using CH = std::decay_t<Token>;
   using AssotiatedAllocator = decltype(boost::asio::get_associated_allocator(token));
-  using CH_alloc_t =
-      typename std::allocator_traits<AssotiatedAllocator>::template rebind_alloc<CH>;
 
-  CH_alloc_t alloc(boost::asio::get_associated_allocator(token));
-  return new (alloc.allocate(1)) CH(std::move(token));  // NOLINT
+  if constexpr (uses_ctx_pool<CH, AssotiatedAllocator>) {
+    return new (CtxPool::allocate<sizeof(CH)>()) CH(std::move(token));  // NOLINT
+  } else {
+    using CH_alloc_t =
+        typename std::allocator_traits<AssotiatedAllocator>::template rebind_alloc<CH>;
+
+    CH_alloc_t alloc(boost::asio::get_associated_allocator(token));
+    return new (alloc.allocate(1)) CH(std::move(token));  // NOLINT
+  }
 }
 
 template<class Token>
@@ -24,11 +46,18 @@ inline void deallocate_ctx(Token* token)
 {
   using CH = std::decay_t<Token>;
   using AssotiatedAllocator = decltype(boost::asio::get_associated_allocator(*token));
-  using CH_alloc_t =
-      typename std::allocator_traits<AssotiatedAllocator>::template rebind_alloc<CH>;
 
-  CH_alloc_t alloc(boost::asio::get_associated_allocator(*token));
-  alloc.deallocate(token, 1);
+  if constexpr (uses_ctx_pool<CH, AssotiatedAllocator>) {
+    token->~CH();
+    CtxPool::deallocate(token);
+  } else {
+    using CH_alloc_t =
+        typename std::allocator_traits<AssotiatedAllocator>::template rebind_alloc<CH>;
+
+    CH_alloc_t alloc(boost::asio::get_associated_allocator(*token));
+    token->~CH();
+    alloc.deallocate(token, 1);
+  }
 }
 
 }  // namespace async_nats::detail
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include <async_nats/detail/capi.h>
+
+/**
+ * FFI call accounting counts the calls of the C API functions made by every thread. It is
+ * compiled in only if ASYNC_NATS_FFI_ACCOUNTING is defined and the Rust library is built with the
+ * `ffi-accounting` feature (both are set by the ASYNC_NATS_FFI_ACCOUNTING CMake option).
+ *
+ * Calls of the completion callbacks from the Rust library are not counted.
+ */
+#if defined(ASYNC_NATS_FFI_ACCOUNTING)
+namespace async_nats
+{
+/**
+ * @brief ffi_calls returns the number of C API calls made by the current thread
+ */
+inline uint64_t ffi_calls() noexcept
+{
+  return async_nats_ffi_calls();
+}
+
+/**
+ * @brief The FfiCallCounter class counts C API calls made by the current thread since its
+ * creation or the last reset
+ *
+ * It is used to see how many crossings a message handler makes, e.g.:
+ *
+ * @code
+ * async_nats::FfiCallCounter counter;
+ * handle(msg);
+ * std::cout << counter.calls() << " calls per message" << std::endl;
+ * @endcode
+ */
+class FfiCallCounter
+{
+public:
+  uint64_t calls() const noexcept { return ffi_calls() - start_; }
+
+  void reset() noexcept { start_ = ffi_calls(); }
+
+private:
+  uint64_t start_ = ffi_calls();
+};
+
+}  // namespace async_nats
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <utility>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <async_nats/tokio_runtime.hpp>
+
+namespace async_nats
+{
+/**
+ * @brief The IoContextDriver class runs the caller-driven TokioRuntime inside an asio executor
+ *
+ * The runtime is polled from the executor every `interval`. Zero interval reposts the poll as
+ * soon as it finishes so the executor never sleeps while the driver is running. Completion
+ * handlers of the runtime are invoked from the executor thread so the application does not need
+ * any synchronization between asio and NATS code.
+ *
+ * The driver stops when stop() is called or when the object is destroyed. The runtime must
+ * outlive the driver.
+ *
+ * @threadsafe This class is NOT thread safe and must be used from the executor thread
+ */
+class IoContextDriver
+{
+public:
+  IoContextDriver(boost::asio::any_io_executor executor,
+                  const TokioRuntime& rt,
+                  std::chrono::steady_clock::duration interval = {})
+      : state_(std::make_shared<State>(executor, rt.get_raw(), interval))
+  {
+    schedule(state_);
+  }
+
+  IoContextDriver(const IoContextDriver&) = delete;
+  IoContextDriver(IoContextDriver&&) noexcept = default;
+  IoContextDriver& operator=(const IoContextDriver&) = delete;
+
+  IoContextDriver& operator=(IoContextDriver&& o) noexcept
+  {
+    if (this == &o) {
+      return *this;
+    }
+
+    // the poll loop of the replaced driver must not outlive it
+    stop();
+    state_ = std::move(o.state_);
+
+    return *this;
+  }
+
+  ~IoContextDriver() noexcept { stop(); }
+
+  /**
+   * @brief stop cancels further polling. Scheduled poll is cancelled as well.
+   *
+   * Assigning another driver stops this one first.
+   */
+  void stop() noexcept
+  {
+    if (state_ == nullptr) {
+      return;
+    }
+
+    state_->stopped = true;
+    boost::system::error_code ec;
+    state_->timer.cancel(ec);
+  }
+
+private:
+  struct State
+  {
+    State(boost::asio::any_io_executor executor,
+          const AsyncNatsTokioRuntime* runtime,
+          std::chrono::steady_clock::duration poll_interval)
+        : timer(executor)
+        , rt(runtime)
+        , interval(poll_interval)
+    {
+    }
+
+    boost::asio::steady_timer timer;
+    const AsyncNatsTokioRuntime* rt;
+    std::chrono::steady_clock::duration interval;
+    bool stopped = false;
+  };
+
+  static void schedule(const std::shared_ptr<State>& state)
+  {
+    if (state->interval == std::chrono::steady_clock::duration::zero()) {
+      boost::asio::post(state->timer.get_executor(), [state]() { tick(state); });
+      return;
+    }
+
+    state->timer.expires_after(state->interval);
+    state->timer.async_wait(
+        [state](const boost::system::error_code& ec)
+        {
+          if (!ec) {
+            tick(state);
+          }
+        });
+  }
+
+  static void tick(const std::shared_ptr<State>& state)
+  {
+    if (state->stopped) {
+      return;
+    }
+
+    async_nats_tokio_runtime_poll(state->rt);
+
+    // handlers invoked by the poll may have stopped the driver
+    if (!state->stopped) {
+      schedule(state);
+    }
+  }
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace async_nats
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <async_nats/detail/capi.h>
+
+namespace async_nats
+{
+/**
+ * @brief The LatencyHistogram struct is a snapshot of a log-linear latency histogram
+ *
+ * Every power of two is split into 16 linear buckets so any reported value is within 6.25% of
+ * the recorded one.
+ */
+struct LatencyHistogram
+{
+  static constexpr std::size_t bucket_count = ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS;
+
+  LatencyHistogram() noexcept = default;
+
+  explicit LatencyHistogram(const AsyncNatsLatencyHistogram& h) noexcept
+      : count(h.count)
+      , sum(h.sum_us)
+      , max(h.max_us)
+  {
+    std::copy(std::begin(h.buckets), std::end(h.buckets), buckets.begin());
+  }
+
+  /**
+   * @brief bucket_lower_bound returns inclusive lower bound of the bucket. The upper bound is the
+   * lower bound of the next bucket.
+   */
+  static std::chrono::microseconds bucket_lower_bound(std::size_t bucket) noexcept
+  {
+    if (bucket < 16) {
+      return std::chrono::microseconds(bucket);
+    }
+    return std::chrono::microseconds(uint64_t(16 + bucket % 16) << (bucket / 16 - 1));
+  }
+
+  std::chrono::microseconds mean() const noexcept
+  {
+    return count == 0 ? std::chrono::microseconds(0) : sum / static_cast<int64_t>(count);
+  }
+
+  /**
+   * @brief percentile returns the upper bound of the bucket that contains the percentile
+   *
+   * @param p - percentile within [0.0; 1.0]
+   */
+  std::chrono::microseconds percentile(double p) const noexcept
+  {
+    if (count == 0) {
+      return std::chrono::microseconds(0);
+    }
+
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        return std::min(bucket_lower_bound(i + 1) - std::chrono::microseconds(1), max);
+      }
+    }
+    return max;
+  }
+
+  uint64_t count = 0;
+  std::chrono::microseconds sum {0};
+  std::chrono::microseconds max {0};
+  std::array<uint64_t, bucket_count> buckets {};
+};
+
+}  // namespace async_nats
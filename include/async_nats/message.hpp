@@ -1,11 +1,13 @@
 #pragma once
 
 #include <cassert>
+#include <initializer_list>
 #include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include <async_nats/detail/capi.h>
 #include <async_nats/owned_string.h>
@@ -387,6 +389,10 @@ public:
 
   operator bool() const noexcept { return message_ != nullptr; }
 
+  AsyncNatsMessage* get_raw() noexcept { return message_; }
+
+  const AsyncNatsMessage* get_raw() const noexcept { return message_; }
+
   std::string_view topic() const noexcept
   {
     assert(message_ != nullptr && "Message must be checked for null before usage");
@@ -449,4 +455,33 @@ private:
   AsyncNatsMessage* message_ = nullptr;
 };
 
+/// MessageHeader is a name and a value of the header
+using MessageHeader = std::pair<std::string_view, std::string_view>;
+
+/**
+ * @brief make_message creates a message that is not received from the server
+ *
+ * It is used to test and benchmark message handlers without a connection. Values of headers with
+ * the same name are appended. The result is an empty Message if a header name is invalid.
+ */
+inline Message make_message(std::string_view topic,
+                            std::string_view data,
+                            std::optional<std::string_view> reply_to = std::nullopt,
+                            std::initializer_list<MessageHeader> headers = {})
+{
+  std::vector<AsyncNatsHeader> raw_headers;
+  raw_headers.reserve(headers.size());
+  for (const auto& [name, value] : headers) {
+    raw_headers.push_back({{name.data(), name.size()}, {value.data(), value.size()}});
+  }
+
+  const AsyncNatsSlice reply = reply_to ? AsyncNatsSlice {reply_to->data(), reply_to->size()}
+                                        : AsyncNatsSlice {nullptr, 0};
+  return Message(async_nats_message_new({topic.data(), topic.size()},
+                                        reply,
+                                        {data.data(), data.size()},
+                                        raw_headers.data(),
+                                        raw_headers.size()));
+}
+
 }  // namespace async_nats
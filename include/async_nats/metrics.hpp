@@ -0,0 +1,677 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <async_nats/connection.hpp>
+#include <async_nats/latency_histogram.hpp>
+#include <async_nats/nonblocking/receiver.hpp>
+#include <async_nats/nonblocking/sender.hpp>
+#include <async_nats/subscribtion.hpp>
+#include <async_nats/tokio_runtime.hpp>
+
+namespace async_nats::metrics
+{
+/**
+ * @brief The Labeled struct names a metrics source. See labeled().
+ */
+template<class T>
+struct Labeled
+{
+  std::string_view name;
+  const T& source;
+};
+
+/**
+ * @brief labeled sets the `name` label of the source metrics
+ *
+ * Sources that are not labeled are named by their position in the argument list of
+ * render_openmetrics().
+ */
+template<class T>
+Labeled<T> labeled(std::string_view name, const T& source) noexcept
+{
+  return {name, source};
+}
+
+namespace detail
+{
+/// upper bounds of the rendered histogram buckets in microseconds
+inline constexpr std::array<uint64_t, 16> histogram_bounds_us {100,
+                                                               250,
+                                                               500,
+                                                               1'000,
+                                                               2'500,
+                                                               5'000,
+                                                               10'000,
+                                                               25'000,
+                                                               50'000,
+                                                               100'000,
+                                                               250'000,
+                                                               500'000,
+                                                               1'000'000,
+                                                               2'500'000,
+                                                               5'000'000,
+                                                               10'000'000};
+
+/// the same bounds in seconds
+inline constexpr std::array<std::string_view, 16> histogram_bounds_text {"0.0001",
+                                                                         "0.00025",
+                                                                         "0.0005",
+                                                                         "0.001",
+                                                                         "0.0025",
+                                                                         "0.005",
+                                                                         "0.01",
+                                                                         "0.025",
+                                                                         "0.05",
+                                                                         "0.1",
+                                                                         "0.25",
+                                                                         "0.5",
+                                                                         "1",
+                                                                         "2.5",
+                                                                         "5",
+                                                                         "10"};
+
+/// Label value is either the text or the number if the text is null
+struct Label
+{
+  std::string_view key;
+  std::string_view text;
+  std::size_t number = 0;
+};
+
+/// Seconds is a duration in microseconds that is rendered as seconds
+struct Seconds
+{
+  uint64_t us = 0;
+};
+
+/**
+ * @brief The OpenMetricsWriter class appends the OpenMetrics text format to a string without any
+ * intermediate allocations
+ */
+class OpenMetricsWriter
+{
+public:
+  explicit OpenMetricsWriter(std::string& out) noexcept
+      : out_(out)
+  {
+  }
+
+  void family(std::string_view name, std::string_view type, std::string_view help)
+  {
+    out_.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    out_.append("# HELP ").append(name).append(" ").append(help).append("\n");
+  }
+
+  template<class T>
+  void sample(std::string_view name,
+              std::string_view suffix,
+              std::initializer_list<Label> labels,
+              T value)
+  {
+    sample(name, suffix, labels.begin(), labels.end(), value);
+  }
+
+  template<class T>
+  void sample(std::string_view name,
+              std::string_view suffix,
+              const Label* first,
+              const Label* last,
+              T value)
+  {
+    out_.append(name).append(suffix);
+    if (first != last) {
+      out_.push_back('{');
+      for (const auto* label = first; label != last; ++label) {
+        if (label != first) {
+          out_.push_back(',');
+        }
+        out_.append(label->key).append("=\"");
+        if (label->text.data() == nullptr) {
+          number(label->number);
+        } else {
+          escaped(label->text);
+        }
+        out_.push_back('"');
+      }
+      out_.push_back('}');
+    }
+    out_.push_back(' ');
+    number(value);
+    out_.push_back('\n');
+  }
+
+  void histogram(std::string_view name,
+                 std::initializer_list<Label> labels,
+                 const LatencyHistogram& h)
+  {
+    // buckets are cumulative and count samples whose histogram bucket is entirely below the bound
+    std::array<uint64_t, histogram_bounds_us.size()> cumulative {};
+    uint64_t seen = 0;
+    std::size_t b = 0;
+    for (std::size_t i = 0; i < LatencyHistogram::bucket_count && b < cumulative.size(); ++i) {
+      const auto upper =
+          static_cast<uint64_t>(LatencyHistogram::bucket_lower_bound(i + 1).count());
+      while (b < cumulative.size() && upper > histogram_bounds_us[b]) {
+        cumulative[b++] = seen;
+      }
+      seen += h.buckets[i];
+    }
+    while (b < cumulative.size()) {
+      cumulative[b++] = seen;
+    }
+
+    // the labels of the histogram followed by `le`
+    assert(labels.size() < max_labels && "Too many histogram labels");
+    std::array<Label, max_labels> bucket {};
+    std::copy(labels.begin(), labels.end(), bucket.begin());
+    auto& le = bucket[labels.size()];
+    le.key = "le";
+    const auto* const first = bucket.data();
+    const auto* const last = first + labels.size() + 1;
+    for (std::size_t i = 0; i < cumulative.size(); ++i) {
+      le.text = histogram_bounds_text[i];
+      sample(name, "_bucket", first, last, cumulative[i]);
+    }
+    le.text = "+Inf";
+    sample(name, "_bucket", first, last, h.count);
+    sample(name, "_count", labels, h.count);
+    sample(name, "_sum", labels, Seconds {static_cast<uint64_t>(h.sum.count())});
+  }
+
+  void eof() { out_.append("# EOF\n"); }
+
+private:
+  static constexpr std::size_t max_labels = 3;
+
+  template<class T>
+  void number(T value)
+  {
+    static_assert(std::is_integral_v<T>, "floating point std::to_chars is not portable");
+    std::array<char, 32> buf {};
+    const auto res = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    out_.append(buf.data(), res.ptr);
+  }
+
+  void number(Seconds value)
+  {
+    number(value.us / 1'000'000);
+    auto fraction = value.us % 1'000'000;
+    if (fraction == 0) {
+      return;
+    }
+    std::array<char, 7> digits {'.', '0', '0', '0', '0', '0', '0'};
+    for (std::size_t i = digits.size() - 1; i > 0; --i) {
+      digits[i] = static_cast<char>('0' + fraction % 10);
+      fraction /= 10;
+    }
+    std::size_t size = digits.size();
+    while (digits[size - 1] == '0') {
+      --size;
+    }
+    out_.append(digits.data(), size);
+  }
+
+  void escaped(std::string_view text)
+  {
+    for (const char c : text) {
+      switch (c) {
+        case '\\':
+          out_.append("\\\\");
+          break;
+        case '"':
+          out_.append("\\\"");
+          break;
+        case '\n':
+          out_.append("\\n");
+          break;
+        default:
+          out_.push_back(c);
+      }
+    }
+  }
+
+  std::string& out_;
+};
+
+// Every source is read once per render; families are then written from the snapshots
+
+struct ConnectionSnapshot
+{
+  ConnectionSnapshot(Label l, const Connection& conn)
+      : label(l)
+      , traffic(conn.statistics())
+      , requests(conn.request_statistics())
+      , publish(conn.publish_latency())
+      , delivery(conn.delivery_latency())
+      , request(conn.request_latency())
+  {
+    for (const auto prefix : conn.request_latency_prefixes()) {
+      request_by_prefix.emplace_back(prefix, conn.request_latency(prefix));
+    }
+  }
+
+  Label label;
+  ConnectionStatistics traffic;
+  RequestStatistics requests;
+  LatencyHistogram publish;
+  LatencyHistogram delivery;
+  /// requests that match none of the prefixes
+  LatencyHistogram request;
+  std::vector<std::pair<std::string_view, LatencyHistogram>> request_by_prefix;
+};
+
+template<class Source, class Statistics>
+struct Snapshot
+{
+  Snapshot(Label l, const Source& source) noexcept
+      : label(l)
+      , stats(source.statistics())
+  {
+  }
+
+  Label label;
+  Statistics stats;
+};
+
+using SubscribtionSnapshot = Snapshot<Subscribtion, SubscribtionStatistics>;
+using SenderSnapshot = Snapshot<nonblocking::Sender, nonblocking::SenderStatistics>;
+using ReceiverSnapshot = Snapshot<nonblocking::Receiver, nonblocking::ReceiverStatistics>;
+
+inline ConnectionSnapshot snapshot(Label l, const Connection& s)
+{
+  return {l, s};
+}
+
+inline SubscribtionSnapshot snapshot(Label l, const Subscribtion& s)
+{
+  return {l, s};
+}
+
+inline SenderSnapshot snapshot(Label l, const nonblocking::Sender& s)
+{
+  return {l, s};
+}
+
+inline ReceiverSnapshot snapshot(Label l, const nonblocking::Receiver& s)
+{
+  return {l, s};
+}
+
+template<class T>
+auto snapshot(Label l, const Labeled<T>& s)
+{
+  l.text = s.name;
+  return snapshot(l, s.source);
+}
+
+template<class Snapshot, class... Snapshots>
+constexpr bool contains(const std::tuple<Snapshots...>* /*unused*/) noexcept
+{
+  return (std::is_same_v<Snapshot, Snapshots> || ...);
+}
+
+/**
+ * @brief write_family writes a family with one sample per snapshot of the given type
+ *
+ * @param get - returns the value of the snapshot
+ */
+template<class Snapshot, class Tuple, class Get>
+void write_family(OpenMetricsWriter& w,
+                  std::string_view name,
+                  std::string_view type,
+                  std::string_view help,
+                  const Tuple& snapshots,
+                  Get get)
+{
+  if constexpr (contains<Snapshot>(static_cast<const Tuple*>(nullptr))) {
+    w.family(name, type, help);
+    const std::string_view suffix = type == "counter" ? "_total" : "";
+    std::apply(
+        [&](const auto&... s)
+        {
+          auto one = [&](const auto& item)
+          {
+            if constexpr (std::is_same_v<std::decay_t<decltype(item)>, Snapshot>) {
+              w.sample(name, suffix, {item.label}, get(item));
+            }
+          };
+          (one(s), ...);
+        },
+        snapshots);
+  }
+}
+
+/// calls `f` for every connection snapshot
+template<class Tuple, class F>
+void for_each_connection(const Tuple& snapshots, F f)
+{
+  std::apply(
+      [&](const auto&... s)
+      {
+        auto one = [&](const auto& item)
+        {
+          if constexpr (std::is_same_v<std::decay_t<decltype(item)>, ConnectionSnapshot>) {
+            f(item);
+          }
+        };
+        (one(s), ...);
+      },
+      snapshots);
+}
+
+template<class Tuple>
+void write_histogram(OpenMetricsWriter& w,
+                     std::string_view name,
+                     std::string_view help,
+                     const Tuple& snapshots,
+                     const LatencyHistogram ConnectionSnapshot::*histogram)
+{
+  if constexpr (contains<ConnectionSnapshot>(static_cast<const Tuple*>(nullptr))) {
+    w.family(name, "histogram", help);
+    for_each_connection(snapshots,
+                        [&](const ConnectionSnapshot& item)
+                        {
+                          // connections without latency histograms are not rendered
+                          if ((item.*histogram).count != 0) {
+                            w.histogram(name, {item.label}, item.*histogram);
+                          }
+                        });
+  }
+}
+
+/**
+ * @brief write_request_histogram writes one series per configured request prefix and one with
+ * the empty prefix for requests that match none of them
+ */
+template<class Tuple>
+void write_request_histogram(OpenMetricsWriter& w,
+                             std::string_view name,
+                             std::string_view help,
+                             const Tuple& snapshots)
+{
+  if constexpr (contains<ConnectionSnapshot>(static_cast<const Tuple*>(nullptr))) {
+    w.family(name, "histogram", help);
+    for_each_connection(
+        snapshots,
+        [&](const ConnectionSnapshot& item)
+        {
+          // connections without latency histograms are not rendered
+          if (item.request_by_prefix.empty() && item.request.count == 0) {
+            return;
+          }
+          for (const auto& [prefix, histogram] : item.request_by_prefix) {
+            w.histogram(name, {item.label, {"prefix", prefix}}, histogram);
+          }
+          w.histogram(name, {item.label, {"prefix", ""}}, item.request);
+        });
+  }
+}
+
+inline void write_runtime(OpenMetricsWriter& w, const TokioRuntimeMetrics& m)
+{
+  // scheduler counters are collected only with the ASYNC_NATS_RUNTIME_METRICS option
+  if (!m.available) {
+    return;
+  }
+
+  w.family("async_nats_runtime_workers", "gauge", "Number of runtime worker threads");
+  w.sample("async_nats_runtime_workers", "", {}, m.workers.size());
+  w.family("async_nats_runtime_remote_schedules",
+           "counter",
+           "Tasks scheduled from outside of the runtime");
+  w.sample("async_nats_runtime_remote_schedules", "_total", {}, m.remote_schedules);
+  w.family("async_nats_runtime_global_queue_depth", "gauge", "Tasks in the global queue");
+  w.sample("async_nats_runtime_global_queue_depth", "", {}, m.global_queue_depth);
+  w.family("async_nats_runtime_blocking_threads", "gauge", "Threads of the blocking pool");
+  w.sample("async_nats_runtime_blocking_threads", "", {}, m.blocking_threads);
+  w.family(
+      "async_nats_runtime_idle_blocking_threads", "gauge", "Idle threads of the blocking pool");
+  w.sample("async_nats_runtime_idle_blocking_threads", "", {}, m.idle_blocking_threads);
+  w.family("async_nats_runtime_blocking_queue_depth", "gauge", "Tasks in the blocking queue");
+  w.sample("async_nats_runtime_blocking_queue_depth", "", {}, m.blocking_queue_depth);
+
+  auto per_worker = [&](std::string_view name,
+                        std::string_view type,
+                        std::string_view help,
+                        auto get)
+  {
+    w.family(name, type, help);
+    const std::string_view suffix = type == "counter" ? "_total" : "";
+    for (std::size_t i = 0; i < m.workers.size(); ++i) {
+      w.sample(name, suffix, {{"worker", {}, i}}, get(m.workers[i]));
+    }
+  };
+  per_worker("async_nats_runtime_worker_busy_seconds",
+             "counter",
+             "Time the worker spent polling tasks",
+             [](const TokioWorkerMetrics& x)
+             { return Seconds {static_cast<uint64_t>(x.busy_time.count())}; });
+  per_worker("async_nats_runtime_worker_polls",
+             "counter",
+             "Tasks polled by the worker",
+             [](const TokioWorkerMetrics& x) { return x.polls; });
+  per_worker("async_nats_runtime_worker_steals",
+             "counter",
+             "Tasks stolen by the worker",
+             [](const TokioWorkerMetrics& x) { return x.steals; });
+  per_worker("async_nats_runtime_worker_overflows",
+             "counter",
+             "Times the local queue of the worker overflowed",
+             [](const TokioWorkerMetrics& x) { return x.overflows; });
+  per_worker("async_nats_runtime_worker_parks",
+             "counter",
+             "Times the worker parked",
+             [](const TokioWorkerMetrics& x) { return x.parks; });
+  per_worker("async_nats_runtime_worker_local_queue_depth",
+             "gauge",
+             "Tasks in the local queue of the worker",
+             [](const TokioWorkerMetrics& x) { return x.local_queue_depth; });
+}
+
+template<class Tuple>
+void write_sources(OpenMetricsWriter& w, const Tuple& s)
+{
+  using C = ConnectionSnapshot;
+  write_family<C>(w,
+                  "async_nats_connection_in_bytes",
+                  "counter",
+                  "Bytes received by the connection",
+                  s,
+                  [](const C& c) { return c.traffic.in_bytes; });
+  write_family<C>(w,
+                  "async_nats_connection_out_bytes",
+                  "counter",
+                  "Bytes sent by the connection",
+                  s,
+                  [](const C& c) { return c.traffic.out_bytes; });
+  write_family<C>(w,
+                  "async_nats_connection_in_messages",
+                  "counter",
+                  "Messages received by the connection",
+                  s,
+                  [](const C& c) { return c.traffic.in_messages; });
+  write_family<C>(w,
+                  "async_nats_connection_out_messages",
+                  "counter",
+                  "Messages sent by the connection",
+                  s,
+                  [](const C& c) { return c.traffic.out_messages; });
+  write_family<C>(w,
+                  "async_nats_connection_connects",
+                  "counter",
+                  "Successful connects including the initial one",
+                  s,
+                  [](const C& c) { return c.traffic.connects; });
+  write_family<C>(w,
+                  "async_nats_connection_pending_messages",
+                  "gauge",
+                  "Publishes that are not handed over to the writer yet",
+                  s,
+                  [](const C& c) { return c.traffic.pending_messages; });
+  write_family<C>(w,
+                  "async_nats_connection_pending_bytes",
+                  "gauge",
+                  "Bytes of publishes that are not handed over to the writer yet",
+                  s,
+                  [](const C& c) { return c.traffic.pending_bytes; });
+  write_family<C>(w,
+                  "async_nats_connection_requests",
+                  "counter",
+                  "Requests sent by the connection",
+                  s,
+                  [](const C& c) { return c.requests.requests; });
+  write_family<C>(w,
+                  "async_nats_connection_hedged_requests",
+                  "counter",
+                  "Requests that sent a hedged duplicate",
+                  s,
+                  [](const C& c) { return c.requests.hedged; });
+  write_family<C>(w,
+                  "async_nats_connection_hedge_wins",
+                  "counter",
+                  "Hedged requests where the duplicate replied first",
+                  s,
+                  [](const C& c) { return c.requests.hedge_wins; });
+  write_family<C>(w,
+                  "async_nats_connection_coalesced_requests",
+                  "counter",
+                  "Requests that joined an identical request in flight",
+                  s,
+                  [](const C& c) { return c.requests.coalesced; });
+  write_family<C>(w,
+                  "async_nats_connection_cache_hits",
+                  "counter",
+                  "Requests served from the response cache",
+                  s,
+                  [](const C& c) { return c.requests.cache_hits; });
+  write_family<C>(w,
+                  "async_nats_connection_cache_misses",
+                  "counter",
+                  "Cacheable requests that were sent to the server",
+                  s,
+                  [](const C& c) { return c.requests.cache_misses; });
+  write_histogram(w,
+                  "async_nats_connection_publish_latency_seconds",
+                  "Time from the publish call to the hand-over to the writer",
+                  s,
+                  &C::publish);
+  write_histogram(w,
+                  "async_nats_connection_delivery_latency_seconds",
+                  "Time from the message arrival to the receive callback",
+                  s,
+                  &C::delivery);
+  write_request_histogram(w,
+                          "async_nats_connection_request_latency_seconds",
+                          "Request round-trip time by subject prefix",
+                          s);
+
+  using S = SubscribtionSnapshot;
+  write_family<S>(w,
+                  "async_nats_subscribtion_messages",
+                  "counter",
+                  "Messages delivered by the subscribtion",
+                  s,
+                  [](const S& x) { return x.stats.messages; });
+  write_family<S>(w,
+                  "async_nats_subscribtion_bytes",
+                  "counter",
+                  "Payload bytes delivered by the subscribtion",
+                  s,
+                  [](const S& x) { return x.stats.bytes; });
+
+  write_family<SenderSnapshot>(w,
+                               "async_nats_sender_sent",
+                               "counter",
+                               "Messages handed over to the connection",
+                               s,
+                               [](const SenderSnapshot& x) { return x.stats.sent; });
+  write_family<SenderSnapshot>(w,
+                               "async_nats_sender_rejected",
+                               "counter",
+                               "Messages rejected because the queue is full",
+                               s,
+                               [](const SenderSnapshot& x) { return x.stats.rejected; });
+  write_family<SenderSnapshot>(w,
+                               "async_nats_sender_unbounded",
+                               "counter",
+                               "Messages enqueued beyond the queue capacity",
+                               s,
+                               [](const SenderSnapshot& x) { return x.stats.unbounded; });
+  write_family<SenderSnapshot>(w,
+                               "async_nats_sender_queued",
+                               "gauge",
+                               "Messages waiting in the queue",
+                               s,
+                               [](const SenderSnapshot& x) { return x.stats.queued; });
+
+  write_family<ReceiverSnapshot>(w,
+                                 "async_nats_receiver_received",
+                                 "counter",
+                                 "Messages received from the subscribtion",
+                                 s,
+                                 [](const ReceiverSnapshot& x) { return x.stats.received; });
+  write_family<ReceiverSnapshot>(w,
+                                 "async_nats_receiver_dropped",
+                                 "counter",
+                                 "Messages dropped because the queue is full",
+                                 s,
+                                 [](const ReceiverSnapshot& x) { return x.stats.dropped; });
+  write_family<ReceiverSnapshot>(w,
+                                 "async_nats_receiver_queued",
+                                 "gauge",
+                                 "Messages waiting in the queue",
+                                 s,
+                                 [](const ReceiverSnapshot& x) { return x.stats.queued; });
+}
+
+template<class... Sources, std::size_t... I>
+void render(OpenMetricsWriter& w, std::index_sequence<I...> /*unused*/, const Sources&... sources)
+{
+  const std::tuple snapshots {snapshot(Label {"name", {}, I}, sources)...};
+  write_sources(w, snapshots);
+}
+
+}  // namespace detail
+
+/**
+ * @brief render_openmetrics renders counters of the runtime and every source in the OpenMetrics
+ * text format
+ *
+ * Sources are Connection, Subscribtion, nonblocking::Sender and nonblocking::Receiver objects,
+ * optionally wrapped with labeled(). Every source is read once. The buffer is cleared but keeps
+ * its capacity so rendering into the same buffer does not allocate once it has grown.
+ *
+ * Latency histograms are reduced to 16 fixed buckets from 100us to 10s and are rendered only for
+ * connections that have recorded samples. Request latency has one series per prefix passed to
+ * ConnectionOptions::latency_histogram_prefix() and one with the empty prefix for other requests.
+ * Runtime scheduler metrics are rendered only if they are available.
+ *
+ * @return view of the buffer
+ */
+template<class... Sources>
+std::string_view render_openmetrics(std::string& buffer,
+                                    const TokioRuntime& rt,
+                                    const Sources&... sources)
+{
+  buffer.clear();
+  detail::OpenMetricsWriter w(buffer);
+  detail::write_runtime(w, rt.metrics());
+  detail::render(w, std::index_sequence_for<Sources...> {}, sources...);
+  w.eof();
+  return buffer;
+}
+
+}  // namespace async_nats::metrics
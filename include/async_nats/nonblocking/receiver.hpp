@@ -1,11 +1,36 @@
 #pragma once
 
+#include <cstdint>
+
 #include <async_nats/detail/capi.h>
 #include <async_nats/message.hpp>
 #include <async_nats/subscribtion.hpp>
 
 namespace async_nats::nonblocking
 {
+/**
+ * @brief The ReceiverStatistics struct contains counters of messages that pass through the
+ * Receiver queue
+ */
+struct ReceiverStatistics
+{
+  ReceiverStatistics() noexcept = default;
+
+  explicit ReceiverStatistics(const AsyncNatsNamedReceiverStatistics& s) noexcept
+      : received(s.received)
+      , dropped(s.dropped)
+      , queued(s.queued)
+  {
+  }
+
+  /// messages that are received from the subscribtion
+  uint64_t received = 0;
+  /// messages that are dropped because the queue is full
+  uint64_t dropped = 0;
+  /// messages that are waiting in the queue
+  uint64_t queued = 0;
+};
+
 /**
  * @brief The Receiver class
  *
@@ -90,6 +115,11 @@ public:
     return Message(async_nats_named_receiver_try_recv(receiver_));
   }
 
+  ReceiverStatistics statistics() const noexcept
+  {
+    return ReceiverStatistics(async_nats_named_receiver_statistics(receiver_));
+  }
+
 private:
   AsyncNatsNamedReceiver* receiver_;
 };
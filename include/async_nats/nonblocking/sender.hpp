@@ -1,15 +1,123 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include <boost/asio/buffer.hpp>
 
 #include <async_nats/connection.hpp>
 #include <async_nats/detail/capi.h>
+#include <async_nats/errors.hpp>
+#include <async_nats/owned_string.h>
 
 namespace async_nats::nonblocking
 {
+/**
+ * @brief The SenderStatistics struct contains counters of messages that pass through the Sender
+ * queue
+ */
+struct SenderStatistics
+{
+  SenderStatistics() noexcept = default;
+
+  explicit SenderStatistics(const AsyncNatsNamedSenderStatistics& s) noexcept
+      : sent(s.sent)
+      , rejected(s.rejected)
+      , unbounded(s.unbounded)
+      , queued(s.queued)
+      , spooled(s.spooled)
+      , spool_replayed(s.spool_replayed)
+      , spool_pending(s.spool_pending)
+  {
+  }
+
+  /// messages that are handed over to the connection
+  uint64_t sent = 0;
+  /// messages that are rejected by try_send() because the queue is full
+  uint64_t rejected = 0;
+  /// messages that are enqueued by send() beyond the queue capacity
+  uint64_t unbounded = 0;
+  /// messages that are waiting in the queue
+  uint64_t queued = 0;
+  /// messages that are written to the spool
+  uint64_t spooled = 0;
+  /// messages that are published from the spool
+  uint64_t spool_replayed = 0;
+  /// messages that are waiting in the spool, including the ones left by a previous process
+  uint64_t spool_pending = 0;
+};
+
+/**
+ * @brief The SpoolOptions class configures the durable spool of a Sender
+ *
+ * The spool is a log of messages in memory-mapped segment files in the directory. Messages are
+ * written to the spool instead of the queue while the connection is down, the queue is full or
+ * the spool has messages, and are published from it in order once the connection is up and the
+ * queue is empty. The files are preallocated when the spool is opened and reused after they are
+ * drained. Messages left by a previous process are published first.
+ *
+ * Messages survive a restart of the process. A message may be published twice if the process
+ * stops or the connection is lost while a batch of spooled messages is being flushed.
+ *
+ * Only one sender may use the directory at a time; it is locked while the sender exists.
+ */
+class SpoolOptions
+{
+public:
+  explicit SpoolOptions(std::string directory)
+      : directory_(std::move(directory))
+  {
+  }
+
+  /**
+   * @brief segment_size sets the size of one segment file. The biggest message must fit into one
+   * segment. Default is 16 MiB.
+   */
+  SpoolOptions& segment_size(uint64_t bytes) noexcept
+  {
+    segment_size_ = bytes;
+    return *this;
+  }
+
+  /**
+   * @brief segments sets the number of segment files. Default is 8.
+   *
+   * The spool can not be opened with fewer segments than before while the extra segments hold
+   * messages.
+   */
+  SpoolOptions& segments(uint64_t count) noexcept
+  {
+    segments_ = count;
+    return *this;
+  }
+
+  AsyncNatsSpoolConfig get_raw() const noexcept
+  {
+    return {directory_.c_str(), segment_size_, segments_};
+  }
+
+private:
+  std::string directory_;
+  uint64_t segment_size_ = 16 * 1024 * 1024;
+  uint64_t segments_ = 8;
+};
+
+class SpoolError : public Exception
+{
+public:
+  explicit SpoolError(const OwnedString& text)
+      : text_(static_cast<std::string_view>(text))
+  {
+  }
+
+  const char* what() const noexcept override { return text_.c_str(); }
+
+private:
+  std::string text_;
+};
+
 /**
  * @brief The Sender class
  *
@@ -40,6 +148,24 @@ public:
   {
   }
 
+  /**
+   * @brief Sender creates a sender with a durable spool, see SpoolOptions
+   * @throws SpoolError if the spool can not be opened or its directory is used by another
+   * sender
+   */
+  explicit Sender(const std::string& topic,
+                  const Connection& conn,
+                  std::size_t capacity,
+                  const SpoolOptions& spool)
+  {
+    AsyncNatsOwnedString err = nullptr;
+    sender_ = async_nats_named_sender_new_spooled(
+        topic.c_str(), conn.get_raw(), capacity, spool.get_raw(), &err);
+    if (sender_ == nullptr) {
+      throw SpoolError(OwnedString(err));
+    }
+  }
+
   Sender(const Sender& o) noexcept
       : sender_(async_nats_named_sender_clone(o.get_raw()))
   {
@@ -95,6 +221,9 @@ public:
   /**
    * @brief try_send - pushes data to the send queue if there is space available
    * @return true if message has been enqueued
+   *
+   * With a spool the message is spooled if it can not be enqueued; false is returned only if the
+   * spool is full as well.
    */
   bool try_send(boost::asio::const_buffer data) const noexcept
   {
@@ -111,6 +240,9 @@ public:
    * @return true if message has been enqueued
    *
    * @note this may cause running out of memory
+   *
+   * With a spool the message is spooled if it can not be enqueued and goes to the queue only if
+   * the spool is full, so it may overtake the spooled messages.
    */
   void send(boost::asio::const_buffer data) const noexcept
   {
@@ -122,6 +254,11 @@ public:
     async_nats_named_sender_send(sender_, topic, {data.data(), data.size()});
   }
 
+  SenderStatistics statistics() const noexcept
+  {
+    return SenderStatistics(async_nats_named_sender_statistics(sender_));
+  }
+
 private:
   AsyncNatsNamedSender* sender_;
 };
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+
+#include <async_nats/detail/capi.h>
+
+namespace async_nats
+{
+/**
+ * @brief The Nuid class generates unique identifiers the same way as the NATS clients do
+ *
+ * An identifier is a random prefix of 12 base62 digits followed by a sequence of 10 digits that
+ * is incremented by a random step. The prefix is regenerated when the sequence overflows. The
+ * generator is not thread safe, use Nuid::next() to generate identifiers with the generator of
+ * the current thread.
+ */
+class Nuid
+{
+public:
+  static constexpr std::size_t prefix_length = 12;
+  static constexpr std::size_t sequence_length = 10;
+  static constexpr std::size_t length = prefix_length + sequence_length;
+
+  Nuid()
+      : random_(seed())
+  {
+    reset();
+  }
+
+  /// writes the next identifier of `length` characters to `out`
+  void generate(char* out) noexcept
+  {
+    sequence_ += increment_;
+    if (sequence_ >= max_sequence) {
+      reset();
+    }
+
+    for (std::size_t i = 0; i < prefix_length; ++i) {
+      out[i] = prefix_[i];
+    }
+    auto sequence = sequence_;
+    for (std::size_t i = length; i > prefix_length; --i) {
+      out[i - 1] = digits[sequence % base];
+      sequence /= base;
+    }
+  }
+
+  /// writes the next identifier of the current thread to `out`
+  static void next(char* out)
+  {
+    static thread_local Nuid nuid;
+    nuid.generate(out);
+  }
+
+private:
+  static constexpr std::string_view digits =
+      "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+  static constexpr std::uint64_t base = 62;
+  /// 62^10
+  static constexpr std::uint64_t max_sequence = 839299365868340224ULL;
+  static constexpr std::uint64_t min_increment = 33;
+  static constexpr std::uint64_t max_increment = 333;
+
+  /// a single draw of std::random_device is only 32 bits, the whole state of the engine is seeded
+  static std::mt19937_64 seed()
+  {
+    std::random_device device;
+    std::array<std::random_device::result_type, std::mt19937_64::state_size * 2> entropy {};
+    for (auto& value : entropy) {
+      value = device();
+    }
+    std::seed_seq seq(entropy.begin(), entropy.end());
+    return std::mt19937_64(seq);
+  }
+
+  void reset() noexcept
+  {
+    std::uniform_int_distribution<std::size_t> digit(0, base - 1);
+    for (auto& c : prefix_) {
+      c = digits[digit(random_)];
+    }
+    sequence_ = std::uniform_int_distribution<std::uint64_t>(0, max_sequence - 1)(random_);
+    increment_ =
+        std::uniform_int_distribution<std::uint64_t>(min_increment, max_increment - 1)(random_);
+  }
+
+  std::mt19937_64 random_;
+  std::array<char, prefix_length> prefix_ {};
+  std::uint64_t sequence_ = 0;
+  std::uint64_t increment_ = 0;
+};
+
+/**
+ * @brief The Inbox class stores an inbox subject in an inline buffer
+ *
+ * The subject is `<prefix>.<nuid>`, it is null-terminated and can be used wherever OwnedString
+ * returned by Connection::new_mailbox() is accepted.
+ */
+class Inbox
+{
+public:
+  /// the longest inbox that fits into the buffer
+  static constexpr std::size_t max_size = 127;
+  /// the longest prefix that can be used
+  static constexpr std::size_t max_prefix = max_size - Nuid::length - 1;
+
+  /**
+   * @brief Inbox generates a new inbox with the given prefix
+   * @throws std::length_error if the prefix is longer than max_prefix
+   */
+  explicit Inbox(std::string_view prefix)
+  {
+    if (prefix.size() > max_prefix) {
+      throw std::length_error("async_nats::Inbox: prefix is too long");
+    }
+    prefix.copy(buffer_.data(), prefix.size());
+    buffer_[prefix.size()] = '.';
+    Nuid::next(buffer_.data() + prefix.size() + 1);
+    size_ = prefix.size() + 1 + Nuid::length;
+    buffer_[size_] = '\0';
+  }
+
+  const char* c_str() const noexcept { return buffer_.data(); }
+
+  std::size_t size() const noexcept { return size_; }
+
+  operator AsyncNatsAsyncString() const noexcept { return buffer_.data(); }
+
+  operator std::string_view() const noexcept { return {buffer_.data(), size_}; }
+
+private:
+  std::array<char, max_size + 1> buffer_;
+  std::size_t size_;
+};
+
+}  // namespace async_nats
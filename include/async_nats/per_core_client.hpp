@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#  include <sched.h>
+#endif
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <async_nats/connection.hpp>
+#include <async_nats/tokio_runtime.hpp>
+
+namespace async_nats
+{
+/**
+ * @brief current_cpu returns the CPU the calling thread is running on
+ *
+ * Falls back to a hash of the thread id on platforms that can not report the CPU so the same
+ * thread is always mapped to the same instance.
+ */
+inline std::size_t current_cpu() noexcept
+{
+#if defined(__linux__)
+  const int cpu = sched_getcpu();
+  if (cpu >= 0) {
+    return static_cast<std::size_t>(cpu);
+  }
+#endif
+  return std::hash<std::thread::id> {}(std::this_thread::get_id());
+}
+
+/**
+ * @brief The PerCoreClient class owns one single-threaded TokioRuntime and one Connection per CPU
+ *
+ * Every runtime thread is pinned to its CPU so publishes and deliveries of a thread-per-core
+ * application never leave the core. Operations are routed to the instance of the calling CPU;
+ * calls from CPUs that are not in the list are distributed by CPU number.
+ *
+ * Connections are established by connect(). The client must outlive this operation.
+ *
+ * @threadsafe This class is thread safe after connect() completes
+ */
+class PerCoreClient
+{
+public:
+  PerCoreClient() noexcept = default;
+
+  /**
+   * @param config - runtime template. Flavor and CPU affinity are overridden for every instance
+   * @param cpus - CPUs to create instances for. Must not be empty
+   */
+  PerCoreClient(const TokioRuntimeConfig& config, const std::vector<std::size_t>& cpus)
+  {
+    assert(!cpus.empty() && "PerCoreClient requires at least one CPU");
+
+    shards_.reserve(cpus.size());
+    for (std::size_t cpu : cpus) {
+      TokioRuntimeConfig shard_config(config);
+      shard_config.flavor(AsyncNats_Runtime_CurrentThread).cpu_affinity({cpu});
+      shards_.push_back(std::make_unique<Shard>(cpu, TokioRuntime(shard_config)));
+
+      if (cpu >= cpu_to_shard_.size()) {
+        cpu_to_shard_.resize(cpu + 1, no_shard);
+      }
+      cpu_to_shard_[cpu] = shards_.size() - 1;
+    }
+  }
+
+  PerCoreClient(const PerCoreClient&) = delete;
+  PerCoreClient(PerCoreClient&&) noexcept = default;
+  PerCoreClient& operator=(const PerCoreClient&) = delete;
+  PerCoreClient& operator=(PerCoreClient&&) noexcept = default;
+  ~PerCoreClient() noexcept = default;
+
+  operator bool() const noexcept { return !shards_.empty(); }
+
+  std::size_t size() const noexcept { return shards_.size(); }
+
+  /**
+   * @brief shard_index returns the index of the instance serving the calling thread
+   */
+  std::size_t shard_index() const noexcept
+  {
+    assert(!shards_.empty() && "PerCoreClient must be checked for null before usage");
+    const auto cpu = current_cpu();
+    if (cpu < cpu_to_shard_.size() && cpu_to_shard_[cpu] != no_shard) {
+      return cpu_to_shard_[cpu];
+    }
+    return cpu % shards_.size();
+  }
+
+  std::size_t cpu(std::size_t index) const noexcept { return shards_[index]->cpu; }
+
+  const TokioRuntime& runtime(std::size_t index) const noexcept { return shards_[index]->rt; }
+
+  Connection& connection(std::size_t index) noexcept { return shards_[index]->conn; }
+
+  /**
+   * @brief local returns the connection of the calling CPU
+   */
+  Connection& local() noexcept { return connection(shard_index()); }
+
+  template<class CompletionToken>
+  auto publish(std::string_view subject,
+               boost::asio::const_buffer data,
+               CompletionToken&& completion_token)
+  {
+    return local().publish(subject, data, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto publish(std::string_view subject,
+               std::string_view reply_to,
+               boost::asio::const_buffer data,
+               CompletionToken&& completion_token)
+  {
+    return local().publish(
+        subject, reply_to, data, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto subcribe(AsyncNatsAsyncString subject, CompletionToken&& completion_token)
+  {
+    return local().subcribe(subject, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto request(AsyncNatsAsyncString subject,
+               boost::asio::const_buffer data,
+               CompletionToken&& completion_token)
+  {
+    return local().request(subject, data, std::forward<CompletionToken>(completion_token));
+  }
+
+  template<class CompletionToken>
+  auto request(AsyncNatsAsyncString subject,
+               RequestBuilder&& req,
+               CompletionToken&& completion_token)
+  {
+    return local().request(
+        subject, std::move(req), std::forward<CompletionToken>(completion_token));
+  }
+
+  /**
+   * @brief connect establishes the connection of every instance on its own runtime
+   *
+   * The result of this operation is either nullptr or the first ConnectionError in
+   * std::exception_ptr.
+   *
+   * @note options must live until the very end of the asynchronous operation.
+   */
+  template<class CompletionToken>
+  auto connect(const ConnectionOptions& options, CompletionToken&& completion_token)
+  {
+    auto init = [this](auto token, std::reference_wrapper<const ConnectionOptions> i_options)
+    {
+      using CH = std::decay_t<decltype(token)>;
+
+      struct State
+      {
+        State(CH&& h, std::size_t count)
+            : handler(std::move(h))
+            , remaining(count)
+        {
+        }
+
+        CH handler;
+        std::mutex mutex;
+        std::size_t remaining;
+        std::exception_ptr error;
+      };
+
+      auto state = std::make_shared<State>(std::move(token), shards_.size());
+      for (auto& shard : shards_) {
+        async_nats::connect(shard->rt,
+                            i_options.get(),
+                            [state, s = shard.get()](std::exception_ptr err, Connection conn)
+                            {
+                              {
+                                std::lock_guard lock(state->mutex);
+                                if (err && !state->error) {
+                                  state->error = err;
+                                }
+                                s->conn = std::move(conn);
+                                if (--state->remaining != 0) {
+                                  return;
+                                }
+                              }
+                              state->handler(state->error);
+                            });
+      }
+    };
+
+    return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr)>(
+        init, completion_token, std::cref(options));
+  }
+
+private:
+  static constexpr std::size_t no_shard = static_cast<std::size_t>(-1);
+
+  struct Shard
+  {
+    Shard(std::size_t c, TokioRuntime&& r) noexcept
+        : cpu(c)
+        , rt(std::move(r))
+    {
+    }
+
+    std::size_t cpu;
+    TokioRuntime rt;
+    // the connection is closed before its runtime stops
+    Connection conn;
+  };
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<std::size_t> cpu_to_shard_;
+};
+
+}  // namespace async_nats
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <chrono>
+#include <stdexcept>
+#include <string>
 
 #include <boost/asio/buffer.hpp>
 
@@ -8,6 +10,123 @@
 
 namespace async_nats
 {
+/**
+ * @brief The HedgePolicy class describes when a duplicate of a slow request should be sent
+ *
+ * The first reply wins. The reply that loses the race is discarded inside the TokioRuntime and
+ * never reaches the completion handler.
+ */
+class HedgePolicy
+{
+public:
+  /**
+   * @brief after sends a duplicate request if there is no reply after a fixed delay
+   */
+  static HedgePolicy after(std::chrono::steady_clock::duration delay) noexcept
+  {
+    return HedgePolicy(Mode::fixed, to_micros(delay), 0.0);
+  }
+
+  /**
+   * @brief percentile sends a duplicate request if there is no reply after the given
+   * percentile of the recent request latencies of the connection
+   *
+   * @param percentile - value within [0.0; 1.0], e.g. 0.95
+   * @param fallback - delay that is used until enough latency samples are collected
+   * @throws std::out_of_range if the percentile is not within [0.0; 1.0]
+   */
+  static HedgePolicy percentile(double percentile, std::chrono::steady_clock::duration fallback)
+  {
+    if (!(percentile >= 0.0 && percentile <= 1.0)) {
+      throw std::out_of_range("async_nats::HedgePolicy: percentile must be within [0.0; 1.0]");
+    }
+    return HedgePolicy(Mode::percentile, to_micros(fallback), percentile);
+  }
+
+  void apply(AsyncNatsRequest* request) const noexcept
+  {
+    if (mode_ == Mode::percentile) {
+      async_nats_request_hedge_percentile(request, percentile_, delay_us_);
+    } else {
+      async_nats_request_hedge_after(request, delay_us_);
+    }
+  }
+
+private:
+  enum class Mode
+  {
+    fixed,
+    percentile,
+  };
+
+  HedgePolicy(Mode mode, uint64_t delay_us, double percentile) noexcept
+      : mode_(mode)
+      , delay_us_(delay_us)
+      , percentile_(percentile)
+  {
+  }
+
+  static uint64_t to_micros(std::chrono::steady_clock::duration duration) noexcept
+  {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  }
+
+  Mode mode_ = Mode::fixed;
+  uint64_t delay_us_ = 0;
+  double percentile_ = 0.0;
+};
+
+/**
+ * @brief The RequestStatistics struct contains request counters of a Connection
+ */
+struct RequestStatistics
+{
+  RequestStatistics() noexcept = default;
+
+  explicit RequestStatistics(const AsyncNatsRequestStatistics& s) noexcept
+      : requests(s.requests)
+      , hedged(s.hedged)
+      , hedge_wins(s.hedge_wins)
+      , coalesced(s.coalesced)
+      , cache_hits(s.cache_hits)
+      , cache_misses(s.cache_misses)
+  {
+  }
+
+  /**
+   * @brief hedge_rate returns share of requests that sent a hedged duplicate
+   */
+  double hedge_rate() const noexcept
+  {
+    return requests == 0 ? 0.0 : static_cast<double>(hedged) / static_cast<double>(requests);
+  }
+
+  /**
+   * @brief win_rate returns share of hedged requests where the duplicate replied first
+   */
+  double win_rate() const noexcept
+  {
+    return hedged == 0 ? 0.0 : static_cast<double>(hedge_wins) / static_cast<double>(hedged);
+  }
+
+  /**
+   * @brief cache_hit_rate returns share of cacheable requests served from the response cache
+   */
+  double cache_hit_rate() const noexcept
+  {
+    const auto total = cache_hits + cache_misses;
+    return total == 0 ? 0.0 : static_cast<double>(cache_hits) / static_cast<double>(total);
+  }
+
+  uint64_t requests = 0;
+  uint64_t hedged = 0;
+  uint64_t hedge_wins = 0;
+  uint64_t coalesced = 0;
+  uint64_t cache_hits = 0;
+  uint64_t cache_misses = 0;
+};
+
 /**
  * @brief The Request class is used to construct an RPC request
  */
@@ -75,6 +194,50 @@ public:
     return *this;
   }
 
+  /**
+   * @brief hedge enables hedging for this request
+   */
+  RequestBuilder& hedge(const HedgePolicy& policy) noexcept
+  {
+    policy.apply(request_);
+    return *this;
+  }
+
+  /**
+   * @brief coalesce shares the reply between identical requests
+   *
+   * Requests to the same subject with the same payload that are in flight at the same time are
+   * sent only once and every one of them completes with the same Message. Options of the request
+   * that was sent first are used.
+   */
+  RequestBuilder& coalesce() noexcept
+  {
+    async_nats_request_coalesce(request_);
+    return *this;
+  }
+
+  /**
+   * @brief coalesce shares the reply between requests to the same subject with the same key
+   * regardless of their payload
+   */
+  RequestBuilder& coalesce(AsyncNatsBorrowedString key) noexcept
+  {
+    async_nats_request_coalesce_key(request_, key);
+    return *this;
+  }
+
+  /**
+   * @brief cache serves the request from the response cache of the connection
+   *
+   * Only idempotent requests should be cached. Requests are cached by subject and payload. Does
+   * nothing if the response cache is not enabled in ConnectionOptions.
+   */
+  RequestBuilder& cache() noexcept
+  {
+    async_nats_request_cache(request_);
+    return *this;
+  }
+
   /**
    * @brief release returns control over underlying struct
    */
@@ -89,4 +252,183 @@ private:
   AsyncNatsRequest* request_ = nullptr;
 };
 
+/**
+ * @brief The ResponseCacheOptions class configures the response cache of a Connection
+ *
+ * The cache stores successful replies to requests that are built with RequestBuilder::cache().
+ * Replies expire after the TTL of their subject and the least recently used reply is evicted when
+ * the cache is full.
+ */
+class ResponseCacheOptions
+{
+public:
+  ResponseCacheOptions() noexcept
+      : options_(async_nats_response_cache_config_new())
+  {
+  }
+
+  ResponseCacheOptions(const ResponseCacheOptions&) noexcept = delete;
+  ResponseCacheOptions(ResponseCacheOptions&& o) noexcept
+      : options_(o.options_)
+  {
+    o.options_ = nullptr;
+  }
+
+  ~ResponseCacheOptions() noexcept
+  {
+    if (options_ != nullptr) {
+      async_nats_response_cache_config_delete(options_);
+    }
+  }
+
+  ResponseCacheOptions& operator=(const ResponseCacheOptions&) noexcept = delete;
+  ResponseCacheOptions& operator=(ResponseCacheOptions&& o) noexcept
+  {
+    if (this == &o) {
+      return *this;
+    }
+
+    if (options_ != nullptr) {
+      async_nats_response_cache_config_delete(options_);
+    }
+
+    options_ = o.options_;
+    o.options_ = nullptr;
+    return *this;
+  }
+
+  /**
+   * @brief capacity sets maximum number of cached replies. Default is 1024.
+   */
+  ResponseCacheOptions& capacity(uint64_t count) noexcept
+  {
+    async_nats_response_cache_config_capacity(options_, count);
+    return *this;
+  }
+
+  /**
+   * @brief default_ttl sets TTL of the subjects without their own TTL. Default is 1 second. Zero
+   * disables caching for such subjects.
+   */
+  ResponseCacheOptions& default_ttl(std::chrono::steady_clock::duration ttl) noexcept
+  {
+    async_nats_response_cache_config_default_ttl(options_, to_micros(ttl));
+    return *this;
+  }
+
+  /**
+   * @brief ttl sets TTL of replies to the subject
+   */
+  ResponseCacheOptions& ttl(const std::string& subject,
+                            std::chrono::steady_clock::duration ttl) noexcept
+  {
+    async_nats_response_cache_config_subject_ttl(options_, subject.c_str(), to_micros(ttl));
+    return *this;
+  }
+
+  /**
+   * @brief invalidation_subject subscribes the cache to the subject. The payload of every message
+   * is the subject whose cached replies are dropped. An empty payload drops all replies.
+   */
+  ResponseCacheOptions& invalidation_subject(const std::string& subject) noexcept
+  {
+    async_nats_response_cache_config_invalidation_subject(options_, subject.c_str());
+    return *this;
+  }
+
+  const AsyncNatsResponseCacheConfig* get_raw() const noexcept { return options_; }
+
+private:
+  static uint64_t to_micros(std::chrono::steady_clock::duration duration) noexcept
+  {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  }
+
+  AsyncNatsResponseCacheConfig* options_;
+};
+
+/**
+ * @brief The RequestManyOptions class defines when the stream of replies is finished
+ *
+ * The stream is finished when any of the conditions is met. Without conditions the stream is
+ * finished only when the Subscribtion is destroyed or cancelled.
+ */
+class RequestManyOptions
+{
+public:
+  RequestManyOptions() noexcept
+      : options_(async_nats_request_many_options_new())
+  {
+  }
+
+  RequestManyOptions(const RequestManyOptions&) noexcept = delete;
+  RequestManyOptions(RequestManyOptions&& o) noexcept
+      : options_(o.options_)
+  {
+    o.options_ = nullptr;
+  }
+
+  ~RequestManyOptions() noexcept
+  {
+    if (options_ != nullptr) {
+      async_nats_request_many_options_delete(options_);
+    }
+  }
+
+  RequestManyOptions& operator=(const RequestManyOptions&) noexcept = delete;
+  RequestManyOptions& operator=(RequestManyOptions&& o) noexcept
+  {
+    if (this == &o) {
+      return *this;
+    }
+
+    if (options_ != nullptr) {
+      async_nats_request_many_options_delete(options_);
+    }
+
+    options_ = o.options_;
+    o.options_ = nullptr;
+    return *this;
+  }
+
+  /**
+   * @brief max_messages finishes the stream after receiving the given number of replies
+   *
+   * The stream is finished right away if the count is 0.
+   */
+  RequestManyOptions& max_messages(uint64_t count) noexcept
+  {
+    async_nats_request_many_options_max_messages(options_, count);
+    return *this;
+  }
+
+  /**
+   * @brief idle_timeout finishes the stream if there are no replies for the given duration
+   */
+  RequestManyOptions& idle_timeout(std::chrono::steady_clock::duration timeout) noexcept
+  {
+    async_nats_request_many_options_idle_timeout(
+        options_,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(timeout).count()));
+    return *this;
+  }
+
+  /**
+   * @brief sentinel finishes the stream when a reply with empty payload is received. The
+   * sentinel reply itself is not delivered.
+   */
+  RequestManyOptions& sentinel(bool enabled = true) noexcept
+  {
+    async_nats_request_many_options_sentinel(options_, enabled);
+    return *this;
+  }
+
+  const AsyncNatsRequestManyOptions* get_raw() const noexcept { return options_; }
+
+private:
+  AsyncNatsRequestManyOptions* options_;
+};
+
 }  // namespace async_nats
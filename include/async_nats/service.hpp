@@ -0,0 +1,401 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <async_nats/connection.hpp>
+#include <async_nats/detail/capi.h>
+#include <async_nats/detail/helpers.hpp>
+#include <async_nats/errors.hpp>
+#include <async_nats/message.hpp>
+#include <async_nats/owned_string.h>
+
+namespace async_nats
+{
+class ServiceOptions
+{
+public:
+  /**
+   * @param name - name of the service. Statistics are available on `$SRV.STATS.<name>`
+   * @param subject - subject the service listens on
+   */
+  ServiceOptions(const std::string& name, const std::string& subject) noexcept
+      : options_(async_nats_service_config_new(name.c_str(), subject.c_str()))
+  {
+  }
+
+  ServiceOptions(const ServiceOptions&) noexcept = delete;
+  ServiceOptions(ServiceOptions&& o) noexcept
+      : options_(o.options_)
+  {
+    o.options_ = nullptr;
+  }
+
+  ~ServiceOptions() noexcept
+  {
+    if (options_ != nullptr) {
+      async_nats_service_config_delete(options_);
+    }
+  }
+
+  ServiceOptions& operator=(const ServiceOptions&) noexcept = delete;
+  ServiceOptions& operator=(ServiceOptions&& o) noexcept
+  {
+    if (this == &o) {
+      return *this;
+    }
+
+    if (options_ != nullptr) {
+      async_nats_service_config_delete(options_);
+    }
+
+    options_ = o.options_;
+    o.options_ = nullptr;
+    return *this;
+  }
+
+  /**
+   * @brief queue_group distributes requests between all instances of the service with the same
+   * queue group
+   */
+  ServiceOptions& queue_group(const std::string& group) noexcept
+  {
+    async_nats_service_config_queue_group(options_, group.c_str());
+    return *this;
+  }
+
+  /**
+   * @brief max_in_flight limits the number of requests that are passed to the handler and are not
+   * responded yet. Other requests wait in the queue.
+   */
+  ServiceOptions& max_in_flight(uint64_t count) noexcept
+  {
+    async_nats_service_config_max_in_flight(options_, count);
+    return *this;
+  }
+
+  /**
+   * @brief max_queued limits the number of requests that wait in the queue for a free in-flight
+   * slot. Requests that arrive when the queue is full are rejected with `503` status without
+   * calling the handler.
+   */
+  ServiceOptions& max_queued(uint64_t count) noexcept
+  {
+    async_nats_service_config_max_queued(options_, count);
+    return *this;
+  }
+
+  /**
+   * @brief queue_budget enables load shedding
+   *
+   * Requests that waited in the queue for longer than the budget are rejected with `503` status
+   * without calling the handler.
+   */
+  ServiceOptions& queue_budget(std::chrono::steady_clock::duration budget) noexcept
+  {
+    async_nats_service_config_queue_budget(
+        options_,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(budget).count()));
+    return *this;
+  }
+
+  const AsyncNatsServiceConfig* get_raw() const noexcept { return options_; }
+
+private:
+  AsyncNatsServiceConfig* options_;
+};
+
+class ServiceError : public Exception
+{
+public:
+  explicit ServiceError(const OwnedString& text)
+      : text_(static_cast<std::string_view>(text))
+  {
+  }
+
+  const char* what() const noexcept override { return text_.c_str(); }
+
+private:
+  std::string text_;
+};
+
+/**
+ * @brief The ServiceRequest class is a single request received by the Service
+ *
+ * The request occupies one in-flight slot of the service until it is responded or destroyed.
+ * Destroying the request without a response counts it as an error.
+ *
+ * @threadsafe This class is NOT thread safe but it may be moved to and responded from any thread
+ */
+class ServiceRequest
+{
+public:
+  explicit ServiceRequest(AsyncNatsServiceRequest* req) noexcept
+      : req_(req)
+  {
+  }
+
+  ServiceRequest(const ServiceRequest&) noexcept = delete;
+  ServiceRequest(ServiceRequest&& o) noexcept
+      : req_(o.req_)
+  {
+    o.req_ = nullptr;
+  }
+
+  ~ServiceRequest() noexcept
+  {
+    if (req_ != nullptr) {
+      async_nats_service_request_delete(req_);
+    }
+  }
+
+  ServiceRequest& operator=(const ServiceRequest&) noexcept = delete;
+  ServiceRequest& operator=(ServiceRequest&& o) noexcept
+  {
+    if (this == &o) {
+      return *this;
+    }
+
+    if (req_ != nullptr) {
+      async_nats_service_request_delete(req_);
+    }
+
+    req_ = o.req_;
+    o.req_ = nullptr;
+    return *this;
+  }
+
+  operator bool() const noexcept { return req_ != nullptr; }
+
+  /**
+   * @brief message returns the request message
+   *
+   * @note Message::reply_to() of this message is always empty. Use reply_to() instead.
+   */
+  Message message() const noexcept
+  {
+    assert(req_ != nullptr && "Request must be checked for null before usage");
+    return Message(async_nats_service_request_message(req_));
+  }
+
+  std::optional<std::string_view> reply_to() const noexcept
+  {
+    assert(req_ != nullptr && "Request must be checked for null before usage");
+    auto slice = async_nats_service_request_reply_to(req_);
+    if (slice.data != nullptr) {
+      return std::string_view(static_cast<const char*>(slice.data), slice.size);
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * @brief respond sends the reply. Data is copied before the function returns.
+   */
+  void respond(boost::asio::const_buffer data) noexcept
+  {
+    assert(req_ != nullptr && "Request must be checked for null before usage");
+    async_nats_service_request_respond(std::exchange(req_, nullptr),
+                                       AsyncNatsBorrowedMessage {data.data(), data.size()});
+  }
+
+private:
+  AsyncNatsServiceRequest* req_ = nullptr;
+};
+
+/**
+ * @brief The ServiceStatistics struct contains counters of the Service
+ */
+struct ServiceStatistics
+{
+  static constexpr std::size_t histogram_buckets = ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS;
+
+  ServiceStatistics() noexcept = default;
+
+  explicit ServiceStatistics(const AsyncNatsServiceStatistics& s) noexcept
+      : requests(s.requests)
+      , completed(s.completed)
+      , errors(s.errors)
+      , shed(s.shed)
+      , in_flight(s.in_flight)
+  {
+    for (std::size_t i = 0; i < histogram_buckets; ++i) {
+      processing_time[i] = s.processing_time_us[i];
+    }
+  }
+
+  /**
+   * @brief bucket_upper_bound returns exclusive upper bound of the processing time histogram
+   * bucket. The last bucket also counts all slower requests.
+   */
+  static std::chrono::microseconds bucket_upper_bound(std::size_t bucket) noexcept
+  {
+    return std::chrono::microseconds(uint64_t(1) << bucket);
+  }
+
+  uint64_t requests = 0;
+  uint64_t completed = 0;
+  uint64_t errors = 0;
+  uint64_t shed = 0;
+  uint64_t in_flight = 0;
+  std::array<uint64_t, histogram_buckets> processing_time {};
+};
+
+/**
+ * @brief The Service class is a running RPC responder
+ *
+ * The service stops receiving new requests when the object is destroyed.
+ *
+ * @threadsafe This class is thread safe
+ */
+class Service
+{
+public:
+  Service() noexcept = default;
+
+  explicit Service(AsyncNatsService* svc) noexcept
+      : svc_(svc)
+  {
+  }
+
+  Service(const Service&) noexcept = delete;
+  Service(Service&& o) noexcept
+      : svc_(o.svc_)
+  {
+    o.svc_ = nullptr;
+  }
+
+  ~Service() noexcept
+  {
+    if (svc_ != nullptr) {
+      async_nats_service_delete(svc_);
+    }
+  }
+
+  Service& operator=(const Service&) noexcept = delete;
+  Service& operator=(Service&& o) noexcept
+  {
+    if (this == &o) {
+      return *this;
+    }
+
+    if (svc_ != nullptr) {
+      async_nats_service_delete(svc_);
+    }
+
+    svc_ = o.svc_;
+    o.svc_ = nullptr;
+    return *this;
+  }
+
+  operator bool() const noexcept { return svc_ != nullptr; }
+
+  ServiceStatistics statistics() const noexcept
+  {
+    assert(svc_ != nullptr && "Service must be checked for null before usage");
+    return ServiceStatistics(async_nats_service_statistics(svc_));
+  }
+
+private:
+  AsyncNatsService* svc_ = nullptr;
+};
+
+namespace detail
+{
+template<class Handler>
+struct ServiceHandler
+{
+  static void call(AsyncNatsServiceRequest* req, void* ctx) noexcept
+  {
+    auto* h = static_cast<Handler*>(ctx);
+    ServiceRequest request(req);
+    try {
+      if constexpr (std::is_invocable_v<Handler&, ServiceRequest&&>) {
+        (*h)(std::move(request));
+      } else {
+        auto reply = (*h)(request.message());
+        request.respond(boost::asio::buffer(reply));
+      }
+    } catch (...) {
+      // request is dropped and counted as an error
+    }
+  }
+
+  static void drop(void* ctx) noexcept { delete static_cast<Handler*>(ctx); }
+};
+
+}  // namespace detail
+
+/**
+ * @brief start_service starts a new RPC responder on the connection
+ *
+ * The handler is called on the TokioRuntime thread for every request and must not block. It can
+ * have one of the following signatures:
+ * - `R(Message)` where R is a contiguous container of bytes (e.g. std::string or std::vector) that
+ *   is sent as the reply right after the handler returns;
+ * - `void(ServiceRequest&&)` where the request is responded later, possibly from another thread.
+ *
+ * The result of this operation is either a running Service or ServiceError in std::exception_ptr.
+ *
+ * @param conn - connection to use
+ * @param options - service options. They are copied and may be destroyed right after the call
+ * @param handler - request handler
+ * @param token - asio completion token
+ */
+template<class Handler, class CompletionToken>
+auto start_service(const Connection& conn,
+                   const ServiceOptions& options,
+                   Handler&& handler,
+                   CompletionToken&& completion_token)
+{
+  auto init = [](auto token,
+                 auto&& i_handler,
+                 std::reference_wrapper<const Connection> i_conn,
+                 std::reference_wrapper<const ServiceOptions> i_options)
+  {
+    using CH = std::decay_t<decltype(token)>;
+    using H = std::decay_t<decltype(i_handler)>;
+
+    static auto f = [](AsyncNatsService* svc, AsyncNatsOwnedString err, void* ctx)
+    {
+      auto* c = static_cast<CH*>(ctx);
+      if (svc == nullptr) {
+        (*c)(std::make_exception_ptr(ServiceError(OwnedString(err))), Service());
+      } else {
+        (*c)(nullptr, Service(svc));
+      }
+
+      detail::deallocate_ctx(c);
+    };
+
+    // handler is owned by the service and is deleted by the TokioRuntime when the service stops
+    const ::AsyncNatsServiceHandler service_handler {
+        &detail::ServiceHandler<H>::call,
+        &detail::ServiceHandler<H>::drop,
+        new H(std::forward<decltype(i_handler)>(i_handler))};
+
+    auto ctx = detail::allocate_ctx(std::move(token));
+    const ::AsyncNatsServiceStartCallback cb {f, ctx};
+    async_nats_service_start_async(
+        i_conn.get().get_raw(), i_options.get().get_raw(), service_handler, cb);
+  };
+
+  return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr, Service)>(
+      init,
+      completion_token,
+      std::forward<Handler>(handler),
+      std::cref(conn),
+      std::cref(options));
+}
+
+}  // namespace async_nats
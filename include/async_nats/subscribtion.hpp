@@ -1,10 +1,16 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include <boost/asio/async_result.hpp>
 
+#include <async_nats/detail/abort.hpp>
 #include <async_nats/detail/capi.h>
 #include <async_nats/detail/helpers.hpp>
 #include <async_nats/message.hpp>
+#include <async_nats/trace.hpp>
 
 namespace async_nats
 {
@@ -92,6 +98,25 @@ private:
   AsyncNatsSubscribtionCancellationToken* token_ = nullptr;
 };
 
+/**
+ * @brief The SubscribtionStatistics struct contains counters of messages delivered to the
+ * application
+ */
+struct SubscribtionStatistics
+{
+  SubscribtionStatistics() noexcept = default;
+
+  explicit SubscribtionStatistics(const AsyncNatsSubscribtionStatistics& s) noexcept
+      : messages(s.messages)
+      , bytes(s.bytes)
+  {
+  }
+
+  uint64_t messages = 0;
+  /// payload bytes
+  uint64_t bytes = 0;
+};
+
 /**
  * @brief The Subscribtion class
  *
@@ -157,6 +182,21 @@ public:
     return SubscribtionCancellationToken(async_nats_subscribtion_get_cancellation_token(sub_));
   }
 
+  /**
+   * @brief statistics returns counters of this subscribtion. Can be called while a receive
+   * operation is in progress.
+   */
+  SubscribtionStatistics statistics() const noexcept
+  {
+    return SubscribtionStatistics(async_nats_subscribtion_statistics(sub_));
+  }
+
+  /**
+   * @brief receive waits for the next message
+   *
+   * The result is an empty Message if the subscribtion is closed or the operation is cancelled
+   * with asio per-operation cancellation. Cancellation does not lose messages.
+   */
   template<class CompletionToken>
   auto receive(CompletionToken&& completion_token)
   {
@@ -167,18 +207,60 @@ public:
       static auto f = [](AsyncNatsMessage* msg, void* ctx)
       {
         auto* c = static_cast<CH*>(ctx);
+        detail::clear_abort_handle(*c);
+        ASYNC_NATS_TRACE(AsyncNats_Trace_Handler, ctx, {});
         (*c)(Message(msg));
         detail::deallocate_ctx(c);
       };
 
+      const auto* abort = detail::make_abort_handle(token);
       auto ctx = detail::allocate_ctx(std::move(token));
       const ::AsyncNatsReceiveCallback cb {f, ctx};
-      async_nats_subscribtion_receive_async(get_raw(), cb);
+      ASYNC_NATS_TRACE(AsyncNats_Trace_Initiate, ctx, {});
+      async_nats_subscribtion_receive_async(get_raw(), abort, cb);
     };
 
     return boost::asio::async_initiate<CompletionToken, void(Message)>(init, completion_token);
   }
 
+  /**
+   * @brief receive_batch waits for at least one message and takes up to max_messages messages
+   * that are already received
+   *
+   * The result is an empty vector if the subscribtion is closed or the operation is cancelled.
+   */
+  template<class CompletionToken>
+  auto receive_batch(std::size_t max_messages, CompletionToken&& completion_token)
+  {
+    auto init = [this](auto token, std::size_t i_max)
+    {
+      using CH = std::decay_t<decltype(token)>;
+
+      static auto f = [](AsyncNatsMessage* const* msgs, std::size_t count, void* ctx)
+      {
+        auto* c = static_cast<CH*>(ctx);
+        detail::clear_abort_handle(*c);
+        std::vector<Message> batch;
+        batch.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+          batch.emplace_back(msgs[i]);
+        }
+        ASYNC_NATS_TRACE(AsyncNats_Trace_Handler, ctx, {});
+        (*c)(std::move(batch));
+        detail::deallocate_ctx(c);
+      };
+
+      const auto* abort = detail::make_abort_handle(token);
+      auto ctx = detail::allocate_ctx(std::move(token));
+      const ::AsyncNatsReceiveBatchCallback cb {f, ctx};
+      ASYNC_NATS_TRACE(AsyncNats_Trace_Initiate, ctx, {});
+      async_nats_subscribtion_receive_batch_async(get_raw(), i_max, abort, cb);
+    };
+
+    return boost::asio::async_initiate<CompletionToken, void(std::vector<Message>)>(
+        init, completion_token, max_messages);
+  }
+
 private:
   AsyncNatsSubscribtion* sub_ = nullptr;
 };
@@ -0,0 +1,608 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+
+namespace async_nats::testing
+{
+/**
+ * @brief The ServerOptions class configures the in-process Server
+ */
+class ServerOptions
+{
+public:
+  /**
+   * @brief latency delays everything the server sends to a client. A request and its reply are
+   * delayed twice.
+   */
+  ServerOptions& latency(std::chrono::steady_clock::duration latency) noexcept
+  {
+    latency_ = latency;
+    return *this;
+  }
+
+  /**
+   * @brief bandwidth limits the number of bytes per second the server sends to each client
+   *
+   * @param bytes_per_second - the limit; 0 disables it
+   */
+  ServerOptions& bandwidth(std::size_t bytes_per_second) noexcept
+  {
+    bandwidth_ = bytes_per_second;
+    return *this;
+  }
+
+  /**
+   * @brief max_payload is announced to the clients. Bigger messages close the connection.
+   */
+  ServerOptions& max_payload(std::size_t bytes) noexcept
+  {
+    max_payload_ = bytes;
+    return *this;
+  }
+
+  /**
+   * @brief port sets the port to listen on. Default is 0 which picks a free port; pass the port
+   * of a stopped server to simulate its restart.
+   */
+  ServerOptions& port(uint16_t port) noexcept
+  {
+    port_ = port;
+    return *this;
+  }
+
+  std::chrono::steady_clock::duration latency() const noexcept { return latency_; }
+
+  std::size_t bandwidth() const noexcept { return bandwidth_; }
+
+  std::size_t max_payload() const noexcept { return max_payload_; }
+
+  uint16_t port() const noexcept { return port_; }
+
+private:
+  std::chrono::steady_clock::duration latency_ {0};
+  std::size_t bandwidth_ = 0;
+  std::size_t max_payload_ = 1024 * 1024;
+  uint16_t port_ = 0;
+};
+
+namespace detail
+{
+/**
+ * @brief subject_matches checks the subject against the subscribtion subject that may contain
+ * `*` and `>` wildcards
+ */
+inline bool subject_matches(std::string_view pattern, std::string_view subject) noexcept
+{
+  for (;;) {
+    const auto pattern_end = pattern.find('.');
+    const auto subject_end = subject.find('.');
+    const auto pattern_token = pattern.substr(0, pattern_end);
+    if (pattern_token == ">") {
+      return !subject.empty();
+    }
+    if (pattern_token != "*" && pattern_token != subject.substr(0, subject_end)) {
+      return false;
+    }
+    if (pattern_end == std::string_view::npos || subject_end == std::string_view::npos) {
+      return pattern_end == subject_end;
+    }
+    pattern.remove_prefix(pattern_end + 1);
+    subject.remove_prefix(subject_end + 1);
+  }
+}
+
+/// Tokens splits the protocol line by whitespace without allocations
+struct Tokens
+{
+  explicit Tokens(std::string_view line) noexcept
+  {
+    while (size < items.size()) {
+      const auto begin = line.find_first_not_of(" \t");
+      if (begin == std::string_view::npos) {
+        break;
+      }
+      line.remove_prefix(begin);
+      const auto end = line.find_first_of(" \t");
+      items[size++] = line.substr(0, end);
+      if (end == std::string_view::npos) {
+        break;
+      }
+      line.remove_prefix(end);
+    }
+  }
+
+  std::array<std::string_view, 6> items {};
+  std::size_t size = 0;
+};
+
+inline bool parse_size(std::string_view text, std::size_t& value) noexcept
+{
+  if (text.empty()) {
+    return false;
+  }
+  value = 0;
+  for (const char c : text) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    value = value * 10 + static_cast<std::size_t>(c - '0');
+  }
+  return true;
+}
+
+inline bool equals_ignore_case(std::string_view a, std::string_view b) noexcept
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if ((a[i] | 0x20) != (b[i] | 0x20)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct ServerSubscription
+{
+  std::string subject;
+  std::string queue;
+  std::string sid;
+  /// messages delivered so far
+  uint64_t delivered = 0;
+  /// total number of messages after which the subscribtion is removed; 0 if there is no limit
+  uint64_t max = 0;
+  bool done = false;
+};
+
+class ServerSession;
+
+struct ServerState
+{
+  explicit ServerState(const ServerOptions& o)
+      : options(o)
+  {
+  }
+
+  void route(ServerSession& from,
+             std::string_view subject,
+             std::string_view reply,
+             std::string_view headers,
+             std::string_view payload);
+
+  ServerOptions options;
+  uint16_t port = 0;
+  uint64_t next_client_id = 1;
+  std::unordered_map<uint64_t, std::shared_ptr<ServerSession>> sessions;
+  /// picks the queue group member; fixed seed keeps runs reproducible
+  std::minstd_rand rng {42};
+};
+
+/**
+ * @brief The ServerSession class serves one client connection. It is used only by the thread of
+ * the server.
+ */
+class ServerSession : public std::enable_shared_from_this<ServerSession>
+{
+public:
+  ServerSession(boost::asio::ip::tcp::socket socket, ServerState& state, uint64_t id)
+      : socket_(std::move(socket))
+      , delay_timer_(socket_.get_executor())
+      , pace_timer_(socket_.get_executor())
+      , state_(state)
+      , id_(id)
+  {
+  }
+
+  void start()
+  {
+    send("INFO {\"server_id\":\"ASYNC_NATS_TESTING\",\"server_name\":\"async_nats_testing\","
+         "\"version\":\"2.10.0\",\"go\":\"none\",\"host\":\"127.0.0.1\",\"port\":"
+         + std::to_string(state_.port) + ",\"headers\":true,\"max_payload\":"
+         + std::to_string(state_.options.max_payload()) + ",\"proto\":1,\"client_id\":"
+         + std::to_string(id_) + ",\"client_ip\":\"127.0.0.1\"}\r\n");
+    read();
+  }
+
+  void close()
+  {
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    boost::system::error_code ec;
+    socket_.close(ec);
+    delay_timer_.cancel();
+    pace_timer_.cancel();
+    // the session may be the last reference to itself
+    auto self = shared_from_this();
+    state_.sessions.erase(id_);
+  }
+
+  void deliver(ServerSubscription& sub,
+               std::string_view subject,
+               std::string_view reply,
+               std::string_view headers,
+               std::string_view payload)
+  {
+    std::string msg;
+    msg.reserve(subject.size() + reply.size() + headers.size() + payload.size() + 64);
+    msg.append(headers.empty() ? "MSG " : "HMSG ").append(subject).append(" ").append(sub.sid);
+    if (!reply.empty()) {
+      msg.append(" ").append(reply);
+    }
+    if (!headers.empty()) {
+      msg.append(" ").append(std::to_string(headers.size()));
+    }
+    msg.append(" ").append(std::to_string(headers.size() + payload.size())).append("\r\n");
+    msg.append(headers).append(payload).append("\r\n");
+    send(std::move(msg));
+
+    ++sub.delivered;
+    if (sub.max != 0 && sub.delivered >= sub.max) {
+      sub.done = true;
+    }
+  }
+
+  void remove_done()
+  {
+    subs.erase(std::remove_if(subs.begin(), subs.end(), [](const auto& s) { return s.done; }),
+               subs.end());
+  }
+
+  std::vector<ServerSubscription> subs;
+  bool no_responders = false;
+
+private:
+  void read()
+  {
+    socket_.async_read_some(
+        boost::asio::buffer(read_buffer_),
+        [self = shared_from_this()](boost::system::error_code ec, std::size_t n)
+        {
+          if (ec || self->closed_) {
+            self->close();
+            return;
+          }
+          self->input_.append(self->read_buffer_.data(), n);
+          if (self->process()) {
+            self->read();
+          } else {
+            self->flush();
+          }
+        });
+  }
+
+  /// processes every complete protocol message; returns false if the session is closed
+  bool process()
+  {
+    std::size_t pos = 0;
+    for (;;) {
+      const auto eol = input_.find("\r\n", pos);
+      if (eol == std::string::npos) {
+        break;
+      }
+      const Tokens t(std::string_view(input_).substr(pos, eol - pos));
+      const auto op = t.size == 0 ? std::string_view() : t.items[0];
+
+      if (equals_ignore_case(op, "PUB") || equals_ignore_case(op, "HPUB")) {
+        const bool with_headers = op.size() == 4;
+        const std::size_t args = t.size - 1;
+        const std::size_t sizes = with_headers ? 2 : 1;
+        std::size_t header_size = 0;
+        std::size_t total_size = 0;
+        if (args < sizes + 1 || args > sizes + 2 || !parse_size(t.items[t.size - 1], total_size)
+            || (with_headers && !parse_size(t.items[t.size - 2], header_size))
+            || header_size > total_size)
+        {
+          return error("Unknown Protocol Operation");
+        }
+        if (total_size > state_.options.max_payload()) {
+          return error("Maximum Payload Violation");
+        }
+        if (input_.size() < eol + 2 + total_size + 2) {
+          break;
+        }
+        const auto body = std::string_view(input_).substr(eol + 2, total_size);
+        state_.route(*this,
+                     t.items[1],
+                     args == sizes + 2 ? t.items[2] : std::string_view(),
+                     body.substr(0, header_size),
+                     body.substr(header_size));
+        pos = eol + 2 + total_size + 2;
+        if (closed_) {
+          return false;
+        }
+        continue;
+      }
+
+      if (equals_ignore_case(op, "PING")) {
+        send("PONG\r\n");
+      } else if (equals_ignore_case(op, "PONG")) {
+      } else if (equals_ignore_case(op, "CONNECT")) {
+        const auto line = std::string_view(input_).substr(pos, eol - pos);
+        no_responders = line.find("\"no_responders\":true") != std::string_view::npos
+            && line.find("\"headers\":true") != std::string_view::npos;
+      } else if (equals_ignore_case(op, "SUB") && (t.size == 3 || t.size == 4)) {
+        subs.push_back({std::string(t.items[1]),
+                        t.size == 4 ? std::string(t.items[2]) : std::string(),
+                        std::string(t.items[t.size - 1])});
+      } else if (equals_ignore_case(op, "UNSUB") && (t.size == 2 || t.size == 3)) {
+        std::size_t max = 0;
+        if (t.size == 3 && !parse_size(t.items[2], max)) {
+          return error("Unknown Protocol Operation");
+        }
+        // the limit counts the messages that were already delivered
+        for (auto& sub : subs) {
+          if (sub.sid == t.items[1]) {
+            sub.max = max;
+            sub.done = max == 0 || sub.delivered >= max;
+          }
+        }
+        remove_done();
+      } else {
+        return error("Unknown Protocol Operation");
+      }
+      pos = eol + 2;
+    }
+    input_.erase(0, pos);
+    return true;
+  }
+
+  bool error(std::string_view text)
+  {
+    send("-ERR '" + std::string(text) + "'\r\n");
+    closing_ = true;
+    return false;
+  }
+
+  /// sends the data after the configured latency; the order is preserved
+  void send(std::string data)
+  {
+    const auto latency = state_.options.latency();
+    if (latency.count() == 0) {
+      output_.append(data);
+      flush();
+      return;
+    }
+
+    delayed_.emplace_back(std::chrono::steady_clock::now() + latency, std::move(data));
+    if (delayed_.size() == 1) {
+      arm_delay();
+    }
+  }
+
+  void arm_delay()
+  {
+    delay_timer_.expires_at(delayed_.front().first);
+    delay_timer_.async_wait(
+        [self = shared_from_this()](boost::system::error_code ec)
+        {
+          if (ec || self->closed_) {
+            return;
+          }
+          const auto now = std::chrono::steady_clock::now();
+          while (!self->delayed_.empty() && self->delayed_.front().first <= now) {
+            self->output_.append(self->delayed_.front().second);
+            self->delayed_.pop_front();
+          }
+          self->flush();
+          if (!self->delayed_.empty()) {
+            self->arm_delay();
+          }
+        });
+  }
+
+  void flush()
+  {
+    if (writing_ || closed_) {
+      return;
+    }
+    if (output_.empty()) {
+      if (closing_ && delayed_.empty()) {
+        close();
+      }
+      return;
+    }
+
+    // with the bandwidth limit data is written in chunks of 10ms worth of bandwidth
+    const auto bandwidth = state_.options.bandwidth();
+    const auto chunk = bandwidth == 0
+        ? output_.size()
+        : std::min(output_.size(), std::max<std::size_t>(bandwidth / 100, 1));
+    write_buffer_.assign(output_, 0, chunk);
+    output_.erase(0, chunk);
+    writing_ = true;
+
+    boost::asio::async_write(
+        socket_,
+        boost::asio::buffer(write_buffer_),
+        [self = shared_from_this(), bandwidth](boost::system::error_code ec, std::size_t n)
+        {
+          if (ec || self->closed_) {
+            self->close();
+            return;
+          }
+          if (bandwidth == 0) {
+            self->writing_ = false;
+            self->flush();
+            return;
+          }
+          self->pace_timer_.expires_after(std::chrono::microseconds(n * 1'000'000 / bandwidth));
+          self->pace_timer_.async_wait(
+              [self](boost::system::error_code wait_ec)
+              {
+                if (wait_ec || self->closed_) {
+                  return;
+                }
+                self->writing_ = false;
+                self->flush();
+              });
+        });
+  }
+
+  boost::asio::ip::tcp::socket socket_;
+  boost::asio::steady_timer delay_timer_;
+  boost::asio::steady_timer pace_timer_;
+  ServerState& state_;
+  uint64_t id_;
+
+  std::array<char, 64 * 1024> read_buffer_ {};
+  std::string input_;
+  std::string output_;
+  std::string write_buffer_;
+  std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> delayed_;
+  bool writing_ = false;
+  bool closing_ = false;
+  bool closed_ = false;
+};
+
+inline void ServerState::route(ServerSession& from,
+                               std::string_view subject,
+                               std::string_view reply,
+                               std::string_view headers,
+                               std::string_view payload)
+{
+  bool delivered = false;
+  std::unordered_map<std::string_view, std::vector<std::pair<ServerSession*, ServerSubscription*>>>
+      groups;
+
+  for (auto& [id, session] : sessions) {
+    for (auto& sub : session->subs) {
+      if (sub.done || !subject_matches(sub.subject, subject)) {
+        continue;
+      }
+      if (sub.queue.empty()) {
+        session->deliver(sub, subject, reply, headers, payload);
+        delivered = true;
+      } else {
+        groups[sub.queue].emplace_back(session.get(), &sub);
+      }
+    }
+  }
+
+  // every queue group gets one copy of the message
+  for (auto& [queue, members] : groups) {
+    auto& [session, sub] = members[rng() % members.size()];
+    session->deliver(*sub, subject, reply, headers, payload);
+    delivered = true;
+  }
+
+  if (!delivered && !reply.empty() && from.no_responders) {
+    for (auto& sub : from.subs) {
+      if (!sub.done && subject_matches(sub.subject, reply)) {
+        from.deliver(sub, reply, {}, "NATS/1.0 503\r\n\r\n", {});
+        break;
+      }
+    }
+  }
+
+  for (auto& [id, session] : sessions) {
+    session->remove_done();
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @brief The Server class is an in-process NATS server for hermetic tests and benchmarks
+ *
+ * It implements the core client protocol (INFO, CONNECT, PUB/HPUB, SUB/UNSUB with queue groups and
+ * wildcards, MSG/HMSG, PING/PONG and no-responders replies) on a loopback port with its own
+ * thread. There is no authentication, TLS, clustering or JetStream.
+ *
+ * Injected latency and bandwidth limits make results reproducible regardless of the network.
+ */
+class Server
+{
+public:
+  explicit Server(const ServerOptions& options = {})
+      : state_(std::make_unique<detail::ServerState>(options))
+      , acceptor_(io_, {boost::asio::ip::address_v4::loopback(), options.port()})
+  {
+    state_->port = acceptor_.local_endpoint().port();
+    accept();
+    thread_ = std::thread([this] { io_.run(); });
+  }
+
+  Server(const Server&) = delete;
+  Server(Server&&) = delete;
+
+  ~Server() noexcept { stop(); }
+
+  Server& operator=(const Server&) = delete;
+  Server& operator=(Server&&) = delete;
+
+  uint16_t port() const noexcept { return state_->port; }
+
+  /**
+   * @brief url returns the address to pass to ConnectionOptions::address
+   */
+  std::string url() const { return "nats://127.0.0.1:" + std::to_string(port()); }
+
+  /**
+   * @brief stop closes every client connection and stops the server
+   */
+  void stop() noexcept
+  {
+    if (!thread_.joinable()) {
+      return;
+    }
+    boost::asio::post(io_,
+                      [this]
+                      {
+                        boost::system::error_code ec;
+                        acceptor_.close(ec);
+                        auto sessions = std::move(state_->sessions);
+                        for (auto& [id, session] : sessions) {
+                          session->close();
+                        }
+                      });
+    thread_.join();
+  }
+
+private:
+  void accept()
+  {
+    acceptor_.async_accept(
+        [this](boost::system::error_code ec, boost::asio::ip::tcp::socket socket)
+        {
+          if (ec) {
+            return;
+          }
+          boost::system::error_code nodelay_ec;
+          socket.set_option(boost::asio::ip::tcp::no_delay(true), nodelay_ec);
+          const auto id = state_->next_client_id++;
+          auto session = std::make_shared<detail::ServerSession>(std::move(socket), *state_, id);
+          state_->sessions.emplace(id, session);
+          session->start();
+          accept();
+        });
+  }
+
+  boost::asio::io_context io_;
+  std::unique_ptr<detail::ServerState> state_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  std::thread thread_;
+};
+
+}  // namespace async_nats::testing
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "async_nats/detail/capi.h"
 
@@ -14,7 +18,11 @@ public:
   {
   }
 
-  TokioRuntimeConfig(const TokioRuntimeConfig&) = delete;
+  /// a copy of a moved-from config is moved-from as well
+  TokioRuntimeConfig(const TokioRuntimeConfig& o) noexcept
+      : cfg_(o.cfg_ == nullptr ? nullptr : async_nats_tokio_runtime_config_clone(o.cfg_))
+  {
+  }
 
   TokioRuntimeConfig(TokioRuntimeConfig&& o) noexcept
       : cfg_(o.cfg_)
@@ -29,7 +37,19 @@ public:
     }
   }
 
-  TokioRuntimeConfig& operator=(const TokioRuntimeConfig&) = delete;
+  TokioRuntimeConfig& operator=(const TokioRuntimeConfig& o) noexcept
+  {
+    if (this == &o) {
+      return *this;
+    }
+
+    if (cfg_ != nullptr) {
+      async_nats_tokio_runtime_config_delete(cfg_);
+    }
+
+    cfg_ = o.cfg_ == nullptr ? nullptr : async_nats_tokio_runtime_config_clone(o.cfg_);
+    return *this;
+  }
 
   TokioRuntimeConfig& operator=(TokioRuntimeConfig&& o) noexcept
   {
@@ -59,6 +79,85 @@ public:
     return *this;
   }
 
+  /**
+   * @brief flavor selects the scheduler. Multi thread runtime is used by default. Current thread
+   * runtime runs all tasks on a single dedicated thread; thread_count is ignored in this case.
+   *
+   * Caller-driven runtime has no threads at all and runs only inside TokioRuntime::poll() and
+   * TokioRuntime::poll_for(). Use IoContextDriver to run it inside an asio io_context.
+   */
+  TokioRuntimeConfig& flavor(AsyncNatsRuntimeFlavor flavor) noexcept
+  {
+    async_nats_tokio_runtime_config_flavor(cfg_, flavor);
+    return *this;
+  }
+
+  /**
+   * @brief event_interval sets the number of scheduler ticks after which the scheduler polls for
+   * external events (timers, I/O)
+   */
+  TokioRuntimeConfig& event_interval(uint32_t interval) noexcept
+  {
+    async_nats_tokio_runtime_config_event_interval(cfg_, interval);
+    return *this;
+  }
+
+  /**
+   * @brief global_queue_interval sets the number of scheduler ticks after which the scheduler
+   * polls the global task queue
+   *
+   * @throws std::invalid_argument if interval is 0
+   */
+  TokioRuntimeConfig& global_queue_interval(uint32_t interval)
+  {
+    if (!async_nats_tokio_runtime_config_global_queue_interval(cfg_, interval)) {
+      throw std::invalid_argument(
+          "async_nats::TokioRuntimeConfig: global queue interval must be positive");
+    }
+    return *this;
+  }
+
+  /**
+   * @brief max_blocking_threads limits the number of threads spawned for blocking operations
+   *
+   * @throws std::invalid_argument if count is 0
+   */
+  TokioRuntimeConfig& max_blocking_threads(uint32_t count)
+  {
+    if (!async_nats_tokio_runtime_config_max_blocking_threads(cfg_, count)) {
+      throw std::invalid_argument(
+          "async_nats::TokioRuntimeConfig: max blocking threads must be positive");
+    }
+    return *this;
+  }
+
+  /**
+   * @brief thread_keep_alive sets the time that idle blocking threads are kept alive
+   */
+  TokioRuntimeConfig& thread_keep_alive(std::chrono::steady_clock::duration keep_alive) noexcept
+  {
+    async_nats_tokio_runtime_config_thread_keep_alive(
+        cfg_,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(keep_alive).count()));
+    return *this;
+  }
+
+  /**
+   * @brief cpu_affinity pins every runtime thread to the set of CPUs. Supported on Linux only.
+   *
+   * Threads that could not be pinned are counted in TokioRuntimeMetrics::affinity_failures.
+   *
+   * @throws std::out_of_range if a CPU does not fit into the affinity mask of the system
+   */
+  TokioRuntimeConfig& cpu_affinity(const std::vector<std::size_t>& cpus)
+  {
+    if (!async_nats_tokio_runtime_config_cpu_affinity(cfg_, cpus.data(), cpus.size())) {
+      throw std::out_of_range("async_nats::TokioRuntimeConfig: CPU is out of range");
+    }
+    return *this;
+  }
+
   AsyncNatsTokioRuntimeConfig* get_raw() noexcept { return cfg_; }
 
   const AsyncNatsTokioRuntimeConfig* get_raw() const noexcept { return cfg_; }
@@ -67,6 +166,127 @@ private:
   AsyncNatsTokioRuntimeConfig* cfg_;
 };
 
+/**
+ * @brief The TokioWorkerMetrics struct contains scheduler counters of a single worker thread
+ *
+ * Counters are monotonic since the runtime start; queue depth is an instant value.
+ */
+struct TokioWorkerMetrics
+{
+  TokioWorkerMetrics() noexcept = default;
+
+  explicit TokioWorkerMetrics(const AsyncNatsWorkerMetrics& m) noexcept
+      : busy_time(m.busy_time_us)
+      , polls(m.polls)
+      , steals(m.steals)
+      , steal_operations(m.steal_operations)
+      , local_schedules(m.local_schedules)
+      , overflows(m.overflows)
+      , parks(m.parks)
+      , local_queue_depth(m.local_queue_depth)
+  {
+  }
+
+  std::chrono::microseconds busy_time {0};
+  uint64_t polls = 0;
+  uint64_t steals = 0;
+  uint64_t steal_operations = 0;
+  uint64_t local_schedules = 0;
+  uint64_t overflows = 0;
+  uint64_t parks = 0;
+  std::size_t local_queue_depth = 0;
+};
+
+/**
+ * @brief The TokioRuntimeMetrics struct is a snapshot of the TokioRuntime scheduler counters
+ *
+ * Tokio collects these counters only when the library is built with the
+ * ASYNC_NATS_RUNTIME_METRICS CMake option. Otherwise `available` is false and everything is zero.
+ */
+struct TokioRuntimeMetrics
+{
+  /**
+   * @brief busy_time returns the time all workers spent polling tasks
+   */
+  std::chrono::microseconds busy_time() const noexcept
+  {
+    std::chrono::microseconds total {0};
+    for (const auto& w : workers) {
+      total += w.busy_time;
+    }
+    return total;
+  }
+
+  uint64_t polls() const noexcept
+  {
+    uint64_t total = 0;
+    for (const auto& w : workers) {
+      total += w.polls;
+    }
+    return total;
+  }
+
+  uint64_t steals() const noexcept
+  {
+    uint64_t total = 0;
+    for (const auto& w : workers) {
+      total += w.steals;
+    }
+    return total;
+  }
+
+  /**
+   * @brief scheduled returns the number of tasks scheduled both from workers and from outside
+   */
+  uint64_t scheduled() const noexcept
+  {
+    uint64_t total = remote_schedules;
+    for (const auto& w : workers) {
+      total += w.local_schedules;
+    }
+    return total;
+  }
+
+  std::size_t local_queue_depth() const noexcept
+  {
+    std::size_t total = 0;
+    for (const auto& w : workers) {
+      total += w.local_queue_depth;
+    }
+    return total;
+  }
+
+  /**
+   * @brief utilization returns the share of time workers were busy between two snapshots
+   *
+   * A value close to 1.0 means that the runtime is saturated.
+   */
+  static double utilization(const TokioRuntimeMetrics& before,
+                            const TokioRuntimeMetrics& after,
+                            std::chrono::steady_clock::duration elapsed) noexcept
+  {
+    const auto capacity =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+        * static_cast<int64_t>(after.workers.size());
+    if (capacity <= 0) {
+      return 0.0;
+    }
+    return static_cast<double>((after.busy_time() - before.busy_time()).count())
+        / static_cast<double>(capacity);
+  }
+
+  bool available = false;
+  uint64_t remote_schedules = 0;
+  std::size_t global_queue_depth = 0;
+  std::size_t blocking_threads = 0;
+  std::size_t idle_blocking_threads = 0;
+  std::size_t blocking_queue_depth = 0;
+  /// runtime threads that could not be pinned to the configured CPUs, collected even if the
+  /// other counters are not available
+  uint64_t affinity_failures = 0;
+  std::vector<TokioWorkerMetrics> workers;
+};
+
 class TokioRuntime
 {
 public:
@@ -110,6 +330,49 @@ public:
 
   operator bool() const noexcept { return rt_ != nullptr; }
 
+  /**
+   * @brief poll runs ready tasks of the caller-driven runtime and processes I/O without waiting
+   *
+   * Tasks woken by that I/O run before the call returns. Completion handlers are invoked from
+   * this call. It must not be called from a completion handler.
+   */
+  void poll() const noexcept { async_nats_tokio_runtime_poll(rt_); }
+
+  /**
+   * @brief poll_for runs tasks of the caller-driven runtime for the given duration
+   *
+   * Completion handlers are invoked from this call. It must not be called from a completion
+   * handler.
+   */
+  void poll_for(std::chrono::steady_clock::duration duration) const noexcept
+  {
+    async_nats_tokio_runtime_poll_for(
+        rt_,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+  }
+
+  /**
+   * @brief metrics returns a snapshot of the scheduler counters
+   */
+  TokioRuntimeMetrics metrics() const
+  {
+    const auto m = async_nats_tokio_runtime_metrics(rt_);
+    TokioRuntimeMetrics result;
+    result.available = m.available;
+    result.remote_schedules = m.remote_schedules;
+    result.global_queue_depth = m.global_queue_depth;
+    result.blocking_threads = m.blocking_threads;
+    result.idle_blocking_threads = m.idle_blocking_threads;
+    result.blocking_queue_depth = m.blocking_queue_depth;
+    result.affinity_failures = m.affinity_failures;
+    result.workers.reserve(m.workers);
+    for (std::size_t i = 0; i < m.workers; ++i) {
+      result.workers.emplace_back(async_nats_tokio_runtime_worker_metrics(rt_, i));
+    }
+    return result;
+  }
+
   const AsyncNatsTokioRuntime* get_raw() const noexcept { return rt_; }
 
 private:
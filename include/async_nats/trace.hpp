@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include <async_nats/detail/capi.h>
+
+/**
+ * ASYNC_NATS_TRACE reports a stage of the operation that is observed by the C++ wrapper. The
+ * operation is identified by its completion context.
+ *
+ * Tracing is compiled in only if ASYNC_NATS_TRACE_HOOKS is defined and the Rust library is built
+ * with the `trace-hooks` feature (both are set by the ASYNC_NATS_TRACE_HOOKS CMake option).
+ * Otherwise the macro expands to nothing and its arguments are not evaluated.
+ */
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+#  define ASYNC_NATS_TRACE(stage, ctx, subject) ::async_nats::detail::trace(stage, ctx, subject)
+#else
+#  define ASYNC_NATS_TRACE(stage, ctx, subject) static_cast<void>(0)
+#endif
+
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+namespace async_nats
+{
+using TraceStage = AsyncNatsTraceStage;
+using TraceEvent = AsyncNatsTraceEvent;
+
+/**
+ * @brief set_trace_hook registers the function that receives the trace events of every operation
+ *
+ * The hook is called synchronously by the thread that reaches the stage: the caller of the
+ * operation, a tokio worker or the completion handler. It must be thread safe and fast. Pass
+ * nullptr to disable tracing.
+ *
+ * @note Hooks are expected to be set once at startup; every call leaks a few bytes.
+ */
+inline void set_trace_hook(void (*hook)(const TraceEvent*, void*), void* ctx = nullptr) noexcept
+{
+  async_nats_trace_set_hook(AsyncNatsTraceHook {hook, ctx});
+}
+
+/**
+ * @brief subject returns the subject of the traced message; empty if the stage does not know it
+ */
+inline std::string_view subject(const TraceEvent& event) noexcept
+{
+  if (event.subject.data == nullptr) {
+    return {};
+  }
+  return {static_cast<const char*>(event.subject.data), event.subject.size};
+}
+
+namespace detail
+{
+inline void trace(TraceStage stage, const void* ctx, std::string_view subject) noexcept
+{
+  async_nats_trace_emit(stage,
+                        reinterpret_cast<std::uintptr_t>(ctx),
+                        AsyncNatsSlice {subject.data(), subject.size()});
+}
+
+}  // namespace detail
+}  // namespace async_nats
+#endif
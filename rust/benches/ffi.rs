@@ -0,0 +1,243 @@
+//! Measures the cost of the `extern "C"` functions that can be called without a
+//! server. Functions are called through their C declarations so the compiler
+//! can not inline them, the same way the C++ wrapper calls them.
+//!
+//! Run with `cargo bench --bench ffi`.
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use std::ffi::{c_char, c_void};
+
+// only the exported symbols of the library are used
+extern crate nats_fabric;
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct AsyncNatsSlice {
+    data: *const c_void,
+    size: u64,
+}
+
+impl AsyncNatsSlice {
+    fn new(s: &str) -> Self {
+        Self {
+            data: s.as_ptr() as *const c_void,
+            size: s.len() as u64,
+        }
+    }
+}
+
+#[repr(C)]
+struct AsyncNatsHeader {
+    key: AsyncNatsSlice,
+    value: AsyncNatsSlice,
+}
+
+enum AsyncNatsMessage {}
+enum AsyncNatsHeaderIterator {}
+enum AsyncNatsAbortHandle {}
+enum AsyncNatsRequest {}
+enum AsyncNatsConnetionParams {}
+
+extern "C" {
+    fn async_nats_message_new(
+        topic: AsyncNatsSlice,
+        reply_to: AsyncNatsSlice,
+        data: AsyncNatsSlice,
+        headers: *const AsyncNatsHeader,
+        headers_count: u64,
+    ) -> *mut AsyncNatsMessage;
+    fn async_nats_message_clone(msg: *mut AsyncNatsMessage) -> *mut AsyncNatsMessage;
+    fn async_nats_message_delete(msg: *mut AsyncNatsMessage);
+    fn async_nats_message_topic(msg: *const AsyncNatsMessage) -> AsyncNatsSlice;
+    fn async_nats_message_data(msg: *const AsyncNatsMessage) -> AsyncNatsSlice;
+    fn async_nats_message_reply_to(msg: *const AsyncNatsMessage) -> AsyncNatsSlice;
+    fn async_nats_message_has_headers(msg: *mut AsyncNatsMessage) -> bool;
+    fn async_nats_message_status(msg: *const AsyncNatsMessage) -> u16;
+    fn async_nats_message_description(msg: *const AsyncNatsMessage) -> AsyncNatsSlice;
+    fn async_nats_message_length(msg: *const AsyncNatsMessage) -> u64;
+    fn async_nats_message_to_string(msg: *const AsyncNatsMessage) -> *mut c_char;
+    fn async_nats_owned_string_delete(s: *mut c_char);
+    fn async_nats_message_header_iterator(
+        msg: *const AsyncNatsMessage,
+    ) -> *mut AsyncNatsHeaderIterator;
+    fn async_nats_message_get_header(
+        msg: *const AsyncNatsMessage,
+        header: AsyncNatsSlice,
+    ) -> *mut AsyncNatsHeaderIterator;
+    fn async_nats_message_header_iterator_copy(p: *mut AsyncNatsHeaderIterator);
+    fn async_nats_message_header_iterator_free(p: *mut AsyncNatsHeaderIterator);
+    fn async_nats_message_header_iterator_next(p: *mut AsyncNatsHeaderIterator) -> bool;
+    fn async_nats_message_header_iterator_key(p: *mut AsyncNatsHeaderIterator) -> AsyncNatsSlice;
+    fn async_nats_message_header_iterator_value_count(p: *mut AsyncNatsHeaderIterator) -> u64;
+    fn async_nats_message_header_iterator_value_at(
+        p: *mut AsyncNatsHeaderIterator,
+        index: u64,
+    ) -> AsyncNatsSlice;
+    fn async_nats_abort_handle_new() -> *mut AsyncNatsAbortHandle;
+    fn async_nats_abort_handle_abort(handle: *const AsyncNatsAbortHandle);
+    fn async_nats_abort_handle_delete(handle: *mut AsyncNatsAbortHandle);
+    fn async_nats_request_new() -> *mut AsyncNatsRequest;
+    fn async_nats_request_timeout(req: *mut AsyncNatsRequest, timeout: u64);
+    fn async_nats_request_delete(req: *mut AsyncNatsRequest);
+    fn async_nats_connection_config_new() -> *mut AsyncNatsConnetionParams;
+    fn async_nats_connection_config_delete(cfg: *mut AsyncNatsConnetionParams);
+}
+
+/// Synthetic message with a reply subject, 128 bytes of payload and 3 headers
+fn synthetic_message() -> *mut AsyncNatsMessage {
+    let payload = "x".repeat(128);
+    let headers = [
+        AsyncNatsHeader {
+            key: AsyncNatsSlice::new("Nats-Msg-Id"),
+            value: AsyncNatsSlice::new("2f2a5c1e"),
+        },
+        AsyncNatsHeader {
+            key: AsyncNatsSlice::new("Content-Type"),
+            value: AsyncNatsSlice::new("application/json"),
+        },
+        AsyncNatsHeader {
+            key: AsyncNatsSlice::new("Trace"),
+            value: AsyncNatsSlice::new("00-4bf92f3577b34da6-01"),
+        },
+    ];
+    unsafe {
+        async_nats_message_new(
+            AsyncNatsSlice::new("orders.eu.created"),
+            AsyncNatsSlice::new("_INBOX.bench.reply"),
+            AsyncNatsSlice::new(&payload),
+            headers.as_ptr(),
+            headers.len() as u64,
+        )
+    }
+}
+
+fn message(c: &mut Criterion) {
+    let msg = synthetic_message();
+    let mut g = c.benchmark_group("message");
+
+    g.bench_function("new_delete", |b| {
+        b.iter(|| unsafe { async_nats_message_delete(black_box(synthetic_message())) })
+    });
+    g.bench_function("clone_delete", |b| {
+        b.iter(|| unsafe { async_nats_message_delete(async_nats_message_clone(black_box(msg))) })
+    });
+    g.bench_function("topic", |b| {
+        b.iter(|| unsafe { async_nats_message_topic(black_box(msg)) })
+    });
+    g.bench_function("data", |b| {
+        b.iter(|| unsafe { async_nats_message_data(black_box(msg)) })
+    });
+    g.bench_function("reply_to", |b| {
+        b.iter(|| unsafe { async_nats_message_reply_to(black_box(msg)) })
+    });
+    g.bench_function("has_headers", |b| {
+        b.iter(|| unsafe { async_nats_message_has_headers(black_box(msg)) })
+    });
+    g.bench_function("status", |b| {
+        b.iter(|| unsafe { async_nats_message_status(black_box(msg)) })
+    });
+    g.bench_function("description", |b| {
+        b.iter(|| unsafe { async_nats_message_description(black_box(msg)) })
+    });
+    g.bench_function("length", |b| {
+        b.iter(|| unsafe { async_nats_message_length(black_box(msg)) })
+    });
+    g.bench_function("to_string", |b| {
+        b.iter(|| unsafe {
+            async_nats_owned_string_delete(async_nats_message_to_string(black_box(msg)))
+        })
+    });
+    g.finish();
+
+    unsafe { async_nats_message_delete(msg) };
+}
+
+fn headers(c: &mut Criterion) {
+    let msg = synthetic_message();
+    let mut g = c.benchmark_group("headers");
+
+    g.bench_function("iterator_free", |b| {
+        b.iter(|| unsafe {
+            async_nats_message_header_iterator_free(async_nats_message_header_iterator(black_box(
+                msg,
+            )))
+        })
+    });
+    g.bench_function("get_header_free", |b| {
+        let name = AsyncNatsSlice::new("Content-Type");
+        b.iter(|| unsafe {
+            async_nats_message_header_iterator_free(async_nats_message_get_header(
+                black_box(msg),
+                black_box(name),
+            ))
+        })
+    });
+    g.bench_function("walk", |b| {
+        b.iter(|| unsafe {
+            let it = async_nats_message_header_iterator(black_box(msg));
+            while async_nats_message_header_iterator_next(it) {
+                black_box(async_nats_message_header_iterator_key(it));
+                let count = async_nats_message_header_iterator_value_count(it);
+                for i in 0..count {
+                    black_box(async_nats_message_header_iterator_value_at(it, i));
+                }
+            }
+            async_nats_message_header_iterator_free(it);
+        })
+    });
+
+    let it = unsafe { async_nats_message_get_header(msg, AsyncNatsSlice::new("Content-Type")) };
+    g.bench_function("iterator_copy_free", |b| {
+        b.iter(|| unsafe {
+            async_nats_message_header_iterator_copy(black_box(it));
+            async_nats_message_header_iterator_free(black_box(it));
+        })
+    });
+    g.bench_function("iterator_key", |b| {
+        b.iter(|| unsafe { async_nats_message_header_iterator_key(black_box(it)) })
+    });
+    g.bench_function("iterator_value_count", |b| {
+        b.iter(|| unsafe { async_nats_message_header_iterator_value_count(black_box(it)) })
+    });
+    g.bench_function("iterator_value_at", |b| {
+        b.iter(|| unsafe { async_nats_message_header_iterator_value_at(black_box(it), 0) })
+    });
+    g.finish();
+
+    unsafe {
+        async_nats_message_header_iterator_free(it);
+        async_nats_message_delete(msg);
+    }
+}
+
+fn objects(c: &mut Criterion) {
+    let mut g = c.benchmark_group("objects");
+
+    g.bench_function("abort_handle_new_delete", |b| {
+        b.iter(|| unsafe {
+            async_nats_abort_handle_delete(black_box(async_nats_abort_handle_new()))
+        })
+    });
+    g.bench_function("abort_handle_abort", |b| {
+        let handle = unsafe { async_nats_abort_handle_new() };
+        b.iter(|| unsafe { async_nats_abort_handle_abort(black_box(handle)) });
+        unsafe { async_nats_abort_handle_delete(handle) };
+    });
+    g.bench_function("request_new_delete", |b| {
+        b.iter(|| unsafe { async_nats_request_delete(black_box(async_nats_request_new())) })
+    });
+    g.bench_function("request_timeout", |b| {
+        let req = unsafe { async_nats_request_new() };
+        b.iter(|| unsafe { async_nats_request_timeout(black_box(req), black_box(1000)) });
+        unsafe { async_nats_request_delete(req) };
+    });
+    g.bench_function("connection_config_new_delete", |b| {
+        b.iter(|| unsafe {
+            async_nats_connection_config_delete(black_box(async_nats_connection_config_new()))
+        })
+    });
+    g.finish();
+}
+
+criterion_group!(benches, message, headers, objects);
+criterion_main!(benches);
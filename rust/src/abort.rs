@@ -0,0 +1,117 @@
+use crate::ffi_calls::ffi_call;
+use std::sync::{Arc, Mutex};
+use tokio::task::{AbortHandle, JoinHandle};
+
+#[derive(Default)]
+struct AbortState {
+    task: Option<AbortHandle>,
+    aborted: bool,
+    /// the operation may have had side effects, only a terminal abort stops it
+    side_effects: bool,
+}
+
+/// AsyncNatsAbortHandle bridges asio per-operation cancellation with a tokio task.
+///
+/// The handle is created by C++ before the operation is started so the
+/// cancellation that arrives before the task is spawned is not lost. Operations
+/// clone the shared state synchronously so C++ may delete the handle at any time.
+#[derive(Default, Clone)]
+pub struct AsyncNatsAbortHandle(Arc<Mutex<AbortState>>);
+
+impl AsyncNatsAbortHandle {
+    /// Clones the handle passed through FFI. Returns None for null pointers.
+    pub(crate) fn from_raw(handle: *const AsyncNatsAbortHandle) -> Option<Self> {
+        if handle.is_null() {
+            return None;
+        }
+        Some(unsafe { &*handle }.clone())
+    }
+
+    /// Binds the task to the handle. The task is aborted right away if the
+    /// cancellation was requested earlier.
+    pub(crate) fn attach(&self, task: JoinHandle<()>) {
+        let mut state = self.0.lock().unwrap();
+        if state.aborted {
+            task.abort();
+        } else {
+            state.task = Some(task.abort_handle());
+        }
+    }
+
+    /// Marks the point after which the operation may have side effects. Returns
+    /// false if the operation is already aborted and must not start them.
+    pub(crate) fn begin_side_effects(handle: &Option<Self>) -> bool {
+        let Some(handle) = handle else {
+            return true;
+        };
+        let mut state = handle.0.lock().unwrap();
+        state.side_effects = !state.aborted;
+        !state.aborted
+    }
+
+    fn abort(&self, terminal: bool) {
+        let mut state = self.0.lock().unwrap();
+        if state.side_effects && !terminal {
+            return;
+        }
+        state.aborted = true;
+        if let Some(task) = state.task.take() {
+            task.abort();
+        }
+    }
+}
+
+/// Callbacks that are able to report that the operation was aborted
+pub(crate) trait Abortable {
+    fn aborted(self);
+}
+
+/// AbortGuard calls `Abortable::aborted` if the task is dropped before the
+/// callback is taken. That happens when the task is aborted or when the runtime
+/// is shut down with the task still pending.
+pub(crate) struct AbortGuard<C: Abortable>(Option<C>);
+
+impl<C: Abortable> AbortGuard<C> {
+    pub(crate) fn new(cb: C) -> Self {
+        Self(Some(cb))
+    }
+
+    pub(crate) fn take(mut self) -> C {
+        self.0.take().expect("callback is taken only once")
+    }
+}
+
+impl<C: Abortable> Drop for AbortGuard<C> {
+    fn drop(&mut self) {
+        if let Some(cb) = self.0.take() {
+            cb.aborted();
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_abort_handle_new() -> *mut AsyncNatsAbortHandle {
+    ffi_call!();
+    Box::into_raw(Box::default())
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_abort_handle_delete(handle: *mut AsyncNatsAbortHandle) {
+    ffi_call!();
+    unsafe {
+        drop(Box::from_raw(handle));
+    }
+}
+
+/// Aborts the operation the handle is bound to. The operation completes with the
+/// aborted status unless it has already completed. If `terminal` is false the
+/// operation is aborted only if it had no side effects yet.
+#[no_mangle]
+pub extern "C" fn async_nats_abort_handle_abort(
+    handle: *const AsyncNatsAbortHandle,
+    terminal: bool,
+) {
+    ffi_call!();
+    let handle = unsafe { &*handle };
+    handle.abort(terminal);
+}
@@ -0,0 +1,44 @@
+//! Allocation accounting counts the allocations made by the Rust part of the
+//! library, including tokio and async-nats, on every thread. It is built only
+//! with the `alloc-accounting` feature that installs a counting global
+//! allocator.
+
+use crate::ffi_calls::ffi_call;
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+static ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+
+struct CountingAllocator;
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc_zeroed(layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+/// Returns the number of allocations made by the Rust library on all threads
+/// since the start of the process. Reallocations are counted as allocations.
+#[no_mangle]
+pub extern "C" fn async_nats_allocations() -> u64 {
+    ffi_call!();
+    ALLOCATIONS.load(Ordering::Relaxed)
+}
@@ -1,3 +1,4 @@
+use crate::ffi_calls::ffi_call;
 /// This file contains common api structs
 use std::ffi::{c_char, c_ulonglong, c_void, CStr};
 
@@ -37,6 +38,7 @@ pub type AsyncNatsAsyncString = AsyncNatsBorrowedString;
 
 #[no_mangle]
 pub extern "C" fn async_nats_owned_string_delete(s: AsyncNatsOwnedString) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(s));
     }
@@ -0,0 +1,336 @@
+use crate::api::{AsyncNatsBorrowedString, LossyConvert};
+use crate::coalesce::SharedResponse;
+use crate::ffi_calls::ffi_call;
+use async_nats::Client;
+use bytes::Bytes;
+use futures::{FutureExt, StreamExt};
+use std::collections::{BTreeMap, HashMap};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+use tokio::sync::watch;
+
+#[derive(Debug, Clone)]
+pub struct AsyncNatsResponseCacheConfig {
+    capacity: usize,
+    default_ttl: Duration,
+    subject_ttl: HashMap<String, Duration>,
+    invalidation_subject: Option<String>,
+}
+
+impl Default for AsyncNatsResponseCacheConfig {
+    fn default() -> Self {
+        Self {
+            capacity: 1024,
+            default_ttl: Duration::from_secs(1),
+            subject_ttl: HashMap::new(),
+            invalidation_subject: None,
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+struct CacheKey {
+    subject: String,
+    payload: Bytes,
+}
+
+struct Entry {
+    response: Arc<SharedResponse>,
+    expires: Instant,
+    tick: u64,
+}
+
+/// Lru keeps entries ordered by the last access. `order` maps the access tick to
+/// the key so the least recently used entry is the first one. Entries are stored
+/// by subject and then by payload so lookups use the borrowed key.
+#[derive(Default)]
+struct Lru {
+    entries: HashMap<String, HashMap<Bytes, Entry>>,
+    order: BTreeMap<u64, CacheKey>,
+    tick: u64,
+}
+
+impl Lru {
+    fn get(&mut self, subject: &str, payload: &[u8], now: Instant) -> Option<Arc<SharedResponse>> {
+        let entry = self.entries.get_mut(subject)?.get_mut(payload)?;
+        if entry.expires <= now {
+            self.remove(subject, payload);
+            return None;
+        }
+
+        self.tick += 1;
+        let key = self
+            .order
+            .remove(&entry.tick)
+            .expect("every entry is ordered");
+        self.order.insert(self.tick, key);
+        entry.tick = self.tick;
+        Some(entry.response.clone())
+    }
+
+    fn insert(
+        &mut self,
+        key: CacheKey,
+        response: Arc<SharedResponse>,
+        expires: Instant,
+        cap: usize,
+    ) {
+        self.remove(&key.subject, &key.payload);
+        while self.order.len() >= cap {
+            let Some((_, oldest)) = self.order.pop_first() else {
+                break;
+            };
+            self.remove(&oldest.subject, &oldest.payload);
+        }
+
+        self.tick += 1;
+        self.entries.entry(key.subject.clone()).or_default().insert(
+            key.payload.clone(),
+            Entry {
+                response,
+                expires,
+                tick: self.tick,
+            },
+        );
+        self.order.insert(self.tick, key);
+    }
+
+    fn remove(&mut self, subject: &str, payload: &[u8]) {
+        let Some(by_payload) = self.entries.get_mut(subject) else {
+            return;
+        };
+        if let Some(entry) = by_payload.remove(payload) {
+            self.order.remove(&entry.tick);
+        }
+        if by_payload.is_empty() {
+            self.entries.remove(subject);
+        }
+    }
+
+    fn invalidate(&mut self, subject: Option<&str>) {
+        let Some(subject) = subject else {
+            self.entries.clear();
+            self.order.clear();
+            return;
+        };
+
+        for entry in self
+            .entries
+            .remove(subject)
+            .into_iter()
+            .flat_map(HashMap::into_values)
+        {
+            self.order.remove(&entry.tick);
+        }
+    }
+}
+
+/// ResponseCache stores successful replies to cacheable requests
+///
+/// Entries expire after the TTL of the subject and the least recently used entry
+/// is evicted when the cache is full.
+pub struct ResponseCache {
+    config: AsyncNatsResponseCacheConfig,
+    lru: Mutex<Lru>,
+    /// Cache is bypassed if the invalidation subject can not be subscribed
+    enabled: AtomicBool,
+    pub(crate) hits: AtomicU64,
+    pub(crate) misses: AtomicU64,
+    /// Incremented by every invalidation. A reply is cached only if no invalidation
+    /// happened since its request missed the cache.
+    generation: AtomicU64,
+    /// Stops the invalidation task when the last connection is dropped
+    _shutdown: watch::Sender<()>,
+}
+
+impl ResponseCache {
+    pub fn start(
+        rt: &tokio::runtime::Handle,
+        client: &Client,
+        config: AsyncNatsResponseCacheConfig,
+    ) -> Arc<Self> {
+        let (tx, rx) = watch::channel(());
+        let cache = Arc::new(Self {
+            config,
+            lru: Mutex::new(Lru::default()),
+            enabled: AtomicBool::new(true),
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            generation: AtomicU64::new(0),
+            _shutdown: tx,
+        });
+
+        if let Some(subject) = cache.config.invalidation_subject.clone() {
+            rt.spawn(invalidate(
+                client.clone(),
+                subject,
+                Arc::downgrade(&cache),
+                rx,
+            ));
+        }
+        cache
+    }
+
+    /// Returns the generation to pass to `insert` when the request misses the cache
+    pub fn generation(&self) -> u64 {
+        self.generation.load(Ordering::Acquire)
+    }
+
+    pub fn get(&self, subject: &str, payload: &[u8]) -> Option<Arc<SharedResponse>> {
+        if !self.enabled.load(Ordering::Relaxed) {
+            return None;
+        }
+
+        let hit = self
+            .lru
+            .lock()
+            .unwrap()
+            .get(subject, payload, Instant::now());
+        match hit {
+            Some(_) => self.hits.fetch_add(1, Ordering::Relaxed),
+            None => self.misses.fetch_add(1, Ordering::Relaxed),
+        };
+        hit
+    }
+
+    /// Stores the reply. Errors are never cached, neither are replies that were
+    /// requested before an invalidation with a different `generation`.
+    pub fn insert(
+        &self,
+        subject: String,
+        payload: Bytes,
+        generation: u64,
+        response: &Arc<SharedResponse>,
+    ) {
+        if !self.enabled.load(Ordering::Relaxed) || !response.is_ok() {
+            return;
+        }
+
+        let ttl = self
+            .config
+            .subject_ttl
+            .get(&subject)
+            .copied()
+            .unwrap_or(self.config.default_ttl);
+        if ttl.is_zero() {
+            return;
+        }
+
+        let key = CacheKey { subject, payload };
+        let mut lru = self.lru.lock().unwrap();
+        if self.generation.load(Ordering::Acquire) != generation {
+            return;
+        }
+        lru.insert(
+            key,
+            response.clone(),
+            Instant::now() + ttl,
+            self.config.capacity.max(1),
+        );
+    }
+
+    /// Drops the replies of the subject or all replies. Fills that are in flight
+    /// are not cached.
+    fn invalidate(&self, subject: Option<&str>) {
+        let mut lru = self.lru.lock().unwrap();
+        self.generation.fetch_add(1, Ordering::AcqRel);
+        lru.invalidate(subject);
+    }
+}
+
+/// Every message on the invalidation subject drops the cached replies of the
+/// subject in its payload. An empty payload drops the whole cache.
+async fn invalidate(
+    client: Client,
+    subject: String,
+    cache: std::sync::Weak<ResponseCache>,
+    mut shutdown: watch::Receiver<()>,
+) {
+    let mut sub = match client.subscribe(subject).await {
+        Ok(sub) => sub,
+        Err(_) => {
+            if let Some(cache) = cache.upgrade() {
+                cache.enabled.store(false, Ordering::Relaxed);
+                cache.invalidate(None);
+            }
+            return;
+        }
+    };
+
+    loop {
+        let msg = futures::select_biased! {
+            _ = shutdown.changed().fuse() => None,
+            msg = sub.next().fuse() => msg,
+        };
+        let (Some(msg), Some(cache)) = (msg, cache.upgrade()) else {
+            break;
+        };
+
+        let target = std::str::from_utf8(&msg.payload)
+            .ok()
+            .filter(|s| !s.is_empty());
+        cache.invalidate(target);
+    }
+    sub.unsubscribe().await.ok();
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_response_cache_config_new() -> *mut AsyncNatsResponseCacheConfig {
+    ffi_call!();
+    Box::into_raw(Box::default())
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_response_cache_config_delete(cfg: *mut AsyncNatsResponseCacheConfig) {
+    ffi_call!();
+    unsafe {
+        drop(Box::from_raw(cfg));
+    }
+}
+
+/// Maximum number of cached replies
+#[no_mangle]
+pub extern "C" fn async_nats_response_cache_config_capacity(
+    cfg: *mut AsyncNatsResponseCacheConfig,
+    capacity: u64,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.capacity = capacity as usize;
+}
+
+/// TTL of subjects without their own TTL. Zero disables caching for them.
+#[no_mangle]
+pub extern "C" fn async_nats_response_cache_config_default_ttl(
+    cfg: *mut AsyncNatsResponseCacheConfig,
+    ttl_us: u64,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.default_ttl = Duration::from_micros(ttl_us);
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_response_cache_config_subject_ttl(
+    cfg: *mut AsyncNatsResponseCacheConfig,
+    subject: AsyncNatsBorrowedString,
+    ttl_us: u64,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.subject_ttl
+        .insert(subject.lossy_convert(), Duration::from_micros(ttl_us));
+}
+
+/// Messages on this subject invalidate the cache. The payload is the subject
+/// whose replies are dropped; an empty payload drops all replies.
+#[no_mangle]
+pub extern "C" fn async_nats_response_cache_config_invalidation_subject(
+    cfg: *mut AsyncNatsResponseCacheConfig,
+    subject: AsyncNatsBorrowedString,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.invalidation_subject = Some(subject.lossy_convert());
+}
@@ -0,0 +1,176 @@
+use crate::{
+    error::{
+        async_nats_request_error_clone, async_nats_request_error_delete, AsyncNatsRequestError,
+    },
+    message::{async_nats_message_clone, async_nats_message_delete, AsyncNatsMessage},
+};
+use async_nats::{Message, RequestError};
+use futures::future::{BoxFuture, FutureExt, Shared, WeakShared};
+use futures::ready;
+use std::collections::HashMap;
+use std::future::Future;
+use std::pin::Pin;
+use std::sync::{Arc, Mutex};
+use std::task::{Context, Poll};
+
+/// Requests with equal keys that are in flight at the same time share one reply
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub enum CoalesceKey {
+    Payload {
+        subject: String,
+        payload: bytes::Bytes,
+    },
+    Explicit {
+        subject: String,
+        key: String,
+    },
+}
+
+/// SharedResponse owns one reference to the reply that is passed to every
+/// coalesced request. Each request takes its own reference with `share`.
+pub struct SharedResponse(Result<*mut AsyncNatsMessage, *mut AsyncNatsRequestError>);
+unsafe impl Send for SharedResponse {}
+unsafe impl Sync for SharedResponse {}
+
+impl SharedResponse {
+    pub fn new(response: Result<Message, RequestError>) -> Self {
+        Self(match response {
+            Ok(msg) => {
+                let boxed_msg: Box<AsyncNatsMessage> = Box::new(msg.into());
+                Ok(Box::into_raw(boxed_msg))
+            }
+            Err(err) => Err(Box::into_raw(Box::new(AsyncNatsRequestError::new(err)))),
+        })
+    }
+
+    pub fn is_ok(&self) -> bool {
+        self.0.is_ok()
+    }
+
+    /// Returns a new reference to the reply
+    pub fn share(&self) -> Result<*mut AsyncNatsMessage, *mut AsyncNatsRequestError> {
+        match self.0 {
+            Ok(msg) => Ok(async_nats_message_clone(msg)),
+            Err(err) => Err(async_nats_request_error_clone(err)),
+        }
+    }
+}
+
+impl Drop for SharedResponse {
+    fn drop(&mut self) {
+        match self.0 {
+            Ok(msg) => async_nats_message_delete(msg),
+            Err(err) => async_nats_request_error_delete(err),
+        }
+    }
+}
+
+pub type FlightFuture = BoxFuture<'static, Arc<SharedResponse>>;
+pub type Flight = Shared<FlightFuture>;
+
+#[derive(Default)]
+struct Flights {
+    /// Flights by key. The id tells a flight from a newer one with the same key.
+    map: HashMap<CoalesceKey, (u64, WeakShared<FlightFuture>)>,
+    next_id: u64,
+}
+
+/// InFlightRequests tracks coalescable requests of a connection.
+///
+/// The map holds weak references only: the request is dropped (and its inbox is
+/// unsubscribed) as soon as every waiter is gone, for example aborted. The entry
+/// is removed when the request finishes or when its last waiter is dropped.
+#[derive(Default)]
+pub struct InFlightRequests(Mutex<Flights>);
+
+impl InFlightRequests {
+    /// Joins the request that is in flight for the key or starts a new one
+    pub fn join_or_start(
+        &self,
+        key: CoalesceKey,
+        start: impl FnOnce() -> FlightFuture,
+    ) -> Waiter<'_> {
+        let mut flights = self.0.lock().unwrap();
+        if let Some((id, weak)) = flights.map.get(&key) {
+            if let Some(flight) = weak.upgrade() {
+                let id = *id;
+                return Waiter::new(self, key, id, flight, true);
+            }
+        }
+
+        let flight = start().shared();
+        let weak = flight.downgrade().expect("flight is not polled yet");
+        let id = flights.next_id;
+        flights.next_id += 1;
+        flights.map.insert(key.clone(), (id, weak));
+        Waiter::new(self, key, id, flight, false)
+    }
+
+    /// Forgets the flight if it is still the current one for the key. An
+    /// unfinished flight is forgotten only when nobody waits for it anymore.
+    fn forget(&self, key: &CoalesceKey, id: u64, finished: bool) {
+        let mut flights = self.0.lock().unwrap();
+        let Some((current, weak)) = flights.map.get(key) else {
+            return;
+        };
+        if *current == id && (finished || weak.upgrade().is_none()) {
+            flights.map.remove(key);
+        }
+    }
+}
+
+/// Waiter is a request waiting for the shared reply of a flight
+pub struct Waiter<'a> {
+    requests: &'a InFlightRequests,
+    key: CoalesceKey,
+    id: u64,
+    flight: Option<Flight>,
+    joined: bool,
+}
+
+impl<'a> Waiter<'a> {
+    fn new(
+        requests: &'a InFlightRequests,
+        key: CoalesceKey,
+        id: u64,
+        flight: Flight,
+        joined: bool,
+    ) -> Self {
+        Self {
+            requests,
+            key,
+            id,
+            flight: Some(flight),
+            joined,
+        }
+    }
+
+    /// Returns true if the request joined a flight started by another request
+    pub fn joined(&self) -> bool {
+        self.joined
+    }
+}
+
+impl Future for Waiter<'_> {
+    type Output = Arc<SharedResponse>;
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let flight = self
+            .flight
+            .as_mut()
+            .expect("Waiter is polled after completion");
+        let response = ready!(flight.poll_unpin(cx));
+        self.flight = None;
+        self.requests.forget(&self.key, self.id, true);
+        Poll::Ready(response)
+    }
+}
+
+impl Drop for Waiter<'_> {
+    fn drop(&mut self) {
+        // the reference is released first so the last waiter sees the flight dead
+        if self.flight.take().is_some() {
+            self.requests.forget(&self.key, self.id, false);
+        }
+    }
+}
@@ -1,3 +1,4 @@
+use crate::ffi_calls::ffi_call;
 use core::ffi::CStr;
 use std::{os::raw::c_char, str::FromStr};
 
@@ -11,6 +12,7 @@ pub struct AsyncNatsRuntimeConfig {
 
 #[no_mangle]
 pub extern "C" fn nats_runtime_config_new() -> *mut AsyncNatsRuntimeConfig {
+    ffi_call!();
     Box::into_raw(Box::new(AsyncNatsRuntimeConfig {
         endpoints: Default::default(),
     }))
@@ -18,6 +20,7 @@ pub extern "C" fn nats_runtime_config_new() -> *mut AsyncNatsRuntimeConfig {
 
 #[no_mangle]
 pub extern "C" fn nats_runtime_config_free(cfg: *mut AsyncNatsRuntimeConfig) {
+    ffi_call!();
     if cfg.is_null() {
         panic!("cfg pointer is nullptr");
     }
@@ -31,6 +34,7 @@ pub extern "C" fn nats_runtime_config_set_endpoint(
     cfg: *mut AsyncNatsRuntimeConfig,
     endpoint: *const c_char,
 ) {
+    ffi_call!();
     if cfg.is_null() {
         panic!("cfg pointer is nullptr");
     }
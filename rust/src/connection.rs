@@ -1,5 +1,16 @@
+use crate::abort::{AbortGuard, Abortable, AsyncNatsAbortHandle};
+use crate::cache::{AsyncNatsResponseCacheConfig, ResponseCache};
+use crate::coalesce::InFlightRequests;
 use crate::error::AsyncNatsConnectError;
+use crate::event::AsyncNatsConnectionEventHandler;
+use crate::ffi_calls::ffi_call;
+use crate::histogram::LatencyHistograms;
+use crate::latency::LatencyWindow;
+use crate::reconnect::{AsyncNatsReconnectBufferConfig, OutboundMessage, ReconnectBuffer};
+use crate::request::RequestStatistics;
+use crate::statistics::{OutboundBuffer, PendingPublish};
 use crate::tokio_runtime::AsyncNatsTokioRuntime;
+use crate::trace::trace_event;
 use crate::api::{
     AsyncNatsAsyncMessage, AsyncNatsAsyncString, AsyncNatsBorrowedString, AsyncNatsOwnedString,
     AsyncNatsSlice, LossyConvert,
@@ -10,11 +21,38 @@ use bytes::BytesMut;
 use core::slice;
 use std::cell::RefCell;
 use std::ffi::c_void;
+use std::sync::Arc;
+use std::time::Duration;
 
 #[derive(Clone)]
 pub struct AsyncNatsConnection {
     pub(crate) rt: tokio::runtime::Handle,
     pub(crate) client: Client,
+    pub(crate) state: Arc<ConnectionState>,
+}
+
+/// ConnectionState is shared between all clones of the connection
+#[derive(Default)]
+pub(crate) struct ConnectionState {
+    pub(crate) request_stats: RequestStatistics,
+    pub(crate) latency: LatencyWindow,
+    pub(crate) in_flight: InFlightRequests,
+    pub(crate) cache: Option<Arc<ResponseCache>>,
+    pub(crate) outbound: OutboundBuffer,
+    pub(crate) histograms: Option<LatencyHistograms>,
+    /// prefix of the inboxes created by the client, shared with the C++ inbox generator
+    pub(crate) inbox_prefix: String,
+    pub(crate) reconnect: Option<Arc<ReconnectBuffer>>,
+}
+
+impl ConnectionState {
+    /// Records the round-trip time of a successful request
+    pub(crate) fn record_request(&self, subject: &str, latency: Duration) {
+        self.latency.record(latency);
+        if let Some(histograms) = &self.histograms {
+            histograms.request(subject).record(latency);
+        }
+    }
 }
 
 #[repr(C)]
@@ -35,6 +73,7 @@ pub extern "C" fn async_nats_connection_connect(
     cfg: *const AsyncNatsConnetionParams,
     cb: AsyncNatsConnectCallback,
 ) {
+    ffi_call!();
     let rt = unsafe { &*rt };
     let cfg = unsafe { &*cfg };
 
@@ -45,6 +84,21 @@ pub extern "C" fn async_nats_connection_connect(
         if let Some(name) = &cfg.name {
             co = co.name(name);
         }
+        let reconnect = cfg.reconnect.map(|cfg| Arc::new(ReconnectBuffer::new(cfg)));
+        if cfg.event_handler.is_some() || reconnect.is_some() {
+            let handler = cfg.event_handler.clone();
+            let reconnect = reconnect.clone();
+            let handle = handle.clone();
+            co = co.event_callback(move |event| {
+                if let Some(reconnect) = &reconnect {
+                    reconnect.on_event(&handle, &event);
+                }
+                if let Some(handler) = &handler {
+                    handler.call(event);
+                }
+                async {}
+            });
+        }
 
         let conn = connect_with_options(cfg.addrs.clone(), co).await;
         let conn = match conn {
@@ -56,9 +110,23 @@ pub extern "C" fn async_nats_connection_connect(
             }
         };
 
+        if let Some(reconnect) = &reconnect {
+            reconnect.attach(&conn);
+        }
+        let state = ConnectionState {
+            cache: cfg
+                .cache
+                .clone()
+                .map(|cache| ResponseCache::start(&handle, &conn, cache)),
+            histograms: cfg.latency_prefixes.as_deref().map(LatencyHistograms::new),
+            inbox_prefix: inbox_prefix(&conn),
+            reconnect,
+            ..Default::default()
+        };
         let conn = Box::new(AsyncNatsConnection {
             rt: handle,
             client: conn,
+            state: Arc::new(state),
         });
 
         cb.0(Box::into_raw(conn), std::ptr::null_mut(), cb.1);
@@ -69,6 +137,7 @@ pub extern "C" fn async_nats_connection_connect(
 pub extern "C" fn async_nats_connection_clone(
     conn: *const AsyncNatsConnection,
 ) -> *mut AsyncNatsConnection {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let new_conn = Box::new(conn.clone());
     Box::into_raw(new_conn)
@@ -76,6 +145,7 @@ pub extern "C" fn async_nats_connection_clone(
 
 #[no_mangle]
 pub extern "C" fn async_nats_connection_delete(conn: *mut AsyncNatsConnection) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(conn));
     }
@@ -85,11 +155,37 @@ pub extern "C" fn async_nats_connection_delete(conn: *mut AsyncNatsConnection) {
 pub extern "C" fn async_nats_connection_mailbox(
     conn: *mut AsyncNatsConnection,
 ) -> AsyncNatsOwnedString {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let mailbox = conn.client.new_inbox();
     crate::api::string_to_owned_string(mailbox)
 }
 
+/// Returns the prefix of the inboxes created by the connection without the trailing dot.
+///
+/// The slice is valid while the connection or any of its clones exists.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_inbox_prefix(
+    conn: *const AsyncNatsConnection,
+) -> AsyncNatsSlice {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let prefix = &conn.state.inbox_prefix;
+    AsyncNatsSlice {
+        data: prefix.as_ptr() as *const c_void,
+        size: prefix.len() as u64,
+    }
+}
+
+/// The client does not expose its inbox prefix, so it is taken from an inbox it creates
+fn inbox_prefix(client: &Client) -> String {
+    let inbox = client.new_inbox();
+    match inbox.rsplit_once('.') {
+        Some((prefix, _)) => prefix.to_owned(),
+        None => inbox,
+    }
+}
+
 #[repr(C)]
 #[derive(Debug, Clone)]
 pub struct AsyncNatsPublishCallback(extern "C" fn(d: *mut c_void), *mut c_void);
@@ -105,8 +201,10 @@ pub extern "C" fn async_nats_connection_publish_async(
     message: AsyncNatsAsyncMessage,
     cb: AsyncNatsPublishCallback,
 ) {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let topic_str = topic.lossy_convert();
+    trace_event!(AsyncNats_Trace_FfiEntry, cb.1, &topic_str);
     let data_slice =
         unsafe { slice::from_raw_parts(message.0 as *const u8, message.1.try_into().unwrap()) };
 
@@ -124,11 +222,13 @@ pub extern "C" fn async_nats_connection_publish_async(
         mbytes.split_to(data_slice.len()).freeze()
     });
 
-    conn.rt.spawn(async move {
-        let cb = cb.clone();
-        conn.client.publish(topic_str, bytes).await.ok();
-        cb.0(cb.1);
-    });
+    let message = OutboundMessage {
+        pending: PendingPublish::new(&conn.state, bytes.len()),
+        subject: topic_str,
+        reply_to: None,
+        payload: bytes,
+    };
+    publish(conn, message, cb);
 }
 
 /// Publish data asynchronously with reply topic.
@@ -142,9 +242,11 @@ pub extern "C" fn async_nats_connection_publish_with_reply_async(
     message: AsyncNatsAsyncMessage,
     cb: AsyncNatsPublishCallback,
 ) {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let topic_str = topic.lossy_convert();
     let reply_to_str = reply_to.lossy_convert();
+    trace_event!(AsyncNats_Trace_FfiEntry, cb.1, &topic_str);
     let data_slice =
         unsafe { slice::from_raw_parts(message.0 as *const u8, message.1.try_into().unwrap()) };
 
@@ -162,12 +264,33 @@ pub extern "C" fn async_nats_connection_publish_with_reply_async(
         mbytes.split_to(data_slice.len()).freeze()
     });
 
+    let message = OutboundMessage {
+        pending: PendingPublish::new(&conn.state, bytes.len()),
+        subject: topic_str,
+        reply_to: Some(reply_to_str),
+        payload: bytes,
+    };
+    publish(conn, message, cb);
+}
+
+/// Sends the message or puts it into the reconnect buffer. The callback of a
+/// buffered message is called once it is buffered.
+fn publish(
+    conn: &'static AsyncNatsConnection,
+    message: OutboundMessage,
+    cb: AsyncNatsPublishCallback,
+) {
+    let message = match &conn.state.reconnect {
+        Some(reconnect) => reconnect.admit(message),
+        None => Some(message),
+    };
     conn.rt.spawn(async move {
         let cb = cb.clone();
-        conn.client
-            .publish_with_reply(topic_str, reply_to_str, bytes)
-            .await
-            .ok();
+        trace_event!(AsyncNats_Trace_TaskStart, cb.1);
+        if let Some(message) = message {
+            message.send(&conn.client).await;
+        }
+        trace_event!(AsyncNats_Trace_Enqueue, cb.1);
         cb.0(cb.1);
     });
 }
@@ -180,33 +303,69 @@ pub struct AsyncNatsSubscribeCallback(
 );
 unsafe impl Send for AsyncNatsSubscribeCallback {}
 
+impl AsyncNatsSubscribeCallback {
+    pub(crate) fn complete(self, sub: Result<AsyncNatsSubscribtion, String>) {
+        match sub {
+            Ok(sub) => {
+                let sub = Box::new(sub);
+                self.0(Box::into_raw(sub), std::ptr::null_mut(), self.1);
+            }
+            Err(e) => {
+                let err = std::ffi::CString::new(e.as_bytes())
+                    .expect("Unable to convert error into CString");
+                self.0(
+                    std::ptr::null_mut(),
+                    std::ffi::CString::into_raw(err),
+                    self.1,
+                );
+            }
+        }
+    }
+}
+
+impl Abortable for AsyncNatsSubscribeCallback {
+    /// Both pointers are null when subscribing is aborted
+    fn aborted(self) {
+        self.0(std::ptr::null_mut(), std::ptr::null_mut(), self.1);
+    }
+}
+
+/// `abort` is an optional handle that aborts subscribing. Pass null if the
+/// operation is not abortable.
 #[no_mangle]
 pub extern "C" fn async_nats_connection_subscribe_async(
     conn: *const AsyncNatsConnection,
     topic: AsyncNatsAsyncString,
+    abort: *const AsyncNatsAbortHandle,
     cb: AsyncNatsSubscribeCallback,
 ) {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let topic_str = topic.lossy_convert();
+    let abort = AsyncNatsAbortHandle::from_raw(abort);
+    let stage = abort.clone();
 
     let rt = conn.rt.clone();
-    conn.rt.spawn(async move {
-        let cb = cb;
-        let sub = conn.client.subscribe(topic_str).await;
-
-        match sub {
-            Ok(sub) => {
-                let sub = Box::new(AsyncNatsSubscribtion::new(rt, sub));
-                cb.0(Box::into_raw(sub), std::ptr::null_mut(), cb.1);
-            }
-            Err(e) => {
-                // TODO: replace with more specific error when it is implemented in async_nats.rs
-                let err = std::ffi::CString::new(e.to_string().as_bytes())
-                    .expect("Unable to convert error into CString");
-                cb.0(std::ptr::null_mut(), std::ffi::CString::into_raw(err), cb.1);
-            }
+    let task = conn.rt.spawn(async move {
+        let cb = AbortGuard::new(cb);
+        if !AsyncNatsAbortHandle::begin_side_effects(&stage) {
+            return;
         }
+        let sub = conn.client.subscribe(topic_str).await;
+        // TODO: replace with more specific error when it is implemented in async_nats.rs
+        cb.take().complete(
+            sub.map(|sub| match &conn.state.histograms {
+                Some(histograms) => {
+                    AsyncNatsSubscribtion::stamped(rt, sub, histograms.delivery.clone())
+                }
+                None => AsyncNatsSubscribtion::new(rt, sub),
+            })
+            .map_err(|e| e.to_string()),
+        );
     });
+    if let Some(abort) = abort {
+        abort.attach(task);
+    }
 }
 
 // ---- Config ----
@@ -215,16 +374,22 @@ pub extern "C" fn async_nats_connection_subscribe_async(
 pub struct AsyncNatsConnetionParams {
     addrs: Vec<ServerAddr>,
     name: Option<String>,
+    cache: Option<AsyncNatsResponseCacheConfig>,
+    latency_prefixes: Option<Vec<String>>,
+    event_handler: Option<Arc<AsyncNatsConnectionEventHandler>>,
+    reconnect: Option<AsyncNatsReconnectBufferConfig>,
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_connection_config_new() -> *mut AsyncNatsConnetionParams {
+    ffi_call!();
     let cfg = Box::new(AsyncNatsConnetionParams::default());
     Box::into_raw(cfg)
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_connection_config_delete(cfg: *mut AsyncNatsConnetionParams) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(cfg));
     }
@@ -235,15 +400,78 @@ pub extern "C" fn async_nats_connection_config_name(
     cfg: *mut AsyncNatsConnetionParams,
     name: AsyncNatsBorrowedString,
 ) {
+    ffi_call!();
     let cfg = unsafe { &mut *cfg };
     cfg.name = Some(name.lossy_convert());
 }
 
+/// Enables the response cache for cacheable requests. `cache` is copied.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_config_response_cache(
+    cfg: *mut AsyncNatsConnetionParams,
+    cache: *const AsyncNatsResponseCacheConfig,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    let cache = unsafe { &*cache };
+    cfg.cache = Some(cache.clone());
+}
+
+/// Enables latency histograms of publishes, requests and message delivery
+#[no_mangle]
+pub extern "C" fn async_nats_connection_config_latency_histograms(
+    cfg: *mut AsyncNatsConnetionParams,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.latency_prefixes.get_or_insert_with(Vec::new);
+}
+
+/// Enables latency histograms and records the round-trip time of requests with
+/// the subject prefix separately. A request is recorded to the first matching
+/// prefix in the order they are added.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_config_latency_histogram_prefix(
+    cfg: *mut AsyncNatsConnetionParams,
+    prefix: AsyncNatsBorrowedString,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.latency_prefixes
+        .get_or_insert_with(Vec::new)
+        .push(prefix.lossy_convert());
+}
+
+/// Sets the handler of connection events. The handler is shared by the config and
+/// every connection that is created with it. The previous handler is released.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_config_event_handler(
+    cfg: *mut AsyncNatsConnetionParams,
+    handler: AsyncNatsConnectionEventHandler,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.event_handler = Some(Arc::new(handler));
+}
+
+/// Enables the reconnect buffer that keeps publishes while the connection is
+/// down and replays them in order once it is restored
+#[no_mangle]
+pub extern "C" fn async_nats_connection_config_reconnect_buffer(
+    cfg: *mut AsyncNatsConnetionParams,
+    config: AsyncNatsReconnectBufferConfig,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.reconnect = Some(config);
+}
+
 #[no_mangle]
 pub extern "C" fn async_nats_connection_config_addr(
     cfg: *mut AsyncNatsConnetionParams,
     addr: AsyncNatsBorrowedString,
 ) {
+    ffi_call!();
     let cfg = unsafe { &mut *cfg };
     // TODO: Add proper error handling
     cfg.addrs.push(
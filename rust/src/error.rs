@@ -1,4 +1,5 @@
 use crate::api::AsyncNatsOwnedString;
+use crate::ffi_calls::ffi_call;
 use std::sync::atomic::{AtomicUsize, Ordering};
 
 // ------------------- ConnectError -------------------
@@ -17,6 +18,7 @@ impl AsyncNatsConnectError {
 pub extern "C" fn async_nats_connection_error_clone(
     err: *mut AsyncNatsConnectError,
 ) -> *mut AsyncNatsConnectError {
+    ffi_call!();
     let err_ptr = unsafe { &*err };
     err_ptr.1.fetch_add(1, std::sync::atomic::Ordering::Acquire);
     return err;
@@ -45,6 +47,7 @@ pub enum AsyncNatsConnectErrorKind {
 pub extern "C" fn async_nats_connection_error_kind(
     err: *const AsyncNatsConnectError,
 ) -> AsyncNatsConnectErrorKind {
+    ffi_call!();
     let err = unsafe { &*err };
     match err.0.kind() {
         async_nats::ConnectErrorKind::ServerParse => {
@@ -69,12 +72,14 @@ pub extern "C" fn async_nats_connection_error_kind(
 pub extern "C" fn async_nats_connection_error_describtion(
     err: *const AsyncNatsConnectError,
 ) -> AsyncNatsOwnedString {
+    ffi_call!();
     let err = unsafe { &*err };
     crate::api::string_to_owned_string(err.0.to_string())
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_connection_error_delete(err: *mut AsyncNatsConnectError) {
+    ffi_call!();
     let err_ptr = unsafe { &*err };
     let c = err_ptr.1.fetch_sub(1, Ordering::Release);
     if c == 1 {
@@ -113,6 +118,7 @@ pub enum AsyncNatsRequestErrorKind {
 pub extern "C" fn async_nats_request_error_clone(
     err: *mut AsyncNatsRequestError,
 ) -> *mut AsyncNatsRequestError {
+    ffi_call!();
     let err_ptr = unsafe { &*err };
     err_ptr.1.fetch_add(1, std::sync::atomic::Ordering::Acquire);
     return err;
@@ -122,6 +128,7 @@ pub extern "C" fn async_nats_request_error_clone(
 pub extern "C" fn async_nats_request_error_kind(
     err: *const AsyncNatsRequestError,
 ) -> AsyncNatsRequestErrorKind {
+    ffi_call!();
     let err = unsafe { &*err };
     match err.0.kind() {
         async_nats::RequestErrorKind::TimedOut => {
@@ -138,12 +145,14 @@ pub extern "C" fn async_nats_request_error_kind(
 pub extern "C" fn async_nats_request_error_describtion(
     err: *const AsyncNatsRequestError,
 ) -> AsyncNatsOwnedString {
+    ffi_call!();
     let err = unsafe { &*err };
     crate::api::string_to_owned_string(err.0.to_string())
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_request_error_delete(err: *mut AsyncNatsRequestError) {
+    ffi_call!();
     let err_ptr = unsafe { &*err };
     let c = err_ptr.1.fetch_sub(1, Ordering::Release);
     if c == 1 {
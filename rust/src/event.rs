@@ -0,0 +1,76 @@
+use crate::api::AsyncNatsSlice;
+use async_nats::Event;
+use std::ffi::c_void;
+
+#[repr(C)]
+#[allow(non_camel_case_types, dead_code)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AsyncNatsConnectionEventKind {
+    /// The connection to the server is established or restored
+    AsyncNats_Event_Connected,
+    /// The connection to the server is lost. The client reconnects automatically.
+    AsyncNats_Event_Disconnected,
+    /// The server is going to shut down soon and asks clients to move away
+    AsyncNats_Event_LameDuckMode,
+    /// The subscribtion `sid` does not keep up and its messages are dropped
+    AsyncNats_Event_SlowConsumer,
+    /// The server reported an error
+    AsyncNats_Event_ServerError,
+    /// The client failed to process the connection
+    AsyncNats_Event_ClientError,
+}
+
+/// Connection event is only valid during the handler call
+#[repr(C)]
+#[derive(Debug)]
+pub struct AsyncNatsConnectionEvent {
+    pub kind: AsyncNatsConnectionEventKind,
+    /// Subscribtion id of the slow consumer; zero for other events
+    pub sid: u64,
+    /// Error description of server and client errors; empty for other events
+    pub description: AsyncNatsSlice,
+}
+
+/// AsyncNatsConnectionEventHandler is called for every connection event.
+///
+/// The handler is called on the TokioRuntime thread and must not block. The second
+/// function is called exactly once when the config and every connection that was
+/// created with it are deleted.
+#[repr(C)]
+pub struct AsyncNatsConnectionEventHandler(
+    extern "C" fn(event: *const AsyncNatsConnectionEvent, d: *mut c_void),
+    extern "C" fn(d: *mut c_void),
+    *mut c_void,
+);
+unsafe impl Send for AsyncNatsConnectionEventHandler {}
+unsafe impl Sync for AsyncNatsConnectionEventHandler {}
+
+impl AsyncNatsConnectionEventHandler {
+    pub(crate) fn call(&self, event: Event) {
+        use AsyncNatsConnectionEventKind::*;
+
+        let (kind, sid, description) = match event {
+            Event::Connected => (AsyncNats_Event_Connected, 0, String::new()),
+            Event::Disconnected => (AsyncNats_Event_Disconnected, 0, String::new()),
+            Event::LameDuckMode => (AsyncNats_Event_LameDuckMode, 0, String::new()),
+            Event::SlowConsumer(sid) => (AsyncNats_Event_SlowConsumer, sid, String::new()),
+            Event::ServerError(err) => (AsyncNats_Event_ServerError, 0, err.to_string()),
+            Event::ClientError(err) => (AsyncNats_Event_ClientError, 0, err.to_string()),
+        };
+        let event = AsyncNatsConnectionEvent {
+            kind,
+            sid,
+            description: AsyncNatsSlice {
+                data: description.as_ptr() as *const c_void,
+                size: description.len() as u64,
+            },
+        };
+        self.0(&event, self.2);
+    }
+}
+
+impl Drop for AsyncNatsConnectionEventHandler {
+    fn drop(&mut self) {
+        self.1(self.2);
+    }
+}
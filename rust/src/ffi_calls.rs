@@ -0,0 +1,39 @@
+//! FFI call accounting counts the calls of every `extern "C"` function made by
+//! the current thread. It is built only with the `ffi-accounting` feature;
+//! without it `ffi_call!` expands to nothing.
+
+#[cfg(feature = "ffi-accounting")]
+use std::cell::Cell;
+
+#[cfg(feature = "ffi-accounting")]
+thread_local! {
+    static CALLS: Cell<u64> = const { Cell::new(0) };
+}
+
+#[cfg(feature = "ffi-accounting")]
+pub(crate) fn count() {
+    CALLS.with(|calls| calls.set(calls.get() + 1));
+}
+
+/// Counts the call of the FFI function
+#[cfg(feature = "ffi-accounting")]
+macro_rules! ffi_call {
+    () => {
+        $crate::ffi_calls::count()
+    };
+}
+
+#[cfg(not(feature = "ffi-accounting"))]
+macro_rules! ffi_call {
+    () => {};
+}
+
+pub(crate) use ffi_call;
+
+/// Returns the number of FFI calls made by the current thread. This call is
+/// not counted.
+#[cfg(feature = "ffi-accounting")]
+#[no_mangle]
+pub extern "C" fn async_nats_ffi_calls() -> u64 {
+    CALLS.with(Cell::get)
+}
@@ -0,0 +1,186 @@
+use std::cell::Cell;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::time::Duration;
+
+/// Number of linear sub-buckets in every power of two. Bucket width is at most
+/// 1/16 of its lower bound so any reported value is within 6.25% of the sample.
+const SUB_BUCKET_BITS: u32 = 4;
+const SUB_BUCKETS: usize = 1 << SUB_BUCKET_BITS;
+/// Samples above 2^32 microseconds (about 71 minutes) are clamped
+const MAX_EXPONENT: u32 = 31;
+const MAX_VALUE: u64 = (1 << (MAX_EXPONENT + 1)) - 1;
+
+/// Number of buckets in the latency histogram
+pub const ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS: usize = 464;
+const _: () = assert!(
+    ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS
+        == (MAX_EXPONENT - SUB_BUCKET_BITS + 2) as usize * SUB_BUCKETS
+);
+
+/// Number of independently updated copies of the histogram. Every thread records
+/// into one copy so concurrent writers rarely touch the same cache lines.
+const SHARDS: usize = 8;
+
+/// Returns bucket index of the value in microseconds
+fn bucket(value: u64) -> usize {
+    let value = value.min(MAX_VALUE);
+    if value < SUB_BUCKETS as u64 {
+        return value as usize;
+    }
+    let exponent = 63 - value.leading_zeros();
+    let mantissa = (value >> (exponent - SUB_BUCKET_BITS)) as usize & (SUB_BUCKETS - 1);
+    (exponent - SUB_BUCKET_BITS + 1) as usize * SUB_BUCKETS + mantissa
+}
+
+thread_local! {
+    static SHARD: Cell<Option<usize>> = const { Cell::new(None) };
+}
+
+/// Returns the shard of the current thread. Threads are assigned to shards in
+/// round-robin order on first use.
+fn current_shard() -> usize {
+    static NEXT: AtomicUsize = AtomicUsize::new(0);
+    SHARD.with(|shard| match shard.get() {
+        Some(shard) => shard,
+        None => {
+            let next = NEXT.fetch_add(1, Ordering::Relaxed) % SHARDS;
+            shard.set(Some(next));
+            next
+        }
+    })
+}
+
+#[repr(align(128))]
+struct Shard {
+    count: AtomicU64,
+    sum: AtomicU64,
+    max: AtomicU64,
+    buckets: [AtomicU64; ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS],
+}
+
+impl Default for Shard {
+    fn default() -> Self {
+        Self {
+            count: AtomicU64::new(0),
+            sum: AtomicU64::new(0),
+            max: AtomicU64::new(0),
+            buckets: std::array::from_fn(|_| AtomicU64::new(0)),
+        }
+    }
+}
+
+/// LatencyHistogram is a log-linear histogram of latencies in microseconds.
+///
+/// Recording is a few relaxed atomic increments in the shard of the calling
+/// thread. Shards are merged when the snapshot is taken so the snapshot may miss
+/// samples that are recorded concurrently.
+pub(crate) struct LatencyHistogram {
+    shards: Box<[Shard]>,
+}
+
+impl Default for LatencyHistogram {
+    fn default() -> Self {
+        Self {
+            shards: (0..SHARDS).map(|_| Shard::default()).collect(),
+        }
+    }
+}
+
+impl LatencyHistogram {
+    pub(crate) fn record(&self, latency: Duration) {
+        let value = latency.as_micros().min(MAX_VALUE as u128) as u64;
+        let shard = &self.shards[current_shard()];
+        shard.buckets[bucket(value)].fetch_add(1, Ordering::Relaxed);
+        shard.count.fetch_add(1, Ordering::Relaxed);
+        shard.sum.fetch_add(value, Ordering::Relaxed);
+        shard.max.fetch_max(value, Ordering::Relaxed);
+    }
+
+    pub(crate) fn snapshot(&self) -> AsyncNatsLatencyHistogram {
+        let mut snapshot = AsyncNatsLatencyHistogram::default();
+        for shard in self.shards.iter() {
+            snapshot.count += shard.count.load(Ordering::Relaxed);
+            snapshot.sum_us += shard.sum.load(Ordering::Relaxed);
+            snapshot.max_us = snapshot.max_us.max(shard.max.load(Ordering::Relaxed));
+            for (dst, src) in snapshot.buckets.iter_mut().zip(shard.buckets.iter()) {
+                *dst += src.load(Ordering::Relaxed);
+            }
+        }
+        snapshot
+    }
+}
+
+/// LatencyHistograms are recorded by the connection when they are enabled in the
+/// connection config.
+pub(crate) struct LatencyHistograms {
+    /// Time from the publish call to the message being handed over to the writer
+    pub(crate) publish: LatencyHistogram,
+    /// Time from the message arrival to the subscribtion to the receive callback
+    pub(crate) delivery: std::sync::Arc<LatencyHistogram>,
+    /// Request round-trip time of every configured subject prefix
+    pub(crate) request: Vec<(String, LatencyHistogram)>,
+    /// Request round-trip time of requests that match no prefix
+    pub(crate) request_other: LatencyHistogram,
+}
+
+impl LatencyHistograms {
+    pub(crate) fn new(prefixes: &[String]) -> Self {
+        Self {
+            publish: Default::default(),
+            delivery: Default::default(),
+            request: prefixes
+                .iter()
+                .map(|prefix| (prefix.clone(), LatencyHistogram::default()))
+                .collect(),
+            request_other: Default::default(),
+        }
+    }
+
+    /// Returns request histogram of the first prefix that matches the subject
+    pub(crate) fn request(&self, subject: &str) -> &LatencyHistogram {
+        self.request
+            .iter()
+            .find(|(prefix, _)| subject.starts_with(prefix.as_str()))
+            .map(|(_, histogram)| histogram)
+            .unwrap_or(&self.request_other)
+    }
+
+    /// Returns request histogram of the prefix. Empty prefix selects requests that
+    /// match no prefix.
+    pub(crate) fn request_by_prefix(&self, prefix: &str) -> Option<&LatencyHistogram> {
+        if prefix.is_empty() {
+            return Some(&self.request_other);
+        }
+        self.request
+            .iter()
+            .find(|(p, _)| p == prefix)
+            .map(|(_, histogram)| histogram)
+    }
+}
+
+/// Merged snapshot of the latency histogram. Bucket `i` counts samples within
+/// [lower_bound(i); lower_bound(i + 1)) microseconds where lower_bound is `i` for
+/// the first 16 buckets and `(16 + i % 16) << (i / 16 - 1)` for the rest.
+#[repr(C)]
+#[derive(Debug)]
+pub struct AsyncNatsLatencyHistogram {
+    /// Number of samples
+    pub count: u64,
+    /// Sum of all samples
+    pub sum_us: u64,
+    /// The largest sample
+    pub max_us: u64,
+    /// Sample counts. See `ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS`
+    pub buckets: [u64; ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS],
+}
+
+impl Default for AsyncNatsLatencyHistogram {
+    fn default() -> Self {
+        Self {
+            count: 0,
+            sum_us: 0,
+            max_us: 0,
+            buckets: [0; ASYNC_NATS_LATENCY_HISTOGRAM_BUCKETS],
+        }
+    }
+}
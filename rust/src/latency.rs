@@ -0,0 +1,50 @@
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::time::Duration;
+
+const WINDOW_SIZE: usize = 256;
+const MIN_SAMPLES: usize = 32;
+
+/// LatencyWindow keeps the last `WINDOW_SIZE` request latencies of a connection.
+///
+/// Writers never block each other: every sample takes a slot in a ring buffer and
+/// overwrites the oldest one. Readers copy the ring and compute the percentile on
+/// the copy so a concurrent write can only make the answer one sample stale.
+pub struct LatencyWindow {
+    samples: [AtomicU64; WINDOW_SIZE],
+    pos: AtomicUsize,
+}
+
+impl Default for LatencyWindow {
+    fn default() -> Self {
+        Self {
+            samples: std::array::from_fn(|_| AtomicU64::new(0)),
+            pos: AtomicUsize::new(0),
+        }
+    }
+}
+
+impl LatencyWindow {
+    pub fn record(&self, latency: Duration) {
+        let idx = self.pos.fetch_add(1, Ordering::Relaxed) % WINDOW_SIZE;
+        self.samples[idx].store(latency.as_micros() as u64, Ordering::Relaxed);
+    }
+
+    /// Returns latency percentile or None if there are not enough samples yet
+    ///
+    /// `percentile` must be within [0.0; 1.0]
+    pub fn percentile(&self, percentile: f64) -> Option<Duration> {
+        let count = self.pos.load(Ordering::Relaxed).min(WINDOW_SIZE);
+        if count < MIN_SAMPLES {
+            return None;
+        }
+
+        let mut copy = [0u64; WINDOW_SIZE];
+        for (dst, src) in copy.iter_mut().zip(self.samples.iter()).take(count) {
+            *dst = src.load(Ordering::Relaxed);
+        }
+
+        let rank = ((count - 1) as f64 * percentile.clamp(0.0, 1.0)).round() as usize;
+        let (_, value, _) = copy[..count].select_nth_unstable(rank);
+        Some(Duration::from_micros(*value))
+    }
+}
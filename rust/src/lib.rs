@@ -1,10 +1,24 @@
+mod abort;
+#[cfg(feature = "alloc-accounting")]
+mod allocations;
 mod api;
+mod cache;
+mod coalesce;
 mod config;
 mod connection;
 mod error;
+mod event;
+mod ffi_calls;
+mod histogram;
+mod latency;
 mod message;
 mod named_receiver;
 mod named_sender;
+mod reconnect;
 mod request;
+mod service;
+mod spool;
+mod statistics;
 mod subscribtion;
 mod tokio_runtime;
+mod trace;
@@ -16,11 +16,69 @@ impl Into<AsyncNatsMessage> for async_nats::Message {
 }
 
 use crate::api::{string_to_owned_string, AsyncNatsOwnedString, AsyncNatsSlice};
+use crate::ffi_calls::ffi_call;
+use bytes::Bytes;
+use core::slice;
+
+/// Header of the message created with `async_nats_message_new`
+#[repr(C)]
+pub struct AsyncNatsHeader {
+    pub key: AsyncNatsSlice,
+    pub value: AsyncNatsSlice,
+}
+
+/// Creates a message that is not received from the server. It is used to test
+/// and benchmark message handlers without a connection. Values of headers with
+/// the same key are appended.
+///
+/// Returns null if a header name is invalid
+#[no_mangle]
+pub extern "C" fn async_nats_message_new(
+    topic: AsyncNatsSlice,
+    reply_to: AsyncNatsSlice,
+    data: AsyncNatsSlice,
+    headers: *const AsyncNatsHeader,
+    headers_count: u64,
+) -> *mut AsyncNatsMessage {
+    ffi_call!();
+    let subject = topic.as_str().unwrap_or_default().to_owned();
+    let reply = reply_to.as_str().map(str::to_owned);
+    let payload = Bytes::copy_from_slice(data.as_slice().unwrap_or_default());
+
+    let headers = if headers_count == 0 {
+        None
+    } else {
+        let headers = unsafe { slice::from_raw_parts(headers, headers_count as usize) };
+        let mut map = async_nats::HeaderMap::new();
+        for header in headers {
+            let Ok(key) = async_nats::HeaderName::from_str(header.key.as_str().unwrap_or_default())
+            else {
+                return std::ptr::null_mut();
+            };
+            map.append(key, header.value.as_str().unwrap_or_default());
+        }
+        Some(map)
+    };
+
+    let length = subject.len() + reply.as_ref().map_or(0, String::len) + payload.len();
+    let msg: AsyncNatsMessage = async_nats::Message {
+        subject,
+        reply,
+        payload,
+        headers,
+        status: None,
+        description: None,
+        length,
+    }
+    .into();
+    Box::into_raw(Box::new(msg))
+}
 
 /// Deletes NatsMessage.
 /// Using this object after free causes undefined bahavior
 #[no_mangle]
 pub extern "C" fn async_nats_message_delete(msg: *mut AsyncNatsMessage) {
+    ffi_call!();
     let msg = unsafe { &mut *msg };
     let refs = msg.1.fetch_sub(1, Ordering::Release);
     if refs == 1 {
@@ -33,6 +91,7 @@ pub extern "C" fn async_nats_message_delete(msg: *mut AsyncNatsMessage) {
 /// Increments reference counter
 #[no_mangle]
 pub extern "C" fn async_nats_message_clone(msg: *mut AsyncNatsMessage) -> *mut AsyncNatsMessage {
+    ffi_call!();
     let msg_ref = unsafe { &*msg };
     msg_ref.1.fetch_add(1, Ordering::Acquire);
     msg
@@ -42,6 +101,7 @@ pub extern "C" fn async_nats_message_clone(msg: *mut AsyncNatsMessage) -> *mut A
 /// Topic is valid while NatsMessage is valid
 #[no_mangle]
 pub extern "C" fn async_nats_message_topic(msg: *const AsyncNatsMessage) -> AsyncNatsSlice {
+    ffi_call!();
     let msg = unsafe { &*msg };
     AsyncNatsSlice {
         data: msg.0.subject.as_ptr() as *const c_void,
@@ -53,6 +113,7 @@ pub extern "C" fn async_nats_message_topic(msg: *const AsyncNatsMessage) -> Asyn
 /// Slice is valid while NatsMessage is valid
 #[no_mangle]
 pub extern "C" fn async_nats_message_data(msg: *const AsyncNatsMessage) -> AsyncNatsSlice {
+    ffi_call!();
     let msg = unsafe { &*msg };
     AsyncNatsSlice {
         data: msg.0.payload.as_ptr() as *const c_void,
@@ -62,6 +123,7 @@ pub extern "C" fn async_nats_message_data(msg: *const AsyncNatsMessage) -> Async
 
 #[no_mangle]
 pub extern "C" fn async_nats_message_reply_to(msg: *const AsyncNatsMessage) -> AsyncNatsSlice {
+    ffi_call!();
     let msg = unsafe { &*msg };
 
     let Some(reply) = &msg.0.reply else {
@@ -76,6 +138,7 @@ pub extern "C" fn async_nats_message_reply_to(msg: *const AsyncNatsMessage) -> A
 
 #[no_mangle]
 pub extern "C" fn async_nats_message_has_headers(msg: *mut AsyncNatsMessage) -> bool {
+    ffi_call!();
     let msg_ref = unsafe { &*msg };
     msg_ref.0.headers.is_some()
 }
@@ -109,6 +172,7 @@ unsafe fn header_iterator_from_ptr<'_0, '_1>(
 pub extern "C" fn async_nats_message_header_iterator(
     msg: *const AsyncNatsMessage,
 ) -> *mut AsyncNatsHeaderIterator {
+    ffi_call!();
     let msg_ref = unsafe { &*msg };
     let headers = msg_ref
         .0
@@ -126,12 +190,14 @@ pub extern "C" fn async_nats_message_header_iterator(
 
 #[no_mangle]
 pub unsafe extern "C" fn async_nats_message_header_iterator_copy(p: *mut AsyncNatsHeaderIterator) {
+    ffi_call!();
     let ctx: &'_ mut HeaderIterator<'_> = unsafe { header_iterator_from_ptr(p) };
     ctx.refcnt += 1;
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn async_nats_message_header_iterator_free(p: *mut AsyncNatsHeaderIterator) {
+    ffi_call!();
     let ctx: &'_ mut HeaderIterator<'_> = unsafe { header_iterator_from_ptr(p) };
     ctx.refcnt -= 1;
     if ctx.refcnt == 0 {
@@ -141,6 +207,7 @@ pub unsafe extern "C" fn async_nats_message_header_iterator_free(p: *mut AsyncNa
 
 #[no_mangle]
 pub extern "C" fn async_nats_message_header_iterator_next(p: *mut AsyncNatsHeaderIterator) -> bool {
+    ffi_call!();
     let ctx: &'_ mut HeaderIterator<'_> = unsafe { header_iterator_from_ptr(p) };
     let val = ctx
         .iter
@@ -155,6 +222,7 @@ pub extern "C" fn async_nats_message_header_iterator_next(p: *mut AsyncNatsHeade
 pub extern "C" fn async_nats_message_header_iterator_key(
     p: *mut AsyncNatsHeaderIterator,
 ) -> AsyncNatsSlice {
+    ffi_call!();
     let ctx: &'_ mut HeaderIterator<'_> = unsafe { header_iterator_from_ptr(p) };
     let (k, _) = ctx.val.expect("Trying to derev an empty header");
     let str: &str = k.as_ref();
@@ -169,6 +237,7 @@ pub extern "C" fn async_nats_message_get_header(
     msg: *const AsyncNatsMessage,
     header: AsyncNatsSlice,
 ) -> *mut AsyncNatsHeaderIterator {
+    ffi_call!();
     let msg = unsafe { &*msg };
     let Some(headers) = &msg.0.headers else {
         return std::ptr::null_mut();
@@ -198,6 +267,7 @@ pub extern "C" fn async_nats_message_get_header(
 pub extern "C" fn async_nats_message_header_iterator_value_count(
     p: *mut AsyncNatsHeaderIterator,
 ) -> u64 {
+    ffi_call!();
     let ctx: &'_ mut HeaderIterator<'_> = unsafe { header_iterator_from_ptr(p) };
     let (_, v) = ctx.val.expect("Trying to derev an empty header");
     v.iter().count() as u64
@@ -208,6 +278,7 @@ pub extern "C" fn async_nats_message_header_iterator_value_at(
     p: *mut AsyncNatsHeaderIterator,
     index: u64,
 ) -> AsyncNatsSlice {
+    ffi_call!();
     let ctx: &'_ mut HeaderIterator<'_> = unsafe { header_iterator_from_ptr(p) };
     let (_, v) = ctx.val.expect("Trying to derev an empty header");
     let str = v
@@ -240,6 +311,7 @@ pub enum AsyncNatsMessageStatus {
 /// >0 - some status code
 #[no_mangle]
 pub extern "C" fn async_nats_message_status(msg: *const AsyncNatsMessage) -> u16 {
+    ffi_call!();
     let msg = unsafe { &*msg };
 
     let Some(status) = &msg.0.status else {
@@ -251,6 +323,7 @@ pub extern "C" fn async_nats_message_status(msg: *const AsyncNatsMessage) -> u16
 
 #[no_mangle]
 pub extern "C" fn async_nats_message_description(msg: *const AsyncNatsMessage) -> AsyncNatsSlice {
+    ffi_call!();
     let msg = unsafe { &*msg };
 
     let Some(description) = &msg.0.description else {
@@ -266,6 +339,7 @@ pub extern "C" fn async_nats_message_description(msg: *const AsyncNatsMessage) -
 /// Return length of the message over the wire
 #[no_mangle]
 pub extern "C" fn async_nats_message_length(msg: *const AsyncNatsMessage) -> u64 {
+    ffi_call!();
     let msg = unsafe { &*msg };
     msg.0.length as u64
 }
@@ -274,6 +348,7 @@ pub extern "C" fn async_nats_message_length(msg: *const AsyncNatsMessage) -> u64
 pub extern "C" fn async_nats_message_to_string(
     msg: *const AsyncNatsMessage,
 ) -> AsyncNatsOwnedString {
+    ffi_call!();
     let msg = unsafe { &*msg };
     string_to_owned_string(format!("{:?}", &msg.0))
 }
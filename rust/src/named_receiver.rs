@@ -1,5 +1,8 @@
 use std::ffi::c_ulonglong;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
 
+use crate::ffi_calls::ffi_call;
 use crate::message::AsyncNatsMessage;
 use crate::subscribtion::AsyncNatsSubscribtion;
 use crossbeam::channel::{bounded, Receiver};
@@ -7,23 +10,38 @@ use crossbeam::channel::{bounded, Receiver};
 #[derive(Clone)]
 pub struct AsyncNatsNamedReceiver {
     receiver: Receiver<async_nats::Message>,
+    counters: Arc<ReceiverCounters>,
+}
+
+#[derive(Default)]
+struct ReceiverCounters {
+    received: AtomicU64,
+    dropped: AtomicU64,
 }
 
 impl AsyncNatsNamedReceiver {
     pub fn new(w: AsyncNatsSubscribtion, capacity: usize) -> Self {
         let rt = w.rt.clone();
         let (tx, rx) = bounded(capacity);
+        let counters = Arc::new(ReceiverCounters::default());
+        let task_counters = counters.clone();
         rt.spawn(async move {
             let mut w = w;
             loop {
                 let Some(msg) = w.inner.pop().await else {
                     return;
                 };
-                tx.try_send(msg).ok();
+                task_counters.received.fetch_add(1, Ordering::Relaxed);
+                if tx.try_send(msg).is_err() {
+                    task_counters.dropped.fetch_add(1, Ordering::Relaxed);
+                }
             }
         });
 
-        Self { receiver: rx }
+        Self {
+            receiver: rx,
+            counters,
+        }
     }
 }
 
@@ -32,6 +50,7 @@ pub extern "C" fn async_nats_named_receiver_new(
     s: *mut AsyncNatsSubscribtion,
     capacity: c_ulonglong,
 ) -> *mut AsyncNatsNamedReceiver {
+    ffi_call!();
     let sub = unsafe { Box::from_raw(s) };
     let recv = Box::new(AsyncNatsNamedReceiver::new(*sub, capacity as usize));
     Box::into_raw(recv)
@@ -41,12 +60,14 @@ pub extern "C" fn async_nats_named_receiver_new(
 pub extern "C" fn async_nats_named_receiver_clone(
     recv: *const AsyncNatsNamedReceiver,
 ) -> *mut AsyncNatsNamedReceiver {
+    ffi_call!();
     let receiver = unsafe { &*recv };
     Box::into_raw(Box::new(receiver.clone()))
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_named_receiver_delete(recv: *mut AsyncNatsNamedReceiver) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(recv));
     }
@@ -56,6 +77,7 @@ pub extern "C" fn async_nats_named_receiver_delete(recv: *mut AsyncNatsNamedRece
 pub extern "C" fn async_nats_named_receiver_try_recv(
     s: *const AsyncNatsNamedReceiver,
 ) -> *mut AsyncNatsMessage {
+    ffi_call!();
     let receiver = unsafe { &*s };
     let Ok(msg) = receiver.receiver.try_recv() else {
         return std::ptr::null_mut();
@@ -67,9 +89,35 @@ pub extern "C" fn async_nats_named_receiver_try_recv(
 pub extern "C" fn async_nats_named_receiver_recv(
     s: *const AsyncNatsNamedReceiver,
 ) -> *mut AsyncNatsMessage {
+    ffi_call!();
     let receiver = unsafe { &*s };
     let Ok(msg) = receiver.receiver.recv() else {
         return std::ptr::null_mut();
     };
     Box::into_raw(Box::new(msg.into()))
 }
+
+/// Counters of messages that pass through the receiver queue
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsNamedReceiverStatistics {
+    /// Messages that are received from the subscribtion
+    pub received: u64,
+    /// Messages that are dropped because the queue is full
+    pub dropped: u64,
+    /// Messages that are waiting in the queue
+    pub queued: u64,
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_named_receiver_statistics(
+    recv: *const AsyncNatsNamedReceiver,
+) -> AsyncNatsNamedReceiverStatistics {
+    ffi_call!();
+    let receiver = unsafe { &*recv };
+    AsyncNatsNamedReceiverStatistics {
+        received: receiver.counters.received.load(Ordering::Relaxed),
+        dropped: receiver.counters.dropped.load(Ordering::Relaxed),
+        queued: receiver.receiver.len() as u64,
+    }
+}
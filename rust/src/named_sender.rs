@@ -1,11 +1,24 @@
-use crate::api::{AsyncNatsBorrowedMessage, AsyncNatsBorrowedString, LossyConvert};
+use crate::api::{
+    AsyncNatsBorrowedMessage, AsyncNatsBorrowedString, AsyncNatsOwnedString, LossyConvert,
+};
 use crate::connection::AsyncNatsConnection;
+use crate::ffi_calls::ffi_call;
+use crate::spool::{AsyncNatsSpoolConfig, Spool};
+use async_nats::connection::State;
 use bytes::{Bytes, BytesMut};
+use std::borrow::Cow;
 use std::cell::RefCell;
 use std::ffi::c_ulonglong;
-use std::sync::Arc;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+use std::time::Duration;
 use tokio::sync::mpsc::{unbounded_channel, UnboundedSender};
-use tokio::sync::{OwnedSemaphorePermit, Semaphore};
+use tokio::sync::{Notify, OwnedSemaphorePermit, Semaphore};
+
+/// Messages that are read from the spool and published before a flush
+const SPOOL_BATCH: usize = 1024;
+/// Interval of checking the connection while the spool can not be drained
+const SPOOL_RETRY: Duration = Duration::from_millis(100);
 
 #[derive(Clone)]
 pub struct AsyncNatsNamedSender {
@@ -14,6 +27,15 @@ pub struct AsyncNatsNamedSender {
 
 impl AsyncNatsNamedSender {
     pub fn with_capacity(topic: String, conn: &AsyncNatsConnection, capacity: usize) -> Self {
+        Self::with_spool(topic, conn, capacity, None)
+    }
+
+    pub fn with_spool(
+        topic: String,
+        conn: &AsyncNatsConnection,
+        capacity: usize,
+        spool: Option<Spool>,
+    ) -> Self {
         let (tx, mut rx) = unbounded_channel();
 
         let inner = Arc::new(NamedSenderInner {
@@ -21,7 +43,16 @@ impl AsyncNatsNamedSender {
             conn: conn.clone(),
             sender: tx,
             sem: Arc::new(Semaphore::new(capacity)),
+            counters: Default::default(),
+            spool: spool.map(|log| SenderSpool {
+                pending: AtomicU64::new(log.pending()),
+                log: Mutex::new(log),
+                ready: Default::default(),
+            }),
         });
+        if inner.spool.is_some() {
+            conn.rt.spawn(drain_spool(Arc::downgrade(&inner)));
+        }
 
         let inner_clone = inner.clone();
         conn.rt.spawn(async move {
@@ -39,6 +70,9 @@ impl AsyncNatsNamedSender {
                     )
                     .await
                     .expect("Unknown error while sending event from the queue");
+                let counters = &inner_clone.counters;
+                counters.queued.fetch_sub(1, Ordering::Relaxed);
+                counters.sent.fetch_add(1, Ordering::Relaxed);
             }
         });
 
@@ -51,6 +85,106 @@ struct NamedSenderInner {
     conn: AsyncNatsConnection,
     sender: UnboundedSender<Message>,
     sem: Arc<Semaphore>,
+    counters: SenderCounters,
+    spool: Option<SenderSpool>,
+}
+
+impl NamedSenderInner {
+    fn connected(&self) -> bool {
+        self.conn.client.connection_state() == State::Connected
+    }
+
+    /// Appends the message to the spool if it can not go to the queue: the
+    /// spool has messages, the connection is down or the queue is full. Returns
+    /// None if the message goes to the queue, otherwise whether it is spooled.
+    fn spool(&self, topic: AsyncNatsBorrowedString, data: &[u8], queue_full: bool) -> Option<bool> {
+        let spool = self.spool.as_ref()?;
+        // the common case of an empty spool and a live connection does not lock
+        // the log; the counter is updated under the lock, so it is checked again
+        let bypass = |empty: bool| empty && !queue_full && self.connected();
+        if bypass(spool.pending.load(Ordering::Relaxed) == 0) {
+            return None;
+        }
+        let mut log = spool.log.lock().unwrap();
+        if bypass(log.is_empty()) {
+            return None;
+        }
+
+        let subject = if topic.is_null() {
+            Cow::Borrowed(&self.topic)
+        } else {
+            Cow::Owned(topic.lossy_convert())
+        };
+        if !log.append(&subject, data) {
+            return Some(false);
+        }
+        spool.pending.store(log.pending(), Ordering::Relaxed);
+        drop(log);
+        self.counters.spooled.fetch_add(1, Ordering::Relaxed);
+        spool.ready.notify_one();
+        Some(true)
+    }
+}
+
+struct SenderSpool {
+    log: Mutex<Spool>,
+    /// Messages in the spool, readable without the lock
+    pending: AtomicU64,
+    /// Wakes up the drain task when a message is spooled
+    ready: Arc<Notify>,
+}
+
+/// Publishes the spooled messages in order once the connection is up and the
+/// queue is empty. Messages are removed from the spool after the batch is
+/// flushed, so a batch that fails is published again.
+async fn drain_spool(inner: Weak<NamedSenderInner>) {
+    loop {
+        let Some(inner) = inner.upgrade() else {
+            return;
+        };
+        let spool = inner.spool.as_ref().unwrap();
+        let ready = spool.pending.load(Ordering::Relaxed) != 0
+            && inner.counters.queued.load(Ordering::Relaxed) == 0
+            && inner.connected();
+        if !ready {
+            // the sender may be dropped while waiting
+            let notify = spool.ready.clone();
+            drop(inner);
+            tokio::time::timeout(SPOOL_RETRY, notify.notified())
+                .await
+                .ok();
+            continue;
+        }
+
+        let (batch, cursor) = spool.log.lock().unwrap().read(SPOOL_BATCH);
+        let count = batch.len() as u64;
+        let client = &inner.conn.client;
+        for message in batch {
+            client.publish(message.subject, message.payload).await.ok();
+        }
+        if client.flush().await.is_err() {
+            tokio::time::sleep(SPOOL_RETRY).await;
+            continue;
+        }
+
+        let mut log = spool.log.lock().unwrap();
+        log.commit(cursor);
+        spool.pending.store(log.pending(), Ordering::Relaxed);
+        inner
+            .counters
+            .spool_replayed
+            .fetch_add(count, Ordering::Relaxed);
+    }
+}
+
+#[derive(Default)]
+struct SenderCounters {
+    sent: AtomicU64,
+    rejected: AtomicU64,
+    unbounded: AtomicU64,
+    queued: AtomicU64,
+    spooled: AtomicU64,
+    spool_replayed: AtomicU64,
 }
 
 struct Message {
@@ -65,6 +199,7 @@ pub extern "C" fn async_nats_named_sender_new(
     conn: *const AsyncNatsConnection,
     capacity: c_ulonglong,
 ) -> *mut AsyncNatsNamedSender {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let sender = Box::new(AsyncNatsNamedSender::with_capacity(
         topic.lossy_convert(),
@@ -74,10 +209,39 @@ pub extern "C" fn async_nats_named_sender_new(
     Box::into_raw(sender)
 }
 
+/// Creates a sender with a durable spool. Returns null and sets `err` if the
+/// spool can not be opened.
+#[no_mangle]
+pub extern "C" fn async_nats_named_sender_new_spooled(
+    topic: AsyncNatsBorrowedString,
+    conn: *const AsyncNatsConnection,
+    capacity: c_ulonglong,
+    spool: AsyncNatsSpoolConfig,
+    err: *mut AsyncNatsOwnedString,
+) -> *mut AsyncNatsNamedSender {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let spool = match Spool::open(&spool) {
+        Ok(spool) => spool,
+        Err(e) => {
+            unsafe { *err = crate::api::string_to_owned_string(e.to_string()) };
+            return std::ptr::null_mut();
+        }
+    };
+    let sender = Box::new(AsyncNatsNamedSender::with_spool(
+        topic.lossy_convert(),
+        conn,
+        capacity as usize,
+        Some(spool),
+    ));
+    Box::into_raw(sender)
+}
+
 #[no_mangle]
 pub extern "C" fn async_nats_named_sender_clone(
     sender: *const AsyncNatsNamedSender,
 ) -> *mut AsyncNatsNamedSender {
+    ffi_call!();
     let sender = unsafe { &*sender };
     let new_sender = Box::new(sender.clone());
     Box::into_raw(new_sender)
@@ -85,6 +249,7 @@ pub extern "C" fn async_nats_named_sender_clone(
 
 #[no_mangle]
 pub extern "C" fn async_nats_named_sender_delete(sender: *mut AsyncNatsNamedSender) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(sender));
     }
@@ -96,16 +261,25 @@ pub extern "C" fn async_nats_named_sender_try_send(
     topic: AsyncNatsBorrowedString,
     data: AsyncNatsBorrowedMessage,
 ) -> bool {
+    ffi_call!();
     let sender = unsafe { &*sender };
+    let counters = &sender.inner.counters;
 
     let permit = sender.inner.sem.clone().try_acquire_owned();
+    let data_slice =
+        unsafe { std::slice::from_raw_parts(data.0 as *const u8, data.1.try_into().unwrap()) };
+    if let Some(spooled) = sender.inner.spool(topic, data_slice, permit.is_err()) {
+        if !spooled {
+            counters.rejected.fetch_add(1, Ordering::Relaxed);
+        }
+        return spooled;
+    }
+
     let Ok(permit) = permit else {
+        counters.rejected.fetch_add(1, Ordering::Relaxed);
         return false;
     };
 
-    let data_slice =
-        unsafe { std::slice::from_raw_parts(data.0 as *const u8, data.1.try_into().unwrap()) };
-
     thread_local! {
         static BYTES: RefCell<BytesMut> = RefCell::new(bytes::BytesMut::with_capacity(65535));
     }
@@ -123,6 +297,7 @@ pub extern "C" fn async_nats_named_sender_try_send(
         message: bytes,
         _permit: Some(permit),
     };
+    counters.queued.fetch_add(1, Ordering::Relaxed);
     sender.inner.sender.send(message).ok();
     true
 }
@@ -133,7 +308,9 @@ pub extern "C" fn async_nats_named_sender_send(
     topic: AsyncNatsBorrowedString,
     data: AsyncNatsBorrowedMessage,
 ) {
+    ffi_call!();
     let sender = unsafe { &*sender };
+    let counters = &sender.inner.counters;
     let permit = sender.inner.sem.clone().try_acquire_owned();
     let permit = match permit {
         Ok(x) => Some(x),
@@ -142,6 +319,10 @@ pub extern "C" fn async_nats_named_sender_send(
 
     let data_slice =
         unsafe { std::slice::from_raw_parts(data.0 as *const u8, data.1.try_into().unwrap()) };
+    // a message that does not fit into the spool goes to the queue
+    if sender.inner.spool(topic, data_slice, permit.is_none()) == Some(true) {
+        return;
+    }
 
     thread_local! {
         static BYTES: RefCell<BytesMut> = RefCell::new(bytes::BytesMut::with_capacity(65535));
@@ -160,5 +341,52 @@ pub extern "C" fn async_nats_named_sender_send(
         message: bytes,
         _permit: permit,
     };
+    if message._permit.is_none() {
+        counters.unbounded.fetch_add(1, Ordering::Relaxed);
+    }
+    counters.queued.fetch_add(1, Ordering::Relaxed);
     sender.inner.sender.send(message).ok();
 }
+
+/// Counters of messages that pass through the sender queue
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsNamedSenderStatistics {
+    /// Messages that are handed over to the connection
+    pub sent: u64,
+    /// Messages that are rejected by `try_send` because the queue is full
+    pub rejected: u64,
+    /// Messages that are enqueued by `send` beyond the queue capacity
+    pub unbounded: u64,
+    /// Messages that are waiting in the queue
+    pub queued: u64,
+    /// Messages that are written to the spool
+    pub spooled: u64,
+    /// Messages that are published from the spool
+    pub spool_replayed: u64,
+    /// Messages that are waiting in the spool, including the ones left by a
+    /// previous process
+    pub spool_pending: u64,
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_named_sender_statistics(
+    sender: *const AsyncNatsNamedSender,
+) -> AsyncNatsNamedSenderStatistics {
+    ffi_call!();
+    let sender = unsafe { &*sender };
+    let counters = &sender.inner.counters;
+    AsyncNatsNamedSenderStatistics {
+        sent: counters.sent.load(Ordering::Relaxed),
+        rejected: counters.rejected.load(Ordering::Relaxed),
+        unbounded: counters.unbounded.load(Ordering::Relaxed),
+        queued: counters.queued.load(Ordering::Relaxed),
+        spooled: counters.spooled.load(Ordering::Relaxed),
+        spool_replayed: counters.spool_replayed.load(Ordering::Relaxed),
+        spool_pending: sender
+            .inner
+            .spool
+            .as_ref()
+            .map_or(0, |spool| spool.pending.load(Ordering::Relaxed)),
+    }
+}
@@ -0,0 +1,238 @@
+//! Reconnect buffer keeps publishes while the connection is down and replays
+//! them in order once it is restored.
+
+use crate::connection::AsyncNatsConnection;
+use crate::ffi_calls::ffi_call;
+use crate::statistics::PendingPublish;
+use async_nats::{Client, Event};
+use bytes::Bytes;
+use std::collections::VecDeque;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+
+/// Messages that are handed over to the client before it is flushed
+const REPLAY_BATCH: usize = 1024;
+
+#[repr(C)]
+#[allow(non_camel_case_types, dead_code)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AsyncNatsReconnectOverflow {
+    /// The new message is dropped
+    AsyncNats_Overflow_DropNewest,
+    /// The oldest messages are dropped to make room for the new one
+    AsyncNats_Overflow_DropOldest,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct AsyncNatsReconnectBufferConfig {
+    /// Maximum number of buffered messages
+    pub max_messages: u64,
+    /// Maximum size of subjects and payloads of the buffered messages
+    pub max_bytes: u64,
+    /// What to do with a message that does not fit into the buffer
+    pub overflow: AsyncNatsReconnectOverflow,
+}
+
+/// OutboundMessage is a publish that is either sent right away or buffered
+pub(crate) struct OutboundMessage {
+    pub(crate) subject: String,
+    pub(crate) reply_to: Option<String>,
+    pub(crate) payload: Bytes,
+    pub(crate) pending: PendingPublish,
+}
+
+impl OutboundMessage {
+    fn size(&self) -> u64 {
+        let reply_to = self.reply_to.as_ref().map_or(0, String::len);
+        (self.subject.len() + reply_to + self.payload.len()) as u64
+    }
+
+    /// Hands the message over to the client writer
+    pub(crate) async fn send(self, client: &Client) {
+        match self.reply_to {
+            Some(reply_to) => client
+                .publish_with_reply(self.subject, reply_to, self.payload)
+                .await
+                .ok(),
+            None => client.publish(self.subject, self.payload).await.ok(),
+        };
+        drop(self.pending);
+    }
+}
+
+#[derive(Default)]
+struct Queue {
+    messages: VecDeque<OutboundMessage>,
+    bytes: u64,
+    /// Incremented on every disconnect to stop the replay of the previous connect
+    epoch: u64,
+}
+
+pub(crate) struct ReconnectBuffer {
+    config: AsyncNatsReconnectBufferConfig,
+    /// Publishes bypass the queue while set. Changed with the queue locked.
+    connected: AtomicBool,
+    queue: Mutex<Queue>,
+    /// Serializes replays of consecutive reconnects
+    replaying: tokio::sync::Mutex<()>,
+    client: OnceLock<Client>,
+    buffered_messages: AtomicU64,
+    buffered_bytes: AtomicU64,
+    buffered: AtomicU64,
+    replayed: AtomicU64,
+    dropped: AtomicU64,
+}
+
+impl ReconnectBuffer {
+    pub(crate) fn new(config: AsyncNatsReconnectBufferConfig) -> Self {
+        Self {
+            config,
+            connected: AtomicBool::new(true),
+            queue: Default::default(),
+            replaying: Default::default(),
+            client: OnceLock::new(),
+            buffered_messages: AtomicU64::new(0),
+            buffered_bytes: AtomicU64::new(0),
+            buffered: AtomicU64::new(0),
+            replayed: AtomicU64::new(0),
+            dropped: AtomicU64::new(0),
+        }
+    }
+
+    /// Sets the client that replays the messages once the connection is established
+    pub(crate) fn attach(&self, client: &Client) {
+        self.client.set(client.clone()).ok();
+    }
+
+    /// Returns the message back if the connection is up and it must be sent
+    /// right away. Otherwise the message is buffered or dropped.
+    pub(crate) fn admit(&self, message: OutboundMessage) -> Option<OutboundMessage> {
+        if self.connected.load(Ordering::Acquire) {
+            return Some(message);
+        }
+
+        let mut queue = self.queue.lock().unwrap();
+        if self.connected.load(Ordering::Relaxed) {
+            return Some(message);
+        }
+
+        let size = message.size();
+        let fits = |queue: &Queue| {
+            (queue.messages.len() as u64) < self.config.max_messages
+                && queue.bytes + size <= self.config.max_bytes
+        };
+        if self.config.overflow == AsyncNatsReconnectOverflow::AsyncNats_Overflow_DropOldest
+            && size <= self.config.max_bytes
+        {
+            while !fits(&queue) {
+                let Some(oldest) = queue.messages.pop_front() else {
+                    break;
+                };
+                queue.bytes -= oldest.size();
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+        if fits(&queue) {
+            queue.bytes += size;
+            queue.messages.push_back(message);
+            self.buffered.fetch_add(1, Ordering::Relaxed);
+        } else {
+            self.dropped.fetch_add(1, Ordering::Relaxed);
+        }
+        self.update_gauges(&queue);
+        None
+    }
+
+    pub(crate) fn on_event(self: &Arc<Self>, rt: &tokio::runtime::Handle, event: &Event) {
+        match event {
+            Event::Disconnected => {
+                let mut queue = self.queue.lock().unwrap();
+                queue.epoch += 1;
+                self.connected.store(false, Ordering::Release);
+            }
+            Event::Connected => {
+                // the epoch is taken now, a disconnect before the replay starts stops it
+                let epoch = self.queue.lock().unwrap().epoch;
+                let this = self.clone();
+                rt.spawn(async move { this.replay(epoch).await });
+            }
+            _ => {}
+        }
+    }
+
+    /// Hands the buffered messages over to the client in batches and opens the
+    /// bypass once the queue is empty. New publishes are queued behind the
+    /// replayed ones until then, so the order is kept. `epoch` is the epoch of
+    /// the connect that started the replay.
+    async fn replay(&self, epoch: u64) {
+        let Some(client) = self.client.get() else {
+            return;
+        };
+        let _replaying = self.replaying.lock().await;
+        loop {
+            let batch: Vec<OutboundMessage> = {
+                let mut queue = self.queue.lock().unwrap();
+                if queue.epoch != epoch {
+                    // disconnected again, the next connect continues the replay
+                    return;
+                }
+                if queue.messages.is_empty() {
+                    self.connected.store(true, Ordering::Release);
+                    return;
+                }
+                let count = queue.messages.len().min(REPLAY_BATCH);
+                let batch: Vec<_> = queue.messages.drain(..count).collect();
+                queue.bytes -= batch.iter().map(OutboundMessage::size).sum::<u64>();
+                self.update_gauges(&queue);
+                batch
+            };
+            let count = batch.len() as u64;
+            for message in batch {
+                message.send(client).await;
+            }
+            self.replayed.fetch_add(count, Ordering::Relaxed);
+            client.flush().await.ok();
+        }
+    }
+
+    fn update_gauges(&self, queue: &Queue) {
+        self.buffered_messages
+            .store(queue.messages.len() as u64, Ordering::Relaxed);
+        self.buffered_bytes.store(queue.bytes, Ordering::Relaxed);
+    }
+}
+
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsReconnectBufferStatistics {
+    /// Number of messages in the buffer
+    pub buffered_messages: u64,
+    /// Size of subjects and payloads of the messages in the buffer
+    pub buffered_bytes: u64,
+    /// Total number of messages put into the buffer
+    pub buffered: u64,
+    /// Total number of messages replayed after a reconnect
+    pub replayed: u64,
+    /// Total number of messages dropped because the buffer was full
+    pub dropped: u64,
+}
+
+/// Returns counters of the reconnect buffer. All zeros if the buffer is disabled.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_reconnect_buffer_statistics(
+    conn: *const AsyncNatsConnection,
+) -> AsyncNatsReconnectBufferStatistics {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let Some(buffer) = &conn.state.reconnect else {
+        return Default::default();
+    };
+    AsyncNatsReconnectBufferStatistics {
+        buffered_messages: buffer.buffered_messages.load(Ordering::Relaxed),
+        buffered_bytes: buffer.buffered_bytes.load(Ordering::Relaxed),
+        buffered: buffer.buffered.load(Ordering::Relaxed),
+        replayed: buffer.replayed.load(Ordering::Relaxed),
+        dropped: buffer.dropped.load(Ordering::Relaxed),
+    }
+}
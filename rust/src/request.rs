@@ -1,11 +1,22 @@
 use crate::{
+    abort::{AbortGuard, Abortable, AsyncNatsAbortHandle},
     api::{AsyncNatsAsyncMessage, AsyncNatsAsyncString, LossyConvert},
-    connection::AsyncNatsConnection,
+    coalesce::{CoalesceKey, SharedResponse},
+    connection::{AsyncNatsConnection, AsyncNatsSubscribeCallback},
     error::AsyncNatsRequestError,
+    ffi_calls::ffi_call,
     message::AsyncNatsMessage,
+    subscribtion::{AsyncNatsSubscribtion, StreamLimits},
+    trace::trace_event,
 };
+use async_nats::{Message, RequestError};
 use core::slice;
+use core::time::Duration;
+use futures::future::{select, Either, FutureExt};
 use std::ffi::c_void;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::Instant;
 
 #[repr(C)]
 #[derive(Debug, Clone)]
@@ -15,18 +26,60 @@ pub struct AsyncNatsRequestCallback(
 );
 unsafe impl Send for AsyncNatsRequestCallback {}
 
+impl AsyncNatsRequestCallback {
+    fn complete(self, response: Result<Message, RequestError>) {
+        trace_event!(AsyncNats_Trace_Receive, self.1);
+        match response {
+            Ok(msg) => {
+                let boxed_msg: Box<AsyncNatsMessage> = Box::new(msg.into());
+                self.0(Box::into_raw(boxed_msg), std::ptr::null_mut(), self.1);
+            }
+            Err(err) => {
+                let err = Box::new(AsyncNatsRequestError::new(err));
+                self.0(std::ptr::null_mut(), Box::leak(err), self.1)
+            }
+        }
+    }
+
+    fn complete_shared(self, response: &SharedResponse) {
+        trace_event!(AsyncNats_Trace_Receive, self.1);
+        match response.share() {
+            Ok(msg) => self.0(msg, std::ptr::null_mut(), self.1),
+            Err(err) => self.0(std::ptr::null_mut(), err, self.1),
+        }
+    }
+}
+
+impl Abortable for AsyncNatsRequestCallback {
+    /// Both pointers are null when the request is aborted
+    fn aborted(self) {
+        self.0(std::ptr::null_mut(), std::ptr::null_mut(), self.1)
+    }
+}
+
+/// `abort` is an optional handle that aborts the request. Pass null if the
+/// request is not abortable.
 #[no_mangle]
 pub extern "C" fn async_nats_connection_request_async(
     conn: *const AsyncNatsConnection,
     topic: AsyncNatsAsyncString,
     message: AsyncNatsAsyncMessage,
+    abort: *const AsyncNatsAbortHandle,
     cb: AsyncNatsRequestCallback,
 ) {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let topic_str = topic.lossy_convert();
+    let abort = AsyncNatsAbortHandle::from_raw(abort);
+    let stage = abort.clone();
+    trace_event!(AsyncNats_Trace_FfiEntry, cb.1, &topic_str);
 
-    conn.rt.spawn(async move {
-        let cb = cb.clone();
+    let task = conn.rt.spawn(async move {
+        trace_event!(AsyncNats_Trace_TaskStart, cb.1);
+        let cb = AbortGuard::new(cb);
+        if !AsyncNatsAbortHandle::begin_side_effects(&stage) {
+            return;
+        }
         let message = message;
         let data_slice =
             unsafe { slice::from_raw_parts(message.0 as *const u8, message.1.try_into().unwrap()) };
@@ -34,47 +87,192 @@ pub extern "C" fn async_nats_connection_request_async(
         // call the callback.
         // Should wait for `https://github.com/tokio-rs/bytes/issues/437` and think for
         // better solution depending on implementation
-        let bytes = bytes::Bytes::copy_from_slice(data_slice);
+        let request = AsyncNatsRequest {
+            payload: Some(bytes::Bytes::copy_from_slice(data_slice)),
+            ..Default::default()
+        };
 
-        let response = conn.client.request(topic_str, bytes).await;
-        match response {
-            Ok(msg) => {
-                let boxed_msg: Box<AsyncNatsMessage> = Box::new(msg.into());
-                cb.0(Box::into_raw(boxed_msg), std::ptr::null_mut(), cb.1);
-            }
-            Err(err) => {
-                let err = Box::new(AsyncNatsRequestError::new(err));
-                cb.0(std::ptr::null_mut(), Box::leak(err), cb.1)
-            }
-        }
+        let response = execute(conn, topic_str, &request).await;
+        cb.take().complete(response);
     });
+    if let Some(abort) = abort {
+        abort.attach(task);
+    }
 }
 
+/// `abort` is an optional handle that aborts the request. Pass null if the
+/// request is not abortable.
 #[no_mangle]
 pub extern "C" fn async_nats_connection_send_request_async(
     conn: *const AsyncNatsConnection,
     topic: AsyncNatsAsyncString,
     request: *mut AsyncNatsRequest,
+    abort: *const AsyncNatsAbortHandle,
     cb: AsyncNatsRequestCallback,
 ) {
+    ffi_call!();
     let conn = unsafe { &*conn };
     let topic_str = topic.lossy_convert();
-    let mut request = unsafe { Box::from_raw(request) };
+    let request = unsafe { Box::from_raw(request) };
+    let abort = AsyncNatsAbortHandle::from_raw(abort);
+    let stage = abort.clone();
+    trace_event!(AsyncNats_Trace_FfiEntry, cb.1, &topic_str);
 
-    conn.rt.spawn(async move {
-        let cb = cb.clone();
-        let response = conn.client.send_request(topic_str, request.build()).await;
-        match response {
-            Ok(msg) => {
-                let boxed_msg: Box<AsyncNatsMessage> = Box::new(msg.into());
-                cb.0(Box::into_raw(boxed_msg), std::ptr::null_mut(), cb.1);
-            }
-            Err(err) => {
-                let err = Box::new(AsyncNatsRequestError::new(err));
-                cb.0(std::ptr::null_mut(), Box::leak(err), cb.1)
-            }
+    let task = conn.rt.spawn(async move {
+        trace_event!(AsyncNats_Trace_TaskStart, cb.1);
+        let cb = AbortGuard::new(cb);
+        let cache = conn.state.cache.as_ref().filter(|_| request.cache);
+        let payload = request.payload.clone().unwrap_or_default();
+        let generation = cache.map_or(0, |cache| cache.generation());
+        if let Some(hit) = cache.and_then(|cache| cache.get(&topic_str, &payload)) {
+            let stats = &conn.state.request_stats;
+            stats.requests.fetch_add(1, Ordering::Relaxed);
+            cb.take().complete_shared(&hit);
+            return;
         }
+        if !AsyncNatsAbortHandle::begin_side_effects(&stage) {
+            return;
+        }
+
+        if cache.is_none() && request.coalesce.is_none() {
+            let response = execute(conn, topic_str, &request).await;
+            cb.take().complete(response);
+            return;
+        }
+
+        let response = execute_shared(conn, topic_str.clone(), request).await;
+        if let Some(cache) = cache {
+            cache.insert(topic_str, payload, generation, &response);
+        }
+        cb.take().complete_shared(&response);
+    });
+    if let Some(abort) = abort {
+        abort.attach(task);
+    }
+}
+
+/// Sends the request and returns the reply that can be shared between many
+/// callbacks. Coalescing requests join the identical request in flight.
+async fn execute_shared(
+    conn: &'static AsyncNatsConnection,
+    subject: String,
+    request: Box<AsyncNatsRequest>,
+) -> Arc<SharedResponse> {
+    let Some(key) = request.coalesce_key(&subject) else {
+        return Arc::new(SharedResponse::new(execute(conn, subject, &request).await));
+    };
+
+    let waiter = conn.state.in_flight.join_or_start(key, || {
+        async move {
+            let response = execute(conn, subject, &request).await;
+            Arc::new(SharedResponse::new(response))
+        }
+        .boxed()
     });
+    if waiter.joined() {
+        let stats = &conn.state.request_stats;
+        stats.requests.fetch_add(1, Ordering::Relaxed);
+        stats.coalesced.fetch_add(1, Ordering::Relaxed);
+    }
+    waiter.await
+}
+
+/// Sends the request applying all options that are set for it
+async fn execute(
+    conn: &AsyncNatsConnection,
+    subject: String,
+    request: &AsyncNatsRequest,
+) -> Result<Message, RequestError> {
+    let stats = &conn.state.request_stats;
+    stats.requests.fetch_add(1, Ordering::Relaxed);
+
+    let started = Instant::now();
+    let primary = conn
+        .client
+        .send_request(subject.clone(), request.build(request.inbox.clone()));
+
+    let Some(delay) = request.hedge.as_ref().map(|h| h.delay(conn)) else {
+        let response = primary.await;
+        if response.is_ok() {
+            conn.state.record_request(&subject, started.elapsed());
+        }
+        return response;
+    };
+
+    futures::pin_mut!(primary);
+    let sleep = tokio::time::sleep(delay);
+    futures::pin_mut!(sleep);
+    let primary = match select(primary, sleep).await {
+        Either::Left((response, _)) => {
+            if response.is_ok() {
+                conn.state.record_request(&subject, started.elapsed());
+            }
+            return response;
+        }
+        Either::Right((_, primary)) => primary,
+    };
+
+    // The primary request is slow, send a duplicate with a fresh inbox. The future
+    // that loses the race is dropped here which unsubscribes its inbox, so the late
+    // reply is discarded by the client and never reaches C++.
+    stats.hedged.fetch_add(1, Ordering::Relaxed);
+    let hedge_started = Instant::now();
+    let hedge = conn
+        .client
+        .send_request(subject.clone(), request.build(None));
+    futures::pin_mut!(hedge);
+
+    let (response, hedge_won) = match select(primary, hedge).await {
+        Either::Left((Ok(msg), _)) => (Ok(msg), false),
+        Either::Right((Ok(msg), _)) => (Ok(msg), true),
+        // one of the requests has failed; the other one is the last chance
+        Either::Left((Err(_), hedge)) => (hedge.await, true),
+        Either::Right((Err(_), primary)) => (primary.await, false),
+    };
+
+    if response.is_ok() {
+        if hedge_won {
+            stats.hedge_wins.fetch_add(1, Ordering::Relaxed);
+            conn.state.record_request(&subject, hedge_started.elapsed());
+        } else {
+            conn.state.record_request(&subject, started.elapsed());
+        }
+    }
+    response
+}
+
+#[derive(Debug, Clone)]
+pub enum HedgePolicy {
+    /// Send a duplicate after a fixed delay
+    Fixed(Duration),
+    /// Send a duplicate when the request is slower than the given percentile of
+    /// recent requests of this connection. `fallback` is used while there are not
+    /// enough samples.
+    Percentile { percentile: f64, fallback: Duration },
+}
+
+impl HedgePolicy {
+    fn delay(&self, conn: &AsyncNatsConnection) -> Duration {
+        match self {
+            HedgePolicy::Fixed(delay) => *delay,
+            HedgePolicy::Percentile {
+                percentile,
+                fallback,
+            } => conn
+                .state
+                .latency
+                .percentile(*percentile)
+                .unwrap_or(*fallback),
+        }
+    }
+}
+
+#[derive(Debug, Clone)]
+pub enum Coalesce {
+    /// Coalesce requests with equal subject and payload
+    Payload,
+    /// Coalesce requests with equal subject and key
+    Key(String),
 }
 
 #[derive(Default)]
@@ -82,32 +280,52 @@ pub struct AsyncNatsRequest {
     inbox: Option<String>,
     timeout: Option<core::time::Duration>,
     payload: Option<bytes::Bytes>,
+    hedge: Option<HedgePolicy>,
+    coalesce: Option<Coalesce>,
+    cache: bool,
     // TODO: headers
 }
 
 impl AsyncNatsRequest {
-    pub fn build(&mut self) -> async_nats::Request {
+    /// Builds a new request. Payload is shared so the request can be built more
+    /// than once (for example for hedging).
+    pub fn build(&self, inbox: Option<String>) -> async_nats::Request {
         let mut req = async_nats::Request::new();
-        if self.inbox.is_some() {
-            req = req.inbox(self.inbox.take().unwrap());
+        if let Some(inbox) = inbox {
+            req = req.inbox(inbox);
         }
         if self.timeout.is_some() {
-            req = req.timeout(self.timeout.take());
+            req = req.timeout(self.timeout);
         }
-        if self.payload.is_some() {
-            req = req.payload(self.payload.take().unwrap());
+        if let Some(payload) = &self.payload {
+            req = req.payload(payload.clone());
         }
         req
     }
+
+    fn coalesce_key(&self, subject: &str) -> Option<CoalesceKey> {
+        match self.coalesce.as_ref()? {
+            Coalesce::Payload => Some(CoalesceKey::Payload {
+                subject: subject.to_owned(),
+                payload: self.payload.clone().unwrap_or_default(),
+            }),
+            Coalesce::Key(key) => Some(CoalesceKey::Explicit {
+                subject: subject.to_owned(),
+                key: key.clone(),
+            }),
+        }
+    }
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_request_new() -> *mut AsyncNatsRequest {
+    ffi_call!();
     Box::leak(Box::new(AsyncNatsRequest::default()))
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_request_delete(req: *mut AsyncNatsRequest) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(req));
     }
@@ -118,6 +336,7 @@ pub extern "C" fn async_nats_request_inbox(
     req: *mut AsyncNatsRequest,
     inbox: AsyncNatsAsyncString,
 ) {
+    ffi_call!();
     let req = unsafe { &mut *req };
     let inbox_str = inbox.lossy_convert();
     req.inbox = Some(inbox_str);
@@ -125,6 +344,7 @@ pub extern "C" fn async_nats_request_inbox(
 
 #[no_mangle]
 pub extern "C" fn async_nats_request_timeout(req: *mut AsyncNatsRequest, timeout: u64) {
+    ffi_call!();
     let req = unsafe { &mut *req };
     req.timeout = Some(core::time::Duration::from_millis(timeout));
 }
@@ -134,6 +354,7 @@ pub extern "C" fn async_nats_request_message(
     req: *mut AsyncNatsRequest,
     message: AsyncNatsAsyncMessage,
 ) {
+    ffi_call!();
     let req = unsafe { &mut *req };
     let data_slice =
         unsafe { slice::from_raw_parts(message.0 as *const u8, message.1.try_into().unwrap()) };
@@ -141,3 +362,214 @@ pub extern "C" fn async_nats_request_message(
     let bytes = bytes::Bytes::copy_from_slice(data_slice);
     req.payload = Some(bytes);
 }
+
+/// Send a duplicate request if there is no reply after `delay_us` microseconds.
+/// The first reply wins.
+#[no_mangle]
+pub extern "C" fn async_nats_request_hedge_after(req: *mut AsyncNatsRequest, delay_us: u64) {
+    ffi_call!();
+    let req = unsafe { &mut *req };
+    req.hedge = Some(HedgePolicy::Fixed(Duration::from_micros(delay_us)));
+}
+
+/// Send a duplicate request if there is no reply after the `percentile` ([0.0; 1.0])
+/// of the recent request latencies of the connection. `fallback_us` is used until
+/// enough latency samples are collected.
+#[no_mangle]
+pub extern "C" fn async_nats_request_hedge_percentile(
+    req: *mut AsyncNatsRequest,
+    percentile: f64,
+    fallback_us: u64,
+) {
+    ffi_call!();
+    let req = unsafe { &mut *req };
+    req.hedge = Some(HedgePolicy::Percentile {
+        percentile,
+        fallback: Duration::from_micros(fallback_us),
+    });
+}
+
+/// Share the reply with other coalescing requests to the same subject with the
+/// same payload that are in flight at the same time. Only the first request is
+/// sent and its options are used.
+#[no_mangle]
+pub extern "C" fn async_nats_request_coalesce(req: *mut AsyncNatsRequest) {
+    ffi_call!();
+    let req = unsafe { &mut *req };
+    req.coalesce = Some(Coalesce::Payload);
+}
+
+/// Same as `async_nats_request_coalesce` but requests are matched by the subject
+/// and the `key` instead of the payload
+#[no_mangle]
+pub extern "C" fn async_nats_request_coalesce_key(
+    req: *mut AsyncNatsRequest,
+    key: AsyncNatsAsyncString,
+) {
+    ffi_call!();
+    let req = unsafe { &mut *req };
+    req.coalesce = Some(Coalesce::Key(key.lossy_convert()));
+}
+
+/// Serve the request from the response cache of the connection if possible and
+/// cache the reply otherwise. Requests are cached by subject and payload.
+#[no_mangle]
+pub extern "C" fn async_nats_request_cache(req: *mut AsyncNatsRequest) {
+    ffi_call!();
+    let req = unsafe { &mut *req };
+    req.cache = true;
+}
+
+// ---- Request many ----
+
+#[derive(Default, Clone)]
+pub struct AsyncNatsRequestManyOptions {
+    limits: StreamLimits,
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_request_many_options_new() -> *mut AsyncNatsRequestManyOptions {
+    ffi_call!();
+    Box::into_raw(Box::default())
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_request_many_options_delete(opts: *mut AsyncNatsRequestManyOptions) {
+    ffi_call!();
+    unsafe {
+        drop(Box::from_raw(opts));
+    }
+}
+
+/// Finish the stream after receiving `count` replies. The stream is finished right
+/// away if `count` is 0.
+#[no_mangle]
+pub extern "C" fn async_nats_request_many_options_max_messages(
+    opts: *mut AsyncNatsRequestManyOptions,
+    count: u64,
+) {
+    ffi_call!();
+    let opts = unsafe { &mut *opts };
+    opts.limits.max_messages = Some(count as usize);
+}
+
+/// Finish the stream if there are no replies for `timeout_us` microseconds
+#[no_mangle]
+pub extern "C" fn async_nats_request_many_options_idle_timeout(
+    opts: *mut AsyncNatsRequestManyOptions,
+    timeout_us: u64,
+) {
+    ffi_call!();
+    let opts = unsafe { &mut *opts };
+    opts.limits.idle_timeout = Some(Duration::from_micros(timeout_us));
+}
+
+/// Finish the stream when a reply with empty payload is received
+#[no_mangle]
+pub extern "C" fn async_nats_request_many_options_sentinel(
+    opts: *mut AsyncNatsRequestManyOptions,
+    enabled: bool,
+) {
+    ffi_call!();
+    let opts = unsafe { &mut *opts };
+    opts.limits.sentinel = enabled;
+}
+
+/// Sends a request that expects a stream of replies. All replies are received by
+/// the resulting subscribtion that is finished according to the options.
+///
+/// `opts` is copied and may be null. `abort` is an optional handle that aborts
+/// the operation.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_request_many_async(
+    conn: *const AsyncNatsConnection,
+    topic: AsyncNatsAsyncString,
+    message: AsyncNatsAsyncMessage,
+    opts: *const AsyncNatsRequestManyOptions,
+    abort: *const AsyncNatsAbortHandle,
+    cb: AsyncNatsSubscribeCallback,
+) {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let topic_str = topic.lossy_convert();
+    let data_slice =
+        unsafe { slice::from_raw_parts(message.0 as *const u8, message.1.try_into().unwrap()) };
+    let payload = bytes::Bytes::copy_from_slice(data_slice);
+    let limits = match opts.is_null() {
+        true => StreamLimits::default(),
+        false => unsafe { &*opts }.limits.clone(),
+    };
+    let abort = AsyncNatsAbortHandle::from_raw(abort);
+    let stage = abort.clone();
+
+    let task = conn.rt.spawn(async move {
+        let cb = AbortGuard::new(cb);
+        if !AsyncNatsAbortHandle::begin_side_effects(&stage) {
+            return;
+        }
+        let inbox = conn.client.new_inbox();
+        // subscribe before publishing so the first reply is not lost
+        let result = match conn.client.subscribe(inbox.clone()).await {
+            Ok(sub) => conn
+                .client
+                .publish_with_reply(topic_str, inbox, payload)
+                .await
+                .map(|_| sub)
+                .map_err(|e| e.to_string()),
+            Err(e) => Err(e.to_string()),
+        };
+
+        cb.take().complete(
+            result.map(|sub| AsyncNatsSubscribtion::with_limits(conn.rt.clone(), sub, limits)),
+        );
+    });
+    if let Some(abort) = abort {
+        abort.attach(task);
+    }
+}
+
+// ---- Statistics ----
+
+#[derive(Default)]
+pub(crate) struct RequestStatistics {
+    pub(crate) requests: AtomicU64,
+    pub(crate) hedged: AtomicU64,
+    pub(crate) hedge_wins: AtomicU64,
+    pub(crate) coalesced: AtomicU64,
+}
+
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsRequestStatistics {
+    /// Total number of requests sent by the user
+    pub requests: u64,
+    /// Number of requests that sent a hedged duplicate
+    pub hedged: u64,
+    /// Number of hedged requests where the duplicate replied first
+    pub hedge_wins: u64,
+    /// Number of requests that joined an identical request in flight instead of
+    /// sending their own
+    pub coalesced: u64,
+    /// Number of cacheable requests served from the response cache
+    pub cache_hits: u64,
+    /// Number of cacheable requests that were sent to the server
+    pub cache_misses: u64,
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_connection_request_statistics(
+    conn: *const AsyncNatsConnection,
+) -> AsyncNatsRequestStatistics {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let stats = &conn.state.request_stats;
+    let cache = conn.state.cache.as_ref();
+    AsyncNatsRequestStatistics {
+        requests: stats.requests.load(Ordering::Relaxed),
+        hedged: stats.hedged.load(Ordering::Relaxed),
+        hedge_wins: stats.hedge_wins.load(Ordering::Relaxed),
+        coalesced: stats.coalesced.load(Ordering::Relaxed),
+        cache_hits: cache.map_or(0, |c| c.hits.load(Ordering::Relaxed)),
+        cache_misses: cache.map_or(0, |c| c.misses.load(Ordering::Relaxed)),
+    }
+}
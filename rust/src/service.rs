@@ -0,0 +1,600 @@
+use crate::api::{
+    string_to_owned_string, AsyncNatsBorrowedMessage, AsyncNatsBorrowedString,
+    AsyncNatsOwnedString, AsyncNatsSlice, LossyConvert,
+};
+use crate::connection::AsyncNatsConnection;
+use crate::ffi_calls::ffi_call;
+use crate::message::{async_nats_message_clone, async_nats_message_delete, AsyncNatsMessage};
+use async_nats::{Client, HeaderMap, Message, Subscriber};
+use bytes::{Bytes, BytesMut};
+use futures::{FutureExt, StreamExt};
+use std::cell::RefCell;
+use std::collections::VecDeque;
+use std::ffi::c_void;
+use std::fmt::Write;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+use tokio::sync::mpsc::error::TrySendError;
+use tokio::sync::mpsc::{
+    channel, unbounded_channel, Receiver, Sender, UnboundedReceiver, UnboundedSender,
+};
+use tokio::sync::{watch, OwnedSemaphorePermit, Semaphore};
+
+/// Number of buckets in the processing time histogram. Bucket `i` counts requests that
+/// took less than `2^i` microseconds (and at least `2^(i-1)`); the last bucket also
+/// counts everything slower.
+pub const ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS: usize = 24;
+
+// ---- Config ----
+
+#[derive(Clone)]
+pub struct AsyncNatsServiceConfig {
+    name: String,
+    subject: String,
+    queue_group: Option<String>,
+    max_in_flight: usize,
+    max_queued: usize,
+    queue_budget: Option<Duration>,
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_service_config_new(
+    name: AsyncNatsBorrowedString,
+    subject: AsyncNatsBorrowedString,
+) -> *mut AsyncNatsServiceConfig {
+    ffi_call!();
+    let cfg = Box::new(AsyncNatsServiceConfig {
+        name: name.lossy_convert(),
+        subject: subject.lossy_convert(),
+        queue_group: None,
+        max_in_flight: 256,
+        max_queued: 1024,
+        queue_budget: None,
+    });
+    Box::into_raw(cfg)
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_service_config_delete(cfg: *mut AsyncNatsServiceConfig) {
+    ffi_call!();
+    unsafe {
+        drop(Box::from_raw(cfg));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_service_config_queue_group(
+    cfg: *mut AsyncNatsServiceConfig,
+    queue_group: AsyncNatsBorrowedString,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.queue_group = Some(queue_group.lossy_convert());
+}
+
+/// Maximum number of requests that are passed to the handler and are not responded yet
+#[no_mangle]
+pub extern "C" fn async_nats_service_config_max_in_flight(
+    cfg: *mut AsyncNatsServiceConfig,
+    max_in_flight: u64,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.max_in_flight = (max_in_flight as usize).max(1);
+}
+
+/// Maximum number of requests that wait in the queue for a free in-flight slot. Requests
+/// that arrive when the queue is full are rejected with `503` without calling the handler
+#[no_mangle]
+pub extern "C" fn async_nats_service_config_max_queued(
+    cfg: *mut AsyncNatsServiceConfig,
+    max_queued: u64,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.max_queued = (max_queued as usize).max(1);
+}
+
+/// Requests that waited in the queue for longer than `budget_us` microseconds are
+/// rejected with `503` without calling the handler
+#[no_mangle]
+pub extern "C" fn async_nats_service_config_queue_budget(
+    cfg: *mut AsyncNatsServiceConfig,
+    budget_us: u64,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.queue_budget = Some(Duration::from_micros(budget_us));
+}
+
+// ---- Service ----
+
+#[derive(Default)]
+struct ServiceStatistics {
+    requests: AtomicU64,
+    completed: AtomicU64,
+    errors: AtomicU64,
+    shed: AtomicU64,
+    processing_time_us: [AtomicU64; ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS],
+}
+
+impl ServiceStatistics {
+    fn record_processing_time(&self, elapsed: Duration) {
+        let us = elapsed.as_micros() as u64;
+        let bucket = (u64::BITS - us.leading_zeros()) as usize;
+        self.processing_time_us[bucket.min(ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS - 1)]
+            .fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// Appends `value` to `out` as a quoted JSON string
+fn write_json_string(out: &mut String, value: &str) {
+    out.push('"');
+    for c in value.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            '\n' => out.push_str("\\n"),
+            '\r' => out.push_str("\\r"),
+            '\t' => out.push_str("\\t"),
+            c if (c as u32) < 0x20 => {
+                write!(out, "\\u{:04x}", c as u32).ok();
+            }
+            c => out.push(c),
+        }
+    }
+    out.push('"');
+}
+
+struct Reply {
+    subject: String,
+    headers: Option<HeaderMap>,
+    payload: Bytes,
+}
+
+struct ServiceShared {
+    name: String,
+    subject: String,
+    max_in_flight: usize,
+    sem: Arc<Semaphore>,
+    stats: ServiceStatistics,
+    replies: UnboundedSender<Reply>,
+}
+
+impl ServiceShared {
+    fn in_flight(&self) -> u64 {
+        (self.max_in_flight - self.sem.available_permits()) as u64
+    }
+
+    fn stats_json(&self) -> String {
+        let stats = &self.stats;
+        let mut json = String::with_capacity(512);
+        json.push_str("{\"name\":");
+        write_json_string(&mut json, &self.name);
+        json.push_str(",\"subject\":");
+        write_json_string(&mut json, &self.subject);
+        write!(
+            json,
+            ",\"requests\":{},\"completed\":{},\"errors\":{},\"shed\":{},\"in_flight\":{},\
+             \"processing_time_us\":[",
+            stats.requests.load(Ordering::Relaxed),
+            stats.completed.load(Ordering::Relaxed),
+            stats.errors.load(Ordering::Relaxed),
+            stats.shed.load(Ordering::Relaxed),
+            self.in_flight(),
+        )
+        .ok();
+        for (i, bucket) in stats.processing_time_us.iter().enumerate() {
+            if i != 0 {
+                json.push(',');
+            }
+            write!(json, "{}", bucket.load(Ordering::Relaxed)).ok();
+        }
+        json.push_str("]}");
+        json
+    }
+}
+
+/// AsyncNatsServiceHandler is called for every accepted request.
+///
+/// The handler is called on the TokioRuntime thread and must not block. The second
+/// function is called exactly once when the service is stopped and the handler is not
+/// going to be called anymore.
+#[repr(C)]
+pub struct AsyncNatsServiceHandler(
+    extern "C" fn(req: *mut AsyncNatsServiceRequest, d: *mut c_void),
+    extern "C" fn(d: *mut c_void),
+    *mut c_void,
+);
+unsafe impl Send for AsyncNatsServiceHandler {}
+
+impl Drop for AsyncNatsServiceHandler {
+    fn drop(&mut self) {
+        self.1(self.2);
+    }
+}
+
+#[repr(C)]
+pub struct AsyncNatsServiceStartCallback(
+    extern "C" fn(svc: *mut AsyncNatsService, err: AsyncNatsOwnedString, d: *mut c_void),
+    *mut c_void,
+);
+unsafe impl Send for AsyncNatsServiceStartCallback {}
+
+impl AsyncNatsServiceStartCallback {
+    fn fail(&self, err: String) {
+        self.0(std::ptr::null_mut(), string_to_owned_string(err), self.1);
+    }
+}
+
+pub struct AsyncNatsService {
+    shared: Arc<ServiceShared>,
+    // tasks of the service are stopped when the sender is dropped
+    _shutdown: watch::Sender<()>,
+}
+
+/// Starts a new service. Config is copied and may be deleted right after the call.
+#[no_mangle]
+pub extern "C" fn async_nats_service_start_async(
+    conn: *const AsyncNatsConnection,
+    cfg: *const AsyncNatsServiceConfig,
+    handler: AsyncNatsServiceHandler,
+    cb: AsyncNatsServiceStartCallback,
+) {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let cfg = unsafe { &*cfg }.clone();
+
+    conn.rt.spawn(async move {
+        let cb = cb;
+        let handler = handler;
+        let sub = match &cfg.queue_group {
+            Some(group) => {
+                conn.client
+                    .queue_subscribe(cfg.subject.clone(), group.clone())
+                    .await
+            }
+            None => conn.client.subscribe(cfg.subject.clone()).await,
+        };
+        let sub = match sub {
+            Ok(sub) => sub,
+            Err(e) => return cb.fail(e.to_string()),
+        };
+        let stats_subject = format!("$SRV.STATS.{}", cfg.name);
+        let stats_sub = match conn.client.subscribe(stats_subject).await {
+            Ok(sub) => sub,
+            Err(e) => return cb.fail(e.to_string()),
+        };
+
+        let (shutdown_tx, shutdown_rx) = watch::channel(());
+        let (replies_tx, replies_rx) = unbounded_channel();
+        let shared = Arc::new(ServiceShared {
+            name: cfg.name.clone(),
+            subject: cfg.subject.clone(),
+            max_in_flight: cfg.max_in_flight,
+            sem: Arc::new(Semaphore::new(cfg.max_in_flight)),
+            stats: Default::default(),
+            replies: replies_tx,
+        });
+
+        let (queue_tx, queue_rx) = channel(cfg.max_queued);
+        conn.rt
+            .spawn(intake(shared.clone(), sub, queue_tx, shutdown_rx.clone()));
+        conn.rt.spawn(dispatch(
+            shared.clone(),
+            queue_rx,
+            cfg.queue_budget,
+            handler,
+            shutdown_rx.clone(),
+        ));
+        conn.rt
+            .spawn(stats_endpoint(shared.clone(), stats_sub, shutdown_rx));
+        conn.rt
+            .spawn(write_replies(conn.client.clone(), replies_rx));
+
+        let svc = Box::new(AsyncNatsService {
+            shared,
+            _shutdown: shutdown_tx,
+        });
+        cb.0(Box::into_raw(svc), std::ptr::null_mut(), cb.1);
+    });
+}
+
+/// Stops the service. Requests that are already passed to the handler can still be
+/// responded.
+#[no_mangle]
+pub extern "C" fn async_nats_service_delete(svc: *mut AsyncNatsService) {
+    ffi_call!();
+    unsafe {
+        drop(Box::from_raw(svc));
+    }
+}
+
+/// Moves messages from the subscription to the dispatch queue and stamps them with the
+/// arrival time so the queueing delay can be measured. Messages that do not fit into the
+/// queue are shed.
+async fn intake(
+    shared: Arc<ServiceShared>,
+    mut sub: Subscriber,
+    queue: Sender<(Message, Instant)>,
+    mut shutdown: watch::Receiver<()>,
+) {
+    loop {
+        futures::select_biased! {
+            _ = shutdown.changed().fuse() => {
+                sub.unsubscribe().await.ok();
+                return;
+            },
+            msg = sub.next().fuse() => {
+                let Some(msg) = msg else {
+                    return;
+                };
+                match queue.try_send((msg, Instant::now())) {
+                    Ok(()) => {}
+                    Err(TrySendError::Full((msg, _))) => {
+                        shared.stats.requests.fetch_add(1, Ordering::Relaxed);
+                        shed(&shared, msg);
+                    }
+                    Err(TrySendError::Closed(_)) => return,
+                }
+            },
+        };
+    }
+}
+
+async fn dispatch(
+    shared: Arc<ServiceShared>,
+    mut queue: Receiver<(Message, Instant)>,
+    budget: Option<Duration>,
+    handler: AsyncNatsServiceHandler,
+    mut shutdown: watch::Receiver<()>,
+) {
+    let over_budget = |arrived: &Instant| budget.map_or(false, |b| arrived.elapsed() > b);
+
+    loop {
+        let (mut msg, arrived) = futures::select_biased! {
+            _ = shutdown.changed().fuse() => return,
+            item = queue.recv().fuse() => match item {
+                Some(item) => item,
+                None => return,
+            },
+        };
+        shared.stats.requests.fetch_add(1, Ordering::Relaxed);
+
+        if over_budget(&arrived) {
+            shed(&shared, msg);
+            continue;
+        }
+
+        let permit = futures::select_biased! {
+            _ = shutdown.changed().fuse() => return,
+            permit = shared.sem.clone().acquire_owned().fuse() => {
+                permit.expect("Service semaphore is never closed")
+            },
+        };
+
+        if over_budget(&arrived) {
+            shed(&shared, msg);
+            continue;
+        }
+
+        // reply subject is moved to the request so the reply is published without copying it
+        let reply = msg.reply.take();
+        let boxed_msg: Box<AsyncNatsMessage> = Box::new(msg.into());
+        let req = Box::new(AsyncNatsServiceRequest {
+            msg: Box::into_raw(boxed_msg),
+            reply,
+            started: Instant::now(),
+            shared: shared.clone(),
+            _permit: permit,
+            responded: false,
+        });
+        handler.0(Box::into_raw(req), handler.2);
+    }
+}
+
+fn shed(shared: &ServiceShared, msg: Message) {
+    shared.stats.shed.fetch_add(1, Ordering::Relaxed);
+    let Some(reply) = msg.reply else {
+        return;
+    };
+
+    let mut headers = HeaderMap::new();
+    headers.insert("Nats-Service-Error", "Service overloaded");
+    headers.insert("Nats-Service-Error-Code", "503");
+    shared
+        .replies
+        .send(Reply {
+            subject: reply,
+            headers: Some(headers),
+            payload: Bytes::new(),
+        })
+        .ok();
+}
+
+async fn stats_endpoint(
+    shared: Arc<ServiceShared>,
+    mut sub: Subscriber,
+    mut shutdown: watch::Receiver<()>,
+) {
+    loop {
+        futures::select_biased! {
+            _ = shutdown.changed().fuse() => {
+                sub.unsubscribe().await.ok();
+                return;
+            },
+            msg = sub.next().fuse() => {
+                let Some(msg) = msg else {
+                    return;
+                };
+                let Some(reply) = msg.reply else {
+                    continue;
+                };
+                shared
+                    .replies
+                    .send(Reply {
+                        subject: reply,
+                        headers: None,
+                        payload: shared.stats_json().into(),
+                    })
+                    .ok();
+            },
+        };
+    }
+}
+
+/// Publishes replies of all requests of the service. Replies that are ready at the
+/// same time are published back to back without yielding between them.
+async fn write_replies(client: Client, mut replies: UnboundedReceiver<Reply>) {
+    let mut batch = VecDeque::new();
+    while let Some(reply) = replies.recv().await {
+        batch.push_back(reply);
+        while let Ok(reply) = replies.try_recv() {
+            batch.push_back(reply);
+        }
+
+        for reply in batch.drain(..) {
+            match reply.headers {
+                Some(headers) => client
+                    .publish_with_headers(reply.subject, headers, reply.payload)
+                    .await
+                    .ok(),
+                None => client.publish(reply.subject, reply.payload).await.ok(),
+            };
+        }
+    }
+}
+
+// ---- Request ----
+
+pub struct AsyncNatsServiceRequest {
+    msg: *mut AsyncNatsMessage,
+    reply: Option<String>,
+    started: Instant,
+    shared: Arc<ServiceShared>,
+    _permit: OwnedSemaphorePermit,
+    responded: bool,
+}
+
+impl Drop for AsyncNatsServiceRequest {
+    fn drop(&mut self) {
+        if !self.responded {
+            self.shared.stats.errors.fetch_add(1, Ordering::Relaxed);
+        }
+        async_nats_message_delete(self.msg);
+    }
+}
+
+/// Returns new reference to the request message
+///
+/// `reply_to` of the returned message is always empty. Use
+/// `async_nats_service_request_reply_to` instead.
+#[no_mangle]
+pub extern "C" fn async_nats_service_request_message(
+    req: *mut AsyncNatsServiceRequest,
+) -> *mut AsyncNatsMessage {
+    ffi_call!();
+    let req = unsafe { &*req };
+    async_nats_message_clone(req.msg)
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_service_request_reply_to(
+    req: *const AsyncNatsServiceRequest,
+) -> AsyncNatsSlice {
+    ffi_call!();
+    let req = unsafe { &*req };
+    let Some(reply) = &req.reply else {
+        return AsyncNatsSlice::default();
+    };
+
+    AsyncNatsSlice {
+        data: reply.as_ptr() as *const c_void,
+        size: reply.len() as u64,
+    }
+}
+
+/// Sends the reply and deletes the request. Data is copied before the function returns.
+#[no_mangle]
+pub extern "C" fn async_nats_service_request_respond(
+    req: *mut AsyncNatsServiceRequest,
+    data: AsyncNatsBorrowedMessage,
+) {
+    ffi_call!();
+    let mut req = unsafe { Box::from_raw(req) };
+    req.responded = true;
+    let stats = &req.shared.stats;
+    stats.completed.fetch_add(1, Ordering::Relaxed);
+    stats.record_processing_time(req.started.elapsed());
+
+    let Some(subject) = req.reply.take() else {
+        return;
+    };
+
+    let data_slice =
+        unsafe { std::slice::from_raw_parts(data.0 as *const u8, data.1.try_into().unwrap()) };
+    thread_local! {
+        static BYTES: RefCell<BytesMut> = RefCell::new(bytes::BytesMut::with_capacity(65535));
+    }
+    let payload = BYTES.with(|f| {
+        let mut mbytes = f.borrow_mut();
+        mbytes.extend_from_slice(data_slice);
+        mbytes.split_to(data_slice.len()).freeze()
+    });
+
+    req.shared
+        .replies
+        .send(Reply {
+            subject,
+            headers: None,
+            payload,
+        })
+        .ok();
+}
+
+/// Deletes the request without sending a reply. The request is counted as an error.
+#[no_mangle]
+pub extern "C" fn async_nats_service_request_delete(req: *mut AsyncNatsServiceRequest) {
+    ffi_call!();
+    unsafe {
+        drop(Box::from_raw(req));
+    }
+}
+
+// ---- Statistics ----
+
+#[repr(C)]
+pub struct AsyncNatsServiceStatistics {
+    /// Number of requests received by the service
+    pub requests: u64,
+    /// Number of requests that were responded by the handler
+    pub completed: u64,
+    /// Number of requests that were dropped by the handler without a reply
+    pub errors: u64,
+    /// Number of requests that were rejected because of the queue budget or a full queue
+    pub shed: u64,
+    /// Number of requests that are being processed by the handler right now
+    pub in_flight: u64,
+    /// Processing time histogram. See `ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS`
+    pub processing_time_us: [u64; ASYNC_NATS_SERVICE_HISTOGRAM_BUCKETS],
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_service_statistics(
+    svc: *const AsyncNatsService,
+) -> AsyncNatsServiceStatistics {
+    ffi_call!();
+    let svc = unsafe { &*svc };
+    let stats = &svc.shared.stats;
+    AsyncNatsServiceStatistics {
+        requests: stats.requests.load(Ordering::Relaxed),
+        completed: stats.completed.load(Ordering::Relaxed),
+        errors: stats.errors.load(Ordering::Relaxed),
+        shed: stats.shed.load(Ordering::Relaxed),
+        in_flight: svc.shared.in_flight(),
+        processing_time_us: std::array::from_fn(|i| {
+            stats.processing_time_us[i].load(Ordering::Relaxed)
+        }),
+    }
+}
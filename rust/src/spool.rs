@@ -0,0 +1,525 @@
+//! Spool is a durable log of messages kept in memory-mapped segment files.
+//!
+//! The segment files are created and preallocated when the spool is opened and
+//! are reused afterwards: a segment that is drained returns to the free list and
+//! is written again with a new sequence number. Every segment starts with a
+//! header that stores its sequence, whether it holds data and the offset of the
+//! first unread record, so the spool continues where it stopped after a restart.
+//! Free segments keep their last sequence and new ones continue after the
+//! highest sequence found in any header, so a sequence is never used twice.
+//!
+//! Records are `[len: u32][checksum: u32][subject_len: u16][subject][payload]`
+//! padded to 8 bytes. The checksum covers the sequence of the segment, so stale
+//! records of a recycled segment are never read back.
+//!
+//! Only one spool may use a directory at a time, which is enforced with an
+//! exclusive lock on the lock file of the directory.
+
+use crate::api::{AsyncNatsBorrowedString, LossyConvert};
+use bytes::Bytes;
+use std::collections::VecDeque;
+use std::io;
+use std::path::{Path, PathBuf};
+
+const MAGIC: u64 = u64::from_le_bytes(*b"NATSPOOL");
+const HEADER_SIZE: usize = 64;
+const RECORD_HEADER: usize = 8;
+const RECORD_ALIGN: usize = 8;
+
+/// Offsets of the segment header fields
+const HEADER_MAGIC: usize = 0;
+const HEADER_SEQ: usize = 8;
+const HEADER_READ: usize = 16;
+const HEADER_ACTIVE: usize = 24;
+
+const LOCK_FILE: &str = "spool.lock";
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct AsyncNatsSpoolConfig {
+    /// Directory of the segment files. It is created if it does not exist.
+    pub directory: AsyncNatsBorrowedString,
+    /// Size of one segment file in bytes. The biggest message must fit into one
+    /// segment.
+    pub segment_size: u64,
+    /// Number of segment files
+    pub segments: u64,
+}
+
+/// SpooledMessage is a message read back from the spool
+pub(crate) struct SpooledMessage {
+    pub(crate) subject: String,
+    pub(crate) payload: Bytes,
+}
+
+/// Cursor points right after the last record of a read batch
+#[derive(Debug, Clone, Copy)]
+pub(crate) struct Cursor {
+    /// position of the segment in the active list
+    segment: usize,
+    offset: usize,
+    records: u64,
+}
+
+pub(crate) struct Spool {
+    slots: Vec<Segment>,
+    /// Slots with data ordered by sequence. The front one is read and the back
+    /// one is written.
+    active: VecDeque<usize>,
+    free: Vec<usize>,
+    next_seq: u64,
+    /// Write offset in the back segment
+    write: usize,
+    pending: u64,
+    /// Keeps other spools out of the directory while it is open
+    _lock: DirectoryLock,
+}
+
+impl Spool {
+    pub(crate) fn open(config: &AsyncNatsSpoolConfig) -> io::Result<Self> {
+        let segment_size = config.segment_size as usize;
+        if segment_size <= HEADER_SIZE + RECORD_HEADER || config.segments == 0 {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "spool segments are too small",
+            ));
+        }
+        let directory = PathBuf::from(config.directory.lossy_convert());
+        std::fs::create_dir_all(&directory)?;
+        let lock = DirectoryLock::acquire(&directory.join(LOCK_FILE))?;
+        check_extra_segments(&directory, config.segments)?;
+
+        let mut slots = Vec::new();
+        for i in 0..config.segments {
+            slots.push(Segment::open(&segment_path(&directory, i), segment_size)?);
+        }
+
+        let mut active: Vec<usize> = (0..slots.len()).filter(|&i| slots[i].active()).collect();
+        active.sort_by_key(|&i| slots[i].seq());
+        let free = (0..slots.len()).filter(|&i| !slots[i].active()).collect();
+        let next_seq = slots.iter().map(Segment::seq).max().unwrap_or(0) + 1;
+
+        let mut spool = Self {
+            slots,
+            active: active.into(),
+            free,
+            next_seq,
+            write: HEADER_SIZE,
+            pending: 0,
+            _lock: lock,
+        };
+        spool.recover();
+        Ok(spool)
+    }
+
+    /// Counts the unread records and finds the end of the back segment
+    fn recover(&mut self) {
+        for position in 0..self.active.len() {
+            let segment = &self.slots[self.active[position]];
+            let mut offset = segment.read_offset();
+            while let Some(next) = segment.next_record(offset, segment.len()) {
+                offset = next;
+                self.pending += 1;
+            }
+            self.write = offset;
+        }
+        if self.pending == 0 {
+            self.recycle_all();
+        }
+    }
+
+    pub(crate) fn pending(&self) -> u64 {
+        self.pending
+    }
+
+    pub(crate) fn is_empty(&self) -> bool {
+        self.pending == 0
+    }
+
+    /// Appends a message. Fails if the spool is full or the message does not
+    /// fit into a segment.
+    pub(crate) fn append(&mut self, subject: &str, payload: &[u8]) -> bool {
+        let body = 2 + subject.len() + payload.len();
+        let size = record_size(body);
+        let segment_size = self.slots[0].len();
+        if subject.len() > u16::MAX as usize || HEADER_SIZE + size > segment_size {
+            return false;
+        }
+        if self.active.is_empty() || self.write + size > segment_size {
+            if !self.roll() {
+                return false;
+            }
+        }
+
+        let back = *self.active.back().unwrap();
+        let segment = &mut self.slots[back];
+        let seq = segment.seq();
+        let data = segment.bytes_mut();
+        let record = &mut data[self.write..self.write + RECORD_HEADER + body];
+        let (header, rest) = record.split_at_mut(RECORD_HEADER);
+        rest[..2].copy_from_slice(&(subject.len() as u16).to_le_bytes());
+        rest[2..2 + subject.len()].copy_from_slice(subject.as_bytes());
+        rest[2 + subject.len()..].copy_from_slice(payload);
+        header[4..].copy_from_slice(&checksum(seq, rest).to_le_bytes());
+        header[..4].copy_from_slice(&(body as u32).to_le_bytes());
+
+        self.write += size;
+        self.pending += 1;
+        true
+    }
+
+    /// Starts a new back segment from the free list
+    fn roll(&mut self) -> bool {
+        let Some(slot) = self.free.pop() else {
+            return false;
+        };
+        if let Some(&back) = self.active.back() {
+            self.slots[back].sync();
+        }
+        let seq = self.next_seq;
+        self.next_seq += 1;
+        let segment = &mut self.slots[slot];
+        segment.set(HEADER_READ, HEADER_SIZE as u64);
+        segment.set(HEADER_SEQ, seq);
+        segment.set(HEADER_ACTIVE, 1);
+        self.active.push_back(slot);
+        self.write = HEADER_SIZE;
+        true
+    }
+
+    /// Reads up to `max` messages after the last committed one. The messages
+    /// stay in the spool until the returned cursor is committed.
+    pub(crate) fn read(&self, max: usize) -> (Vec<SpooledMessage>, Cursor) {
+        let mut messages = Vec::new();
+        let mut cursor = Cursor {
+            segment: 0,
+            offset: self
+                .active
+                .front()
+                .map_or(HEADER_SIZE, |&i| self.slots[i].read_offset()),
+            records: 0,
+        };
+        while messages.len() < max && cursor.segment < self.active.len() {
+            let segment = &self.slots[self.active[cursor.segment]];
+            let end = if cursor.segment + 1 == self.active.len() {
+                self.write
+            } else {
+                segment.len()
+            };
+            match segment.next_record(cursor.offset, end) {
+                Some(next) => {
+                    messages.push(segment.message(cursor.offset));
+                    cursor.offset = next;
+                    cursor.records += 1;
+                }
+                None if cursor.segment + 1 < self.active.len() => {
+                    cursor.segment += 1;
+                    cursor.offset = self.slots[self.active[cursor.segment]].read_offset();
+                }
+                None => break,
+            }
+        }
+        (messages, cursor)
+    }
+
+    /// Removes the messages up to the cursor and recycles the drained segments
+    pub(crate) fn commit(&mut self, cursor: Cursor) {
+        for _ in 0..cursor.segment {
+            let slot = self.active.pop_front().unwrap();
+            self.recycle(slot);
+        }
+        self.pending -= cursor.records;
+        if self.pending == 0 {
+            self.recycle_all();
+        } else if let Some(&front) = self.active.front() {
+            self.slots[front].set(HEADER_READ, cursor.offset as u64);
+            self.slots[front].sync();
+        }
+    }
+
+    fn recycle(&mut self, slot: usize) {
+        self.slots[slot].set(HEADER_ACTIVE, 0);
+        self.slots[slot].sync();
+        self.free.push(slot);
+    }
+
+    fn recycle_all(&mut self) {
+        while let Some(slot) = self.active.pop_front() {
+            self.recycle(slot);
+        }
+        self.write = HEADER_SIZE;
+    }
+}
+
+fn segment_path(directory: &Path, index: u64) -> PathBuf {
+    directory.join(format!("segment-{index:04}.spool"))
+}
+
+/// Fails if a segment beyond the configured count holds messages, e.g. because
+/// the spool was reopened with fewer segments. Free segments are ignored.
+fn check_extra_segments(directory: &Path, segments: u64) -> io::Result<()> {
+    use std::io::Read;
+
+    for entry in std::fs::read_dir(directory)? {
+        let path = entry?.path();
+        let index = path
+            .file_name()
+            .and_then(|name| name.to_str())
+            .and_then(|name| name.strip_prefix("segment-")?.strip_suffix(".spool"))
+            .and_then(|index| index.parse::<u64>().ok());
+        if !index.is_some_and(|index| index >= segments) {
+            continue;
+        }
+
+        let mut header = [0u8; HEADER_ACTIVE + 8];
+        let read = std::fs::File::open(&path)?.read_exact(&mut header);
+        let field =
+            |offset: usize| u64::from_le_bytes(header[offset..offset + 8].try_into().unwrap());
+        if read.is_ok() && field(HEADER_MAGIC) == MAGIC && field(HEADER_ACTIVE) != 0 {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                format!(
+                    "{} holds messages beyond the configured {segments} segments",
+                    path.display()
+                ),
+            ));
+        }
+    }
+    Ok(())
+}
+
+fn record_size(body: usize) -> usize {
+    (RECORD_HEADER + body + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN
+}
+
+/// FNV-1a of the segment sequence and the record body
+fn checksum(seq: u64, body: &[u8]) -> u32 {
+    seq.to_le_bytes()
+        .iter()
+        .chain(body)
+        .fold(0x811c9dc5u32, |hash, b| {
+            (hash ^ *b as u32).wrapping_mul(0x01000193)
+        })
+}
+
+struct Segment {
+    map: Mapping,
+}
+
+impl Segment {
+    fn open(path: &Path, size: usize) -> io::Result<Self> {
+        let mut segment = Self {
+            map: Mapping::open(path, size)?,
+        };
+        if segment.get(HEADER_MAGIC) != MAGIC {
+            segment.set(HEADER_SEQ, 0);
+            segment.set(HEADER_ACTIVE, 0);
+            segment.set(HEADER_MAGIC, MAGIC);
+        }
+        Ok(segment)
+    }
+
+    fn len(&self) -> usize {
+        self.map.len
+    }
+
+    fn bytes(&self) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(self.map.ptr, self.map.len) }
+    }
+
+    fn bytes_mut(&mut self) -> &mut [u8] {
+        unsafe { std::slice::from_raw_parts_mut(self.map.ptr, self.map.len) }
+    }
+
+    fn get(&self, field: usize) -> u64 {
+        u64::from_le_bytes(self.bytes()[field..field + 8].try_into().unwrap())
+    }
+
+    fn set(&mut self, field: usize, value: u64) {
+        self.bytes_mut()[field..field + 8].copy_from_slice(&value.to_le_bytes());
+    }
+
+    fn seq(&self) -> u64 {
+        self.get(HEADER_SEQ)
+    }
+
+    fn active(&self) -> bool {
+        self.get(HEADER_ACTIVE) != 0
+    }
+
+    fn read_offset(&self) -> usize {
+        (self.get(HEADER_READ) as usize).clamp(HEADER_SIZE, self.len())
+    }
+
+    /// Returns the offset of the record after the valid record at `offset`
+    fn next_record(&self, offset: usize, end: usize) -> Option<usize> {
+        let data = self.bytes();
+        if offset + RECORD_HEADER > end {
+            return None;
+        }
+        let body = u32::from_le_bytes(data[offset..offset + 4].try_into().unwrap()) as usize;
+        if body < 2 || offset + RECORD_HEADER + body > end {
+            return None;
+        }
+        let sum = u32::from_le_bytes(data[offset + 4..offset + 8].try_into().unwrap());
+        let start = offset + RECORD_HEADER;
+        if checksum(self.seq(), &data[start..start + body]) != sum {
+            return None;
+        }
+        Some(offset + record_size(body))
+    }
+
+    fn message(&self, offset: usize) -> SpooledMessage {
+        let data = self.bytes();
+        let body = u32::from_le_bytes(data[offset..offset + 4].try_into().unwrap()) as usize;
+        let start = offset + RECORD_HEADER;
+        let body = &data[start..start + body];
+        let subject_len = u16::from_le_bytes([body[0], body[1]]) as usize;
+        SpooledMessage {
+            subject: String::from_utf8_lossy(&body[2..2 + subject_len]).into_owned(),
+            payload: Bytes::copy_from_slice(&body[2 + subject_len..]),
+        }
+    }
+
+    fn sync(&self) {
+        self.map.sync();
+    }
+}
+
+/// Mapping is a shared writable mapping of a whole file
+struct Mapping {
+    ptr: *mut u8,
+    len: usize,
+    _file: std::fs::File,
+}
+
+unsafe impl Send for Mapping {}
+
+#[cfg(unix)]
+impl Mapping {
+    fn open(path: &Path, len: usize) -> io::Result<Self> {
+        use std::os::unix::io::AsRawFd;
+
+        let file = std::fs::OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .open(path)?;
+        let size = file.metadata()?.len();
+        if size == 0 {
+            preallocate(&file, len)?;
+        } else if size != len as u64 {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidData,
+                format!("{} has a different segment size", path.display()),
+            ));
+        }
+
+        let ptr = unsafe {
+            libc::mmap(
+                std::ptr::null_mut(),
+                len,
+                libc::PROT_READ | libc::PROT_WRITE,
+                libc::MAP_SHARED,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(Self {
+            ptr: ptr as *mut u8,
+            len,
+            _file: file,
+        })
+    }
+
+    /// Starts writing the dirty pages back to the file
+    fn sync(&self) {
+        unsafe {
+            libc::msync(self.ptr as *mut libc::c_void, self.len, libc::MS_ASYNC);
+        }
+    }
+}
+
+#[cfg(unix)]
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        unsafe {
+            libc::msync(self.ptr as *mut libc::c_void, self.len, libc::MS_SYNC);
+            libc::munmap(self.ptr as *mut libc::c_void, self.len);
+        }
+    }
+}
+
+/// DirectoryLock is an exclusive lock of the spool directory that is released
+/// when the lock file is closed, including when the process dies
+struct DirectoryLock {
+    _file: std::fs::File,
+}
+
+#[cfg(unix)]
+impl DirectoryLock {
+    fn acquire(path: &Path) -> io::Result<Self> {
+        use std::os::unix::io::AsRawFd;
+
+        let file = std::fs::OpenOptions::new()
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .open(path)?;
+        if unsafe { libc::flock(file.as_raw_fd(), libc::LOCK_EX | libc::LOCK_NB) } != 0 {
+            let err = io::Error::last_os_error();
+            if err.kind() != io::ErrorKind::WouldBlock {
+                return Err(err);
+            }
+            return Err(io::Error::new(
+                io::ErrorKind::WouldBlock,
+                format!("{} is held by another spool", path.display()),
+            ));
+        }
+        Ok(Self { _file: file })
+    }
+}
+
+/// Reserves the blocks of the file so appends do not fail on a full disk
+#[cfg(unix)]
+fn preallocate(file: &std::fs::File, len: usize) -> io::Result<()> {
+    file.set_len(len as u64)?;
+    #[cfg(target_os = "linux")]
+    {
+        use std::os::unix::io::AsRawFd;
+
+        let err = unsafe { libc::posix_fallocate(file.as_raw_fd(), 0, len as libc::off_t) };
+        if err != 0 {
+            return Err(io::Error::from_raw_os_error(err));
+        }
+    }
+    Ok(())
+}
+
+#[cfg(not(unix))]
+impl DirectoryLock {
+    fn acquire(path: &Path) -> io::Result<Self> {
+        let file = std::fs::OpenOptions::new()
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .open(path)?;
+        Ok(Self { _file: file })
+    }
+}
+
+#[cfg(not(unix))]
+impl Mapping {
+    fn open(_path: &Path, _len: usize) -> io::Result<Self> {
+        Err(io::Error::new(
+            io::ErrorKind::Unsupported,
+            "the spool is not supported on this platform",
+        ))
+    }
+
+    fn sync(&self) {}
+}
@@ -0,0 +1,172 @@
+use crate::api::{AsyncNatsSlice, LossyConvert};
+use crate::connection::{AsyncNatsConnection, ConnectionState};
+use crate::ffi_calls::ffi_call;
+use crate::histogram::{AsyncNatsLatencyHistogram, LatencyHistogram, LatencyHistograms};
+use std::ffi::c_void;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::Instant;
+
+/// OutboundBuffer counts publishes that were accepted by the connection but are
+/// not handed over to the client writer yet.
+#[derive(Default)]
+pub(crate) struct OutboundBuffer {
+    messages: AtomicU64,
+    bytes: AtomicU64,
+}
+
+/// PendingPublish occupies the outbound buffer until it is dropped. The time it
+/// was pending is recorded to the publish latency histogram.
+pub(crate) struct PendingPublish {
+    state: Arc<ConnectionState>,
+    bytes: u64,
+    started: Instant,
+}
+
+impl PendingPublish {
+    pub(crate) fn new(state: &Arc<ConnectionState>, bytes: usize) -> Self {
+        let bytes = bytes as u64;
+        state.outbound.messages.fetch_add(1, Ordering::Relaxed);
+        state.outbound.bytes.fetch_add(bytes, Ordering::Relaxed);
+        Self {
+            state: state.clone(),
+            bytes,
+            started: Instant::now(),
+        }
+    }
+}
+
+impl Drop for PendingPublish {
+    fn drop(&mut self) {
+        let outbound = &self.state.outbound;
+        outbound.messages.fetch_sub(1, Ordering::Relaxed);
+        outbound.bytes.fetch_sub(self.bytes, Ordering::Relaxed);
+        if let Some(histograms) = &self.state.histograms {
+            histograms.publish.record(self.started.elapsed());
+        }
+    }
+}
+
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsConnectionStatistics {
+    /// Number of bytes received from the server
+    pub in_bytes: u64,
+    /// Number of bytes sent to the server
+    pub out_bytes: u64,
+    /// Number of messages received from the server
+    pub in_messages: u64,
+    /// Number of messages sent to the server
+    pub out_messages: u64,
+    /// Number of successful connects including the initial one
+    pub connects: u64,
+    /// Number of publishes accepted by the connection and not handed over to the
+    /// writer yet
+    pub pending_messages: u64,
+    /// Payload size of the pending publishes
+    pub pending_bytes: u64,
+}
+
+/// Returns traffic counters of the connection. Counters are read with relaxed
+/// atomic loads without any locks.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_statistics(
+    conn: *const AsyncNatsConnection,
+) -> AsyncNatsConnectionStatistics {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let stats = conn.client.statistics();
+    let outbound = &conn.state.outbound;
+    AsyncNatsConnectionStatistics {
+        in_bytes: stats.in_bytes.load(Ordering::Relaxed),
+        out_bytes: stats.out_bytes.load(Ordering::Relaxed),
+        in_messages: stats.in_messages.load(Ordering::Relaxed),
+        out_messages: stats.out_messages.load(Ordering::Relaxed),
+        connects: stats.connects.load(Ordering::Relaxed),
+        pending_messages: outbound.messages.load(Ordering::Relaxed),
+        pending_bytes: outbound.bytes.load(Ordering::Relaxed),
+    }
+}
+
+fn histogram_snapshot(
+    conn: *const AsyncNatsConnection,
+    select: impl FnOnce(&LatencyHistograms) -> Option<&LatencyHistogram>,
+) -> AsyncNatsLatencyHistogram {
+    let conn = unsafe { &*conn };
+    conn.state
+        .histograms
+        .as_ref()
+        .and_then(select)
+        .map(LatencyHistogram::snapshot)
+        .unwrap_or_default()
+}
+
+/// Returns the histogram of time from the publish call to the message being
+/// handed over to the client writer. Empty if histograms are disabled.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_publish_latency(
+    conn: *const AsyncNatsConnection,
+) -> AsyncNatsLatencyHistogram {
+    ffi_call!();
+    histogram_snapshot(conn, |h| Some(&h.publish))
+}
+
+/// Returns the histogram of time from the message arrival to the subscribtion to
+/// the receive callback. Empty if histograms are disabled.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_delivery_latency(
+    conn: *const AsyncNatsConnection,
+) -> AsyncNatsLatencyHistogram {
+    ffi_call!();
+    histogram_snapshot(conn, |h| Some(h.delivery.as_ref()))
+}
+
+/// Returns the request round-trip time histogram of the configured subject
+/// prefix. Empty prefix selects requests that match no prefix. Empty if
+/// histograms are disabled or the prefix is unknown.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_request_latency(
+    conn: *const AsyncNatsConnection,
+    prefix: AsyncNatsSlice,
+) -> AsyncNatsLatencyHistogram {
+    ffi_call!();
+    let prefix: String = prefix.lossy_convert();
+    histogram_snapshot(conn, |h| h.request_by_prefix(&prefix))
+}
+
+/// Returns the number of subject prefixes with their own request latency
+/// histogram. Zero if histograms are disabled.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_request_latency_prefix_count(
+    conn: *const AsyncNatsConnection,
+) -> usize {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    conn.state
+        .histograms
+        .as_ref()
+        .map_or(0, |h| h.request.len())
+}
+
+/// Returns the subject prefix of the request latency histogram `index` in the
+/// order they were configured. Empty if `index` is out of range.
+///
+/// The slice is valid while the connection or any of its clones exists.
+#[no_mangle]
+pub extern "C" fn async_nats_connection_request_latency_prefix(
+    conn: *const AsyncNatsConnection,
+    index: usize,
+) -> AsyncNatsSlice {
+    ffi_call!();
+    let conn = unsafe { &*conn };
+    let prefix = conn
+        .state
+        .histograms
+        .as_ref()
+        .and_then(|h| h.request.get(index))
+        .map_or("", |(prefix, _)| prefix.as_str());
+    AsyncNatsSlice {
+        data: prefix.as_ptr() as *const c_void,
+        size: prefix.len() as u64,
+    }
+}
@@ -1,55 +1,286 @@
+use crate::abort::{AbortGuard, Abortable, AsyncNatsAbortHandle};
+use crate::ffi_calls::ffi_call;
+use crate::histogram::LatencyHistogram;
 use crate::message::AsyncNatsMessage;
+use crate::trace::trace_event;
 use async_nats::{Message, Subscriber};
 use futures::{FutureExt, StreamExt};
 use std::ffi::c_void;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+/// Capacity of the queue between the stamping task and the subscribtion. Matches
+/// the default capacity of the client subscriber.
+const STAMPED_CAPACITY: usize = 65536;
+
+/// StreamLimits define when a subscribtion is finished by the client.
+/// Subscribtion is unsubscribed when any of the limits is reached.
+#[derive(Debug, Default, Clone)]
+pub struct StreamLimits {
+    /// Finish after receiving this number of messages
+    pub max_messages: Option<usize>,
+    /// Finish if there are no messages for this duration
+    pub idle_timeout: Option<Duration>,
+    /// Finish when a message with empty payload is received. The sentinel message
+    /// itself is not delivered.
+    pub sentinel: bool,
+}
+
+/// Source of the subscribtion messages
+enum Source {
+    /// Messages are read directly from the client subscriber
+    Direct(Subscriber),
+    /// A separate task stamps every message with its arrival time to record the
+    /// delivery latency when the message is taken by the receiver
+    Stamped {
+        receiver: tokio::sync::mpsc::Receiver<(Instant, Message)>,
+        unsubscribe: Option<tokio::sync::oneshot::Sender<()>>,
+        histogram: Arc<LatencyHistogram>,
+    },
+}
+
+impl Source {
+    fn stamped(
+        rt: &tokio::runtime::Handle,
+        mut sub: Subscriber,
+        histogram: Arc<LatencyHistogram>,
+    ) -> Self {
+        let (tx, receiver) = tokio::sync::mpsc::channel(STAMPED_CAPACITY);
+        let (unsubscribe, mut unsubscribe_rx) = tokio::sync::oneshot::channel::<()>();
+        rt.spawn(async move {
+            let mut unsubscribed = false;
+            loop {
+                let msg = if unsubscribed {
+                    sub.next().await
+                } else {
+                    futures::select_biased! {
+                        msg = sub.next().fuse() => msg,
+                        _ = (&mut unsubscribe_rx).fuse() => {
+                            // messages that are already received are still delivered
+                            unsubscribed = true;
+                            sub.unsubscribe().await.ok();
+                            continue;
+                        },
+                    }
+                };
+                let Some(msg) = msg else {
+                    break;
+                };
+                if tx.send((Instant::now(), msg)).await.is_err() {
+                    break;
+                }
+            }
+        });
+        Source::Stamped {
+            receiver,
+            unsubscribe: Some(unsubscribe),
+            histogram,
+        }
+    }
+
+    async fn next(&mut self) -> Option<Message> {
+        match self {
+            Source::Direct(sub) => sub.next().await,
+            Source::Stamped {
+                receiver,
+                histogram,
+                ..
+            } => {
+                let (arrived, msg) = receiver.recv().await?;
+                histogram.record(arrived.elapsed());
+                Some(msg)
+            }
+        }
+    }
+
+    async fn unsubscribe(&mut self) {
+        match self {
+            Source::Direct(sub) => {
+                sub.unsubscribe().await.ok();
+            }
+            Source::Stamped { unsubscribe, .. } => {
+                if let Some(unsubscribe) = unsubscribe.take() {
+                    unsubscribe.send(()).ok();
+                }
+            }
+        }
+    }
+}
+
+/// Counters of the messages that are delivered by the subscribtion. They are
+/// shared so they can be read while a receive operation is in progress.
+#[derive(Default)]
+struct SubscribtionCounters {
+    messages: AtomicU64,
+    bytes: AtomicU64,
+}
 
 pub struct Subscribtion {
-    sub: Subscriber,
+    source: Source,
     sd_receiver: tokio::sync::mpsc::Receiver<()>,
+    limits: StreamLimits,
+    received: usize,
+    finished: bool,
+    /// the subscribtion is finished but the server has not been told yet
+    unsubscribe_pending: bool,
+    counters: Arc<SubscribtionCounters>,
 }
 
 impl Subscribtion {
-    pub async fn pop(&mut self) -> Option<Message> {
+    async fn next(&mut self) -> Option<Message> {
         loop {
             futures::select_biased! {
-                msg = self.sub.next().fuse() => {
+                msg = self.source.next().fuse() => {
                     return msg;
                 },
                 _ = self.sd_receiver.recv().fuse() => {
-                    self.sub.unsubscribe().await.expect("Unable to unsubscribe from channel");
+                    self.source.unsubscribe().await;
                 },
             };
         }
     }
+
+    pub async fn pop(&mut self) -> Option<Message> {
+        if self.finished {
+            if std::mem::take(&mut self.unsubscribe_pending) {
+                self.source.unsubscribe().await;
+            }
+            return None;
+        }
+
+        let msg = match self.limits.idle_timeout {
+            None => self.next().await,
+            Some(timeout) => match tokio::time::timeout(timeout, self.next()).await {
+                Ok(msg) => msg,
+                Err(_) => {
+                    self.finish().await;
+                    return None;
+                }
+            },
+        };
+        self.accept(msg)
+    }
+
+    /// Waits for at least one message and then takes up to `max` messages that are
+    /// already received without waiting. Returns an empty batch when the
+    /// subscribtion is finished.
+    pub async fn pop_batch(&mut self, max: usize) -> Vec<Message> {
+        let mut batch = Vec::new();
+        let Some(first) = self.pop().await else {
+            return batch;
+        };
+        batch.push(first);
+
+        while batch.len() < max && !self.finished {
+            let Some(msg) = self.next().now_or_never() else {
+                break;
+            };
+            match self.accept(msg) {
+                Some(msg) => batch.push(msg),
+                None => break,
+            }
+        }
+        batch
+    }
+
+    /// Applies stream limits to the received message. It does not wait, so an abort
+    /// never drops a message that is already taken from the source.
+    fn accept(&mut self, msg: Option<Message>) -> Option<Message> {
+        let Some(msg) = msg else {
+            self.finished = true;
+            return None;
+        };
+
+        if self.limits.sentinel && msg.payload.is_empty() {
+            self.finish_now();
+            return None;
+        }
+
+        self.received += 1;
+        self.counters.messages.fetch_add(1, Ordering::Relaxed);
+        self.counters
+            .bytes
+            .fetch_add(msg.payload.len() as u64, Ordering::Relaxed);
+        if self
+            .limits
+            .max_messages
+            .is_some_and(|max| self.received >= max)
+        {
+            self.finish_now();
+        }
+        Some(msg)
+    }
+
+    async fn finish(&mut self) {
+        self.finished = true;
+        self.source.unsubscribe().await;
+    }
+
+    /// Finishes the subscribtion without waiting. The unsubscription that can not
+    /// be sent right away is completed by the next `pop`.
+    fn finish_now(&mut self) {
+        self.finished = true;
+        self.unsubscribe_pending = self.source.unsubscribe().now_or_never().is_none();
+    }
 }
 
 pub struct AsyncNatsSubscribtion {
     pub(crate) rt: tokio::runtime::Handle,
     pub(crate) inner: Subscribtion,
     sd_sender: tokio::sync::mpsc::Sender<()>,
+    counters: Arc<SubscribtionCounters>,
 }
 
 impl AsyncNatsSubscribtion {
     pub fn new(rt: tokio::runtime::Handle, sub: Subscriber) -> Self {
+        Self::with_limits(rt, sub, StreamLimits::default())
+    }
+
+    pub fn with_limits(rt: tokio::runtime::Handle, sub: Subscriber, limits: StreamLimits) -> Self {
+        Self::with_source(rt, Source::Direct(sub), limits)
+    }
+
+    /// Creates a subscribtion that records the delivery latency of every message
+    pub fn stamped(
+        rt: tokio::runtime::Handle,
+        sub: Subscriber,
+        histogram: Arc<LatencyHistogram>,
+    ) -> Self {
+        let source = Source::stamped(&rt, sub, histogram);
+        Self::with_source(rt, source, StreamLimits::default())
+    }
+
+    fn with_source(rt: tokio::runtime::Handle, source: Source, limits: StreamLimits) -> Self {
         let (tx, rx) = tokio::sync::mpsc::channel(1);
+        let counters = Arc::new(SubscribtionCounters::default());
+        // a stream of zero messages is finished right away
+        let empty = limits.max_messages == Some(0);
         Self {
             rt,
             inner: Subscribtion {
-                sub,
+                source,
                 sd_receiver: rx,
+                limits,
+                received: 0,
+                finished: empty,
+                unsubscribe_pending: empty,
+                counters: counters.clone(),
             },
             sd_sender: tx,
+            counters,
         }
     }
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_subscribtion_delete(s: *mut AsyncNatsSubscribtion) {
+    ffi_call!();
     let mut s = unsafe { Box::from_raw(s) };
 
     let rt = s.rt.clone();
     rt.spawn(async move {
-        s.inner.sub.unsubscribe().await.ok();
+        s.inner.source.unsubscribe().await;
         drop(s);
     });
 }
@@ -61,23 +292,112 @@ pub struct AsyncNatsReceiveCallback(
 );
 unsafe impl Send for AsyncNatsReceiveCallback {}
 
+impl Abortable for AsyncNatsReceiveCallback {
+    fn aborted(self) {
+        self.0(std::ptr::null_mut(), self.1);
+    }
+}
+
+/// `abort` is an optional handle that aborts receiving. Messages are not lost when
+/// receiving is aborted and can be received by the next call.
 #[no_mangle]
 pub extern "C" fn async_nats_subscribtion_receive_async(
     s: *mut AsyncNatsSubscribtion,
+    abort: *const AsyncNatsAbortHandle,
     cb: AsyncNatsReceiveCallback,
 ) {
+    ffi_call!();
     let s = unsafe { &mut *s };
-    s.rt.spawn(async {
-        let cb = cb;
+    let abort = AsyncNatsAbortHandle::from_raw(abort);
+    trace_event!(AsyncNats_Trace_FfiEntry, cb.1);
+    let task = s.rt.spawn(async {
+        trace_event!(AsyncNats_Trace_TaskStart, cb.1);
+        let cb = AbortGuard::new(cb);
         let res = s.inner.pop().await;
+        let cb = cb.take();
         let Some(msg) = res else {
             cb.0(std::ptr::null_mut(), cb.1);
             return;
         };
+        trace_event!(AsyncNats_Trace_Receive, cb.1, &msg.subject);
 
         let boxed_msg: Box<AsyncNatsMessage> = Box::new(msg.into());
         cb.0(Box::into_raw(boxed_msg), cb.1);
     });
+    if let Some(abort) = abort {
+        abort.attach(task);
+    }
+}
+
+#[repr(C)]
+pub struct AsyncNatsReceiveBatchCallback(
+    extern "C" fn(msgs: *const *mut AsyncNatsMessage, count: usize, c: *mut c_void),
+    *mut c_void,
+);
+unsafe impl Send for AsyncNatsReceiveBatchCallback {}
+
+impl Abortable for AsyncNatsReceiveBatchCallback {
+    fn aborted(self) {
+        self.0(std::ptr::null(), 0, self.1);
+    }
+}
+
+/// Receives up to `max` messages at once. The callback owns every message but
+/// the array itself is only valid during the call. An empty batch means that the
+/// subscribtion is finished or the operation is aborted.
+#[no_mangle]
+pub extern "C" fn async_nats_subscribtion_receive_batch_async(
+    s: *mut AsyncNatsSubscribtion,
+    max: usize,
+    abort: *const AsyncNatsAbortHandle,
+    cb: AsyncNatsReceiveBatchCallback,
+) {
+    ffi_call!();
+    let s = unsafe { &mut *s };
+    let abort = AsyncNatsAbortHandle::from_raw(abort);
+    let rt = s.rt.clone();
+    trace_event!(AsyncNats_Trace_FfiEntry, cb.1);
+    let task = rt.spawn(async move {
+        trace_event!(AsyncNats_Trace_TaskStart, cb.1);
+        let cb = AbortGuard::new(cb);
+        let batch = s.inner.pop_batch(max.max(1)).await;
+        let cb = cb.take();
+
+        let msgs: Vec<*mut AsyncNatsMessage> = batch
+            .into_iter()
+            .map(|msg| {
+                trace_event!(AsyncNats_Trace_Receive, cb.1, &msg.subject);
+                let boxed_msg: Box<AsyncNatsMessage> = Box::new(msg.into());
+                Box::into_raw(boxed_msg)
+            })
+            .collect();
+        cb.0(msgs.as_ptr(), msgs.len(), cb.1);
+    });
+    if let Some(abort) = abort {
+        abort.attach(task);
+    }
+}
+
+/// Counters of the messages that are delivered to the application
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsSubscribtionStatistics {
+    pub messages: u64,
+    /// Payload bytes
+    pub bytes: u64,
+}
+
+/// Can be called while a receive operation is in progress
+#[no_mangle]
+pub extern "C" fn async_nats_subscribtion_statistics(
+    s: *const AsyncNatsSubscribtion,
+) -> AsyncNatsSubscribtionStatistics {
+    ffi_call!();
+    let s = unsafe { &*s };
+    AsyncNatsSubscribtionStatistics {
+        messages: s.counters.messages.load(Ordering::Relaxed),
+        bytes: s.counters.bytes.load(Ordering::Relaxed),
+    }
 }
 
 pub struct AsyncNatsSubscribtionCancellationToken {
@@ -88,6 +408,7 @@ pub struct AsyncNatsSubscribtionCancellationToken {
 pub extern "C" fn async_nats_subscribtion_get_cancellation_token(
     s: *mut AsyncNatsSubscribtion,
 ) -> *mut AsyncNatsSubscribtionCancellationToken {
+    ffi_call!();
     let s = unsafe { &mut *s };
     let token = Box::new(AsyncNatsSubscribtionCancellationToken {
         sd_sender: s.sd_sender.clone(),
@@ -99,6 +420,7 @@ pub extern "C" fn async_nats_subscribtion_get_cancellation_token(
 pub extern "C" fn async_nats_subscribtion_cancellation_token_clone(
     c: *mut AsyncNatsSubscribtionCancellationToken,
 ) -> *mut AsyncNatsSubscribtionCancellationToken {
+    ffi_call!();
     let c = unsafe { &mut *c };
     let token = Box::new(AsyncNatsSubscribtionCancellationToken {
         sd_sender: c.sd_sender.clone(),
@@ -110,6 +432,7 @@ pub extern "C" fn async_nats_subscribtion_cancellation_token_clone(
 pub extern "C" fn async_nats_subscribtion_cancellation_token_delete(
     c: *mut AsyncNatsSubscribtionCancellationToken,
 ) {
+    ffi_call!();
     let c = unsafe { Box::from_raw(c) };
     drop(c);
 }
@@ -118,6 +441,7 @@ pub extern "C" fn async_nats_subscribtion_cancellation_token_delete(
 pub extern "C" fn async_nats_subscribtion_cancellation_token_cancel(
     c: *mut AsyncNatsSubscribtionCancellationToken,
 ) {
+    ffi_call!();
     let c = unsafe { &mut *c };
     c.sd_sender.try_send(()).ok();
 }
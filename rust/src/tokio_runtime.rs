@@ -1,45 +1,311 @@
 use crate::api::{AsyncNatsBorrowedString, LossyConvert};
+use crate::ffi_calls::ffi_call;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::Duration;
+
+/// Number of CPUs that fit into the affinity mask
+#[cfg(target_os = "linux")]
+const MAX_CPUS: usize = libc::CPU_SETSIZE as usize;
+#[cfg(not(target_os = "linux"))]
+const MAX_CPUS: usize = usize::MAX;
 
 pub struct AsyncNatsTokioRuntime {
-    pub(crate) runtime: tokio::runtime::Runtime,
+    pub(crate) runtime: Arc<tokio::runtime::Runtime>,
+    driver: Option<RuntimeDriver>,
+    /// Runtime threads that could not be pinned to `cpu_affinity`
+    affinity_failures: Arc<AtomicU64>,
+}
+
+/// RuntimeDriver is a dedicated thread that drives the current-thread runtime
+struct RuntimeDriver {
+    stop: tokio::sync::oneshot::Sender<()>,
+    thread: std::thread::JoinHandle<()>,
 }
 
 impl AsyncNatsTokioRuntime {
     pub fn new(cfg: &AsyncNatsTokioRuntimeConfig) -> Self {
-        let runtime = tokio::runtime::Builder::new_multi_thread()
-            .enable_all()
-            .worker_threads(cfg.thread_count)
-            .thread_name(cfg.thread_name.as_str())
-            .build()
-            .expect("Unable to create tokio runtime");
-
-        Self { runtime }
+        let mut builder = match cfg.flavor {
+            AsyncNatsRuntimeFlavor::AsyncNats_Runtime_MultiThread => {
+                let mut builder = tokio::runtime::Builder::new_multi_thread();
+                builder.worker_threads(cfg.thread_count);
+                builder
+            }
+            AsyncNatsRuntimeFlavor::AsyncNats_Runtime_CurrentThread
+            | AsyncNatsRuntimeFlavor::AsyncNats_Runtime_CallerDriven => {
+                tokio::runtime::Builder::new_current_thread()
+            }
+        };
+        builder.enable_all().thread_name(cfg.thread_name.as_str());
+        if let Some(interval) = cfg.event_interval {
+            builder.event_interval(interval);
+        }
+        if let Some(interval) = cfg.global_queue_interval {
+            builder.global_queue_interval(interval);
+        }
+        if let Some(count) = cfg.max_blocking_threads {
+            builder.max_blocking_threads(count);
+        }
+        if let Some(keep_alive) = cfg.thread_keep_alive {
+            builder.thread_keep_alive(keep_alive);
+        }
+        let affinity_failures = Arc::new(AtomicU64::new(0));
+        if !cfg.cpu_affinity.is_empty() {
+            let cpus = cfg.cpu_affinity.clone();
+            let failures = affinity_failures.clone();
+            builder.on_thread_start(move || pin_current_thread(&cpus, &failures));
+        }
+        let runtime = Arc::new(builder.build().expect("Unable to create tokio runtime"));
+
+        let driver = match cfg.flavor {
+            AsyncNatsRuntimeFlavor::AsyncNats_Runtime_MultiThread
+            | AsyncNatsRuntimeFlavor::AsyncNats_Runtime_CallerDriven => None,
+            AsyncNatsRuntimeFlavor::AsyncNats_Runtime_CurrentThread => {
+                let (stop, rx) = tokio::sync::oneshot::channel::<()>();
+                let rt = runtime.clone();
+                let cpus = cfg.cpu_affinity.clone();
+                let failures = affinity_failures.clone();
+                let thread = std::thread::Builder::new()
+                    .name(cfg.thread_name.clone())
+                    .spawn(move || {
+                        pin_current_thread(&cpus, &failures);
+                        rt.block_on(rx).ok();
+                    })
+                    .expect("Unable to start tokio runtime thread");
+                Some(RuntimeDriver { stop, thread })
+            }
+        };
+
+        Self {
+            runtime,
+            driver,
+            affinity_failures,
+        }
     }
 
     pub fn handle(&self) -> tokio::runtime::Handle {
         self.runtime.handle().clone()
     }
+
+    #[cfg(tokio_unstable)]
+    pub fn metrics(&self) -> AsyncNatsRuntimeMetrics {
+        let m = self.runtime.metrics();
+        AsyncNatsRuntimeMetrics {
+            available: true,
+            workers: m.num_workers(),
+            remote_schedules: m.remote_schedule_count(),
+            global_queue_depth: m.injection_queue_depth(),
+            blocking_threads: m.num_blocking_threads(),
+            idle_blocking_threads: m.num_idle_blocking_threads(),
+            blocking_queue_depth: m.blocking_queue_depth(),
+            affinity_failures: self.affinity_failures.load(Ordering::Relaxed),
+        }
+    }
+
+    #[cfg(not(tokio_unstable))]
+    pub fn metrics(&self) -> AsyncNatsRuntimeMetrics {
+        AsyncNatsRuntimeMetrics {
+            affinity_failures: self.affinity_failures.load(Ordering::Relaxed),
+            ..Default::default()
+        }
+    }
+
+    #[cfg(tokio_unstable)]
+    pub fn worker_metrics(&self, worker: usize) -> AsyncNatsWorkerMetrics {
+        let m = self.runtime.metrics();
+        if worker >= m.num_workers() {
+            return AsyncNatsWorkerMetrics::default();
+        }
+        AsyncNatsWorkerMetrics {
+            busy_time_us: m.worker_total_busy_duration(worker).as_micros() as u64,
+            polls: m.worker_poll_count(worker),
+            steals: m.worker_steal_count(worker),
+            steal_operations: m.worker_steal_operations(worker),
+            local_schedules: m.worker_local_schedule_count(worker),
+            overflows: m.worker_overflow_count(worker),
+            parks: m.worker_park_count(worker),
+            local_queue_depth: m.worker_local_queue_depth(worker),
+        }
+    }
+
+    #[cfg(not(tokio_unstable))]
+    pub fn worker_metrics(&self, _worker: usize) -> AsyncNatsWorkerMetrics {
+        AsyncNatsWorkerMetrics::default()
+    }
+}
+
+impl Drop for AsyncNatsTokioRuntime {
+    fn drop(&mut self) {
+        if let Some(driver) = self.driver.take() {
+            driver.stop.send(()).ok();
+            driver.thread.join().ok();
+        }
+    }
+}
+
+/// Restricts the current thread to the CPU set and counts the failure in
+/// `failures` if the system rejects it. Does nothing on platforms without thread
+/// affinity support.
+fn pin_current_thread(cpus: &[usize], failures: &AtomicU64) {
+    if cpus.is_empty() {
+        return;
+    }
+
+    #[cfg(target_os = "linux")]
+    unsafe {
+        let mut set: libc::cpu_set_t = std::mem::zeroed();
+        // CPUs are checked against MAX_CPUS when the config is set
+        for cpu in cpus {
+            libc::CPU_SET(*cpu, &mut set);
+        }
+        if libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &set) != 0 {
+            failures.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+    #[cfg(not(target_os = "linux"))]
+    let _ = failures;
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_tokio_runtime_new(
     cfg: *const AsyncNatsTokioRuntimeConfig,
 ) -> *mut AsyncNatsTokioRuntime {
+    ffi_call!();
     let cfg = unsafe { &*cfg };
     let tr = Box::new(AsyncNatsTokioRuntime::new(cfg));
     Box::into_raw(tr)
 }
 
+/// Runs tasks of the caller-driven runtime that are ready and polls I/O without
+/// waiting. Tasks woken by that I/O are run before returning. Must not be called
+/// from a callback that is invoked by the runtime.
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_poll(runtime: *const AsyncNatsTokioRuntime) {
+    ffi_call!();
+    let runtime = unsafe { &*runtime };
+    // the scheduler polls I/O only after the run queue is drained, so the first
+    // yield runs ready tasks and the second one runs the tasks woken by I/O
+    runtime.runtime.block_on(async {
+        tokio::task::yield_now().await;
+        tokio::task::yield_now().await;
+    });
+}
+
+/// Runs tasks of the caller-driven runtime for `timeout_us` microseconds. Must not
+/// be called from a callback that is invoked by the runtime.
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_poll_for(
+    runtime: *const AsyncNatsTokioRuntime,
+    timeout_us: u64,
+) {
+    ffi_call!();
+    let runtime = unsafe { &*runtime };
+    runtime
+        .runtime
+        .block_on(tokio::time::sleep(Duration::from_micros(timeout_us)));
+}
+
+/// Scheduler counters of the whole runtime.
+///
+/// Tokio exposes them only when the library is built with `--cfg tokio_unstable`.
+/// Otherwise all fields are zero and `available` is false.
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsRuntimeMetrics {
+    /// True if the library is built with runtime metrics support
+    pub available: bool,
+    /// Number of worker threads
+    pub workers: usize,
+    /// Number of tasks scheduled from outside of the runtime
+    pub remote_schedules: u64,
+    /// Number of tasks waiting in the global queue
+    pub global_queue_depth: usize,
+    /// Number of threads in the blocking pool
+    pub blocking_threads: usize,
+    /// Number of idle threads in the blocking pool
+    pub idle_blocking_threads: usize,
+    /// Number of tasks waiting for a blocking pool thread
+    pub blocking_queue_depth: usize,
+    /// Number of runtime threads that could not be pinned to the configured CPUs.
+    /// Collected regardless of `available`.
+    pub affinity_failures: u64,
+}
+
+/// Scheduler counters of a single worker thread. Counters are monotonic since the
+/// runtime start; depths are instant values.
+#[repr(C)]
+#[derive(Debug, Default)]
+pub struct AsyncNatsWorkerMetrics {
+    /// Total time the worker spent polling tasks
+    pub busy_time_us: u64,
+    /// Number of task polls
+    pub polls: u64,
+    /// Number of tasks stolen from other workers
+    pub steals: u64,
+    /// Number of steal operations
+    pub steal_operations: u64,
+    /// Number of tasks scheduled from the worker thread
+    pub local_schedules: u64,
+    /// Number of times the local queue overflowed into the global queue
+    pub overflows: u64,
+    /// Number of times the worker parked
+    pub parks: u64,
+    /// Number of tasks waiting in the local queue
+    pub local_queue_depth: usize,
+}
+
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_metrics(
+    runtime: *const AsyncNatsTokioRuntime,
+) -> AsyncNatsRuntimeMetrics {
+    ffi_call!();
+    let runtime = unsafe { &*runtime };
+    runtime.metrics()
+}
+
+/// Returns counters of the worker thread. `worker` must be less than
+/// `AsyncNatsRuntimeMetrics::workers`; zeroes are returned otherwise.
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_worker_metrics(
+    runtime: *const AsyncNatsTokioRuntime,
+    worker: usize,
+) -> AsyncNatsWorkerMetrics {
+    ffi_call!();
+    let runtime = unsafe { &*runtime };
+    runtime.worker_metrics(worker)
+}
+
 #[no_mangle]
 pub extern "C" fn async_nats_tokio_runtime_delete(runtime: *mut AsyncNatsTokioRuntime) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(runtime));
     }
 }
 
+#[repr(C)]
+#[allow(non_camel_case_types, dead_code)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AsyncNatsRuntimeFlavor {
+    /// Tasks are executed by a pool of `thread_count` worker threads
+    AsyncNats_Runtime_MultiThread,
+    /// Tasks are executed by a single dedicated thread
+    AsyncNats_Runtime_CurrentThread,
+    /// Tasks are executed by the thread that calls `async_nats_tokio_runtime_poll`
+    /// or `async_nats_tokio_runtime_poll_for`. Nothing happens between the calls.
+    AsyncNats_Runtime_CallerDriven,
+}
+
+#[derive(Clone)]
 pub struct AsyncNatsTokioRuntimeConfig {
     thread_name: String,
     thread_count: usize,
+    flavor: AsyncNatsRuntimeFlavor,
+    event_interval: Option<u32>,
+    global_queue_interval: Option<u32>,
+    max_blocking_threads: Option<usize>,
+    thread_keep_alive: Option<Duration>,
+    cpu_affinity: Vec<usize>,
 }
 
 impl Default for AsyncNatsTokioRuntimeConfig {
@@ -52,18 +318,38 @@ impl Default for AsyncNatsTokioRuntimeConfig {
                     Err(_) => 1,
                 }
             },
+            flavor: AsyncNatsRuntimeFlavor::AsyncNats_Runtime_MultiThread,
+            event_interval: None,
+            global_queue_interval: None,
+            max_blocking_threads: None,
+            thread_keep_alive: None,
+            cpu_affinity: Vec::new(),
         }
     }
 }
 
 #[no_mangle]
 pub extern "C" fn async_nats_tokio_runtime_config_new() -> *mut AsyncNatsTokioRuntimeConfig {
+    ffi_call!();
     let cfg = Box::new(AsyncNatsTokioRuntimeConfig::default());
     Box::into_raw(cfg)
 }
 
+/// Returns a copy of the config or null if `cfg` is null
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_config_clone(
+    cfg: *const AsyncNatsTokioRuntimeConfig,
+) -> *mut AsyncNatsTokioRuntimeConfig {
+    ffi_call!();
+    let Some(cfg) = (unsafe { cfg.as_ref() }) else {
+        return std::ptr::null_mut();
+    };
+    Box::into_raw(Box::new(cfg.clone()))
+}
+
 #[no_mangle]
 pub extern "C" fn async_nats_tokio_runtime_config_delete(cfg: *mut AsyncNatsTokioRuntimeConfig) {
+    ffi_call!();
     unsafe {
         drop(Box::from_raw(cfg));
     }
@@ -74,6 +360,7 @@ pub extern "C" fn async_nats_tokio_runtime_config_thread_name(
     cfg: *mut AsyncNatsTokioRuntimeConfig,
     thread_name: AsyncNatsBorrowedString,
 ) {
+    ffi_call!();
     let cfg = unsafe { &mut *cfg };
     cfg.thread_name = thread_name.lossy_convert();
 }
@@ -83,6 +370,94 @@ pub extern "C" fn async_nats_tokio_runtime_config_thread_count(
     cfg: *mut AsyncNatsTokioRuntimeConfig,
     thread_count: u32,
 ) {
+    ffi_call!();
     let cfg = unsafe { &mut *cfg };
     cfg.thread_count = thread_count as usize;
 }
+
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_config_flavor(
+    cfg: *mut AsyncNatsTokioRuntimeConfig,
+    flavor: AsyncNatsRuntimeFlavor,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.flavor = flavor;
+}
+
+/// Number of scheduler ticks after which the scheduler polls for external
+/// events (timers, I/O)
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_config_event_interval(
+    cfg: *mut AsyncNatsTokioRuntimeConfig,
+    interval: u32,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.event_interval = Some(interval);
+}
+
+/// Number of scheduler ticks after which the scheduler polls the global task
+/// queue. Returns false and leaves the config unchanged if `interval` is 0.
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_config_global_queue_interval(
+    cfg: *mut AsyncNatsTokioRuntimeConfig,
+    interval: u32,
+) -> bool {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    if interval == 0 {
+        return false;
+    }
+    cfg.global_queue_interval = Some(interval);
+    true
+}
+
+/// Maximum number of threads spawned for blocking operations. Returns false and
+/// leaves the config unchanged if `count` is 0.
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_config_max_blocking_threads(
+    cfg: *mut AsyncNatsTokioRuntimeConfig,
+    count: u32,
+) -> bool {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    if count == 0 {
+        return false;
+    }
+    cfg.max_blocking_threads = Some(count as usize);
+    true
+}
+
+/// Time that idle blocking threads are kept alive
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_config_thread_keep_alive(
+    cfg: *mut AsyncNatsTokioRuntimeConfig,
+    keep_alive_us: u64,
+) {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    cfg.thread_keep_alive = Some(Duration::from_micros(keep_alive_us));
+}
+
+/// Pins every runtime thread to the set of `count` CPUs. The array is copied.
+/// Supported on Linux only. Returns false and leaves the config unchanged if a
+/// CPU does not fit into the affinity mask of the system.
+#[no_mangle]
+pub extern "C" fn async_nats_tokio_runtime_config_cpu_affinity(
+    cfg: *mut AsyncNatsTokioRuntimeConfig,
+    cpus: *const usize,
+    count: usize,
+) -> bool {
+    ffi_call!();
+    let cfg = unsafe { &mut *cfg };
+    let cpus = match count {
+        0 => &[][..],
+        _ => unsafe { std::slice::from_raw_parts(cpus, count) },
+    };
+    if cpus.iter().any(|cpu| *cpu >= MAX_CPUS) {
+        return false;
+    }
+    cfg.cpu_affinity = cpus.to_vec();
+    true
+}
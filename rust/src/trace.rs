@@ -0,0 +1,139 @@
+//! Tracing hooks report the stages of every publish, request and receive to a
+//! registered C callback. They are built only with the `trace-hooks` feature;
+//! without it `trace_event!` expands to nothing and its arguments are not
+//! evaluated.
+
+#[cfg(feature = "trace-hooks")]
+use crate::api::AsyncNatsSlice;
+#[cfg(feature = "trace-hooks")]
+use crate::ffi_calls::ffi_call;
+#[cfg(feature = "trace-hooks")]
+use std::ffi::c_void;
+#[cfg(feature = "trace-hooks")]
+use std::sync::atomic::{AtomicPtr, Ordering};
+#[cfg(feature = "trace-hooks")]
+use std::sync::OnceLock;
+#[cfg(feature = "trace-hooks")]
+use std::time::Instant;
+
+/// Stage of the operation at which the trace event is fired
+#[cfg(feature = "trace-hooks")]
+#[repr(C)]
+#[allow(non_camel_case_types, dead_code)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AsyncNatsTraceStage {
+    /// The operation is initiated by the C++ wrapper
+    AsyncNats_Trace_Initiate,
+    /// The FFI function of the operation is entered
+    AsyncNats_Trace_FfiEntry,
+    /// The tokio task of the operation starts running
+    AsyncNats_Trace_TaskStart,
+    /// The message is handed over to the writer of the connection. The writer
+    /// flushes the socket for many messages at once so this is the last stage of
+    /// a publish.
+    AsyncNats_Trace_Enqueue,
+    /// The message or the reply is received from the connection
+    AsyncNats_Trace_Receive,
+    /// The completion handler is about to be invoked by the C++ wrapper
+    AsyncNats_Trace_Handler,
+}
+
+/// Trace event is only valid during the hook call
+#[cfg(feature = "trace-hooks")]
+#[repr(C)]
+#[derive(Debug)]
+pub struct AsyncNatsTraceEvent {
+    pub stage: AsyncNatsTraceStage,
+    /// Identity of the operation. It is the completion context passed to the FFI
+    /// function so every stage of one operation reports the same id. Ids are
+    /// reused after the operation completes.
+    pub id: u64,
+    /// Monotonic time in nanoseconds since the first event of the process
+    pub timestamp_ns: u64,
+    /// Subject of the message. Empty if the stage does not know it.
+    pub subject: AsyncNatsSlice,
+}
+
+/// Trace hook is called synchronously from the thread that fires the event so it
+/// must be thread safe and fast. Null function disables tracing.
+#[cfg(feature = "trace-hooks")]
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct AsyncNatsTraceHook(
+    Option<extern "C" fn(event: *const AsyncNatsTraceEvent, ctx: *mut c_void)>,
+    *mut c_void,
+);
+
+#[cfg(feature = "trace-hooks")]
+static HOOK: AtomicPtr<AsyncNatsTraceHook> = AtomicPtr::new(std::ptr::null_mut());
+
+#[cfg(feature = "trace-hooks")]
+fn timestamp_ns() -> u64 {
+    static EPOCH: OnceLock<Instant> = OnceLock::new();
+    EPOCH.get_or_init(Instant::now).elapsed().as_nanos() as u64
+}
+
+#[cfg(feature = "trace-hooks")]
+pub(crate) fn emit(stage: AsyncNatsTraceStage, id: u64, subject: &[u8]) {
+    let hook = HOOK.load(Ordering::Acquire);
+    if hook.is_null() {
+        return;
+    }
+    let hook = unsafe { *hook };
+    let Some(f) = hook.0 else {
+        return;
+    };
+    let event = AsyncNatsTraceEvent {
+        stage,
+        id,
+        timestamp_ns: timestamp_ns(),
+        subject: AsyncNatsSlice {
+            data: subject.as_ptr() as *const c_void,
+            size: subject.len() as u64,
+        },
+    };
+    f(&event, hook.1);
+}
+
+/// Reports the stage of the operation `$id` to the trace hook
+#[cfg(feature = "trace-hooks")]
+macro_rules! trace_event {
+    ($stage:ident, $id:expr) => {
+        $crate::trace::trace_event!($stage, $id, "")
+    };
+    ($stage:ident, $id:expr, $subject:expr) => {
+        $crate::trace::emit(
+            $crate::trace::AsyncNatsTraceStage::$stage,
+            $id as u64,
+            AsRef::<[u8]>::as_ref($subject),
+        )
+    };
+}
+
+#[cfg(not(feature = "trace-hooks"))]
+macro_rules! trace_event {
+    ($($args:tt)*) => {};
+}
+
+pub(crate) use trace_event;
+
+/// Registers the trace hook. Hooks are expected to be set once at startup: the
+/// previous hook is never freed because other threads may still be calling it.
+#[cfg(feature = "trace-hooks")]
+#[no_mangle]
+pub extern "C" fn async_nats_trace_set_hook(hook: AsyncNatsTraceHook) {
+    ffi_call!();
+    HOOK.store(Box::into_raw(Box::new(hook)), Ordering::Release);
+}
+
+/// Fires the event of a stage that is observed by the caller of the library
+#[cfg(feature = "trace-hooks")]
+#[no_mangle]
+pub extern "C" fn async_nats_trace_emit(
+    stage: AsyncNatsTraceStage,
+    id: u64,
+    subject: AsyncNatsSlice,
+) {
+    ffi_call!();
+    emit(stage, id, subject.as_slice().unwrap_or_default());
+}
@@ -0,0 +1,326 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <boost/asio/bind_allocator.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+// The test binary replaces the global operator new to count the allocations of the C++ wrappers.
+// Only the thread that starts the operations is counted, so allocations of the handlers on the
+// runtime threads and of the in-process test server are not. Rust allocations are counted on all
+// threads when the library is built with ASYNC_NATS_ALLOC_ACCOUNTING.
+//
+// The C++ pins below are the exact allocations of one operation. The total over all operations is
+// compared, so a change that adds or removes an allocation on a hot path, even in a fraction of
+// the operations, fails these tests and the pin has to be updated.
+//
+// Rust allocations of other threads, e.g. the connection reader and writer or the tokio timers,
+// cannot be told apart from the ones of the operations. The Rust pins are therefore upper bounds
+// of the average per operation over a warmed-up run: the allocations of the operation itself plus
+// a tolerance for the background work. They are checked by the alloc-accounting CI job, which
+// reports the measured average when a bound is exceeded.
+
+namespace
+{
+thread_local uint64_t cpp_allocations = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+  ++cpp_allocations;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t /*size*/) noexcept
+{
+  std::free(p);
+}
+
+namespace
+{
+namespace pins
+{
+/// completion handler contexts are reused by detail::CtxPool
+constexpr uint64_t publish_cpp = 0;
+constexpr uint64_t receive_cpp = 0;
+constexpr uint64_t request_cpp = 0;
+
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+/// background allocations of other threads allowed per operation on average
+constexpr double rust_tolerance = 1.0;
+
+/// subject string, tokio task
+constexpr uint64_t publish_rust = 2;
+/// tokio task, boxed message
+constexpr uint64_t receive_rust = 2;
+/// requester: subject string, tokio task, inbox, response channel, response message and its box;
+/// responder: received message and its box, reply subject, receive and publish tasks
+constexpr uint64_t request_rust = 16;
+#endif
+}  // namespace pins
+
+constexpr uint64_t operations = 1000;
+
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+/// rust_budget returns the upper bound of the average Rust allocations of one operation
+constexpr double rust_budget(uint64_t pin) noexcept
+{
+  return static_cast<double>(pin) + pins::rust_tolerance;
+}
+
+/// per_operation returns the average number of allocations of one operation
+double per_operation(uint64_t allocations) noexcept
+{
+  return static_cast<double>(allocations) / static_cast<double>(operations);
+}
+#endif
+
+/// Allocations counts allocations since its creation
+class Allocations
+{
+public:
+  uint64_t cpp() const noexcept { return cpp_allocations - cpp_start_; }
+
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+  uint64_t rust() const noexcept { return rust_.allocations(); }
+#endif
+
+private:
+  uint64_t cpp_start_ = cpp_allocations;
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+  async_nats::RustAllocationCounter rust_;
+#endif
+};
+
+/// Completions waits for the handlers without allocations
+class Completions
+{
+public:
+  void done() noexcept
+  {
+    count_.fetch_add(1, std::memory_order_release);
+    count_.notify_one();
+  }
+
+  void wait(uint64_t count) noexcept
+  {
+    auto current = count_.load(std::memory_order_acquire);
+    while (current < count) {
+      count_.wait(current, std::memory_order_acquire);
+      current = count_.load(std::memory_order_acquire);
+    }
+    count_.fetch_sub(count, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> count_ {0};
+};
+
+/// Arena hands out memory of a preallocated buffer and never reuses it
+class Arena
+{
+public:
+  explicit Arena(std::size_t size)
+      : buffer_(std::make_unique<std::byte[]>(size))
+      , size_(size)
+  {
+  }
+
+  void* allocate(std::size_t size)
+  {
+    constexpr auto align = alignof(std::max_align_t);
+    size = (size + align - 1) / align * align;
+    if (used_ + size > size_) {
+      throw std::bad_alloc();
+    }
+    used_ += size;
+    return buffer_.get() + used_ - size;
+  }
+
+private:
+  std::unique_ptr<std::byte[]> buffer_;
+  std::size_t size_;
+  std::size_t used_ = 0;
+};
+
+template<class T>
+class ArenaAllocator
+{
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(Arena& arena) noexcept
+      : arena_(&arena)
+  {
+  }
+
+  template<class U>
+  explicit ArenaAllocator(const ArenaAllocator<U>& o) noexcept
+      : arena_(o.arena())
+  {
+  }
+
+  T* allocate(std::size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T))); }
+
+  void deallocate(T* /*p*/, std::size_t /*n*/) noexcept {}
+
+  Arena* arena() const noexcept { return arena_; }
+
+  friend bool operator==(const ArenaAllocator& a, const ArenaAllocator& b) noexcept
+  {
+    return a.arena_ == b.arena_;
+  }
+
+  friend bool operator!=(const ArenaAllocator& a, const ArenaAllocator& b) noexcept
+  {
+    return a.arena_ != b.arena_;
+  }
+
+private:
+  Arena* arena_;
+};
+
+/// Responder replies to every request with its payload
+struct Responder
+{
+  async_nats::Connection& conn;
+  async_nats::Subscribtion sub;
+
+  void next()
+  {
+    sub.receive(
+        [this](async_nats::Message msg)
+        {
+          if (!msg) {
+            return;
+          }
+          const auto data = msg.data();
+          conn.publish(*msg.reply_to(), boost::asio::buffer(data.data(), data.size()), [] {});
+          next();
+        });
+  }
+};
+
+}  // namespace
+
+TEST_F(NatsFixture, PublishAllocations)
+{
+  const auto m = c.new_mailbox();
+  const std::string data = "test";
+  Completions completions;
+  auto publish = [&]
+  {
+    for (uint64_t i = 0; i < operations; ++i) {
+      c.publish(m, boost::asio::buffer(data), [&completions] { completions.done(); });
+    }
+    completions.wait(operations);
+  };
+
+  publish();
+  const Allocations allocations;
+  publish();
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+  EXPECT_LE(per_operation(allocations.rust()), rust_budget(pins::publish_rust));
+#endif
+  EXPECT_EQ(allocations.cpp(), pins::publish_cpp * operations);
+}
+
+/// Check that publish does not allocate if the handler has an allocator of its own
+TEST_F(NatsFixture, PublishWithAllocatorDoesNotAllocate)
+{
+  const auto m = c.new_mailbox();
+  const std::string data = "test";
+  Arena arena(1024 * 1024);
+  Completions completions;
+  auto publish = [&]
+  {
+    for (uint64_t i = 0; i < operations; ++i) {
+      c.publish(m,
+                boost::asio::buffer(data),
+                boost::asio::bind_allocator(ArenaAllocator<void>(arena),
+                                            [&completions] { completions.done(); }));
+    }
+    completions.wait(operations);
+  };
+
+  publish();
+  const Allocations allocations;
+  publish();
+  const auto cpp = allocations.cpp();
+  EXPECT_EQ(cpp, 0);
+}
+
+TEST_F(NatsFixture, ReceiveAllocations)
+{
+  const auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+  const std::string data = "test";
+  Completions completions;
+  auto receive = [&]
+  {
+    for (uint64_t i = 0; i < operations; ++i) {
+      c.publish(m, boost::asio::buffer(data), [&completions] { completions.done(); });
+    }
+    completions.wait(operations);
+    std::this_thread::sleep_for(10 * default_sleep);
+
+    const Allocations allocations;
+    for (uint64_t i = 0; i < operations; ++i) {
+      sub.receive([&completions](const async_nats::Message&) { completions.done(); });
+      completions.wait(1);
+    }
+    return allocations;
+  };
+
+  receive();
+  const auto allocations = receive();
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+  EXPECT_LE(per_operation(allocations.rust()), rust_budget(pins::receive_rust));
+#endif
+  EXPECT_EQ(allocations.cpp(), pins::receive_cpp * operations);
+}
+
+TEST_F(NatsFixture, RequestAllocations)
+{
+  const auto m = c.new_mailbox();
+  Responder responder {c, c.subcribe(m, boost::asio::use_future).get()};
+  responder.next();
+  std::this_thread::sleep_for(default_sleep);
+
+  const std::string data = "test";
+  Completions completions;
+  auto request = [&]
+  {
+    for (uint64_t i = 0; i < operations; ++i) {
+      c.request(m,
+                boost::asio::buffer(data),
+                [&completions](std::exception_ptr, const async_nats::Message&)
+                { completions.done(); });
+      completions.wait(1);
+    }
+  };
+
+  request();
+  const Allocations allocations;
+  request();
+#if defined(ASYNC_NATS_ALLOC_ACCOUNTING)
+  EXPECT_LE(per_operation(allocations.rust()), rust_budget(pins::request_rust));
+#endif
+  EXPECT_EQ(allocations.cpp(), pins::request_cpp * operations);
+}
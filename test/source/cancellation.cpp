@@ -0,0 +1,96 @@
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/system_error.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that the cancelled request completes with operation_aborted
+TEST_F(NatsFixture, CancelRequest)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  boost::asio::cancellation_signal signal;
+  auto req =
+      c.request(m,
+                boost::asio::const_buffer(),
+                boost::asio::bind_cancellation_slot(signal.slot(), boost::asio::use_future));
+
+  // wait for the request to reach the responder and never reply
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+
+  signal.emit(boost::asio::cancellation_type::terminal);
+  GTEST_ASSERT_EQ(req.wait_for(test_timeout), std::future_status::ready);
+  try {
+    req.get();
+    FAIL() << "cancelled request must not succeed";
+  } catch (const boost::system::system_error& e) {
+    GTEST_ASSERT_EQ(e.code(), boost::asio::error::operation_aborted);
+  }
+}
+
+/// Check that cancelled receive does not lose messages
+TEST_F(NatsFixture, CancelReceive)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  boost::asio::cancellation_signal signal;
+  auto res = sub.receive(
+      boost::asio::bind_cancellation_slot(signal.slot(), boost::asio::use_future));
+  signal.emit(boost::asio::cancellation_type::terminal);
+  GTEST_ASSERT_EQ(res.wait_for(test_timeout), std::future_status::ready);
+  GTEST_ASSERT_EQ(res.get(), false);
+
+  std::string data = "test";
+  c.publish(m, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+  GTEST_ASSERT_EQ(msg.data(), data);
+}
+
+/// Check that total cancellation is ignored once the request is sent and the slot is cleared
+TEST_F(NatsFixture, CancelRequestTotalAfterSend)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  boost::asio::cancellation_signal signal;
+  auto req =
+      c.request(m,
+                boost::asio::const_buffer(),
+                boost::asio::bind_cancellation_slot(signal.slot(), boost::asio::use_future));
+
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+
+  // the request already had side effects, so it can not be cancelled without them
+  signal.emit(boost::asio::cancellation_type::total);
+  std::string data = "reply";
+  c.publish(*msg.reply_to(),
+            boost::asio::const_buffer(data.data(), data.size()),
+            boost::asio::use_future)
+      .get();
+  GTEST_ASSERT_EQ(req.wait_for(test_timeout), std::future_status::ready);
+  GTEST_ASSERT_EQ(req.get().data(), data);
+  GTEST_ASSERT_FALSE(signal.slot().has_handler());
+}
+
+/// Check that receive supports total cancellation because it has no side effects
+TEST_F(NatsFixture, CancelReceiveTotal)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  boost::asio::cancellation_signal signal;
+  auto res = sub.receive(
+      boost::asio::bind_cancellation_slot(signal.slot(), boost::asio::use_future));
+  signal.emit(boost::asio::cancellation_type::total);
+  GTEST_ASSERT_EQ(res.wait_for(test_timeout), std::future_status::ready);
+  GTEST_ASSERT_EQ(res.get(), false);
+  GTEST_ASSERT_FALSE(signal.slot().has_handler());
+}
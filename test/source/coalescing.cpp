@@ -0,0 +1,89 @@
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/system_error.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that identical requests in flight are sent once and share the reply
+TEST_F(NatsFixture, CoalescedRequest)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  constexpr std::size_t count = 3;
+  std::string request = "test";
+  std::vector<std::future<async_nats::Message>> requests;
+  for (std::size_t i = 0; i < count; ++i) {
+    requests.push_back(
+        c.request(m,
+                  std::move(async_nats::RequestBuilder()
+                                .data(boost::asio::const_buffer(request.data(), request.size()))
+                                .coalesce()),
+                  boost::asio::use_future));
+  }
+
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+  // let all requests join the one in flight
+  std::this_thread::sleep_for(default_sleep);
+
+  std::string reply = "test reply";
+  c.publish(msg.reply_to().value(),
+            boost::asio::const_buffer(reply.data(), reply.size()),
+            boost::asio::use_future)
+      .get();
+
+  for (auto& req : requests) {
+    auto response = req.get();
+    GTEST_ASSERT_EQ(response, true);
+    GTEST_ASSERT_EQ(response.data(), reply);
+  }
+
+  // only one request went on the wire
+  auto extra = sub.receive(boost::asio::use_future);
+  GTEST_ASSERT_EQ(extra.wait_for(default_sleep), std::future_status::timeout);
+
+  auto stats = c.request_statistics();
+  GTEST_ASSERT_EQ(stats.requests, count);
+  GTEST_ASSERT_EQ(stats.coalesced, count - 1);
+}
+
+/// Check that the request is sent again when every request of the previous flight is aborted
+TEST_F(NatsFixture, CoalescedRequestAborted)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+  std::string request = "test";
+  auto coalesced = [&]
+  {
+    return std::move(async_nats::RequestBuilder()
+                         .data(boost::asio::const_buffer(request.data(), request.size()))
+                         .coalesce());
+  };
+
+  boost::asio::cancellation_signal signal;
+  auto aborted = c.request(
+      m, coalesced(), boost::asio::bind_cancellation_slot(signal.slot(), boost::asio::use_future));
+  GTEST_ASSERT_EQ(sub.receive(boost::asio::use_future).get(), true);
+  signal.emit(boost::asio::cancellation_type::terminal);
+  GTEST_ASSERT_EQ(aborted.wait_for(test_timeout), std::future_status::ready);
+  ASSERT_THROW(aborted.get(), boost::system::system_error);
+
+  auto req = c.request(m, coalesced(), boost::asio::use_future);
+  auto received = sub.receive(boost::asio::use_future);
+  GTEST_ASSERT_EQ(received.wait_for(test_timeout), std::future_status::ready);
+  const auto msg = received.get();
+  std::string reply = "test reply";
+  c.publish(msg.reply_to().value(),
+            boost::asio::const_buffer(reply.data(), reply.size()),
+            boost::asio::use_future)
+      .get();
+  GTEST_ASSERT_EQ(req.get().data(), reply);
+  GTEST_ASSERT_EQ(c.request_statistics().coalesced, 0);
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <async_nats/testing/server.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/system_executor.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that the connected event is delivered on the chosen executor
+TEST(ConnectionEvents, ConnectedOnExecutor)
+{
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+  std::thread ioc_thread([&ioc]() { ioc.run(); });
+
+  auto connected = std::make_shared<std::promise<std::thread::id>>();
+  auto result = connected->get_future();
+
+  async_nats::TokioRuntime rt;
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url())
+      .on_event(ioc.get_executor(),
+                [connected](async_nats::ConnectionEvent event) mutable
+                {
+                  if (event.kind == AsyncNats_Event_Connected && connected) {
+                    connected->set_value(std::this_thread::get_id());
+                    connected.reset();
+                  }
+                });
+
+  {
+    auto c = async_nats::connect(rt, options, boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(result.wait_for(NatsFixture::test_timeout), std::future_status::ready);
+    GTEST_ASSERT_EQ(result.get(), ioc_thread.get_id());
+  }
+
+  work.reset();
+  ioc_thread.join();
+}
+
+/// Check that an outage is reported as Disconnected followed by Connected once the server is back
+TEST(ConnectionEvents, DisconnectAndReconnect)
+{
+  struct Sequence
+  {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<AsyncNatsConnectionEventKind> kinds;
+  };
+  auto sequence = std::make_shared<Sequence>();
+  const auto wait_for = [&sequence](std::size_t count)
+  {
+    std::unique_lock<std::mutex> lock(sequence->mutex);
+    // the client backs off between reconnect attempts
+    return sequence->cv.wait_for(lock,
+                                 std::chrono::seconds(10),
+                                 [&sequence, count] { return sequence->kinds.size() >= count; });
+  };
+
+  async_nats::testing::Server server;
+  async_nats::TokioRuntime rt;
+  async_nats::ConnectionOptions options;
+  options.address(server.url())
+      .on_event(boost::asio::system_executor(),
+                [sequence](const async_nats::ConnectionEvent& event)
+                {
+                  if (event.kind != AsyncNats_Event_Connected
+                      && event.kind != AsyncNats_Event_Disconnected)
+                  {
+                    return;
+                  }
+                  {
+                    const std::lock_guard<std::mutex> lock(sequence->mutex);
+                    sequence->kinds.push_back(event.kind);
+                  }
+                  sequence->cv.notify_all();
+                });
+
+  auto c = async_nats::connect(rt, options, boost::asio::use_future).get();
+  GTEST_ASSERT_TRUE(wait_for(1));
+
+  const auto port = server.port();
+  server.stop();
+  GTEST_ASSERT_TRUE(wait_for(2));
+
+  const async_nats::testing::Server restarted(async_nats::testing::ServerOptions().port(port));
+  GTEST_ASSERT_TRUE(wait_for(3));
+
+  const std::lock_guard<std::mutex> lock(sequence->mutex);
+  const std::vector<AsyncNatsConnectionEventKind> expected {
+      AsyncNats_Event_Connected, AsyncNats_Event_Disconnected, AsyncNats_Event_Connected};
+  GTEST_ASSERT_EQ(sequence->kinds, expected);
+}
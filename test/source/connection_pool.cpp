@@ -0,0 +1,121 @@
+#include <cstddef>
+#include <future>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+namespace
+{
+/// returns the number of pool connections that have sent at least one message
+std::size_t active_connections(const async_nats::ConnectionPool& pool)
+{
+  std::size_t active = 0;
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    if (pool.connection(i).statistics().out_messages != 0) {
+      ++active;
+    }
+  }
+  return active;
+}
+
+}  // namespace
+
+/// Check that messages to one subject are sent by one connection of the pool while different
+/// subjects are spread across the connections
+TEST_F(NatsFixture, ConnectionPoolSubjectHash)
+{
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+  auto pool = async_nats::connect_pool(rt,
+                                       options,
+                                       3,
+                                       async_nats::ShardingPolicy::subject_hash,
+                                       boost::asio::use_future)
+                  .get();
+  GTEST_ASSERT_EQ(pool.size(), 3);
+
+  const std::string prefix(static_cast<std::string_view>(c.new_mailbox()));
+  auto sub = c.subcribe((prefix + ".*").c_str(), boost::asio::use_future).get();
+
+  // take subjects until they are sharded to at least two connections
+  std::vector<std::string> subjects;
+  std::set<std::size_t> shards;
+  while (subjects.size() < 4 || shards.size() < 2) {
+    subjects.push_back(prefix + "." + std::to_string(subjects.size()));
+    shards.insert(pool.select(subjects.back()));
+    GTEST_ASSERT_EQ(pool.select(subjects.back()), pool.select(subjects.back()));
+  }
+
+  // publishes are not awaited one by one so they are in flight at the same time
+  constexpr int count = 64;
+  std::vector<std::string> payloads;
+  payloads.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    payloads.push_back(std::to_string(i));
+  }
+  std::vector<std::future<void>> published;
+  for (const auto& data : payloads) {
+    for (const auto& subject : subjects) {
+      published.push_back(pool.publish(
+          subject, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future));
+    }
+  }
+  for (auto& f : published) {
+    f.get();
+  }
+
+  // concurrent publishes may be reordered, so only the number of messages is checked
+  std::vector<int> received(subjects.size(), 0);
+  for (std::size_t i = 0; i < count * subjects.size(); ++i) {
+    auto msg = sub.receive(boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(msg, true);
+    const auto index = std::stoul(std::string(msg.topic().substr(prefix.size() + 1)));
+    GTEST_ASSERT_LT(index, subjects.size());
+    ++received[index];
+  }
+  for (const auto n : received) {
+    GTEST_ASSERT_EQ(n, count);
+  }
+
+  GTEST_ASSERT_EQ(active_connections(pool), shards.size());
+}
+
+/// Check that round-robin pool spreads subscriptions and publishes across all connections
+TEST_F(NatsFixture, ConnectionPoolRoundRobin)
+{
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+  auto pool = async_nats::connect_pool(rt,
+                                       options,
+                                       2,
+                                       async_nats::ShardingPolicy::round_robin,
+                                       boost::asio::use_future)
+                  .get();
+
+  auto m = c.new_mailbox();
+  auto sub1 = pool.subcribe(m, boost::asio::use_future).get();
+  auto sub2 = pool.subcribe(m, boost::asio::use_future).get();
+
+  std::string data = "test";
+  std::vector<std::future<void>> published;
+  for (int i = 0; i < 2; ++i) {
+    published.push_back(pool.publish(
+        m, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future));
+  }
+  for (auto& f : published) {
+    f.get();
+  }
+
+  for (auto* sub : {&sub1, &sub2}) {
+    for (int i = 0; i < 2; ++i) {
+      auto msg = sub->receive(boost::asio::use_future).get();
+      GTEST_ASSERT_EQ(msg, true);
+      GTEST_ASSERT_EQ(msg.data(), data);
+    }
+  }
+  GTEST_ASSERT_EQ(active_connections(pool), 2);
+}
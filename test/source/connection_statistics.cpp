@@ -0,0 +1,30 @@
+#include <string>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that traffic counters grow with published and received messages
+TEST_F(NatsFixture, ConnectionStatistics)
+{
+  const auto before = c.statistics();
+  GTEST_ASSERT_EQ(before.connects, 1);
+  GTEST_ASSERT_EQ(before.reconnects(), 0);
+
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  std::string data = "test";
+  c.publish(m, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+
+  const auto after = c.statistics();
+  GTEST_ASSERT_GT(after.out_messages, before.out_messages);
+  GTEST_ASSERT_GE(after.out_bytes, before.out_bytes + data.size());
+  GTEST_ASSERT_GT(after.in_messages, before.in_messages);
+  GTEST_ASSERT_GE(after.in_bytes, before.in_bytes + data.size());
+  GTEST_ASSERT_EQ(after.pending_messages, 0);
+  GTEST_ASSERT_EQ(after.pending_bytes, 0);
+}
@@ -0,0 +1,52 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <async_nats/async_nats.hpp>
+
+/// Check that a synthetic message exposes everything it was created with
+TEST(FfiCalls, MakeMessage)
+{
+  const std::string data = "test";
+  auto msg = async_nats::make_message(
+      "test.subject", data, "test.reply", {{"Key", "value1"}, {"Key", "value2"}, {"Other", "x"}});
+  GTEST_ASSERT_EQ(msg, true);
+  GTEST_ASSERT_EQ(msg.topic(), "test.subject");
+  GTEST_ASSERT_EQ(msg.data(), data);
+  GTEST_ASSERT_EQ(msg.reply_to(), "test.reply");
+
+  auto headers = msg.headers();
+  GTEST_ASSERT_EQ(headers, true);
+  auto values = headers.get_header("Key");
+  GTEST_ASSERT_EQ(values.has_value(), true);
+  GTEST_ASSERT_EQ(values->size(), 2);
+  GTEST_ASSERT_EQ(values->at(0), "value1");
+  GTEST_ASSERT_EQ(values->at(1), "value2");
+
+  const auto plain = async_nats::make_message("test.subject", data);
+  GTEST_ASSERT_EQ(plain.reply_to(), std::nullopt);
+  GTEST_ASSERT_EQ(plain.headers(), false);
+}
+
+#if defined(ASYNC_NATS_FFI_ACCOUNTING)
+/// Check that every accessor of the message is counted as one call
+TEST(FfiCalls, Counter)
+{
+  const auto msg = async_nats::make_message("test.subject", "test");
+
+  async_nats::FfiCallCounter counter;
+  GTEST_ASSERT_EQ(counter.calls(), 0);
+  static_cast<void>(msg.topic());
+  static_cast<void>(msg.data());
+  GTEST_ASSERT_EQ(counter.calls(), 2);
+
+  // copy and destruction of the message are calls too
+  {
+    const auto copy = msg;
+  }
+  GTEST_ASSERT_EQ(counter.calls(), 4);
+
+  counter.reset();
+  GTEST_ASSERT_EQ(counter.calls(), 0);
+}
+#endif
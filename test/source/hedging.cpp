@@ -0,0 +1,108 @@
+#include <chrono>
+#include <future>
+#include <stdexcept>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that a duplicate is sent to a slow responder and its reply wins
+TEST_F(NatsFixture, HedgedRequest)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  std::string request = "test";
+  auto req = c.request(m,
+                       boost::asio::const_buffer(request.data(), request.size()),
+                       async_nats::HedgePolicy::after(default_sleep),
+                       boost::asio::use_future);
+
+  // ignore the first request and reply only to the duplicate
+  auto first = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(first, true);
+  auto second = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(second, true);
+  GTEST_ASSERT_EQ(second.data(), request);
+  GTEST_ASSERT_NE(first.reply_to(), second.reply_to());
+
+  std::string reply = "test reply";
+  c.publish(second.reply_to().value(),
+            boost::asio::const_buffer(reply.data(), reply.size()),
+            boost::asio::use_future)
+      .get();
+
+  auto response = req.get();
+  GTEST_ASSERT_EQ(response, true);
+  GTEST_ASSERT_EQ(response.data(), reply);
+
+  auto stats = c.request_statistics();
+  GTEST_ASSERT_EQ(stats.requests, 1);
+  GTEST_ASSERT_EQ(stats.hedged, 1);
+  GTEST_ASSERT_EQ(stats.hedge_wins, 1);
+}
+
+/// Check that fast replies do not trigger hedging
+TEST_F(NatsFixture, HedgedRequestFastReply)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  std::string request = "test";
+  auto req = c.request(m,
+                       std::move(async_nats::RequestBuilder()
+                                     .data(boost::asio::const_buffer(request.data(), request.size()))
+                                     .hedge(async_nats::HedgePolicy::after(test_timeout))),
+                       boost::asio::use_future);
+
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+  c.publish(msg.reply_to().value(), boost::asio::const_buffer(), boost::asio::use_future).get();
+
+  auto response = req.get();
+  GTEST_ASSERT_EQ(response, true);
+
+  auto stats = c.request_statistics();
+  GTEST_ASSERT_EQ(stats.requests, 1);
+  GTEST_ASSERT_EQ(stats.hedged, 0);
+  GTEST_ASSERT_EQ(stats.hedge_rate(), 0.0);
+}
+
+/// Check that the 0th percentile is a percentile policy and not a fixed delay
+TEST_F(NatsFixture, HedgedRequestZeroPercentile)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  // collect enough latency samples for the percentile to be used instead of the fallback
+  for (int i = 0; i < 64; ++i) {
+    auto req = c.request(m, boost::asio::const_buffer(), boost::asio::use_future);
+    auto msg = sub.receive(boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(msg, true);
+    c.publish(msg.reply_to().value(), boost::asio::const_buffer(), boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(req.get(), true);
+  }
+
+  auto req = c.request(m,
+                       boost::asio::const_buffer(),
+                       async_nats::HedgePolicy::percentile(0.0, test_timeout),
+                       boost::asio::use_future);
+  auto first = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(first, true);
+  auto second = sub.receive(boost::asio::use_future);
+  GTEST_ASSERT_EQ(second.wait_for(test_timeout / 2), std::future_status::ready);
+  c.publish(second.get().reply_to().value(), boost::asio::const_buffer(), boost::asio::use_future)
+      .get();
+  GTEST_ASSERT_EQ(req.get(), true);
+  GTEST_ASSERT_EQ(c.request_statistics().hedged, 1);
+}
+
+/// Check that a percentile outside of [0.0; 1.0] is rejected
+TEST(HedgePolicy, PercentileRange)
+{
+  using async_nats::HedgePolicy;
+  EXPECT_NO_THROW(HedgePolicy::percentile(0.0, std::chrono::seconds(1)));
+  EXPECT_NO_THROW(HedgePolicy::percentile(1.0, std::chrono::seconds(1)));
+  EXPECT_THROW(HedgePolicy::percentile(-0.1, std::chrono::seconds(1)), std::out_of_range);
+  EXPECT_THROW(HedgePolicy::percentile(1.5, std::chrono::seconds(1)), std::out_of_range);
+}
@@ -0,0 +1,44 @@
+#include <string>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that built-in histograms record publishes, deliveries and requests by subject prefix
+TEST_F(NatsFixture, LatencyHistograms)
+{
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url()).latency_histogram_prefix("latency.");
+  auto conn = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  const std::string subject = "latency." + std::string(c.new_mailbox());
+  auto sub = conn.subcribe(subject.c_str(), boost::asio::use_future).get();
+
+  std::string data = "test";
+  conn.publish(
+          subject, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+
+  auto req = conn.request(subject.c_str(),
+                          boost::asio::const_buffer(data.data(), data.size()),
+                          boost::asio::use_future);
+  auto request = sub.receive(boost::asio::use_future).get();
+  c.publish(request.reply_to().value(),
+            boost::asio::const_buffer(data.data(), data.size()),
+            boost::asio::use_future)
+      .get();
+  GTEST_ASSERT_EQ(req.get().data(), data);
+
+  const auto publish = conn.publish_latency();
+  GTEST_ASSERT_EQ(publish.count, 1);
+  GTEST_ASSERT_GE(publish.percentile(1.0), publish.mean());
+
+  GTEST_ASSERT_EQ(conn.delivery_latency().count, 2);
+  GTEST_ASSERT_EQ(conn.request_latency("latency.").count, 1);
+  GTEST_ASSERT_EQ(conn.request_latency().count, 0);
+
+  // histograms are disabled by default
+  GTEST_ASSERT_EQ(c.publish_latency().count, 0);
+}
@@ -1,3 +1,11 @@
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/use_future.hpp>
+
 #include "nats_fixture.hpp"
 
 /// Test if two mailboxes are different
@@ -8,3 +16,56 @@ TEST_F(NatsFixture, Mailbox)
   GTEST_ASSERT_EQ(static_cast<std::string_view>(box1) == static_cast<std::string_view>(box2),
                   false);
 }
+
+/// Check that inboxes generated in C++ have the same prefix as the mailboxes of the connection
+TEST_F(NatsFixture, InboxPrefix)
+{
+  const std::string_view mailbox = c.new_mailbox();
+  const auto inbox = c.new_inbox();
+  const std::string_view view = inbox;
+
+  GTEST_ASSERT_EQ(c.inbox_prefix(), mailbox.substr(0, mailbox.rfind('.')));
+  GTEST_ASSERT_EQ(view.size(), mailbox.size());
+  GTEST_ASSERT_EQ(view.substr(0, view.rfind('.')), c.inbox_prefix());
+  GTEST_ASSERT_EQ(std::string_view(inbox.c_str()), view);
+}
+
+/// Check that inboxes are unique across threads
+TEST_F(NatsFixture, InboxUnique)
+{
+  constexpr std::size_t threads = 4;
+  constexpr std::size_t count = 10000;
+  std::vector<std::vector<std::string>> generated(threads);
+  std::vector<std::thread> workers;
+  for (auto& inboxes : generated) {
+    workers.emplace_back(
+        [this, &inboxes]
+        {
+          for (std::size_t i = 0; i < count; ++i) {
+            inboxes.emplace_back(std::string_view(c.new_inbox()));
+          }
+        });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  std::set<std::string> unique;
+  for (const auto& inboxes : generated) {
+    unique.insert(inboxes.begin(), inboxes.end());
+  }
+  GTEST_ASSERT_EQ(unique.size(), threads * count);
+}
+
+/// Check that an inbox can be used as a reply subject
+TEST_F(NatsFixture, InboxReply)
+{
+  const auto inbox = c.new_inbox();
+  auto sub = c.subcribe(inbox, boost::asio::use_future).get();
+
+  const std::string data = "test";
+  c.publish(inbox, boost::asio::buffer(data), boost::asio::use_future).get();
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg.data(), data);
+  GTEST_ASSERT_EQ(msg.topic(), std::string_view(inbox));
+}
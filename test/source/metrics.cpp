@@ -0,0 +1,96 @@
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that every source is rendered with its label and the exposition is terminated
+TEST_F(NatsFixture, RenderOpenMetrics)
+{
+  async_nats::ConnectionOptions options;
+  options.address(server_url()).latency_histograms();
+  c = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+  auto m2 = c.new_mailbox();
+  const async_nats::nonblocking::Receiver receiver(c.subcribe(m2, boost::asio::use_future).get());
+  const async_nats::nonblocking::Sender sender(m2, c);
+
+  std::string data = "test";
+  c.publish(m, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+  sender.send(boost::asio::const_buffer(data.data(), data.size()));
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+  msg = receiver.receive();
+  GTEST_ASSERT_EQ(msg, true);
+
+  // the sender counts a message after the connection accepted it, which may happen after the
+  // receiver already got it
+  const auto deadline = std::chrono::steady_clock::now() + test_timeout;
+  while (sender.statistics().sent != 1 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  GTEST_ASSERT_EQ(sender.statistics().sent, 1);
+
+  std::string buffer;
+  const auto text = async_nats::metrics::render_openmetrics(
+      buffer, rt, async_nats::metrics::labeled("main", c), sub, sender, receiver);
+  GTEST_ASSERT_EQ(text.data(), buffer.data());
+
+  const auto contains = [&](std::string_view s) { return text.find(s) != std::string_view::npos; };
+  GTEST_ASSERT_TRUE(contains("# TYPE async_nats_connection_out_messages counter\n"));
+  GTEST_ASSERT_TRUE(contains("async_nats_connection_out_messages_total{name=\"main\"} "));
+  GTEST_ASSERT_TRUE(contains("async_nats_subscribtion_messages_total{name=\"1\"} 1\n"));
+  GTEST_ASSERT_TRUE(contains("async_nats_sender_sent_total{name=\"2\"} 1\n"));
+  GTEST_ASSERT_TRUE(contains("async_nats_receiver_received_total{name=\"3\"} 1\n"));
+  GTEST_ASSERT_TRUE(
+      contains("async_nats_connection_publish_latency_seconds_bucket{name=\"main\",le=\"+Inf\"}"));
+  GTEST_ASSERT_TRUE(text.size() >= 6 && text.substr(text.size() - 6) == "# EOF\n");
+
+  // rendering again reuses the buffer
+  const auto capacity = buffer.capacity();
+  async_nats::metrics::render_openmetrics(buffer, rt, c);
+  GTEST_ASSERT_EQ(buffer.capacity(), capacity);
+}
+
+/// Check that request latency is rendered for every configured prefix and for other requests
+TEST_F(NatsFixture, RenderRequestLatencyPrefixes)
+{
+  async_nats::ConnectionOptions options;
+  options.address(server_url())
+      .latency_histogram_prefix("metrics.a.")
+      .latency_histogram_prefix("metrics.b.");
+  c = async_nats::connect(rt, options, boost::asio::use_future).get();
+  const std::vector<std::string_view> prefixes {"metrics.a.", "metrics.b."};
+  GTEST_ASSERT_EQ(c.request_latency_prefixes(), prefixes);
+
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  auto sub = c.subcribe("metrics.a.*", boost::asio::use_future).get();
+  auto other = c.subcribe(subject.c_str(), boost::asio::use_future).get();
+  for (auto* s : {&sub, &other}) {
+    auto req = c.request(s == &sub ? "metrics.a.x" : subject.c_str(),
+                         boost::asio::const_buffer(),
+                         boost::asio::use_future);
+    auto msg = s->receive(boost::asio::use_future).get();
+    c.publish(msg.reply_to().value(), boost::asio::const_buffer(), boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(req.get(), true);
+  }
+
+  std::string buffer;
+  const auto text = async_nats::metrics::render_openmetrics(buffer, rt, c);
+  const auto contains = [&](std::string_view s) { return text.find(s) != std::string_view::npos; };
+  GTEST_ASSERT_TRUE(contains("async_nats_connection_request_latency_seconds_count{name=\"0\","
+                             "prefix=\"metrics.a.\"} 1\n"));
+  GTEST_ASSERT_TRUE(contains("async_nats_connection_request_latency_seconds_count{name=\"0\","
+                             "prefix=\"metrics.b.\"} 0\n"));
+  GTEST_ASSERT_TRUE(contains(
+      "async_nats_connection_request_latency_seconds_count{name=\"0\",prefix=\"\"} 1\n"));
+  GTEST_ASSERT_TRUE(contains("async_nats_connection_request_latency_seconds_bucket{name=\"0\","
+                             "prefix=\"metrics.a.\",le=\"+Inf\"} 1\n"));
+}
@@ -1,15 +1,27 @@
 #include "nats_fixture.hpp"
 
+#include <cstdlib>
+
+#include <async_nats/testing/server.hpp>
 #include <boost/asio/use_future.hpp>
 
 NatsFixture::NatsFixture() = default;
 
 NatsFixture::~NatsFixture() = default;
 
+std::string NatsFixture::server_url()
+{
+  if (const char* url = std::getenv("NATS_URL")) {
+    return url;
+  }
+  static const async_nats::testing::Server server;
+  return server.url();
+}
+
 void NatsFixture::SetUp()
 {
   async_nats::ConnectionOptions options;
-  options.address("nats://localhost:4222");
+  options.address(server_url());
   c = async_nats::connect(rt, options, boost::asio::use_future).get();
   GTEST_ASSERT_NE(c.get_raw(), nullptr);
 }
@@ -1,3 +1,5 @@
+#include <string>
+
 #include <gtest/gtest.h>
 
 #include <async_nats/async_nats.hpp>
@@ -16,6 +18,12 @@ public:
   NatsFixture& operator=(const NatsFixture&) = delete;
   NatsFixture& operator=(NatsFixture&&) = delete;
 
+  /**
+   * @brief server_url returns $NATS_URL or the address of the in-process test server that is
+   * started on the first call
+   */
+  static std::string server_url();
+
   void SetUp() override;
   void TearDown() override;
 
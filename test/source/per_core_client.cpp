@@ -0,0 +1,126 @@
+#include <cstddef>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+namespace
+{
+/// returns the CPUs the process may run on, or {0, 1} if the platform can not report them
+std::vector<std::size_t> allowed_cpus()
+{
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    std::vector<std::size_t> cpus;
+    for (std::size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+    return cpus;
+  }
+#endif
+  return {0, 1};
+}
+
+void pin_current_thread([[maybe_unused]] std::size_t cpu)
+{
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+}  // namespace
+
+/// Check that per-core client routes operations of the calling thread to an instance
+TEST_F(NatsFixture, PerCoreClient)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.thread_name("per_core");
+  async_nats::PerCoreClient client(config, {0});
+  GTEST_ASSERT_EQ(client.size(), 1);
+  GTEST_ASSERT_EQ(client.cpu(0), 0);
+
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+  client.connect(options, boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(client.shard_index(), 0);
+  GTEST_ASSERT_NE(client.local().get_raw(), nullptr);
+
+  auto m = c.new_mailbox();
+  auto sub = client.subcribe(m, boost::asio::use_future).get();
+
+  std::string data = "test";
+  client.publish(m, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+  GTEST_ASSERT_EQ(msg.data(), data);
+}
+
+/// Check that threads on different CPUs are served by different instances
+TEST_F(NatsFixture, PerCoreClientShards)
+{
+  const auto cpus = allowed_cpus();
+  if (cpus.size() < 2) {
+    GTEST_SKIP() << "at least two CPUs are required";
+  }
+
+  async_nats::TokioRuntimeConfig config;
+  config.thread_name("per_core");
+  async_nats::PerCoreClient client(config, {cpus[0], cpus[1]});
+  GTEST_ASSERT_EQ(client.size(), 2);
+
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+  client.connect(options, boost::asio::use_future).get();
+
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  // threads pinned to the CPUs of the instances; elsewhere threads are mapped by their id
+  std::set<std::size_t> shards;
+  for (std::size_t i = 0; i < 16 && shards.size() < 2; ++i) {
+    std::size_t shard = 0;
+    std::thread(
+        [&]
+        {
+          pin_current_thread(cpus[i % 2]);
+          shard = client.shard_index();
+          const std::string data = std::to_string(shard);
+          client
+              .publish(m,
+                       boost::asio::const_buffer(data.data(), data.size()),
+                       boost::asio::use_future)
+              .get();
+        })
+        .join();
+#if defined(__linux__)
+    GTEST_ASSERT_EQ(shard, i % 2);
+#endif
+    shards.insert(shard);
+
+    auto msg = sub.receive(boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(msg.data(), std::to_string(shard));
+  }
+  GTEST_ASSERT_EQ(shards.size(), 2);
+
+  for (std::size_t i = 0; i < client.size(); ++i) {
+    GTEST_ASSERT_GT(client.connection(i).statistics().out_messages, 0);
+  }
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <async_nats/testing/server.hpp>
+#include <boost/asio/system_executor.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+namespace
+{
+/// the client backs off between reconnect attempts
+constexpr auto reconnect_timeout = std::chrono::seconds(10);
+
+/// Events counts connection events of every kind
+class Events
+{
+public:
+  void push(AsyncNatsConnectionEventKind kind)
+  {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      ++counts_[kind];
+    }
+    cv_.notify_all();
+  }
+
+  bool wait(AsyncNatsConnectionEventKind kind, std::size_t count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(
+        lock, reconnect_timeout, [this, kind, count] { return counts_[kind] >= count; });
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::size_t counts_[AsyncNats_Event_ClientError + 1] {};
+};
+
+async_nats::Connection connect(const async_nats::TokioRuntime& rt,
+                               const async_nats::testing::Server& server,
+                               const async_nats::ReconnectBufferOptions& buffer,
+                               const std::shared_ptr<Events>& events)
+{
+  async_nats::ConnectionOptions options;
+  options.address(server.url())
+      .reconnect_buffer(buffer)
+      .on_event(boost::asio::system_executor(),
+                [events](const async_nats::ConnectionEvent& event) { events->push(event.kind); });
+  return async_nats::connect(rt, options, boost::asio::use_future).get();
+}
+
+}  // namespace
+
+/// Check that publishes made during an outage are replayed in order after the reconnect and the
+/// oldest are dropped when the buffer is full
+TEST(ReconnectBuffer, ReplayInOrder)
+{
+  const async_nats::TokioRuntime rt;
+  auto server = std::make_unique<async_nats::testing::Server>();
+  const auto port = server->port();
+  auto events = std::make_shared<Events>();
+  auto c = connect(rt,
+                   *server,
+                   async_nats::ReconnectBufferOptions().max_messages(3).overflow(
+                       AsyncNats_Overflow_DropOldest),
+                   events);
+  auto sub = c.subcribe("reconnect.buffer", boost::asio::use_future).get();
+
+  server.reset();
+  GTEST_ASSERT_TRUE(events->wait(AsyncNats_Event_Disconnected, 1));
+  for (int i = 0; i < 5; ++i) {
+    const auto data = std::to_string(i);
+    c.publish("reconnect.buffer", boost::asio::buffer(data), boost::asio::use_future).get();
+  }
+  auto stats = c.reconnect_buffer_statistics();
+  GTEST_ASSERT_EQ(stats.buffered_messages, 3);
+  GTEST_ASSERT_EQ(stats.buffered_bytes, 3 * (std::string("reconnect.buffer").size() + 1));
+  GTEST_ASSERT_EQ(stats.dropped, 2);
+
+  server = std::make_unique<async_nats::testing::Server>(
+      async_nats::testing::ServerOptions().port(port));
+  for (int i = 2; i < 5; ++i) {
+    auto msg = sub.receive(boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(msg.data(), std::to_string(i));
+  }
+
+  stats = c.reconnect_buffer_statistics();
+  GTEST_ASSERT_EQ(stats.buffered_messages, 0);
+  GTEST_ASSERT_EQ(stats.buffered, 5);
+  GTEST_ASSERT_EQ(stats.replayed, 3);
+
+  // the buffer is bypassed once it is replayed
+  const std::string data = "direct";
+  c.publish("reconnect.buffer", boost::asio::buffer(data), boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(sub.receive(boost::asio::use_future).get().data(), data);
+  GTEST_ASSERT_EQ(c.reconnect_buffer_statistics().buffered, 5);
+}
+
+/// Check that new messages are dropped when the buffer is full
+TEST(ReconnectBuffer, DropNewest)
+{
+  const async_nats::TokioRuntime rt;
+  auto server = std::make_unique<async_nats::testing::Server>();
+  auto events = std::make_shared<Events>();
+  auto c = connect(rt, *server, async_nats::ReconnectBufferOptions().max_bytes(16), events);
+
+  server.reset();
+  GTEST_ASSERT_TRUE(events->wait(AsyncNats_Event_Disconnected, 1));
+  const std::string data(4, 'x');
+  for (int i = 0; i < 3; ++i) {
+    c.publish("drop", boost::asio::buffer(data), boost::asio::use_future).get();
+  }
+
+  const auto stats = c.reconnect_buffer_statistics();
+  GTEST_ASSERT_EQ(stats.buffered_messages, 2);
+  GTEST_ASSERT_EQ(stats.buffered_bytes, 16);
+  GTEST_ASSERT_EQ(stats.dropped, 1);
+}
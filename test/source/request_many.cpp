@@ -0,0 +1,101 @@
+#include <string>
+#include <vector>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that the stream of replies is finished by the sentinel
+TEST_F(NatsFixture, RequestManySentinel)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  auto stream = c.request_many(m,
+                               boost::asio::const_buffer(),
+                               async_nats::RequestManyOptions().sentinel(),
+                               boost::asio::use_future)
+                    .get();
+  auto req = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(req, true);
+
+  const std::vector<std::string> chunks = {"first", "second", "third"};
+  for (const auto& chunk : chunks) {
+    c.publish(req.reply_to().value(),
+              boost::asio::const_buffer(chunk.data(), chunk.size()),
+              boost::asio::use_future)
+        .get();
+  }
+  c.publish(req.reply_to().value(), boost::asio::const_buffer(), boost::asio::use_future).get();
+
+  std::vector<std::string> received;
+  while (true) {
+    auto batch = stream.receive_batch(16, boost::asio::use_future).get();
+    if (batch.empty()) {
+      break;
+    }
+    for (const auto& msg : batch) {
+      received.emplace_back(msg.data());
+    }
+  }
+  GTEST_ASSERT_EQ(received, chunks);
+}
+
+/// Check that the stream of replies is finished after max messages and on idle timeout
+TEST_F(NatsFixture, RequestManyLimits)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  auto stream =
+      c.request_many(m,
+                     boost::asio::const_buffer(),
+                     async_nats::RequestManyOptions().max_messages(2).idle_timeout(default_sleep),
+                     boost::asio::use_future)
+          .get();
+  auto req = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(req, true);
+
+  std::string data = "test";
+  for (int i = 0; i < 3; ++i) {
+    c.publish(req.reply_to().value(),
+              boost::asio::const_buffer(data.data(), data.size()),
+              boost::asio::use_future)
+        .get();
+  }
+
+  GTEST_ASSERT_EQ(stream.receive(boost::asio::use_future).get(), true);
+  GTEST_ASSERT_EQ(stream.receive(boost::asio::use_future).get(), true);
+  GTEST_ASSERT_EQ(stream.receive(boost::asio::use_future).get(), false);
+
+  // nobody replies to the second stream so it is finished by the idle timeout
+  async_nats::RequestManyOptions idle_options;
+  idle_options.idle_timeout(default_sleep);
+  auto idle =
+      c.request_many(m, boost::asio::const_buffer(), idle_options, boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(idle.receive(boost::asio::use_future).get(), false);
+}
+
+/// Check that the stream of zero messages is finished right away
+TEST_F(NatsFixture, RequestManyZeroMessages)
+{
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  auto stream = c.request_many(m,
+                               boost::asio::const_buffer(),
+                               async_nats::RequestManyOptions().max_messages(0),
+                               boost::asio::use_future)
+                    .get();
+  auto req = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(req, true);
+
+  std::string data = "test";
+  c.publish(req.reply_to().value(),
+            boost::asio::const_buffer(data.data(), data.size()),
+            boost::asio::use_future)
+      .get();
+  auto msg = stream.receive(boost::asio::use_future);
+  GTEST_ASSERT_EQ(msg.wait_for(test_timeout), std::future_status::ready);
+  GTEST_ASSERT_EQ(msg.get(), false);
+}
@@ -0,0 +1,182 @@
+#include <future>
+#include <string>
+#include <thread>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+namespace
+{
+/// sends a cacheable request with the payload
+std::future<async_nats::Message> cached_request(async_nats::Connection& conn,
+                                                const std::string& subject,
+                                                const std::string& payload)
+{
+  const auto data = boost::asio::const_buffer(payload.data(), payload.size());
+  return conn.request(subject.c_str(),
+                      std::move(async_nats::RequestBuilder().data(data).cache()),
+                      boost::asio::use_future);
+}
+
+/// answers the next request that reaches the subscribtion with its own payload
+void echo(async_nats::Connection& conn, async_nats::Subscribtion& sub)
+{
+  auto received = sub.receive(boost::asio::use_future);
+  ASSERT_EQ(received.wait_for(NatsFixture::test_timeout), std::future_status::ready);
+  const auto msg = received.get();
+  const auto data = msg.data();
+  conn.publish(msg.reply_to().value(),
+               boost::asio::const_buffer(data.data(), data.size()),
+               boost::asio::use_future)
+      .get();
+}
+
+}  // namespace
+
+/// Check that cached replies are served without a round trip until invalidated
+TEST_F(NatsFixture, ResponseCache)
+{
+  const std::string invalidation(static_cast<std::string_view>(c.new_mailbox()));
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url())
+      .response_cache(std::move(async_nats::ResponseCacheOptions()
+                                    .default_ttl(test_timeout * 10)
+                                    .invalidation_subject(invalidation)));
+  auto cached = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  auto sub = c.subcribe(subject.c_str(), boost::asio::use_future).get();
+  // wait for the cache to subscribe to the invalidation subject
+  std::this_thread::sleep_for(default_sleep);
+
+  std::string reply = "test reply";
+  auto request = [&]()
+  {
+    return cached.request(subject.c_str(),
+                          std::move(async_nats::RequestBuilder().cache()),
+                          boost::asio::use_future);
+  };
+  auto respond = [&]()
+  {
+    auto msg = sub.receive(boost::asio::use_future).get();
+    GTEST_ASSERT_EQ(msg, true);
+    c.publish(msg.reply_to().value(),
+              boost::asio::const_buffer(reply.data(), reply.size()),
+              boost::asio::use_future)
+        .get();
+  };
+
+  auto first = request();
+  respond();
+  GTEST_ASSERT_EQ(first.get().data(), reply);
+
+  // served from the cache, nobody responds
+  GTEST_ASSERT_EQ(request().get().data(), reply);
+
+  c.publish(invalidation.c_str(),
+            boost::asio::const_buffer(subject.data(), subject.size()),
+            boost::asio::use_future)
+      .get();
+  std::this_thread::sleep_for(default_sleep);
+
+  auto third = request();
+  respond();
+  GTEST_ASSERT_EQ(third.get().data(), reply);
+
+  auto stats = cached.request_statistics();
+  GTEST_ASSERT_EQ(stats.requests, 3);
+  GTEST_ASSERT_EQ(stats.cache_hits, 1);
+  GTEST_ASSERT_EQ(stats.cache_misses, 2);
+}
+
+/// Check that expired replies are requested again
+TEST_F(NatsFixture, ResponseCacheTtl)
+{
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url())
+      .response_cache(std::move(async_nats::ResponseCacheOptions().default_ttl(default_sleep)));
+  auto cached = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  auto sub = c.subcribe(subject.c_str(), boost::asio::use_future).get();
+
+  auto first = cached_request(cached, subject, "test");
+  echo(c, sub);
+  GTEST_ASSERT_EQ(first.get().data(), "test");
+  GTEST_ASSERT_EQ(cached_request(cached, subject, "test").get().data(), "test");
+
+  std::this_thread::sleep_for(default_sleep * 2);
+  auto expired = cached_request(cached, subject, "test");
+  echo(c, sub);
+  GTEST_ASSERT_EQ(expired.get().data(), "test");
+
+  auto stats = cached.request_statistics();
+  GTEST_ASSERT_EQ(stats.cache_hits, 1);
+  GTEST_ASSERT_EQ(stats.cache_misses, 2);
+}
+
+/// Check that the least recently used reply is evicted when the cache is full
+TEST_F(NatsFixture, ResponseCacheEviction)
+{
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url())
+      .response_cache(std::move(
+          async_nats::ResponseCacheOptions().capacity(2).default_ttl(test_timeout * 10)));
+  auto cached = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  auto sub = c.subcribe(subject.c_str(), boost::asio::use_future).get();
+
+  for (const std::string payload : {"a", "b"}) {
+    auto req = cached_request(cached, subject, payload);
+    echo(c, sub);
+    GTEST_ASSERT_EQ(req.get().data(), payload);
+  }
+  // "a" becomes the most recently used one, so "c" evicts "b"
+  GTEST_ASSERT_EQ(cached_request(cached, subject, "a").get().data(), "a");
+  auto third = cached_request(cached, subject, "c");
+  echo(c, sub);
+  GTEST_ASSERT_EQ(third.get().data(), "c");
+
+  GTEST_ASSERT_EQ(cached_request(cached, subject, "a").get().data(), "a");
+  auto evicted = cached_request(cached, subject, "b");
+  echo(c, sub);
+  GTEST_ASSERT_EQ(evicted.get().data(), "b");
+
+  auto stats = cached.request_statistics();
+  GTEST_ASSERT_EQ(stats.cache_hits, 2);
+  GTEST_ASSERT_EQ(stats.cache_misses, 4);
+}
+
+/// Check that the TTL of a subject overrides the default one
+TEST_F(NatsFixture, ResponseCacheSubjectTtl)
+{
+  const std::string uncached(static_cast<std::string_view>(c.new_mailbox()));
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url())
+      .response_cache(std::move(async_nats::ResponseCacheOptions()
+                                    .default_ttl(test_timeout * 10)
+                                    .ttl(uncached, std::chrono::seconds(0))));
+  auto cached = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  auto uncached_sub = c.subcribe(uncached.c_str(), boost::asio::use_future).get();
+  auto sub = c.subcribe(subject.c_str(), boost::asio::use_future).get();
+
+  // replies to the subject with zero TTL are never cached
+  for (int i = 0; i < 2; ++i) {
+    auto req = cached_request(cached, uncached, "test");
+    echo(c, uncached_sub);
+    GTEST_ASSERT_EQ(req.get().data(), "test");
+  }
+
+  auto req = cached_request(cached, subject, "test");
+  echo(c, sub);
+  GTEST_ASSERT_EQ(req.get().data(), "test");
+  GTEST_ASSERT_EQ(cached_request(cached, subject, "test").get().data(), "test");
+
+  auto stats = cached.request_statistics();
+  GTEST_ASSERT_EQ(stats.cache_hits, 1);
+  GTEST_ASSERT_EQ(stats.cache_misses, 3);
+}
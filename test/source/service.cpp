@@ -0,0 +1,252 @@
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+TEST_F(NatsFixture, ServiceReply)
+{
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  auto svc = async_nats::start_service(
+                 c,
+                 async_nats::ServiceOptions("test_service", subject).queue_group("test"),
+                 [](const async_nats::Message& msg)
+                 { return std::string("Hello, ").append(msg.data()); },
+                 boost::asio::use_future)
+                 .get();
+  GTEST_ASSERT_EQ(svc, true);
+
+  std::string request = "world";
+  auto response = c.request(subject.c_str(),
+                            boost::asio::const_buffer(request.data(), request.size()),
+                            boost::asio::use_future)
+                      .get();
+  GTEST_ASSERT_EQ(response.data(), "Hello, world");
+
+  auto stats = svc.statistics();
+  GTEST_ASSERT_EQ(stats.requests, 1);
+  GTEST_ASSERT_EQ(stats.completed, 1);
+  GTEST_ASSERT_EQ(stats.errors, 0);
+  GTEST_ASSERT_EQ(stats.in_flight, 0);
+
+  uint64_t histogram_total = 0;
+  for (auto count : stats.processing_time) {
+    histogram_total += count;
+  }
+  GTEST_ASSERT_EQ(histogram_total, 1);
+
+  auto stats_reply =
+      c.request("$SRV.STATS.test_service", boost::asio::const_buffer(), boost::asio::use_future)
+          .get();
+  GTEST_ASSERT_NE(stats_reply.data().find("\"completed\":1"), std::string_view::npos);
+}
+
+/// Check that requests are responded asynchronously and dropped requests are counted
+TEST_F(NatsFixture, ServiceAsyncReply)
+{
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  std::array<std::promise<async_nats::ServiceRequest>, 2> received;
+  std::atomic<std::size_t> calls {0};
+  auto svc = async_nats::start_service(
+                 c,
+                 async_nats::ServiceOptions("test_async_service", subject).max_in_flight(1),
+                 [&](async_nats::ServiceRequest&& req)
+                 { received.at(calls.fetch_add(1)).set_value(std::move(req)); },
+                 boost::asio::use_future)
+                 .get();
+
+  auto response =
+      c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future);
+  auto req = received[0].get_future().get();
+  GTEST_ASSERT_EQ(req.reply_to().has_value(), true);
+  GTEST_ASSERT_EQ(svc.statistics().in_flight, 1);
+
+  std::string reply = "reply";
+  req.respond(boost::asio::const_buffer(reply.data(), reply.size()));
+  GTEST_ASSERT_EQ(response.get().data(), reply);
+  GTEST_ASSERT_EQ(svc.statistics().in_flight, 0);
+
+  // the second request is destroyed without a reply
+  auto unanswered =
+      c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future);
+  {
+    auto dropped = received[1].get_future().get();
+    GTEST_ASSERT_EQ(svc.statistics().in_flight, 1);
+  }
+  const auto stats = svc.statistics();
+  GTEST_ASSERT_EQ(stats.requests, 2);
+  GTEST_ASSERT_EQ(stats.completed, 1);
+  GTEST_ASSERT_EQ(stats.errors, 1);
+  GTEST_ASSERT_EQ(stats.in_flight, 0);
+}
+
+/// Check that the handler is never called for more than max_in_flight requests at a time
+TEST_F(NatsFixture, ServiceMaxInFlight)
+{
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<async_nats::ServiceRequest> received;
+  auto svc = async_nats::start_service(
+                 c,
+                 async_nats::ServiceOptions("test_max_in_flight", subject).max_in_flight(2),
+                 [&](async_nats::ServiceRequest&& req)
+                 {
+                   const std::lock_guard<std::mutex> lock(mutex);
+                   received.push_back(std::move(req));
+                   cv.notify_all();
+                 },
+                 boost::asio::use_future)
+                 .get();
+
+  std::vector<std::future<async_nats::Message>> responses;
+  for (int i = 0; i < 3; ++i) {
+    responses.push_back(
+        c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  GTEST_ASSERT_TRUE(cv.wait_for(lock, test_timeout, [&] { return received.size() == 2; }));
+  GTEST_ASSERT_FALSE(cv.wait_for(lock, default_sleep, [&] { return received.size() > 2; }));
+  GTEST_ASSERT_EQ(svc.statistics().in_flight, 2);
+
+  // responding to one of the requests lets the queued one through
+  received[0].respond(boost::asio::const_buffer());
+  GTEST_ASSERT_TRUE(cv.wait_for(lock, test_timeout, [&] { return received.size() == 3; }));
+  GTEST_ASSERT_EQ(svc.statistics().in_flight, 2);
+  received[1].respond(boost::asio::const_buffer());
+  received[2].respond(boost::asio::const_buffer());
+  lock.unlock();
+
+  for (auto& response : responses) {
+    GTEST_ASSERT_EQ(response.wait_for(test_timeout), std::future_status::ready);
+    GTEST_ASSERT_EQ(response.get(), true);
+  }
+  GTEST_ASSERT_EQ(svc.statistics().completed, 3);
+  GTEST_ASSERT_EQ(svc.statistics().in_flight, 0);
+}
+
+/// Check that requests that waited in the queue for longer than the budget are shed with 503
+TEST_F(NatsFixture, ServiceQueueBudget)
+{
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  std::promise<async_nats::ServiceRequest> first;
+  std::atomic<int> calls {0};
+  auto svc = async_nats::start_service(c,
+                                       async_nats::ServiceOptions("test_queue_budget", subject)
+                                           .max_in_flight(1)
+                                           .queue_budget(default_sleep),
+                                       [&](async_nats::ServiceRequest&& req)
+                                       {
+                                         if (calls.fetch_add(1) == 0) {
+                                           first.set_value(std::move(req));
+                                         }
+                                       },
+                                       boost::asio::use_future)
+                 .get();
+
+  auto first_response =
+      c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future);
+  auto req = first.get_future().get();
+
+  // the second request waits for the permit held by the first one for longer than the budget
+  auto shed_response =
+      c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future);
+  std::this_thread::sleep_for(default_sleep * 5);
+  req.respond(boost::asio::const_buffer());
+  GTEST_ASSERT_EQ(first_response.get(), true);
+
+  GTEST_ASSERT_EQ(shed_response.wait_for(test_timeout), std::future_status::ready);
+  auto shed = shed_response.get();
+  GTEST_ASSERT_EQ(shed, true);
+  auto code = shed.headers().get_header("Nats-Service-Error-Code");
+  GTEST_ASSERT_TRUE(code.has_value());
+  GTEST_ASSERT_EQ(code->at(0), "503");
+
+  GTEST_ASSERT_EQ(calls.load(), 1);
+  auto stats = svc.statistics();
+  GTEST_ASSERT_EQ(stats.requests, 2);
+  GTEST_ASSERT_EQ(stats.shed, 1);
+  GTEST_ASSERT_EQ(stats.completed, 1);
+}
+
+/// Check that requests that do not fit into the queue are shed with 503
+TEST_F(NatsFixture, ServiceQueueFull)
+{
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  std::promise<async_nats::ServiceRequest> first;
+  std::atomic<int> calls {0};
+  auto svc = async_nats::start_service(
+                 c,
+                 async_nats::ServiceOptions("test_queue_full", subject)
+                     .max_in_flight(1)
+                     .max_queued(1),
+                 [&](async_nats::ServiceRequest&& req)
+                 {
+                   if (calls.fetch_add(1) == 0) {
+                     first.set_value(std::move(req));
+                   } else {
+                     req.respond(boost::asio::const_buffer());
+                   }
+                 },
+                 boost::asio::use_future)
+                 .get();
+
+  auto first_response =
+      c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future);
+  auto req = first.get_future().get();
+
+  // the second request waits for the permit, the third one fills the queue
+  std::vector<std::future<async_nats::Message>> queued;
+  for (int i = 0; i < 2; ++i) {
+    queued.push_back(
+        c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future));
+    std::this_thread::sleep_for(default_sleep);
+  }
+  auto shed_response =
+      c.request(subject.c_str(), boost::asio::const_buffer(), boost::asio::use_future);
+  GTEST_ASSERT_EQ(shed_response.wait_for(test_timeout), std::future_status::ready);
+  auto shed = shed_response.get();
+  auto code = shed.headers().get_header("Nats-Service-Error-Code");
+  GTEST_ASSERT_TRUE(code.has_value());
+  GTEST_ASSERT_EQ(code->at(0), "503");
+
+  req.respond(boost::asio::const_buffer());
+  GTEST_ASSERT_EQ(first_response.get(), true);
+  for (auto& response : queued) {
+    GTEST_ASSERT_EQ(response.wait_for(test_timeout), std::future_status::ready);
+    GTEST_ASSERT_FALSE(response.get().headers().get_header("Nats-Service-Error-Code"));
+  }
+
+  GTEST_ASSERT_EQ(calls.load(), 3);
+  auto stats = svc.statistics();
+  GTEST_ASSERT_EQ(stats.requests, 4);
+  GTEST_ASSERT_EQ(stats.shed, 1);
+  GTEST_ASSERT_EQ(stats.completed, 3);
+}
+
+/// Check that the statistics endpoint escapes the service name
+TEST_F(NatsFixture, ServiceStatsEscaping)
+{
+  const std::string subject(static_cast<std::string_view>(c.new_mailbox()));
+  auto svc = async_nats::start_service(
+                 c,
+                 async_nats::ServiceOptions("test_\"quoted\\", subject),
+                 [](const async_nats::Message&) { return std::string(); },
+                 boost::asio::use_future)
+                 .get();
+  GTEST_ASSERT_EQ(svc, true);
+
+  auto stats_reply = c.request("$SRV.STATS.test_\"quoted\\",
+                               boost::asio::const_buffer(),
+                               boost::asio::use_future)
+                         .get();
+  GTEST_ASSERT_NE(stats_reply.data().find(R"("name":"test_\"quoted\\")"), std::string_view::npos);
+}
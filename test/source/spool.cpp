@@ -0,0 +1,260 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <async_nats/testing/server.hpp>
+#include <boost/asio/system_executor.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+namespace
+{
+/// TempDirectory is removed with its content when it goes out of scope
+class TempDirectory
+{
+public:
+  explicit TempDirectory(const std::string& name)
+      : path_(std::filesystem::temp_directory_path() / name)
+  {
+    std::filesystem::remove_all(path_);
+  }
+
+  TempDirectory(const TempDirectory&) = delete;
+  TempDirectory& operator=(const TempDirectory&) = delete;
+
+  ~TempDirectory() { std::filesystem::remove_all(path_); }
+
+  std::string path() const { return path_.string(); }
+
+private:
+  std::filesystem::path path_;
+};
+
+using async_nats::nonblocking::Sender;
+using async_nats::nonblocking::SenderStatistics;
+
+SenderStatistics wait_drained(const Sender& sender)
+{
+  const auto deadline = std::chrono::steady_clock::now() + NatsFixture::test_timeout;
+  auto stats = sender.statistics();
+  while (stats.spool_pending != 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(NatsFixture::default_sleep);
+    stats = sender.statistics();
+  }
+  return stats;
+}
+
+/// connects to the server and stops it, the connection is returned once it is disconnected
+async_nats::Connection connect_and_stop(const async_nats::TokioRuntime& rt,
+                                        async_nats::testing::Server& server)
+{
+  auto disconnected = std::make_shared<std::promise<void>>();
+  auto result = disconnected->get_future();
+  async_nats::ConnectionOptions connection_options;
+  connection_options.address(server.url())
+      .on_event(boost::asio::system_executor(),
+                [disconnected](const async_nats::ConnectionEvent& event) mutable
+                {
+                  if (event.kind == AsyncNats_Event_Disconnected && disconnected) {
+                    disconnected->set_value();
+                    disconnected.reset();
+                  }
+                });
+  auto c = async_nats::connect(rt, connection_options, boost::asio::use_future).get();
+
+  server.stop();
+  if (result.wait_for(NatsFixture::test_timeout) != std::future_status::ready) {
+    throw std::runtime_error("the connection was not disconnected");
+  }
+  return c;
+}
+
+}  // namespace
+
+/// Check that messages that do not fit into the queue are spooled and published in order
+TEST_F(NatsFixture, SpoolOverCapacity)
+{
+#if defined(_WIN32)
+  GTEST_SKIP() << "the spool is not supported on Windows";
+#endif
+  const TempDirectory dir("async_nats_spool_over_capacity");
+  const auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  const async_nats::nonblocking::Sender sender(
+      std::string(static_cast<std::string_view>(m)),
+      c,
+      0,
+      async_nats::nonblocking::SpoolOptions(dir.path()).segment_size(4096).segments(4));
+  for (int i = 0; i < 100; ++i) {
+    const auto data = std::to_string(i);
+    GTEST_ASSERT_TRUE(sender.try_send(boost::asio::buffer(data)));
+  }
+  for (int i = 0; i < 100; ++i) {
+    auto msg = sub.receive(boost::asio::use_future);
+    GTEST_ASSERT_EQ(msg.wait_for(test_timeout), std::future_status::ready);
+    GTEST_ASSERT_EQ(msg.get().data(), std::to_string(i));
+  }
+
+  const auto stats = wait_drained(sender);
+  GTEST_ASSERT_EQ(stats.spooled, 100);
+  GTEST_ASSERT_EQ(stats.spool_replayed, 100);
+  GTEST_ASSERT_EQ(stats.spool_pending, 0);
+}
+
+/// Check that messages spooled during an outage survive the restart of the sender
+TEST(Spool, SurvivesRestart)
+{
+#if defined(_WIN32)
+  GTEST_SKIP() << "the spool is not supported on Windows";
+#endif
+  const TempDirectory dir("async_nats_spool_restart");
+  const auto options = async_nats::nonblocking::SpoolOptions(dir.path()).segment_size(4096);
+  const async_nats::TokioRuntime rt;
+  {
+    async_nats::testing::Server server;
+    auto c = connect_and_stop(rt, server);
+    const async_nats::nonblocking::Sender sender("audit", c, 128, options);
+    for (int i = 0; i < 10; ++i) {
+      const auto data = std::to_string(i);
+      GTEST_ASSERT_TRUE(sender.try_send(boost::asio::buffer(data)));
+    }
+    GTEST_ASSERT_EQ(sender.statistics().spool_pending, 10);
+  }
+
+  const async_nats::testing::Server server;
+  async_nats::ConnectionOptions connection_options;
+  connection_options.address(server.url());
+  auto c = async_nats::connect(rt, connection_options, boost::asio::use_future).get();
+  auto sub = c.subcribe("audit", boost::asio::use_future).get();
+
+  const async_nats::nonblocking::Sender sender("audit", c, 128, options);
+  for (int i = 0; i < 10; ++i) {
+    auto msg = sub.receive(boost::asio::use_future);
+    GTEST_ASSERT_EQ(msg.wait_for(NatsFixture::test_timeout), std::future_status::ready);
+    GTEST_ASSERT_EQ(msg.get().data(), std::to_string(i));
+  }
+  GTEST_ASSERT_EQ(wait_drained(sender).spool_replayed, 10);
+}
+
+/// Check that messages drained before a restart are not replayed with the ones spooled after it
+TEST(Spool, RestartAfterDrain)
+{
+#if defined(_WIN32)
+  GTEST_SKIP() << "the spool is not supported on Windows";
+#endif
+  const TempDirectory dir("async_nats_spool_restart_after_drain");
+  const auto options = async_nats::nonblocking::SpoolOptions(dir.path()).segment_size(4096);
+  const async_nats::TokioRuntime rt;
+  {
+    const async_nats::testing::Server server;
+    async_nats::ConnectionOptions connection_options;
+    connection_options.address(server.url());
+    auto c = async_nats::connect(rt, connection_options, boost::asio::use_future).get();
+    auto sub = c.subcribe("audit", boost::asio::use_future).get();
+
+    const async_nats::nonblocking::Sender sender("audit", c, 0, options);
+    for (int i = 0; i < 50; ++i) {
+      const auto data = "old-" + std::to_string(i);
+      GTEST_ASSERT_TRUE(sender.try_send(boost::asio::buffer(data)));
+    }
+    for (int i = 0; i < 50; ++i) {
+      auto msg = sub.receive(boost::asio::use_future);
+      GTEST_ASSERT_EQ(msg.wait_for(NatsFixture::test_timeout), std::future_status::ready);
+    }
+    GTEST_ASSERT_EQ(wait_drained(sender).spool_replayed, 50);
+  }
+  {
+    async_nats::testing::Server server;
+    auto c = connect_and_stop(rt, server);
+    const async_nats::nonblocking::Sender sender("audit", c, 128, options);
+    for (int i = 0; i < 5; ++i) {
+      const auto data = "new-" + std::to_string(i);
+      GTEST_ASSERT_TRUE(sender.try_send(boost::asio::buffer(data)));
+    }
+    GTEST_ASSERT_EQ(sender.statistics().spool_pending, 5);
+  }
+
+  const async_nats::testing::Server server;
+  async_nats::ConnectionOptions connection_options;
+  connection_options.address(server.url());
+  auto c = async_nats::connect(rt, connection_options, boost::asio::use_future).get();
+  auto sub = c.subcribe("audit", boost::asio::use_future).get();
+
+  const async_nats::nonblocking::Sender sender("audit", c, 128, options);
+  for (int i = 0; i < 5; ++i) {
+    auto msg = sub.receive(boost::asio::use_future);
+    GTEST_ASSERT_EQ(msg.wait_for(NatsFixture::test_timeout), std::future_status::ready);
+    GTEST_ASSERT_EQ(msg.get().data(), "new-" + std::to_string(i));
+  }
+  GTEST_ASSERT_EQ(wait_drained(sender).spool_replayed, 5);
+}
+
+/// Check that a directory can not be used by two spools at the same time
+TEST_F(NatsFixture, SpoolExclusiveDirectory)
+{
+#if defined(_WIN32)
+  GTEST_SKIP() << "the spool is not supported on Windows";
+#endif
+  const TempDirectory dir("async_nats_spool_exclusive");
+  const async_nats::nonblocking::SpoolOptions options(dir.path());
+  {
+    const async_nats::nonblocking::Sender sender("audit", c, 128, options);
+    ASSERT_THROW(async_nats::nonblocking::Sender("audit", c, 128, options),
+                 async_nats::nonblocking::SpoolError);
+  }
+
+  // the directory is released with the sender
+  const async_nats::nonblocking::Sender sender("audit", c, 128, options);
+}
+
+/// Check that messages in segments beyond the configured count are not silently ignored
+TEST(Spool, FewerSegments)
+{
+#if defined(_WIN32)
+  GTEST_SKIP() << "the spool is not supported on Windows";
+#endif
+  const TempDirectory dir("async_nats_spool_fewer_segments");
+  const auto options = [&](uint64_t segments)
+  {
+    return async_nats::nonblocking::SpoolOptions(dir.path()).segment_size(4096).segments(
+        segments);
+  };
+  const async_nats::TokioRuntime rt;
+  async_nats::testing::Server server;
+  auto c = connect_and_stop(rt, server);
+  {
+    const async_nats::nonblocking::Sender sender("audit", c, 128, options(4));
+    // 18 messages fit into a segment, so the messages take 3 segments
+    const std::string data(200, 'x');
+    for (int i = 0; i < 50; ++i) {
+      GTEST_ASSERT_TRUE(sender.try_send(boost::asio::buffer(data)));
+    }
+  }
+
+  ASSERT_THROW(async_nats::nonblocking::Sender("audit", c, 128, options(2)),
+               async_nats::nonblocking::SpoolError);
+  const async_nats::nonblocking::Sender sender("audit", c, 128, options(4));
+  GTEST_ASSERT_EQ(sender.statistics().spool_pending, 50);
+}
+
+/// Check that a spool in a directory that can not be created is reported
+TEST_F(NatsFixture, SpoolOpenError)
+{
+  const TempDirectory dir("async_nats_spool_error");
+  std::filesystem::create_directories(std::filesystem::path(dir.path()).parent_path());
+  {
+    std::ofstream file(dir.path());
+  }
+  ASSERT_THROW(
+      async_nats::nonblocking::Sender(
+          "audit", c, 128, async_nats::nonblocking::SpoolOptions(dir.path() + "/spool")),
+      async_nats::nonblocking::SpoolError);
+}
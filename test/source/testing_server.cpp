@@ -0,0 +1,200 @@
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <async_nats/testing/server.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+namespace
+{
+async_nats::Connection connect(const async_nats::TokioRuntime& rt,
+                               const async_nats::testing::Server& server)
+{
+  async_nats::ConnectionOptions options;
+  options.address(server.url());
+  return async_nats::connect(rt, options, boost::asio::use_future).get();
+}
+
+/// RawClient speaks the protocol directly to check exactly what the server sends
+class RawClient
+{
+public:
+  explicit RawClient(const async_nats::testing::Server& server)
+      : socket_(io_)
+  {
+    socket_.connect({boost::asio::ip::address_v4::loopback(), server.port()});
+  }
+
+  void send(std::string_view data) { boost::asio::write(socket_, boost::asio::buffer(data)); }
+
+  /// sends PING and returns everything the server sent before the PONG
+  std::string sync()
+  {
+    constexpr std::string_view pong = "PONG\r\n";
+    send("PING\r\n");
+    const auto n = boost::asio::read_until(socket_, boost::asio::dynamic_buffer(input_), pong);
+    auto received = input_.substr(0, n - pong.size());
+    input_.erase(0, n);
+    return received;
+  }
+
+private:
+  boost::asio::io_context io_;
+  boost::asio::ip::tcp::socket socket_;
+  std::string input_;
+};
+
+std::size_t count(std::string_view text, std::string_view what)
+{
+  std::size_t n = 0;
+  for (auto pos = text.find(what); pos != std::string_view::npos; pos = text.find(what, pos + 1)) {
+    ++n;
+  }
+  return n;
+}
+
+}  // namespace
+
+TEST(TestingServer, SubjectMatches)
+{
+  using async_nats::testing::detail::subject_matches;
+  GTEST_ASSERT_TRUE(subject_matches("a.b.c", "a.b.c"));
+  GTEST_ASSERT_TRUE(subject_matches("a.*.c", "a.b.c"));
+  GTEST_ASSERT_TRUE(subject_matches("a.>", "a.b.c"));
+  GTEST_ASSERT_TRUE(subject_matches(">", "a"));
+  GTEST_ASSERT_FALSE(subject_matches("a.b", "a.b.c"));
+  GTEST_ASSERT_FALSE(subject_matches("a.b.c", "a.b"));
+  GTEST_ASSERT_FALSE(subject_matches("a.>", "a"));
+  GTEST_ASSERT_FALSE(subject_matches("a.*", "b.c"));
+}
+
+/// Check that wildcard subscribtions receive the matching messages only
+TEST(TestingServer, Wildcards)
+{
+  const async_nats::TokioRuntime rt;
+  const async_nats::testing::Server server;
+  auto c = connect(rt, server);
+
+  auto single = c.subcribe("orders.*.created", boost::asio::use_future).get();
+  auto full = c.subcribe("orders.>", boost::asio::use_future).get();
+
+  const std::string created = "created";
+  const std::string deleted = "deleted";
+  c.publish("orders.eu.deleted", boost::asio::buffer(deleted), boost::asio::use_future).get();
+  c.publish("orders.eu.created", boost::asio::buffer(created), boost::asio::use_future).get();
+
+  auto msg = single.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg.data(), created);
+  msg = full.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg.data(), deleted);
+  msg = full.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg.data(), created);
+}
+
+/// Check that the injected latency is added to every message the server delivers
+TEST(TestingServer, Latency)
+{
+  constexpr auto latency = std::chrono::milliseconds(50);
+  const async_nats::TokioRuntime rt;
+  const async_nats::testing::Server server(async_nats::testing::ServerOptions().latency(latency));
+  auto c = connect(rt, server);
+
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  const std::string data = "test";
+  const auto start = std::chrono::steady_clock::now();
+  auto req = c.request(m, boost::asio::buffer(data), boost::asio::use_future);
+  auto msg = sub.receive(boost::asio::use_future).get();
+  c.publish(msg.reply_to().value(), boost::asio::buffer(data), boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(req.get().data(), data);
+
+  GTEST_ASSERT_GE(std::chrono::steady_clock::now() - start, 2 * latency);
+}
+
+/// Check that the bandwidth limit slows down the delivery of big messages
+TEST(TestingServer, Bandwidth)
+{
+  const async_nats::TokioRuntime rt;
+  const async_nats::testing::Server server(
+      async_nats::testing::ServerOptions().bandwidth(256 * 1024));
+  auto c = connect(rt, server);
+
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+
+  const std::string data(64 * 1024, 'x');
+  const auto start = std::chrono::steady_clock::now();
+  c.publish(m, boost::asio::buffer(data), boost::asio::use_future).get();
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg.data().size(), data.size());
+
+  GTEST_ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+}
+
+/// Check that every queue group gets one copy of a message and plain subscribtions get all
+TEST(TestingServer, QueueGroups)
+{
+  const async_nats::testing::Server server;
+  RawClient client(server);
+  client.send("CONNECT {\"verbose\":false}\r\nSUB q.x grp 1\r\nSUB q.x grp 2\r\nSUB q.x 3\r\n");
+  for (int i = 0; i < 10; ++i) {
+    client.send("PUB q.x 2\r\nhi\r\n");
+  }
+
+  const auto received = client.sync();
+  GTEST_ASSERT_EQ(count(received, "MSG q.x 1 2\r\n") + count(received, "MSG q.x 2 2\r\n"), 10);
+  GTEST_ASSERT_EQ(count(received, "MSG q.x 3 2\r\n"), 10);
+}
+
+/// Check that messages with headers are delivered as HMSG with the header and total sizes
+TEST(TestingServer, Headers)
+{
+  const async_nats::testing::Server server;
+  RawClient client(server);
+  client.send("CONNECT {\"verbose\":false,\"headers\":true}\r\nSUB h 1\r\n");
+  client.send("HPUB h 12 14\r\nNATS/1.0\r\n\r\nhi\r\n");
+  client.send("HPUB h r 12 14\r\nNATS/1.0\r\n\r\nhi\r\n");
+
+  const auto received = client.sync();
+  GTEST_ASSERT_EQ(count(received, "HMSG h 1 12 14\r\nNATS/1.0\r\n\r\nhi\r\n"), 1);
+  GTEST_ASSERT_EQ(count(received, "HMSG h 1 r 12 14\r\nNATS/1.0\r\n\r\nhi\r\n"), 1);
+}
+
+/// Check that a request without subscribers gets a 503 status if the client asked for it
+TEST(TestingServer, NoResponders)
+{
+  const async_nats::testing::Server server;
+  RawClient client(server);
+  client.send("CONNECT {\"verbose\":false,\"headers\":true,\"no_responders\":true}\r\n"
+              "SUB inbox.> 1\r\nPUB nobody inbox.1 2\r\nhi\r\nPUB nobody 2\r\nhi\r\n");
+
+  // a publish without a reply subject gets no status
+  const auto received = client.sync();
+  GTEST_ASSERT_EQ(received.substr(received.find("\r\n") + 2),
+                  "HMSG inbox.1 1 16 16\r\nNATS/1.0 503\r\n\r\n\r\n");
+}
+
+/// Check that UNSUB with a limit counts the messages that were already delivered
+TEST(TestingServer, UnsubscribeAfter)
+{
+  const async_nats::testing::Server server;
+  RawClient client(server);
+  client.send("CONNECT {\"verbose\":false}\r\nSUB u 1\r\nSUB v 2\r\n");
+  client.send("PUB u 2\r\nhi\r\nPUB u 2\r\nhi\r\nPUB v 2\r\nhi\r\nPUB v 2\r\nhi\r\n");
+  // 2 of 3 messages are delivered, one more is allowed
+  client.send("UNSUB 1 3\r\n");
+  // the limit is already reached so the subscribtion is removed at once
+  client.send("UNSUB 2 1\r\n");
+  for (int i = 0; i < 3; ++i) {
+    client.send("PUB u 2\r\nhi\r\nPUB v 2\r\nhi\r\n");
+  }
+
+  const auto received = client.sync();
+  GTEST_ASSERT_EQ(count(received, "MSG u 1 2\r\n"), 3);
+  GTEST_ASSERT_EQ(count(received, "MSG v 2 2\r\n"), 2);
+}
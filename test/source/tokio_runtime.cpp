@@ -0,0 +1,250 @@
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include "nats_fixture.hpp"
+
+/// Check that a tuned current-thread runtime pinned to a CPU handles messaging
+TEST(TokioRuntime, CurrentThreadFlavor)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.flavor(AsyncNats_Runtime_CurrentThread)
+      .event_interval(31)
+      .global_queue_interval(61)
+      .max_blocking_threads(4)
+      .thread_keep_alive(std::chrono::seconds(1))
+      .cpu_affinity({0});
+  async_nats::TokioRuntime rt(config);
+
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+  auto c = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+  std::string data = "test";
+  c.publish(m, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+
+  auto msg = sub.receive(boost::asio::use_future).get();
+  GTEST_ASSERT_EQ(msg, true);
+  GTEST_ASSERT_EQ(msg.data(), data);
+}
+
+/// Check that caller-driven runtime works inside io_context and calls handlers on its thread
+TEST(TokioRuntime, CallerDriven)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.flavor(AsyncNats_Runtime_CallerDriven);
+  async_nats::TokioRuntime rt(config);
+
+  boost::asio::io_context ioc;
+  async_nats::IoContextDriver driver(ioc.get_executor(), rt);
+
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+
+  const std::string data = "test";
+  const auto thread = std::this_thread::get_id();
+  async_nats::Connection conn;
+  async_nats::Subscribtion sub;
+  std::string received;
+  bool same_thread = true;
+
+  async_nats::connect(
+      rt,
+      options,
+      [&](std::exception_ptr err, async_nats::Connection c)
+      {
+        GTEST_ASSERT_EQ(err, nullptr);
+        same_thread = same_thread && std::this_thread::get_id() == thread;
+        conn = std::move(c);
+        auto m = std::make_shared<async_nats::OwnedString>(conn.new_mailbox());
+        conn.subcribe(
+            *m,
+            [&, m](async_nats::Subscribtion s)
+            {
+              same_thread = same_thread && std::this_thread::get_id() == thread;
+              sub = std::move(s);
+              sub.receive(
+                  [&](async_nats::Message msg)
+                  {
+                    same_thread = same_thread && std::this_thread::get_id() == thread;
+                    received = std::string(msg.data());
+                    driver.stop();
+                  });
+              conn.publish(*m, boost::asio::const_buffer(data.data(), data.size()), [] {});
+            });
+      });
+
+  ioc.run_for(std::chrono::seconds(10));
+  GTEST_ASSERT_EQ(received, data);
+  GTEST_ASSERT_EQ(same_thread, true);
+}
+
+/// Check that a single poll runs the tasks woken by the I/O it processed
+TEST_F(NatsFixture, CallerDrivenSinglePoll)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.flavor(AsyncNats_Runtime_CallerDriven);
+  const async_nats::TokioRuntime driven(config);
+
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+
+  const auto drive_until = [&](const auto& done)
+  {
+    const auto deadline = std::chrono::steady_clock::now() + test_timeout;
+    while (!done() && std::chrono::steady_clock::now() < deadline) {
+      driven.poll_for(std::chrono::milliseconds(1));
+    }
+    return done();
+  };
+
+  async_nats::Connection conn;
+  async_nats::connect(driven,
+                      options,
+                      [&](std::exception_ptr err, async_nats::Connection connected)
+                      {
+                        GTEST_ASSERT_EQ(err, nullptr);
+                        conn = std::move(connected);
+                      });
+  ASSERT_TRUE(drive_until([&] { return static_cast<bool>(conn); }));
+
+  const auto subject = std::make_shared<async_nats::OwnedString>(conn.new_mailbox());
+  async_nats::Subscribtion sub;
+  conn.subcribe(*subject, [&](async_nats::Subscribtion s) { sub = std::move(s); });
+  ASSERT_TRUE(drive_until([&] { return static_cast<bool>(sub); }));
+
+  std::string received;
+  sub.receive([&](async_nats::Message msg) { received = std::string(msg.data()); });
+  // flush SUB to the server and let the receive task wait for the message
+  driven.poll_for(default_sleep);
+
+  const std::string data = "test";
+  c.publish(*subject, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .wait_for(test_timeout);
+  std::this_thread::sleep_for(default_sleep);
+
+  driven.poll();
+  GTEST_ASSERT_EQ(received, data);
+}
+
+/// Check that assigning a driver stops the poll loop of the replaced one
+TEST(TokioRuntime, IoContextDriverMoveAssignment)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.flavor(AsyncNats_Runtime_CallerDriven);
+  auto replaced = std::make_unique<async_nats::TokioRuntime>(config);
+  const async_nats::TokioRuntime rt(config);
+
+  boost::asio::io_context ioc;
+  async_nats::IoContextDriver driver(ioc.get_executor(), *replaced);
+  driver = async_nats::IoContextDriver(ioc.get_executor(), rt);
+  // the replaced loop would poll a destroyed runtime
+  replaced.reset();
+
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+
+  bool connected = false;
+  async_nats::connect(rt,
+                      options,
+                      [&](std::exception_ptr err, const async_nats::Connection&)
+                      {
+                        GTEST_ASSERT_EQ(err, nullptr);
+                        connected = true;
+                        driver.stop();
+                      });
+
+  ioc.run_for(std::chrono::seconds(1));
+  GTEST_ASSERT_EQ(connected, true);
+}
+
+/// Check that runtime metrics snapshot is consistent with the runtime configuration
+TEST(TokioRuntime, Metrics)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.thread_count(2);
+  async_nats::TokioRuntime rt(config);
+
+  async_nats::ConnectionOptions options;
+  options.address(NatsFixture::server_url());
+  auto c = async_nats::connect(rt, options, boost::asio::use_future).get();
+
+  const auto before = rt.metrics();
+  if (!before.available) {
+    GTEST_ASSERT_EQ(before.workers.empty(), true);
+    GTEST_SKIP() << "built without ASYNC_NATS_RUNTIME_METRICS";
+  }
+
+  auto m = c.new_mailbox();
+  auto sub = c.subcribe(m, boost::asio::use_future).get();
+  std::string data = "test";
+  c.publish(m, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+  sub.receive(boost::asio::use_future).get();
+
+  const auto after = rt.metrics();
+  GTEST_ASSERT_EQ(after.workers.size(), 2);
+  GTEST_ASSERT_GT(after.polls(), before.polls());
+  GTEST_ASSERT_GT(after.scheduled(), 0);
+}
+
+/// Check that CPUs beyond the affinity mask are rejected instead of aborting a runtime thread
+TEST(TokioRuntime, CpuAffinityOutOfRange)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.thread_count(1);
+  ASSERT_THROW(config.cpu_affinity({0, std::size_t {1} << 20}), std::out_of_range);
+
+  // the rejected set is not applied
+  const async_nats::TokioRuntime rt(config);
+  GTEST_ASSERT_EQ(rt.metrics().affinity_failures, 0);
+}
+
+/// Check that a zero global queue interval is rejected instead of aborting the runtime builder
+TEST(TokioRuntime, ZeroGlobalQueueInterval)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.thread_count(1);
+  ASSERT_THROW(config.global_queue_interval(0), std::invalid_argument);
+
+  // the rejected interval is not applied
+  const async_nats::TokioRuntime rt(config);
+  GTEST_ASSERT_NE(rt.get_raw(), nullptr);
+}
+
+/// Check that a zero blocking thread limit is rejected instead of aborting the runtime builder
+TEST(TokioRuntime, ZeroMaxBlockingThreads)
+{
+  async_nats::TokioRuntimeConfig config;
+  config.thread_count(1);
+  ASSERT_THROW(config.max_blocking_threads(0), std::invalid_argument);
+
+  // the rejected limit is not applied
+  const async_nats::TokioRuntime rt(config);
+  GTEST_ASSERT_NE(rt.get_raw(), nullptr);
+}
+
+/// Check that a copy of a moved-from config is moved-from as well instead of crashing
+TEST(TokioRuntime, CopyMovedFromConfig)
+{
+  async_nats::TokioRuntimeConfig config;
+  const async_nats::TokioRuntimeConfig moved(std::move(config));
+  // NOLINTNEXTLINE(bugprone-use-after-move)
+  async_nats::TokioRuntimeConfig copy(config);
+  GTEST_ASSERT_EQ(copy.get_raw(), nullptr);
+  copy = moved;
+  GTEST_ASSERT_NE(copy.get_raw(), nullptr);
+  // NOLINTNEXTLINE(bugprone-use-after-move)
+  copy = config;
+  GTEST_ASSERT_EQ(copy.get_raw(), nullptr);
+}
@@ -0,0 +1,76 @@
+#if defined(ASYNC_NATS_TRACE_HOOKS)
+
+#  include <cstdint>
+#  include <mutex>
+#  include <string>
+#  include <vector>
+
+#  include <boost/asio/use_future.hpp>
+
+#  include "nats_fixture.hpp"
+
+namespace
+{
+struct Recorded
+{
+  async_nats::TraceStage stage;
+  std::uint64_t id;
+  std::uint64_t timestamp_ns;
+  std::string subject;
+};
+
+std::mutex events_mutex;
+std::vector<Recorded> events;
+
+void record(const async_nats::TraceEvent* event, void* /*ctx*/)
+{
+  const std::lock_guard lock(events_mutex);
+  events.push_back({event->stage,
+                    event->id,
+                    event->timestamp_ns,
+                    std::string(async_nats::subject(*event))});
+}
+
+}  // namespace
+
+/// Check that a publish reports every stage in order with the same id
+TEST_F(NatsFixture, TracePublishStages)
+{
+  {
+    const std::lock_guard lock(events_mutex);
+    events.clear();
+  }
+  async_nats::set_trace_hook(record);
+
+  const std::string subject = "trace.publish";
+  std::string data = "test";
+  c.publish(subject, boost::asio::const_buffer(data.data(), data.size()), boost::asio::use_future)
+      .get();
+  async_nats::set_trace_hook(nullptr);
+
+  const std::lock_guard lock(events_mutex);
+  ASSERT_FALSE(events.empty());
+  GTEST_ASSERT_EQ(events.front().stage, AsyncNats_Trace_Initiate);
+  GTEST_ASSERT_EQ(events.front().subject, subject);
+
+  const auto id = events.front().id;
+  std::vector<async_nats::TraceStage> stages;
+  std::uint64_t last = 0;
+  for (const auto& e : events) {
+    if (e.id != id) {
+      continue;
+    }
+    GTEST_ASSERT_GE(e.timestamp_ns, last);
+    last = e.timestamp_ns;
+    stages.push_back(e.stage);
+  }
+
+  const std::vector<async_nats::TraceStage> expected {AsyncNats_Trace_Initiate,
+                                                      AsyncNats_Trace_FfiEntry,
+                                                      AsyncNats_Trace_TaskStart,
+                                                      AsyncNats_Trace_Enqueue,
+                                                      AsyncNats_Trace_Handler};
+  GTEST_ASSERT_EQ(stages, expected);
+}
+
+#endif